@@ -49,7 +49,7 @@ struct Vertex
 struct FrameBuffer
 {
 public:
-	FrameBuffer(ID3D12Device* device, UINT commonCount, UINT objectCount, UINT materialCount);
+	FrameBuffer(ID3D12Device* device, GpuMemoryAllocator* allocator, UINT objectCount, UINT materialCount);
 	FrameBuffer(const FrameBuffer& rhs) = delete;
 	FrameBuffer& operator=(const FrameBuffer & rhs) = delete;
 	~FrameBuffer();
@@ -57,10 +57,12 @@ public:
 public:
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
-	std::unique_ptr<UploadBuffer<CommonConstants>> CommonCB = nullptr;
 	std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;		// MaterialConstants is defined in d3dUtil.h
 	std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
 
+	// per-pass constants and dynamic vertices are not stored here; they are suballocated
+	// from the frame ring allocator (FrameRingAllocator.h) every frame.
+
 	UINT64 Fence = 0;
 };
 
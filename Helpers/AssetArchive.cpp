@@ -0,0 +1,252 @@
+//***************************************************************************************
+// AssetArchive.cpp
+//***************************************************************************************
+
+#include "AssetArchive.h"
+#include "ContentHash.h"
+#include "Lz4Block.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+	template<typename Char>
+	bool Normalize(const Char* name, std::string& normalized)
+	{
+		normalized.clear();
+		if (name == nullptr)
+			return false;
+
+		for (; *name != 0; ++name)
+		{
+			if (*name < 0 || *name >= 0x80)
+				return false;
+
+			char c = (char)*name;
+			if (c == '\\')
+				c = '/';
+			else if (c >= 'A' && c <= 'Z')
+				c = (char)(c - 'A' + 'a');
+
+			// "./" at the start, and doubled slashes, name nothing.
+			if (c == '/' && (normalized.empty() || normalized.back() == '/'))
+				continue;
+			if (c == '.' && normalized.empty() && (name[1] == '/' || name[1] == '\\'))
+				continue;
+			normalized.push_back(c);
+		}
+		return !normalized.empty();
+	}
+}
+
+bool NormalizeArchiveName(const char* name, std::string& normalized)
+{
+	return Normalize(name, normalized);
+}
+
+bool NormalizeArchiveName(const wchar_t* name, std::string& normalized)
+{
+	return Normalize(name, normalized);
+}
+
+std::uint64_t ArchiveNameHash(const std::string& normalized)
+{
+	return ContentHash64(normalized.data(), normalized.size());
+}
+
+#if defined(_WIN32)
+
+bool AssetArchive::Open(const wchar_t* fileName)
+{
+	Close();
+	return mFile.Open(fileName) && CheckContents();
+}
+
+#endif
+
+bool AssetArchive::Open(const char* fileName)
+{
+	Close();
+	return mFile.Open(fileName) && CheckContents();
+}
+
+void AssetArchive::Close()
+{
+	mFile.Close();
+	mHeader = nullptr;
+	mEntries = nullptr;
+	mNames = nullptr;
+	mEntryCount = 0;
+}
+
+bool AssetArchive::CheckContents()
+{
+	// everything the lookups rely on is checked once here, so they need no checks later.
+	const std::uint64_t fileSize = mFile.Size();
+	const std::uint8_t* data = mFile.Data();
+	if (fileSize < sizeof(ArchiveHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const ArchiveHeader* header = reinterpret_cast<const ArchiveHeader*>(data);
+	const std::uint64_t tocEnd = sizeof(ArchiveHeader) + (std::uint64_t)header->EntryCount * sizeof(ArchiveEntry);
+	if (header->Magic != ArchiveHeader::Signature || header->Version != ArchiveHeader::CurrentVersion ||
+		header->BlockSize == 0 || tocEnd > fileSize ||
+		header->NamesOffset < tocEnd || header->NamesOffset > fileSize ||
+		header->NamesSize > fileSize - header->NamesOffset)
+	{
+		Close();
+		return false;
+	}
+
+	const ArchiveEntry* entries = reinterpret_cast<const ArchiveEntry*>(data + sizeof(ArchiveHeader));
+	for (std::uint32_t i = 0; i < header->EntryCount; ++i)
+	{
+		const ArchiveEntry& entry = entries[i];
+		bool valid = entry.Offset <= fileSize && entry.StoredSize <= fileSize - entry.Offset &&
+			(std::uint64_t)entry.NameOffset + entry.NameLength <= header->NamesSize &&
+			(i == 0 || entries[i - 1].NameHash <= entry.NameHash);
+
+		if (entry.Compression == ArchiveCompression::None)
+			valid = valid && entry.StoredSize == entry.Size;
+		else if (entry.Compression != ArchiveCompression::Lz4)
+			valid = false;
+
+		if (!valid || entry.Size > SIZE_MAX)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	mHeader = header;
+	mEntries = entries;
+	mNames = reinterpret_cast<const char*>(data + header->NamesOffset);
+	mEntryCount = header->EntryCount;
+	return true;
+}
+
+void AssetArchive::PrefetchAll()const
+{
+	mFile.Prefetch(0, mFile.Size());
+}
+
+std::uint32_t AssetArchive::Find(const char* name)const
+{
+	std::string normalized;
+	return NormalizeArchiveName(name, normalized) ? FindNormalized(normalized) : NotFound;
+}
+
+std::uint32_t AssetArchive::Find(const wchar_t* name)const
+{
+	std::string normalized;
+	return NormalizeArchiveName(name, normalized) ? FindNormalized(normalized) : NotFound;
+}
+
+std::uint32_t AssetArchive::FindNormalized(const std::string& normalized)const
+{
+	if (mEntries == nullptr)
+		return NotFound;
+
+	// binary search on the hash, then the names of the (rare) entries sharing it.
+	const std::uint64_t hash = ArchiveNameHash(normalized);
+	const ArchiveEntry* end = mEntries + mEntryCount;
+	const ArchiveEntry* it = std::lower_bound(mEntries, end, hash,
+		[](const ArchiveEntry& entry, std::uint64_t value) { return entry.NameHash < value; });
+
+	for (; it != end && it->NameHash == hash; ++it)
+	{
+		if (it->NameLength == normalized.size() &&
+			std::memcmp(mNames + it->NameOffset, normalized.data(), normalized.size()) == 0)
+		{
+			return (std::uint32_t)(it - mEntries);
+		}
+	}
+	return NotFound;
+}
+
+std::string AssetArchive::Name(std::uint32_t entry)const
+{
+	return std::string(mNames + mEntries[entry].NameOffset, mEntries[entry].NameLength);
+}
+
+bool AssetArchive::Map(std::uint32_t entry, ArchiveSpan& span)const
+{
+	const ArchiveEntry& e = mEntries[entry];
+	if (e.Compression != ArchiveCompression::None)
+		return false;
+
+	span.Data = mFile.Data() + e.Offset;
+	span.Size = (std::size_t)e.Size;
+	return true;
+}
+
+void AssetArchive::Prefetch(const ArchiveSpan& span)const
+{
+	if (span.Data != nullptr)
+		mFile.Prefetch((std::uint64_t)(span.Data - mFile.Data()), span.Size);
+}
+
+bool AssetArchive::Read(std::uint32_t entry, std::vector<std::uint8_t>& data)const
+{
+	const ArchiveEntry& e = mEntries[entry];
+	const std::uint8_t* stored = mFile.Data() + e.Offset;
+	data.resize((std::size_t)e.Size);
+
+	if (e.Compression == ArchiveCompression::None)
+	{
+		if (e.Size != 0)
+			std::memcpy(data.data(), stored, (std::size_t)e.Size);
+		return true;
+	}
+
+	// the block table, then the blocks one after another.
+	const std::uint64_t blockSize = mHeader->BlockSize;
+	const std::size_t blockCount = (std::size_t)((e.Size + blockSize - 1) / blockSize);
+	const std::uint64_t tableSize = (std::uint64_t)blockCount * sizeof(std::uint32_t);
+	if (tableSize > e.StoredSize)
+		return false;
+
+	std::vector<std::uint64_t> offsets(blockCount + 1);
+	offsets[0] = tableSize;
+	for (std::size_t i = 0; i < blockCount; ++i)
+	{
+		std::uint32_t size;
+		std::memcpy(&size, stored + i * sizeof(std::uint32_t), sizeof(size));
+		offsets[i + 1] = offsets[i] + (size & ~ArchiveEntry::RawBlock);
+	}
+	if (offsets[blockCount] != e.StoredSize)
+		return false;
+
+	std::atomic<bool> damaged(false);
+	ParallelFor(blockCount, 1, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			std::uint32_t flags;
+			std::memcpy(&flags, stored + i * sizeof(std::uint32_t), sizeof(flags));
+
+			const std::uint8_t* src = stored + offsets[i];
+			const std::size_t srcSize = (std::size_t)(offsets[i + 1] - offsets[i]);
+			std::uint8_t* dest = data.data() + i * blockSize;
+			const std::size_t size = (std::size_t)std::min<std::uint64_t>(blockSize, e.Size - i * blockSize);
+
+			if (flags & ArchiveEntry::RawBlock)
+			{
+				if (srcSize != size)
+					damaged = true;
+				else
+					std::memcpy(dest, src, size);
+			}
+			else if (!Lz4Decompress(src, srcSize, dest, size))
+			{
+				damaged = true;
+			}
+		}
+	});
+	return !damaged;
+}
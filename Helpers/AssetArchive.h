@@ -0,0 +1,141 @@
+//***************************************************************************************
+// AssetArchive.h
+//
+// Read access to a packed asset archive (.pak, written by AssetArchiveWriter), so the
+// demo opens one file at startup instead of every texture and shader on its own.  The
+// archive is mapped (MappedFile) and used in place: the table of contents is an array
+// of fixed-size entries sorted by the hash of their names, searched without being
+// parsed or copied, and an uncompressed entry is handed out as a span of the mapping.
+// Prefetching the whole archive turns cold-start I/O into one sequential read.
+//
+// Layout (little-endian):
+//		ArchiveHeader
+//		ArchiveEntry[EntryCount]		sorted by NameHash
+//		names							EntryCount names, not NUL-terminated
+//		payloads						each starting on a multiple of the alignment
+//
+// A compressed payload (ArchiveCompression::Lz4) is a table of one UINT32 per block
+// (the block's stored size, RawBlock set when it is stored uncompressed) followed by the
+// blocks.  Every block but the last holds BlockSize bytes of the entry and decompresses
+// on its own, so the blocks of an entry are decompressed in parallel (ParallelFor).
+//
+// Names are relative ASCII paths; case and the direction of slashes do not matter, so
+// "Textures\\Grass.dds" finds the entry stored as "textures/grass.dds".
+//
+// No Direct3D dependency (the Windows build only needs the Win32 API).  Once open, the
+// archive may be read from any number of threads.
+//***************************************************************************************
+
+#pragma once
+
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+enum class ArchiveCompression : std::uint32_t
+{
+	None = 0,
+	Lz4 = 1,
+};
+
+struct ArchiveHeader
+{
+	static const std::uint32_t Signature = 0x4B415041;		// 'APAK'
+	static const std::uint32_t CurrentVersion = 1;
+
+	std::uint32_t Magic = Signature;
+	std::uint32_t Version = CurrentVersion;
+	std::uint32_t EntryCount = 0;
+	std::uint32_t BlockSize = 0;			// uncompressed bytes per compressed block
+	std::uint64_t NamesOffset = 0;
+	std::uint64_t NamesSize = 0;
+};
+
+struct ArchiveEntry
+{
+	static const std::uint32_t RawBlock = 0x80000000;		// in a block table: stored uncompressed
+
+	std::uint64_t NameHash = 0;				// ArchiveNameHash of the name
+	std::uint64_t ContentHash = 0;			// ContentHash64 of the uncompressed contents
+	std::uint64_t Offset = 0;				// of the payload, from the start of the file
+	std::uint64_t StoredSize = 0;			// payload bytes in the file
+	std::uint64_t Size = 0;					// uncompressed bytes
+	std::uint32_t NameOffset = 0;			// into the names
+	std::uint32_t NameLength = 0;
+	ArchiveCompression Compression = ArchiveCompression::None;
+	std::uint32_t Reserved = 0;
+};
+
+static_assert(sizeof(ArchiveHeader) == 32, "the header is part of the file format");
+static_assert(sizeof(ArchiveEntry) == 56, "the entries are part of the file format");
+
+struct ArchiveSpan
+{
+	const std::uint8_t* Data = nullptr;
+	std::size_t Size = 0;
+};
+
+// The name as it is stored (lower case, forward slashes, no leading "./"); false for a
+// name that is empty or not ASCII.
+bool NormalizeArchiveName(const char* name, std::string& normalized);
+bool NormalizeArchiveName(const wchar_t* name, std::string& normalized);
+
+// Hash of a normalized name.
+std::uint64_t ArchiveNameHash(const std::string& normalized);
+
+class AssetArchive
+{
+public:
+	static const std::uint32_t NotFound = UINT32_MAX;
+
+public:
+	AssetArchive() = default;
+	AssetArchive(const AssetArchive& rhs) = delete;
+	AssetArchive& operator=(const AssetArchive& rhs) = delete;
+
+	// Maps the archive and checks its table of contents; false if it cannot be mapped
+	// (LastError() tells why) or is not an archive (LastError() is 0).
+#if defined(_WIN32)
+	bool Open(const wchar_t* fileName);
+#endif
+	bool Open(const char* fileName);
+	void Close();
+
+	// Hints that the whole archive is about to be read, front to back.
+	void PrefetchAll()const;
+
+	// The entry stored under 'name', or NotFound.
+	std::uint32_t Find(const char* name)const;
+	std::uint32_t Find(const wchar_t* name)const;
+
+	std::string Name(std::uint32_t entry)const;
+	std::uint64_t Size(std::uint32_t entry)const { return mEntries[entry].Size; }
+	std::uint64_t ContentHash(std::uint32_t entry)const { return mEntries[entry].ContentHash; }
+	bool IsCompressed(std::uint32_t entry)const { return mEntries[entry].Compression != ArchiveCompression::None; }
+
+	// The contents of an uncompressed entry, in place in the mapping (valid while the
+	// archive is open); false for a compressed one.
+	bool Map(std::uint32_t entry, ArchiveSpan& span)const;
+
+	// Hints that 'span' (of an entry) is about to be read.
+	void Prefetch(const ArchiveSpan& span)const;
+
+	// Copies the contents of any entry to 'data', decompressing a compressed one; false
+	// if its payload is damaged.
+	bool Read(std::uint32_t entry, std::vector<std::uint8_t>& data)const;
+
+	bool IsOpen()const { return mEntries != nullptr; }
+	std::uint32_t EntryCount()const { return mEntryCount; }
+	unsigned long LastError()const { return mFile.LastError(); }
+
+private:
+	bool CheckContents();
+	std::uint32_t FindNormalized(const std::string& normalized)const;
+
+private:
+	MappedFile mFile;
+	const ArchiveHeader* mHeader = nullptr;
+	const ArchiveEntry* mEntries = nullptr;
+	const char* mNames = nullptr;
+	std::uint32_t mEntryCount = 0;
+};
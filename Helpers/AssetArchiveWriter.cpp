@@ -0,0 +1,172 @@
+//***************************************************************************************
+// AssetArchiveWriter.cpp
+//***************************************************************************************
+
+#include "AssetArchiveWriter.h"
+#include "ContentHash.h"
+#include "Lz4Block.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+AssetArchiveWriter::AssetArchiveWriter(std::uint32_t alignment, std::uint32_t blockSize)
+	: mAlignment(std::max(alignment, 1u)), mBlockSize(std::max(blockSize, 1u))
+{
+}
+
+bool AssetArchiveWriter::Add(const char* name, std::vector<std::uint8_t> data, bool compress)
+{
+	Pending entry;
+	if (!NormalizeArchiveName(name, entry.Name))
+		return false;
+
+	auto taken = std::find_if(mPending.begin(), mPending.end(),
+		[&](const Pending& other) { return other.Name == entry.Name; });
+	if (taken != mPending.end())
+		return false;
+
+	entry.NameHash = ArchiveNameHash(entry.Name);
+	entry.Data = std::move(data);
+	entry.Compress = compress && !entry.Data.empty();
+	mSize += entry.Data.size();
+	mPending.push_back(std::move(entry));
+	return true;
+}
+
+void AssetArchiveWriter::Compress(std::vector<Pending*>& entries)
+{
+	// every block of every entry is one task.
+	struct Block
+	{
+		Pending* Entry;
+		std::size_t Index;
+		std::vector<std::uint8_t> Data;
+		bool Raw = false;
+	};
+
+	std::vector<Block> blocks;
+	for (Pending* entry : entries)
+	{
+		entry->Stored.clear();
+		if (!entry->Compress)
+			continue;
+
+		std::size_t count = (entry->Data.size() + mBlockSize - 1) / mBlockSize;
+		for (std::size_t i = 0; i < count; ++i)
+			blocks.push_back({ entry, i, {} });
+	}
+
+	ParallelFor(blocks.size(), 1, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t b = begin; b < end; ++b)
+		{
+			Block& block = blocks[b];
+			const std::vector<std::uint8_t>& data = block.Entry->Data;
+			const std::size_t offset = block.Index * mBlockSize;
+			const std::size_t size = std::min<std::size_t>(mBlockSize, data.size() - offset);
+
+			block.Data.resize(Lz4CompressBound(size));
+			block.Data.resize(Lz4Compress(data.data() + offset, size, block.Data.data()));
+			if (block.Data.size() >= size)
+			{
+				block.Data.assign(data.begin() + offset, data.begin() + offset + size);
+				block.Raw = true;
+			}
+		}
+	});
+
+	// the block table and the blocks, in order; blocks of one entry are consecutive.
+	for (std::size_t b = 0; b < blocks.size(); )
+	{
+		Pending* entry = blocks[b].Entry;
+		std::size_t count = 0;
+		std::size_t storedSize = 0;
+		for (; b + count < blocks.size() && blocks[b + count].Entry == entry; ++count)
+			storedSize += sizeof(std::uint32_t) + blocks[b + count].Data.size();
+
+		// not worth decompressing: stored as is.
+		if (storedSize < entry->Data.size() - entry->Data.size() / 8)
+		{
+			entry->Stored.resize(count * sizeof(std::uint32_t));
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const Block& block = blocks[b + i];
+				std::uint32_t size = (std::uint32_t)block.Data.size() | (block.Raw ? ArchiveEntry::RawBlock : 0);
+				std::memcpy(entry->Stored.data() + i * sizeof(std::uint32_t), &size, sizeof(size));
+				entry->Stored.insert(entry->Stored.end(), block.Data.begin(), block.Data.end());
+			}
+		}
+		b += count;
+	}
+}
+
+bool AssetArchiveWriter::Write(const char* fileName)
+{
+	// the table of contents is sorted by name hash (then name, for a stable order).
+	std::vector<Pending*> entries;
+	for (auto& entry : mPending)
+		entries.push_back(&entry);
+	std::sort(entries.begin(), entries.end(), [](const Pending* a, const Pending* b)
+	{
+		if (a->NameHash != b->NameHash)
+			return a->NameHash < b->NameHash;
+		return a->Name < b->Name;
+	});
+
+	Compress(entries);
+
+	ArchiveHeader header;
+	header.EntryCount = (std::uint32_t)entries.size();
+	header.BlockSize = mBlockSize;
+	header.NamesOffset = sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry);
+
+	std::string names;
+	std::vector<ArchiveEntry> toc(entries.size());
+	for (std::size_t i = 0; i < entries.size(); ++i)
+	{
+		toc[i].NameHash = entries[i]->NameHash;
+		toc[i].ContentHash = ContentHash64(entries[i]->Data.data(), entries[i]->Data.size());
+		toc[i].Size = entries[i]->Data.size();
+		toc[i].NameOffset = (std::uint32_t)names.size();
+		toc[i].NameLength = (std::uint32_t)entries[i]->Name.size();
+		names += entries[i]->Name;
+	}
+	header.NamesSize = names.size();
+
+	// payloads in table order, each on a multiple of the alignment.
+	std::uint64_t offset = header.NamesOffset + header.NamesSize;
+	mStoredSize = 0;
+	for (std::size_t i = 0; i < entries.size(); ++i)
+	{
+		const bool compressed = !entries[i]->Stored.empty();
+		offset = (offset + mAlignment - 1) / mAlignment * mAlignment;
+		toc[i].Offset = offset;
+		toc[i].StoredSize = compressed ? entries[i]->Stored.size() : entries[i]->Data.size();
+		toc[i].Compression = compressed ? ArchiveCompression::Lz4 : ArchiveCompression::None;
+		offset += toc[i].StoredSize;
+		mStoredSize += toc[i].StoredSize;
+	}
+
+	FILE* file = std::fopen(fileName, "wb");
+	if (file == nullptr)
+		return false;
+
+	bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+		(toc.empty() || std::fwrite(toc.data(), sizeof(ArchiveEntry), toc.size(), file) == toc.size()) &&
+		std::fwrite(names.data(), 1, names.size(), file) == names.size();
+
+	std::uint64_t position = header.NamesOffset + header.NamesSize;
+	const std::vector<std::uint8_t> padding(mAlignment, 0);
+	for (std::size_t i = 0; i < entries.size() && written; ++i)
+	{
+		const std::vector<std::uint8_t>& payload = !entries[i]->Stored.empty() ? entries[i]->Stored : entries[i]->Data;
+		const std::size_t pad = (std::size_t)(toc[i].Offset - position);
+		written = std::fwrite(padding.data(), 1, pad, file) == pad &&
+			(payload.empty() || std::fwrite(payload.data(), 1, payload.size(), file) == payload.size());
+		position = toc[i].Offset + payload.size();
+	}
+
+	written = (std::fclose(file) == 0) && written;
+	return written;
+}
@@ -0,0 +1,55 @@
+//***************************************************************************************
+// AssetArchiveWriter.h
+//
+// Builds a packed asset archive (see AssetArchive.h for the layout) from files or
+// memory.  Entries marked for compression are cut into BlockSize blocks compressed with
+// LZ4 on all cores; an entry that does not shrink by at least an eighth is stored as is,
+// and so is any block that does not shrink at all.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include "AssetArchive.h"
+
+class AssetArchiveWriter
+{
+public:
+	static const std::uint32_t DefaultAlignment = 4096;			// a page: mapped payloads start on one
+	static const std::uint32_t DefaultBlockSize = 256 * 1024;
+
+public:
+	explicit AssetArchiveWriter(std::uint32_t alignment = DefaultAlignment, std::uint32_t blockSize = DefaultBlockSize);
+
+	// Adds 'data' under 'name'; false if the name is not valid (NormalizeArchiveName) or
+	// is taken already.
+	bool Add(const char* name, std::vector<std::uint8_t> data, bool compress);
+
+	// Writes the archive; false if the file cannot be written.
+	bool Write(const char* fileName);
+
+	std::uint32_t EntryCount()const { return (std::uint32_t)mPending.size(); }
+	std::uint64_t Size()const { return mSize; }				// uncompressed bytes of every entry
+	std::uint64_t StoredSize()const { return mStoredSize; }	// payload bytes of the last Write
+
+private:
+	struct Pending
+	{
+		std::string Name;
+		std::uint64_t NameHash = 0;
+		std::vector<std::uint8_t> Data;
+		std::vector<std::uint8_t> Stored;		// compressed payload (empty: stored as is)
+		bool Compress = false;
+	};
+
+	void Compress(std::vector<Pending*>& entries);
+
+private:
+	std::uint32_t mAlignment = 0;
+	std::uint32_t mBlockSize = 0;
+	std::vector<Pending> mPending;
+	std::uint64_t mSize = 0;
+	std::uint64_t mStoredSize = 0;
+};
@@ -0,0 +1,103 @@
+//***************************************************************************************
+// AtlasPacker.cpp
+//***************************************************************************************
+
+#include "AtlasPacker.h"
+#include <algorithm>
+
+AtlasPacker::AtlasPacker(std::uint32_t width, std::uint32_t height)
+	: mWidth(width), mHeight(height)
+{
+	mSkyline.push_back({ 0, 0, width });
+}
+
+float AtlasPacker::Occupancy()const
+{
+	std::uint64_t area = (std::uint64_t)mWidth * mHeight;
+	return (area != 0) ? (float)mUsedArea / (float)area : 0.0f;
+}
+
+bool AtlasPacker::Fit(std::size_t index, std::uint32_t width, std::uint32_t height, std::uint32_t& y)const
+{
+	if (mSkyline[index].X + width > mWidth)
+		return false;
+
+	// the rectangle rests on the highest segment under it.
+	y = 0;
+	std::uint32_t covered = 0;
+	for (std::size_t i = index; covered < width; ++i)
+	{
+		y = std::max(y, mSkyline[i].Y);
+		covered += mSkyline[i].Width;
+	}
+	return y + height <= mHeight;
+}
+
+bool AtlasPacker::Insert(std::uint32_t width, std::uint32_t height, AtlasRect& rect)
+{
+	if (width == 0 || height == 0)
+		return false;
+
+	std::size_t bestIndex = mSkyline.size();
+	std::uint32_t bestTop = UINT32_MAX;
+	std::uint32_t bestWidth = UINT32_MAX;
+	std::uint32_t bestY = 0;
+	for (std::size_t i = 0; i < mSkyline.size(); ++i)
+	{
+		std::uint32_t y;
+		if (!Fit(i, width, height, y))
+			continue;
+
+		std::uint32_t top = y + height;
+		if (top < bestTop || (top == bestTop && mSkyline[i].Width < bestWidth))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = mSkyline[i].Width;
+			bestY = y;
+		}
+	}
+	if (bestIndex == mSkyline.size())
+		return false;
+
+	rect.X = mSkyline[bestIndex].X;
+	rect.Y = bestY;
+	rect.Width = width;
+	rect.Height = height;
+
+	// the new segment covers the rectangle's top; the segments under it shrink or go.
+	mSkyline.insert(mSkyline.begin() + bestIndex, { rect.X, rect.Y + height, width });
+	const std::uint32_t right = rect.X + width;
+	for (std::size_t i = bestIndex + 1; i < mSkyline.size() && mSkyline[i].X < right; )
+	{
+		std::uint32_t end = mSkyline[i].X + mSkyline[i].Width;
+		if (end <= right)
+		{
+			mSkyline.erase(mSkyline.begin() + i);
+			continue;
+		}
+
+		mSkyline[i].Width = end - right;
+		mSkyline[i].X = right;
+		break;
+	}
+
+	// neighbours at the same height become one segment.
+	for (std::size_t i = 0; i + 1 < mSkyline.size(); )
+	{
+		if (mSkyline[i].Y == mSkyline[i + 1].Y)
+		{
+			mSkyline[i].Width += mSkyline[i + 1].Width;
+			mSkyline.erase(mSkyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	mUsedWidth = std::max(mUsedWidth, right);
+	mUsedHeight = std::max(mUsedHeight, rect.Y + height);
+	mUsedArea += (std::uint64_t)width * height;
+	return true;
+}
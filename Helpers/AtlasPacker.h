@@ -0,0 +1,59 @@
+//***************************************************************************************
+// AtlasPacker.h
+//
+// Packs rectangles into a fixed-size area with the skyline bottom-left heuristic: the
+// packed area is described by its top outline (the skyline), and every rectangle goes
+// where its top edge ends up lowest, on the narrowest fitting stretch when that ties.
+// Fast and tight for the similar-sized rectangles of texture atlases.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct AtlasRect
+{
+	std::uint32_t X = 0;
+	std::uint32_t Y = 0;
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+};
+
+class AtlasPacker
+{
+public:
+	AtlasPacker(std::uint32_t width, std::uint32_t height);
+
+	// Places a width x height rectangle; false when it no longer fits.
+	bool Insert(std::uint32_t width, std::uint32_t height, AtlasRect& rect);
+
+	// The extent of everything placed so far, and the share of the area it covers.
+	std::uint32_t UsedWidth()const { return mUsedWidth; }
+	std::uint32_t UsedHeight()const { return mUsedHeight; }
+	float Occupancy()const;
+
+private:
+	// a stretch of the skyline: [X, X + Width) is filled up to Y.
+	struct Segment
+	{
+		std::uint32_t X;
+		std::uint32_t Y;
+		std::uint32_t Width;
+	};
+
+	// The height a rectangle 'width' wide rests at with its left edge on segment 'index';
+	// false if it sticks out of the area.
+	bool Fit(std::size_t index, std::uint32_t width, std::uint32_t height, std::uint32_t& y)const;
+
+private:
+	std::uint32_t mWidth;
+	std::uint32_t mHeight;
+	std::uint32_t mUsedWidth = 0;
+	std::uint32_t mUsedHeight = 0;
+	std::uint64_t mUsedArea = 0;
+	std::vector<Segment> mSkyline;
+};
@@ -0,0 +1,968 @@
+//***************************************************************************************
+// BlockDecoder.cpp
+//***************************************************************************************
+
+#include "BlockDecoder.h"
+#include "BlockTables.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BLOCK_DECODER_SSE2 1
+#endif
+
+namespace
+{
+	// ---------- shared pieces ----------
+
+	// reads a 128-bit block as a little-endian bit stream (BC6H and BC7), by shifting the
+	// bits read out of the bottom.
+	class BlockBits
+	{
+	public:
+		explicit BlockBits(const std::uint8_t* block)
+		{
+			std::memcpy(&mLow, block, 8);
+			std::memcpy(&mHigh, block + 8, 8);
+		}
+
+		// count: 0 to 32.
+		std::uint32_t Read(std::uint32_t count)
+		{
+			if (count == 0)
+				return 0;
+
+			std::uint32_t value = (std::uint32_t)(mLow & ((1ull << count) - 1));
+			Skip(count);
+			return value;
+		}
+
+		// 16 indices of 'indexBits' bits, less one bit for the texels in 'anchors' (a bit
+		// mask), read from one 64-bit window.
+		void ReadIndices(std::uint32_t indexBits, std::uint32_t anchors, std::uint32_t indices[16])
+		{
+			std::uint64_t window = mLow;
+			std::uint32_t used = 0;
+			for (std::uint32_t i = 0; i < 16; ++i)
+			{
+				std::uint32_t count = indexBits - ((anchors >> i) & 1);
+				indices[i] = (std::uint32_t)(window >> used) & ((1u << count) - 1);
+				used += count;
+			}
+			Skip(used);
+		}
+
+	private:
+		// count: 1 to 63.
+		void Skip(std::uint32_t count)
+		{
+			mLow = (mLow >> count) | (mHigh << (64 - count));
+			mHigh >>= count;
+		}
+
+	private:
+		std::uint64_t mLow;
+		std::uint64_t mHigh;
+	};
+
+	inline void StoreTexel(std::uint8_t* texel, std::uint32_t rgba)
+	{
+		std::memcpy(texel, &rgba, 4);
+	}
+
+	inline std::uint32_t PackRGBA(std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a)
+	{
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	// ---------- BC1-BC3 color ----------
+
+	inline std::uint32_t Expand565(std::uint32_t c)
+	{
+		std::uint32_t r = (c >> 11) & 31;
+		std::uint32_t g = (c >> 5) & 63;
+		std::uint32_t b = c & 31;
+		return PackRGBA((r * 33) >> 2, (g * 65) >> 4, (b * 33) >> 2, 255);
+	}
+
+	inline std::uint32_t Channel(std::uint32_t rgba, int channel)
+	{
+		return (rgba >> (8 * channel)) & 0xFF;
+	}
+
+	// BC1 blocks with c0 <= c1 have three colors and transparent black; BC2/BC3 always have four.
+	void ColorPalette(const std::uint8_t* block, bool allowThreeColor, std::uint32_t palette[4])
+	{
+		std::uint32_t c0 = block[0] | (block[1] << 8);
+		std::uint32_t c1 = block[2] | (block[3] << 8);
+		palette[0] = Expand565(c0);
+		palette[1] = Expand565(c1);
+
+		std::uint32_t c2[4], c3[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			std::uint32_t a = Channel(palette[0], c);
+			std::uint32_t b = Channel(palette[1], c);
+			if (c0 > c1 || !allowThreeColor)
+			{
+				c2[c] = (2 * a + b + 1) / 3;
+				c3[c] = (a + 2 * b + 1) / 3;
+			}
+			else
+			{
+				c2[c] = (a + b + 1) >> 1;
+				c3[c] = 0;
+			}
+		}
+		palette[2] = PackRGBA(c2[0], c2[1], c2[2], c2[3]);
+		palette[3] = PackRGBA(c3[0], c3[1], c3[2], c3[3]);
+	}
+
+#if defined(BLOCK_DECODER_SSE2)
+	// ColorPalette for four blocks 'stride' bytes apart at once: every 16-bit lane holds one
+	// channel of one endpoint, two blocks per register.
+	void ColorPalettes4(const std::uint8_t* blocks, std::size_t stride, bool allowThreeColor, std::uint32_t palettes[4][4])
+	{
+		std::uint16_t ends[8];
+		for (int i = 0; i < 4; ++i)
+		{
+			std::memcpy(&ends[i], blocks + i * stride, 2);
+			std::memcpy(&ends[4 + i], blocks + i * stride + 2, 2);
+		}
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ends));		// c0 of blocks 0-3, c1 of blocks 0-3
+
+		// 565 to 888: isolate each field, move blue up to the top like red, then scale with
+		// a multiply-high ((x * 33) >> 2 for 5 bits, (x * 65) >> 4 for 6 bits).
+		const __m128i fieldMask = _mm_setr_epi16(0xF800 - 0x10000, 0x07E0, 0x001F, 0, 0xF800 - 0x10000, 0x07E0, 0x001F, 0);
+		const __m128i blueUp = _mm_setr_epi16(1, 1, 2048, 0, 1, 1, 2048, 0);
+		const __m128i scale = _mm_setr_epi16(264, 8320, 264, 0, 264, 8320, 264, 0);
+		const __m128i opaque = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+
+		auto expand = [&](__m128i c)
+		{
+			c = _mm_mullo_epi16(_mm_and_si128(c, fieldMask), blueUp);
+			return _mm_or_si128(_mm_mulhi_epu16(c, scale), opaque);
+		};
+
+		__m128i lo = _mm_unpacklo_epi16(v, v);			// c0: b0 b0 b1 b1 b2 b2 b3 b3
+		__m128i hi = _mm_unpackhi_epi16(v, v);			// c1
+		__m128i a[2] = { expand(_mm_unpacklo_epi32(lo, lo)), expand(_mm_unpackhi_epi32(lo, lo)) };
+		__m128i b[2] = { expand(_mm_unpacklo_epi32(hi, hi)), expand(_mm_unpackhi_epi32(hi, hi)) };
+
+		// four color blocks: c0 > c1 (unsigned; flip the sign bits for the signed compare).
+		__m128i fourColor = _mm_set1_epi16(-1);
+		if (allowThreeColor)
+		{
+			const __m128i flip = _mm_set1_epi16(-0x8000);
+			__m128i c0 = _mm_xor_si128(v, flip);
+			__m128i c1 = _mm_xor_si128(_mm_srli_si128(v, 8), flip);
+			fourColor = _mm_cmpgt_epi16(c0, c1);
+			fourColor = _mm_unpacklo_epi16(fourColor, fourColor);
+		}
+		__m128i four[2] = { _mm_unpacklo_epi32(fourColor, fourColor), _mm_unpackhi_epi32(fourColor, fourColor) };
+
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i third = _mm_set1_epi16(21846);		// (x * 21846) >> 16 == x / 3 for x < 768
+
+		for (int pair = 0; pair < 2; ++pair)
+		{
+			__m128i twoA = _mm_add_epi16(a[pair], a[pair]);
+			__m128i twoB = _mm_add_epi16(b[pair], b[pair]);
+			__m128i c2 = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(twoA, b[pair]), one), third);
+			__m128i c3 = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(a[pair], twoB), one), third);
+			__m128i half = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a[pair], b[pair]), one), 1);
+
+			c2 = _mm_or_si128(_mm_and_si128(four[pair], c2), _mm_andnot_si128(four[pair], half));
+			c3 = _mm_and_si128(four[pair], c3);
+
+			// bytes: [c0 c0' c1 c1'] and [c2 c2' c3 c3'] (' = second block of the pair).
+			__m128i p01 = _mm_shuffle_epi32(_mm_packus_epi16(a[pair], b[pair]), _MM_SHUFFLE(3, 1, 2, 0));
+			__m128i p23 = _mm_shuffle_epi32(_mm_packus_epi16(c2, c3), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(palettes[2 * pair]), _mm_unpacklo_epi64(p01, p23));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(palettes[2 * pair + 1]), _mm_unpackhi_epi64(p01, p23));
+		}
+	}
+#endif
+
+	// 'alpha' (16 values, or null) replaces the alpha of the palette colors.
+	void EmitColors(const std::uint8_t* block, const std::uint32_t palette[4], const std::uint8_t* alpha,
+		std::uint8_t* texels, std::size_t rowPitch)
+	{
+		std::uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((std::uint32_t)block[7] << 24);
+		for (int y = 0; y < 4; ++y, indices >>= 8)
+		{
+			std::uint8_t* row = texels + y * rowPitch;
+#if defined(BLOCK_DECODER_SSE2)
+			// one 16 byte store per row of the block.
+			__m128i texelRow = _mm_setr_epi32((int)palette[indices & 3], (int)palette[(indices >> 2) & 3],
+				(int)palette[(indices >> 4) & 3], (int)palette[(indices >> 6) & 3]);
+			if (alpha != nullptr)
+			{
+				std::int32_t alphaRow;
+				std::memcpy(&alphaRow, alpha + 4 * y, 4);
+				const __m128i zero = _mm_setzero_si128();
+				__m128i a = _mm_unpacklo_epi16(zero, _mm_unpacklo_epi8(zero, _mm_cvtsi32_si128(alphaRow)));
+				texelRow = _mm_or_si128(_mm_and_si128(texelRow, _mm_set1_epi32(0x00FFFFFF)), a);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row), texelRow);
+#else
+			for (int x = 0; x < 4; ++x)
+			{
+				std::uint32_t rgba = palette[(indices >> (2 * x)) & 3];
+				if (alpha != nullptr)
+					rgba = (rgba & 0x00FFFFFF) | ((std::uint32_t)alpha[4 * y + x] << 24);
+				StoreTexel(row + 4 * x, rgba);
+			}
+#endif
+		}
+	}
+
+	// ---------- BC2 alpha ----------
+
+	void ExplicitAlpha(const std::uint8_t* block, std::uint8_t alpha[16])
+	{
+#if defined(BLOCK_DECODER_SSE2)
+		// low and high nibble of each byte side by side, then x * 17 as x | x << 4.
+		__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+		__m128i nibbles = _mm_and_si128(_mm_unpacklo_epi8(bytes, _mm_srli_epi16(bytes, 4)), _mm_set1_epi8(15));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(alpha), _mm_or_si128(nibbles, _mm_slli_epi16(nibbles, 4)));
+#else
+		for (int i = 0; i < 16; ++i)
+			alpha[i] = (std::uint8_t)(((block[i / 2] >> (4 * (i & 1))) & 15) * 17);
+#endif
+	}
+
+	// ---------- BC3 alpha, BC4 and BC5 channels ----------
+
+	// 8 values from two endpoints: six interpolated between them (e0 > e1), or four
+	// interpolated plus the ends of the range.
+	void ChannelPalette(std::uint32_t e0, std::uint32_t e1, std::uint8_t palette[8])
+	{
+#if defined(BLOCK_DECODER_SSE2)
+		__m128i a = _mm_set1_epi16((short)e0);
+		__m128i b = _mm_set1_epi16((short)e1);
+		__m128i values;
+		if (e0 > e1)
+		{
+			__m128i sum = _mm_add_epi16(_mm_add_epi16(
+				_mm_mullo_epi16(a, _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1)),
+				_mm_mullo_epi16(b, _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6))), _mm_set1_epi16(3));
+			values = _mm_mulhi_epu16(sum, _mm_set1_epi16(9363));				// / 7 for x < 1800
+		}
+		else
+		{
+			__m128i sum = _mm_add_epi16(_mm_add_epi16(
+				_mm_mullo_epi16(a, _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0)),
+				_mm_mullo_epi16(b, _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0))), _mm_set1_epi16(2));
+			values = _mm_mulhi_epu16(sum, _mm_set1_epi16(13108));				// / 5 for x < 1300
+			values = _mm_or_si128(values, _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 255));
+		}
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(palette), _mm_packus_epi16(values, values));
+#else
+		palette[0] = (std::uint8_t)e0;
+		palette[1] = (std::uint8_t)e1;
+		if (e0 > e1)
+		{
+			for (std::uint32_t i = 1; i < 7; ++i)
+				palette[i + 1] = (std::uint8_t)(((7 - i) * e0 + i * e1 + 3) / 7);
+		}
+		else
+		{
+			for (std::uint32_t i = 1; i < 5; ++i)
+				palette[i + 1] = (std::uint8_t)(((5 - i) * e0 + i * e1 + 2) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+#endif
+	}
+
+	// the signed variant, in SNORM bytes (-128 reads as -127).
+	void SignedChannelPalette(std::int32_t e0, std::int32_t e1, std::int8_t palette[8])
+	{
+		e0 = std::max(e0, -127);
+		e1 = std::max(e1, -127);
+
+#if defined(BLOCK_DECODER_SSE2)
+		// ChannelPalette's rounding on the magnitudes (below 7 * 127), the signs put back after.
+		__m128i a = _mm_set1_epi16((short)e0);
+		__m128i b = _mm_set1_epi16((short)e1);
+		__m128i sum, sign, values;
+		if (e0 > e1)
+		{
+			sum = _mm_add_epi16(_mm_mullo_epi16(a, _mm_setr_epi16(7, 0, 6, 5, 4, 3, 2, 1)),
+				_mm_mullo_epi16(b, _mm_setr_epi16(0, 7, 1, 2, 3, 4, 5, 6)));
+			sign = _mm_srai_epi16(sum, 15);
+			values = _mm_sub_epi16(_mm_xor_si128(sum, sign), sign);
+			values = _mm_mulhi_epu16(_mm_add_epi16(values, _mm_set1_epi16(3)), _mm_set1_epi16(9363));
+		}
+		else
+		{
+			sum = _mm_add_epi16(_mm_mullo_epi16(a, _mm_setr_epi16(5, 0, 4, 3, 2, 1, 0, 0)),
+				_mm_mullo_epi16(b, _mm_setr_epi16(0, 5, 1, 2, 3, 4, 0, 0)));
+			sign = _mm_srai_epi16(sum, 15);
+			values = _mm_sub_epi16(_mm_xor_si128(sum, sign), sign);
+			values = _mm_mulhi_epu16(_mm_add_epi16(values, _mm_set1_epi16(2)), _mm_set1_epi16(13108));
+		}
+		values = _mm_sub_epi16(_mm_xor_si128(values, sign), sign);
+		if (e0 <= e1)
+			values = _mm_add_epi16(values, _mm_setr_epi16(0, 0, 0, 0, 0, 0, -127, 127));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(palette), _mm_packs_epi16(values, values));
+#else
+		auto divide = [](std::int32_t n, std::int32_t d)
+		{
+			return (std::int8_t)((n >= 0) ? (n + d / 2) / d : -((-n + d / 2) / d));
+		};
+
+		palette[0] = (std::int8_t)e0;
+		palette[1] = (std::int8_t)e1;
+		if (e0 > e1)
+		{
+			for (std::int32_t i = 1; i < 7; ++i)
+				palette[i + 1] = divide((7 - i) * e0 + i * e1, 7);
+		}
+		else
+		{
+			for (std::int32_t i = 1; i < 5; ++i)
+				palette[i + 1] = divide((5 - i) * e0 + i * e1, 5);
+			palette[6] = -127;
+			palette[7] = 127;
+		}
+#endif
+	}
+
+#if defined(BLOCK_DECODER_SSE2)
+	// the 16 3 bit indices of a BC4 style block (its last 6 bytes), one per byte.  The index
+	// of texel i starts at bit 3i: a 16-bit lane takes the two bytes holding it, and as SSE2
+	// cannot shift lanes by different counts, a multiply by 2^(8 - 3i % 8) moves it to bit 8.
+	__m128i ChannelIndices(const std::uint8_t* block)
+	{
+		__m128i bytes = _mm_srli_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(block)), 2);
+		__m128i pairs = _mm_unpacklo_epi16(bytes, _mm_srli_si128(bytes, 1));		// lane k: bytes k, k + 1
+
+		// texels 0-7 read the byte pairs 0 0 0 1 1 1 2 2, texels 8-15 the pairs 3 to 5 alike.
+		__m128i high = _mm_srli_si128(pairs, 6);
+		__m128i first = _mm_unpacklo_epi64(_mm_shufflelo_epi16(pairs, _MM_SHUFFLE(1, 0, 0, 0)),
+			_mm_shufflelo_epi16(pairs, _MM_SHUFFLE(2, 2, 1, 1)));
+		__m128i second = _mm_unpacklo_epi64(_mm_shufflelo_epi16(high, _MM_SHUFFLE(1, 0, 0, 0)),
+			_mm_shufflelo_epi16(high, _MM_SHUFFLE(2, 2, 1, 1)));
+
+		const __m128i align = _mm_setr_epi16(256, 32, 4, 128, 16, 2, 64, 8);
+		const __m128i mask = _mm_set1_epi16(7);
+		first = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(first, align), 8), mask);
+		second = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(second, align), 8), mask);
+		return _mm_packus_epi16(first, second);
+	}
+
+	// palette entry 'Entry' in every byte; 'pairs' holds each entry twice (entry k in word k).
+	template <int Entry>
+	__m128i PaletteEntry(__m128i pairs)
+	{
+		__m128i words = (Entry < 4) ? _mm_shufflelo_epi16(pairs, (Entry & 3) * 0x55) : _mm_shufflehi_epi16(pairs, (Entry & 3) * 0x55);
+		return _mm_shuffle_epi32(words, (Entry < 4) ? 0x00 : 0xAA);
+	}
+
+	template <int Entry>
+	__m128i SelectEntry(__m128i indices, __m128i pairs)
+	{
+		return _mm_and_si128(_mm_cmpeq_epi8(indices, _mm_set1_epi8((char)Entry)), PaletteEntry<Entry>(pairs));
+	}
+#endif
+
+	// the 16 values of an 8 byte BC4 style block.
+	void ChannelValues(const std::uint8_t* block, bool isSigned, std::uint8_t values[16])
+	{
+		std::uint8_t palette[8];
+		if (isSigned)
+			SignedChannelPalette((std::int8_t)block[0], (std::int8_t)block[1], reinterpret_cast<std::int8_t*>(palette));
+		else
+			ChannelPalette(block[0], block[1], palette);
+
+#if defined(BLOCK_DECODER_SSE2)
+		// every texel at once: each entry is masked in where the indices match it.
+		__m128i indices = ChannelIndices(block);
+		__m128i entries = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(palette));
+		__m128i pairs = _mm_unpacklo_epi8(entries, entries);
+		__m128i low = _mm_or_si128(_mm_or_si128(SelectEntry<0>(indices, pairs), SelectEntry<1>(indices, pairs)),
+			_mm_or_si128(SelectEntry<2>(indices, pairs), SelectEntry<3>(indices, pairs)));
+		__m128i high = _mm_or_si128(_mm_or_si128(SelectEntry<4>(indices, pairs), SelectEntry<5>(indices, pairs)),
+			_mm_or_si128(SelectEntry<6>(indices, pairs), SelectEntry<7>(indices, pairs)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(values), _mm_or_si128(low, high));
+#else
+		std::uint64_t indices = 0;
+		std::memcpy(&indices, block + 2, 6);
+		for (int i = 0; i < 16; ++i, indices >>= 3)
+			values[i] = palette[indices & 7];
+#endif
+	}
+
+	// texels (red, green or 0, 0, alpha) of BC4/BC5 blocks; 'green' may be null.
+	void EmitChannels(const std::uint8_t* red, const std::uint8_t* green, std::uint8_t alpha,
+		std::uint8_t* texels, std::size_t rowPitch)
+	{
+#if defined(BLOCK_DECODER_SSE2)
+		__m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(red));
+		__m128i g = (green != nullptr) ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(green)) : _mm_setzero_si128();
+		__m128i ba = _mm_set1_epi16((short)(alpha << 8));
+
+		__m128i rgLow = _mm_unpacklo_epi8(r, g);			// texels 0-7
+		__m128i rgHigh = _mm_unpackhi_epi8(r, g);			// texels 8-15
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels), _mm_unpacklo_epi16(rgLow, ba));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + rowPitch), _mm_unpackhi_epi16(rgLow, ba));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + 2 * rowPitch), _mm_unpacklo_epi16(rgHigh, ba));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + 3 * rowPitch), _mm_unpackhi_epi16(rgHigh, ba));
+#else
+		for (int i = 0; i < 16; ++i)
+			StoreTexel(texels + (i / 4) * rowPitch + 4 * (i % 4), PackRGBA(red[i], (green != nullptr) ? green[i] : 0, 0, alpha));
+#endif
+	}
+
+	void FillTexels(std::uint32_t rgba, std::uint8_t* texels, std::size_t rowPitch)
+	{
+		for (int y = 0; y < 4; ++y)
+		{
+			for (int x = 0; x < 4; ++x)
+				StoreTexel(texels + y * rowPitch + 4 * x, rgba);
+		}
+	}
+
+	// ---------- BC6H ----------
+
+	// endpoint fields: W and X are the ends of subset 0, Y and Z those of subset 1; D is the partition.
+	enum Bc6Field : std::uint8_t
+	{
+		End, RW, RX, RY, RZ, GW, GX, GY, GZ, BW, BX, BY, BZ, D,
+	};
+
+	// consecutive header bits of one field, from bit First to bit Last (either direction).
+	struct Bc6Run
+	{
+		std::uint8_t Field;
+		std::uint8_t First;
+		std::uint8_t Last;
+	};
+
+	struct Bc6Mode
+	{
+		std::uint8_t ModeBits;					// 2 bits, or 5 when the low two are 10 or 11
+		bool Transformed;						// X, Y and Z are deltas from W
+		std::uint8_t Subsets;
+		std::uint8_t EndpointBits;
+		std::uint8_t DeltaBits[3];				// of X, Y and Z per channel
+		Bc6Run Runs[24];						// the header after the mode bits, up to End
+	};
+
+	const Bc6Mode Bc6Modes[14] =
+	{
+		{ 0x00, true, 2, 10, { 5, 5, 5 }, { { GY, 4, 4 }, { BY, 4, 4 }, { BZ, 4, 4 }, { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 },
+			{ RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 },
+			{ BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x01, true, 2, 7, { 6, 6, 6 }, { { GY, 5, 5 }, { GZ, 4, 5 }, { RW, 0, 6 }, { BZ, 0, 1 }, { BY, 4, 4 }, { GW, 0, 6 },
+			{ BY, 5, 5 }, { BZ, 2, 2 }, { GY, 4, 4 }, { BW, 0, 6 }, { BZ, 3, 3 }, { BZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 5 },
+			{ GY, 0, 3 }, { GX, 0, 5 }, { GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 5 }, { RZ, 0, 5 }, { D, 0, 4 } } },
+		{ 0x02, true, 2, 11, { 5, 4, 4 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 4 }, { RW, 10, 10 }, { GY, 0, 3 },
+			{ GX, 0, 3 }, { GW, 10, 10 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 3 }, { BW, 10, 10 }, { BZ, 1, 1 }, { BY, 0, 3 },
+			{ RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x06, true, 2, 11, { 4, 5, 4 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 10, 10 }, { GZ, 4, 4 },
+			{ GY, 0, 3 }, { GX, 0, 4 }, { GW, 10, 10 }, { GZ, 0, 3 }, { BX, 0, 3 }, { BW, 10, 10 }, { BZ, 1, 1 }, { BY, 0, 3 },
+			{ RY, 0, 3 }, { BZ, 0, 0 }, { BZ, 2, 2 }, { RZ, 0, 3 }, { GY, 4, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x0A, true, 2, 11, { 4, 4, 5 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 10, 10 }, { BY, 4, 4 },
+			{ GY, 0, 3 }, { GX, 0, 3 }, { GW, 10, 10 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BW, 10, 10 }, { BY, 0, 3 },
+			{ RY, 0, 3 }, { BZ, 1, 2 }, { RZ, 0, 3 }, { BZ, 4, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x0E, true, 2, 9, { 5, 5, 5 }, { { RW, 0, 8 }, { BY, 4, 4 }, { GW, 0, 8 }, { GY, 4, 4 }, { BW, 0, 8 }, { BZ, 4, 4 },
+			{ RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 }, { BZ, 1, 1 },
+			{ BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x12, true, 2, 8, { 6, 5, 5 }, { { RW, 0, 7 }, { GZ, 4, 4 }, { BY, 4, 4 }, { GW, 0, 7 }, { BZ, 2, 2 }, { GY, 4, 4 },
+			{ BW, 0, 7 }, { BZ, 3, 4 }, { RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 }, { BX, 0, 4 },
+			{ BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 5 }, { RZ, 0, 5 }, { D, 0, 4 } } },
+		{ 0x16, true, 2, 8, { 5, 6, 5 }, { { RW, 0, 7 }, { BZ, 0, 0 }, { BY, 4, 4 }, { GW, 0, 7 }, { GY, 5, 4 }, { BW, 0, 7 },
+			{ GZ, 5, 5 }, { BZ, 4, 4 }, { RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 5 }, { GZ, 0, 3 }, { BX, 0, 4 },
+			{ BZ, 1, 1 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x1A, true, 2, 8, { 5, 5, 6 }, { { RW, 0, 7 }, { BZ, 1, 1 }, { BY, 4, 4 }, { GW, 0, 7 }, { BY, 5, 5 }, { GY, 4, 4 },
+			{ BW, 0, 7 }, { BZ, 5, 4 }, { RX, 0, 4 }, { GZ, 4, 4 }, { GY, 0, 3 }, { GX, 0, 4 }, { BZ, 0, 0 }, { GZ, 0, 3 },
+			{ BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 4 }, { BZ, 2, 2 }, { RZ, 0, 4 }, { BZ, 3, 3 }, { D, 0, 4 } } },
+		{ 0x1E, false, 2, 6, { 6, 6, 6 }, { { RW, 0, 5 }, { GZ, 4, 4 }, { BZ, 0, 1 }, { BY, 4, 4 }, { GW, 0, 5 }, { GY, 5, 5 },
+			{ BY, 5, 5 }, { BZ, 2, 2 }, { GY, 4, 4 }, { BW, 0, 5 }, { GZ, 5, 5 }, { BZ, 3, 3 }, { BZ, 5, 5 }, { BZ, 4, 4 },
+			{ RX, 0, 5 }, { GY, 0, 3 }, { GX, 0, 5 }, { GZ, 0, 3 }, { BX, 0, 5 }, { BY, 0, 3 }, { RY, 0, 5 }, { RZ, 0, 5 },
+			{ D, 0, 4 } } },
+		{ 0x03, false, 1, 10, { 10, 10, 10 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 9 }, { GX, 0, 9 }, { BX, 0, 9 } } },
+		{ 0x07, true, 1, 11, { 9, 9, 9 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 8 }, { RW, 10, 10 }, { GX, 0, 8 },
+			{ GW, 10, 10 }, { BX, 0, 8 }, { BW, 10, 10 } } },
+		{ 0x0B, true, 1, 12, { 8, 8, 8 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 7 }, { RW, 11, 10 }, { GX, 0, 7 },
+			{ GW, 11, 10 }, { BX, 0, 7 }, { BW, 11, 10 } } },
+		{ 0x0F, true, 1, 16, { 4, 4, 4 }, { { RW, 0, 9 }, { GW, 0, 9 }, { BW, 0, 9 }, { RX, 0, 3 }, { RW, 15, 10 }, { GX, 0, 3 },
+			{ GW, 15, 10 }, { BX, 0, 3 }, { BW, 15, 10 } } },
+	};
+
+	inline std::int32_t SignExtend(std::int32_t value, std::uint32_t bits)
+	{
+		std::int32_t shift = 32 - (std::int32_t)bits;
+		return (std::int32_t)((std::uint32_t)value << shift) >> shift;
+	}
+
+	// endpoint to the 16-bit range the interpolation works in.
+	std::int32_t Bc6Unquantize(std::int32_t value, std::uint32_t bits, bool isSigned)
+	{
+		if (!isSigned)
+		{
+			if (bits >= 15 || value == 0)
+				return value;
+			if (value == (1 << bits) - 1)
+				return 0xFFFF;
+			return ((value << 16) + 0x8000) >> bits;
+		}
+
+		if (bits >= 16)
+			return value;
+
+		bool negative = value < 0;
+		std::int32_t magnitude = negative ? -value : value;
+		std::int32_t result;
+		if (magnitude == 0)
+			result = 0;
+		else if (magnitude >= (1 << (bits - 1)) - 1)
+			result = 0x7FFF;
+		else
+			result = ((magnitude << 15) + 0x4000) >> (bits - 1);
+		return negative ? -result : result;
+	}
+
+	// interpolated value to half float bits.
+	std::uint16_t Bc6ToHalf(std::int32_t value, bool isSigned)
+	{
+		if (!isSigned)
+			return (std::uint16_t)((value * 31) >> 6);
+
+		std::uint16_t sign = 0;
+		if (value < 0)
+		{
+			sign = 0x8000;
+			value = -value;
+		}
+		return (std::uint16_t)(sign | ((value * 31) >> 5));
+	}
+
+	void DecodeBC6H(const std::uint8_t* block, bool isSigned, std::uint8_t* texels, std::size_t rowPitch)
+	{
+		BlockBits bits(block);
+		std::uint32_t modeBits = bits.Read(2);
+		if (modeBits >= 2)
+			modeBits |= bits.Read(3) << 2;
+
+		const Bc6Mode* mode = nullptr;
+		for (const Bc6Mode& candidate : Bc6Modes)
+		{
+			if (candidate.ModeBits == modeBits)
+				mode = &candidate;
+		}
+
+		// reserved modes decode to black.
+		if (mode == nullptr)
+		{
+			for (int y = 0; y < 4; ++y)
+			{
+				for (int x = 0; x < 4; ++x)
+				{
+					const std::uint16_t black[4] = { 0, 0, 0, 0x3C00 };
+					std::memcpy(texels + y * rowPitch + 8 * x, black, 8);
+				}
+			}
+			return;
+		}
+
+		// fields[channel * 4 + w/x/y/z], then the partition.
+		std::int32_t fields[13] = {};
+		for (const Bc6Run& run : mode->Runs)
+		{
+			if (run.Field == End)
+				break;
+
+			if (run.Last >= run.First)
+			{
+				fields[run.Field - 1] |= (std::int32_t)bits.Read(run.Last - run.First + 1) << run.First;
+				continue;
+			}
+
+			// a few fields store their top bits reversed.
+			for (int bit = run.First; bit >= run.Last; --bit)
+				fields[run.Field - 1] |= (std::int32_t)bits.Read(1) << bit;
+		}
+
+		std::uint32_t partition = (std::uint32_t)fields[D - 1];
+		std::int32_t ends[4][3];			// w, x, y, z
+		for (int c = 0; c < 3; ++c)
+		{
+			std::int32_t w = fields[c * 4];
+			if (isSigned)
+				w = SignExtend(w, mode->EndpointBits);
+			ends[0][c] = w;
+
+			for (int e = 1; e < 4; ++e)
+			{
+				std::int32_t value = fields[c * 4 + e];
+				if (mode->Transformed)
+				{
+					// deltas are signed whatever the format; the sum wraps to the endpoint precision.
+					value = (w + SignExtend(value, mode->DeltaBits[c])) & ((1 << mode->EndpointBits) - 1);
+					if (isSigned)
+						value = SignExtend(value, mode->EndpointBits);
+				}
+				else if (isSigned)
+				{
+					value = SignExtend(value, mode->EndpointBits);
+				}
+				ends[e][c] = value;
+			}
+		}
+
+		for (int e = 0; e < 4; ++e)
+		{
+			for (int c = 0; c < 3; ++c)
+				ends[e][c] = Bc6Unquantize(ends[e][c], mode->EndpointBits, isSigned);
+		}
+
+		std::uint32_t indexBits = (mode->Subsets == 2) ? 3 : 4;
+		const std::uint8_t* weights = Bc7WeightTable(indexBits);
+		std::uint32_t anchor = (mode->Subsets == 2) ? Bc7Anchors2[partition] : 0;
+		std::uint32_t subsets = (mode->Subsets == 2) ? Bc7Partitions2[partition] : 0;
+
+		std::uint32_t indices[16];
+		bits.ReadIndices(indexBits, 1u | (1u << anchor), indices);
+
+		for (std::uint32_t i = 0; i < 16; ++i)
+		{
+			std::uint32_t subset = (subsets >> i) & 1;
+			std::int32_t w = weights[indices[i]];
+
+			std::uint16_t half[4];
+			for (int c = 0; c < 3; ++c)
+			{
+				std::int32_t value = ((64 - w) * ends[2 * subset][c] + w * ends[2 * subset + 1][c] + 32) >> 6;
+				half[c] = Bc6ToHalf(value, isSigned);
+			}
+			half[3] = 0x3C00;		// 1.0
+
+			std::memcpy(texels + (i / 4) * rowPitch + 8 * (i % 4), half, 8);
+		}
+	}
+
+	// ---------- BC7 ----------
+
+	// the 'count' (4, 8 or 16) entries interpolated between two RGBA endpoints with the
+	// BC7 weights, as packed RGBA8.  SSE2 does two entries, eight channels, per step.
+	void Bc7Palette(const std::uint32_t e0[4], const std::uint32_t e1[4], const std::uint8_t* weights,
+		std::uint32_t count, std::uint32_t* palette)
+	{
+#ifdef BLOCK_DECODER_SSE2
+		// (64 - w) * e0 + w * e1 + 32 >> 6 == e0 + (w * (e1 - e0) + 32 >> 6); the product fits 16 bits.
+		const __m128i low = _mm_set_epi16((short)e0[3], (short)e0[2], (short)e0[1], (short)e0[0],
+			(short)e0[3], (short)e0[2], (short)e0[1], (short)e0[0]);
+		const __m128i high = _mm_set_epi16((short)e1[3], (short)e1[2], (short)e1[1], (short)e1[0],
+			(short)e1[3], (short)e1[2], (short)e1[1], (short)e1[0]);
+		const __m128i delta = _mm_sub_epi16(high, low);
+		const __m128i round = _mm_set1_epi16(32);
+
+		for (std::uint32_t k = 0; k < count; k += 2)
+		{
+			__m128i w = _mm_unpacklo_epi64(_mm_set1_epi16(weights[k]), _mm_set1_epi16(weights[k + 1]));
+			__m128i v = _mm_add_epi16(low, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(delta, w), round), 6));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(palette + k), _mm_packus_epi16(v, v));
+		}
+#else
+		for (std::uint32_t k = 0; k < count; ++k)
+		{
+			std::uint32_t w = weights[k];
+			std::uint32_t rgba[4];
+			for (int c = 0; c < 4; ++c)
+				rgba[c] = ((64 - w) * e0[c] + w * e1[c] + 32) >> 6;
+			palette[k] = PackRGBA(rgba[0], rgba[1], rgba[2], rgba[3]);
+		}
+#endif
+	}
+
+	void DecodeBC7(const std::uint8_t* block, std::uint8_t* texels, std::size_t rowPitch)
+	{
+		// the mode is the number of 0 bits before the first 1.
+		std::uint32_t modeIndex = 0;
+		while (modeIndex < 8 && ((block[0] >> modeIndex) & 1) == 0)
+			++modeIndex;
+
+		// no mode bit set: reserved, decodes to transparent black.
+		if (modeIndex == 8)
+		{
+			FillTexels(0, texels, rowPitch);
+			return;
+		}
+
+		BlockBits bits(block);
+		bits.Read(modeIndex + 1);
+
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+		std::uint32_t partition = bits.Read(mode.PartitionBits);
+		std::uint32_t rotation = bits.Read(mode.RotationBits);
+		std::uint32_t indexSelection = bits.Read(mode.IndexSelectionBits);
+
+		// ends[subset * 2 + end][channel]; all reds first, then greens, blues and alphas.
+		std::uint32_t ends[6][4];
+		for (int c = 0; c < 3; ++c)
+		{
+			for (int e = 0; e < mode.Subsets * 2; ++e)
+				ends[e][c] = bits.Read(mode.ColorBits);
+		}
+		for (int e = 0; e < mode.Subsets * 2; ++e)
+			ends[e][3] = bits.Read(mode.AlphaBits);
+
+		std::uint32_t pbits[6] = {};
+		for (int e = 0; e < mode.Subsets * 2; ++e)
+		{
+			if (mode.EndpointPBits)
+				pbits[e] = bits.Read(1);
+		}
+		if (mode.SharedPBits)
+		{
+			for (int s = 0; s < mode.Subsets; ++s)
+				pbits[2 * s] = pbits[2 * s + 1] = bits.Read(1);
+		}
+
+		std::uint32_t hasP = mode.EndpointPBits | mode.SharedPBits;
+		for (int e = 0; e < mode.Subsets * 2; ++e)
+		{
+			for (int c = 0; c < 3; ++c)
+				ends[e][c] = Bc7Unquantize((ends[e][c] << hasP) | (pbits[e] & hasP), mode.ColorBits + hasP);
+
+			ends[e][3] = (mode.AlphaBits == 0) ? 255 :
+				Bc7Unquantize((ends[e][3] << hasP) | (pbits[e] & hasP), mode.AlphaBits + hasP);
+		}
+
+		// subset of every texel, and the anchors whose index has one bit less.
+		std::uint32_t subsets = 0;
+		std::uint32_t anchor1 = 0, anchor2 = 0;
+		if (mode.Subsets == 2)
+		{
+			for (std::uint32_t i = 0; i < 16; ++i)
+				subsets |= ((Bc7Partitions2[partition] >> i) & 1u) << (2 * i);
+			anchor1 = Bc7Anchors2[partition];
+		}
+		else if (mode.Subsets == 3)
+		{
+			subsets = Bc7Partitions3[partition];
+			anchor1 = Bc7Anchors3Second[partition];
+			anchor2 = Bc7Anchors3Third[partition];
+		}
+
+		std::uint32_t anchors = 1u;
+		if (mode.Subsets > 1)
+			anchors |= 1u << anchor1;
+		if (mode.Subsets > 2)
+			anchors |= 1u << anchor2;
+
+		std::uint32_t indices[16];
+		bits.ReadIndices(mode.IndexBits, anchors, indices);
+
+		std::uint32_t secondary[16] = {};
+		if (mode.SecondaryIndexBits != 0)
+			bits.ReadIndices(mode.SecondaryIndexBits, 1u, secondary);
+
+		// colors take the primary indices and alpha the secondary ones, unless swapped.
+		std::uint32_t colorBits = mode.IndexBits;
+		std::uint32_t alphaBits = mode.IndexBits;
+		const std::uint32_t* colorIndices = indices;
+		const std::uint32_t* alphaIndices = indices;
+		if (mode.SecondaryIndexBits != 0)
+		{
+			alphaBits = mode.SecondaryIndexBits;
+			alphaIndices = secondary;
+			if (indexSelection)
+			{
+				std::swap(colorBits, alphaBits);
+				std::swap(colorIndices, alphaIndices);
+			}
+		}
+
+		// palettes[subset * 16 + index]; modes with separate alpha indices take alpha from a
+		// second palette interpolated with the alpha weights.
+		std::uint32_t colors[3 * 16];
+		std::uint32_t alphas[16];
+		for (int s = 0; s < mode.Subsets; ++s)
+			Bc7Palette(ends[2 * s], ends[2 * s + 1], Bc7WeightTable(colorBits), 1u << colorBits, colors + 16 * s);
+		if (mode.SecondaryIndexBits != 0)
+			Bc7Palette(ends[0], ends[1], Bc7WeightTable(alphaBits), 1u << alphaBits, alphas);
+
+		std::uint32_t rgba[16];
+		if (mode.SecondaryIndexBits == 0)
+		{
+			for (std::uint32_t i = 0; i < 16; ++i)
+				rgba[i] = colors[16 * ((subsets >> (2 * i)) & 3) + colorIndices[i]];
+		}
+		else
+		{
+			for (std::uint32_t i = 0; i < 16; ++i)
+				rgba[i] = (colors[colorIndices[i]] & 0x00FFFFFFu) | (alphas[alphaIndices[i]] & 0xFF000000u);
+		}
+
+		// rotation swaps alpha with red, green or blue.
+		if (rotation != 0)
+		{
+			std::uint32_t shift = 8 * (rotation - 1);
+			for (std::uint32_t i = 0; i < 16; ++i)
+			{
+				std::uint32_t a = rgba[i] >> 24;
+				std::uint32_t c = (rgba[i] >> shift) & 0xFF;
+				rgba[i] = (rgba[i] & ~((0xFFu << shift) | 0xFF000000u)) | (a << shift) | (c << 24);
+			}
+		}
+
+		for (std::uint32_t y = 0; y < 4; ++y)
+			std::memcpy(texels + y * rowPitch, rgba + 4 * y, 16);
+	}
+
+	// ---------- rows of blocks ----------
+
+	void DecodeColorBlocks(BlockFormat format, const std::uint8_t* blocks, std::uint32_t blockCount,
+		std::uint8_t* texels, std::size_t rowPitch)
+	{
+		const std::uint32_t stride = BlockBytes(format);
+		const std::uint32_t colorOffset = (format == BlockFormat::BC1) ? 0 : 8;
+		const bool allowThreeColor = (format == BlockFormat::BC1);
+
+#if defined(BLOCK_DECODER_SSE2)
+		const std::uint32_t grouped = blockCount & ~3u;		// blocks whose palettes are built four at a time
+#else
+		const std::uint32_t grouped = 0;
+#endif
+
+		std::uint32_t palettes[4][4];
+		for (std::uint32_t i = 0; i < blockCount; ++i)
+		{
+			const std::uint8_t* block = blocks + i * stride;
+
+#if defined(BLOCK_DECODER_SSE2)
+			if (i < grouped && (i & 3) == 0)
+				ColorPalettes4(block + colorOffset, stride, allowThreeColor, palettes);
+#endif
+			if (i >= grouped)
+				ColorPalette(block + colorOffset, allowThreeColor, palettes[i & 3]);
+
+			std::uint8_t alpha[16];
+			if (format == BlockFormat::BC2)
+				ExplicitAlpha(block, alpha);
+			else if (format == BlockFormat::BC3)
+				ChannelValues(block, false, alpha);
+
+			EmitColors(block + colorOffset, palettes[i & 3], (format == BlockFormat::BC1) ? nullptr : alpha,
+				texels + 16 * i, rowPitch);
+		}
+	}
+
+	// decodes a row of whole blocks into 4 rows of texels.
+	void DecodeBlockRow(BlockFormat format, const std::uint8_t* blocks, std::uint32_t blockCount,
+		std::uint8_t* texels, std::size_t rowPitch)
+	{
+		const std::uint32_t stride = BlockBytes(format);
+		const std::uint32_t blockTexelBytes = 4 * DecodedTexelBytes(format);
+
+		switch (format)
+		{
+		case BlockFormat::BC1:
+		case BlockFormat::BC2:
+		case BlockFormat::BC3:
+			DecodeColorBlocks(format, blocks, blockCount, texels, rowPitch);
+			break;
+
+		default:
+			for (std::uint32_t i = 0; i < blockCount; ++i)
+				DecodeBlock(format, blocks + i * stride, texels + i * blockTexelBytes, rowPitch);
+			break;
+		}
+	}
+}
+
+std::uint32_t BlockBytes(BlockFormat format)
+{
+	return (format == BlockFormat::BC1 || format == BlockFormat::BC4 || format == BlockFormat::BC4Signed) ? 8 : 16;
+}
+
+std::uint32_t DecodedTexelBytes(BlockFormat format)
+{
+	return (format == BlockFormat::BC6H || format == BlockFormat::BC6HSigned) ? 8 : 4;
+}
+
+void DecodeBlock(BlockFormat format, const std::uint8_t* block, std::uint8_t* texels, std::size_t rowPitch)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC2:
+	case BlockFormat::BC3:
+		DecodeColorBlocks(format, block, 1, texels, rowPitch);
+		break;
+
+	case BlockFormat::BC4:
+	case BlockFormat::BC4Signed:
+	case BlockFormat::BC5:
+	case BlockFormat::BC5Signed:
+	{
+		bool isSigned = (format == BlockFormat::BC4Signed || format == BlockFormat::BC5Signed);
+		bool twoChannels = (format == BlockFormat::BC5 || format == BlockFormat::BC5Signed);
+
+		std::uint8_t red[16], green[16];
+		ChannelValues(block, isSigned, red);
+		if (twoChannels)
+			ChannelValues(block + 8, isSigned, green);
+
+		EmitChannels(red, twoChannels ? green : nullptr, isSigned ? 127 : 255, texels, rowPitch);
+		break;
+	}
+
+	case BlockFormat::BC6H:
+	case BlockFormat::BC6HSigned:
+		DecodeBC6H(block, format == BlockFormat::BC6HSigned, texels, rowPitch);
+		break;
+
+	case BlockFormat::BC7:
+		DecodeBC7(block, texels, rowPitch);
+		break;
+	}
+}
+
+void DecodeBlocks(BlockFormat format, const void* blocks, std::size_t blockRowPitch,
+	std::uint32_t width, std::uint32_t height, void* texels, std::size_t rowPitch)
+{
+	const std::uint32_t blocksWide = (width + 3) / 4;
+	const std::uint32_t blocksHigh = (height + 3) / 4;
+	const std::uint32_t texelBytes = DecodedTexelBytes(format);
+	const std::uint8_t* src = static_cast<const std::uint8_t*>(blocks);
+	std::uint8_t* dest = static_cast<std::uint8_t*>(texels);
+
+	// about 64 KB of texels per chunk of block rows.
+	std::size_t rowBytes = (std::size_t)blocksWide * 16 * texelBytes;
+	std::size_t grain = std::max<std::size_t>(64 * 1024 / std::max<std::size_t>(rowBytes, 1), 1);
+
+	ParallelFor(blocksHigh, grain, [&](std::size_t begin, std::size_t end)
+	{
+		std::vector<std::uint8_t> scratch;
+
+		for (std::size_t by = begin; by < end; ++by)
+		{
+			const std::uint8_t* blockRow = src + by * blockRowPitch;
+			std::uint8_t* out = dest + by * 4 * rowPitch;
+			std::uint32_t rows = std::min(height - (std::uint32_t)by * 4, 4u);
+
+			// whole blocks go straight to the surface; a partial edge goes through scratch.
+			if (rows == 4 && (width & 3) == 0)
+			{
+				DecodeBlockRow(format, blockRow, blocksWide, out, rowPitch);
+				continue;
+			}
+
+			std::size_t scratchPitch = (std::size_t)blocksWide * 4 * texelBytes;
+			scratch.resize(scratchPitch * 4);
+			DecodeBlockRow(format, blockRow, blocksWide, scratch.data(), scratchPitch);
+
+			for (std::uint32_t y = 0; y < rows; ++y)
+				std::memcpy(out + y * rowPitch, scratch.data() + y * scratchPitch, (std::size_t)width * texelBytes);
+		}
+	});
+}
@@ -0,0 +1,1471 @@
+//***************************************************************************************
+// BlockEncoder.cpp
+//***************************************************************************************
+
+#include "BlockEncoder.h"
+#include "BlockTables.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BLOCK_ENCODER_SSE2 1
+#endif
+
+namespace
+{
+	// ---------- shared pieces ----------
+
+	// the 16 texels of a block, as bytes and as one float array per channel (for SSE2).
+	struct BlockTexels
+	{
+		alignas(16) float Channels[4][16];
+		std::uint8_t Rgba[16][4];
+	};
+
+	inline std::uint32_t PackRGBA(std::uint32_t r, std::uint32_t g, std::uint32_t b, std::uint32_t a)
+	{
+		return r | (g << 8) | (b << 16) | (a << 24);
+	}
+
+	inline std::uint32_t Channel(std::uint32_t rgba, int channel)
+	{
+		return (rgba >> (8 * channel)) & 0xFF;
+	}
+
+	inline float Clamp255(float v)
+	{
+		return std::min(std::max(v, 0.0f), 255.0f);
+	}
+
+	// Picks for every texel in 'mask' (bit i: texel i) the nearest of 'count' palette entries,
+	// the squared channel differences scaled by 'weights'.  Returns the error of those texels.
+	float AssignIndices(const BlockTexels& block, std::uint32_t mask, const std::uint32_t* palette,
+		std::uint32_t count, const float weights[4], std::uint8_t indices[16])
+	{
+		float entries[16][4];
+		for (std::uint32_t k = 0; k < count; ++k)
+		{
+			for (int c = 0; c < 4; ++c)
+				entries[k][c] = (float)Channel(palette[k], c);
+		}
+
+		float error = 0.0f;
+#if defined(BLOCK_ENCODER_SSE2)
+		// four texels per iteration, one channel per register.
+		for (int group = 0; group < 16; group += 4)
+		{
+			std::uint32_t groupMask = (mask >> group) & 15;
+			if (groupMask == 0)
+				continue;
+
+			__m128 texel[4];
+			for (int c = 0; c < 4; ++c)
+				texel[c] = _mm_load_ps(&block.Channels[c][group]);
+
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (std::uint32_t k = 0; k < count; ++k)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (int c = 0; c < 4; ++c)
+				{
+					__m128 d = _mm_sub_ps(texel[c], _mm_set1_ps(entries[k][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(_mm_mul_ps(d, d), _mm_set1_ps(weights[c])));
+				}
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int)k)), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			alignas(16) float bestErrors[4];
+			alignas(16) std::int32_t bestIndices[4];
+			_mm_store_ps(bestErrors, best);
+			_mm_store_si128(reinterpret_cast<__m128i*>(bestIndices), bestIndex);
+			for (int j = 0; j < 4; ++j)
+			{
+				if ((groupMask >> j) & 1)
+				{
+					indices[group + j] = (std::uint8_t)bestIndices[j];
+					error += bestErrors[j];
+				}
+			}
+		}
+#else
+		for (int i = 0; i < 16; ++i)
+		{
+			if (((mask >> i) & 1) == 0)
+				continue;
+
+			float best = FLT_MAX;
+			for (std::uint32_t k = 0; k < count; ++k)
+			{
+				float distance = 0.0f;
+				for (int c = 0; c < 4; ++c)
+				{
+					float d = block.Channels[c][i] - entries[k][c];
+					distance += d * d * weights[c];
+				}
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = (std::uint8_t)k;
+				}
+			}
+			error += best;
+		}
+#endif
+		return error;
+	}
+
+#if defined(BLOCK_ENCODER_SSE2)
+	inline float HorizontalSum(__m128 v)
+	{
+		__m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+#endif
+
+	// Mean of the 'mask' texels over 'channels' (bit c: channel c) and the direction they
+	// spread along most.  Returns the error left after projecting them onto that line.
+	float PrincipalAxis(const BlockTexels& block, std::uint32_t mask, std::uint32_t channels, float mean[4], float axis[4])
+	{
+		float count = 0.0f;
+		for (int i = 0; i < 16; ++i)
+			count += (float)((mask >> i) & 1);
+		for (int c = 0; c < 4; ++c)
+			mean[c] = axis[c] = 0.0f;
+		if (count == 0.0f)
+			return 0.0f;
+
+		float covariance[4][4];
+#if defined(BLOCK_ENCODER_SSE2)
+		// four texels per register; lanes outside the mask are zeroed.
+		const __m128i laneBits = _mm_set_epi32(8, 4, 2, 1);
+		__m128 lanes[4];
+		for (int g = 0; g < 4; ++g)
+		{
+			__m128i groupMask = _mm_set1_epi32((int)((mask >> (4 * g)) & 15));
+			lanes[g] = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(groupMask, laneBits), laneBits));
+		}
+
+		__m128 d[4][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			if (((channels >> c) & 1) == 0)
+			{
+				for (int g = 0; g < 4; ++g)
+					d[c][g] = _mm_setzero_ps();
+				continue;
+			}
+
+			__m128 sum = _mm_setzero_ps();
+			for (int g = 0; g < 4; ++g)
+				sum = _mm_add_ps(sum, _mm_and_ps(lanes[g], _mm_load_ps(&block.Channels[c][4 * g])));
+			mean[c] = HorizontalSum(sum) / count;
+
+			__m128 m = _mm_set1_ps(mean[c]);
+			for (int g = 0; g < 4; ++g)
+				d[c][g] = _mm_and_ps(lanes[g], _mm_sub_ps(_mm_load_ps(&block.Channels[c][4 * g]), m));
+		}
+
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = r; c < 4; ++c)
+			{
+				__m128 sum = _mm_mul_ps(d[r][0], d[c][0]);
+				for (int g = 1; g < 4; ++g)
+					sum = _mm_add_ps(sum, _mm_mul_ps(d[r][g], d[c][g]));
+				covariance[r][c] = covariance[c][r] = HorizontalSum(sum);
+			}
+		}
+#else
+		for (int i = 0; i < 16; ++i)
+		{
+			if ((mask >> i) & 1)
+			{
+				for (int c = 0; c < 4; ++c)
+					mean[c] += block.Channels[c][i];
+			}
+		}
+		for (int c = 0; c < 4; ++c)
+			mean[c] = ((channels >> c) & 1) ? mean[c] / count : 0.0f;
+
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+				covariance[r][c] = 0.0f;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			if (((mask >> i) & 1) == 0)
+				continue;
+
+			float d[4];
+			for (int c = 0; c < 4; ++c)
+				d[c] = ((channels >> c) & 1) ? block.Channels[c][i] - mean[c] : 0.0f;
+			for (int r = 0; r < 4; ++r)
+			{
+				for (int c = r; c < 4; ++c)
+					covariance[r][c] += d[r] * d[c];
+			}
+		}
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < r; ++c)
+				covariance[r][c] = covariance[c][r];
+		}
+#endif
+
+		// power iteration, from the row of the channel that varies most.
+		float trace = 0.0f;
+		int widest = 0;
+		for (int c = 0; c < 4; ++c)
+		{
+			trace += covariance[c][c];
+			if (covariance[c][c] > covariance[widest][widest])
+				widest = c;
+		}
+		if (trace == 0.0f)
+			return 0.0f;
+
+		float v[4];
+		for (int c = 0; c < 4; ++c)
+			v[c] = covariance[widest][c];
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float w[4] = {};
+			float largest = 0.0f;
+			for (int r = 0; r < 4; ++r)
+			{
+				for (int c = 0; c < 4; ++c)
+					w[r] += covariance[r][c] * v[c];
+				largest = std::max(largest, std::fabs(w[r]));
+			}
+			if (largest == 0.0f)
+				break;
+			for (int c = 0; c < 4; ++c)
+				v[c] = w[c] / largest;
+		}
+
+		float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2] + v[3] * v[3]);
+		if (length == 0.0f)
+			return trace;
+
+		float spread = 0.0f;
+		for (int r = 0; r < 4; ++r)
+		{
+			axis[r] = v[r] / length;
+			for (int c = 0; c < 4; ++c)
+				spread += axis[r] * covariance[r][c] * v[c] / length;
+		}
+		return std::max(trace - spread, 0.0f);
+	}
+
+	// the ends of the line through 'mean' along 'axis' that covers the 'mask' texels.
+	void AxisEndpoints(const BlockTexels& block, std::uint32_t mask, const float mean[4], const float axis[4], float ends[2][4])
+	{
+		float low = FLT_MAX, high = -FLT_MAX;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (((mask >> i) & 1) == 0)
+				continue;
+
+			float t = 0.0f;
+			for (int c = 0; c < 4; ++c)
+				t += (block.Channels[c][i] - mean[c]) * axis[c];
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+
+		for (int c = 0; c < 4; ++c)
+		{
+			ends[0][c] = Clamp255(mean[c] + low * axis[c]);
+			ends[1][c] = Clamp255(mean[c] + high * axis[c]);
+		}
+	}
+
+	// Endpoints that best reproduce the 'mask' texels with the interpolation weights their
+	// indices select (least squares, every channel apart).  False when the weights cannot
+	// tell the endpoints apart.
+	bool SolveEndpoints(const BlockTexels& block, std::uint32_t mask, const std::uint8_t indices[16],
+		const float* weights, float ends[2][4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float xa[4] = {}, xb[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (((mask >> i) & 1) == 0)
+				continue;
+
+			float b = weights[indices[i]];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < 4; ++c)
+			{
+				xa[c] += a * block.Channels[c][i];
+				xb[c] += b * block.Channels[c][i];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+
+		for (int c = 0; c < 4; ++c)
+		{
+			ends[0][c] = Clamp255((bb * xa[c] - ab * xb[c]) / determinant);
+			ends[1][c] = Clamp255((aa * xb[c] - ab * xa[c]) / determinant);
+		}
+		return true;
+	}
+
+	// ---------- BC1-BC3 color ----------
+
+	const float ColorWeights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+	const float FourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	const float ThreeColorWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+	inline std::uint32_t Expand5(std::uint32_t v) { return (v * 33) >> 2; }
+	inline std::uint32_t Expand6(std::uint32_t v) { return (v * 65) >> 4; }
+
+	inline std::uint32_t Expand565(std::uint32_t c)
+	{
+		return PackRGBA(Expand5((c >> 11) & 31), Expand6((c >> 5) & 63), Expand5(c & 31), 255);
+	}
+
+	// the 5 or 6 bit value whose expansion is nearest to v.
+	std::uint32_t Quantize565Channel(float v, std::uint32_t bits)
+	{
+		int max = (1 << bits) - 1;
+		int guess = (int)std::floor(v * max / 255.0f + 0.5f);
+
+		std::uint32_t best = 0;
+		float bestError = FLT_MAX;
+		for (int q = std::max(guess - 1, 0); q <= std::min(guess + 1, max); ++q)
+		{
+			float error = std::fabs((float)((bits == 5) ? Expand5(q) : Expand6(q)) - v);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = (std::uint32_t)q;
+			}
+		}
+		return best;
+	}
+
+	std::uint32_t Quantize565(const float rgb[4])
+	{
+		return (Quantize565Channel(rgb[0], 5) << 11) | (Quantize565Channel(rgb[1], 6) << 5) | Quantize565Channel(rgb[2], 5);
+	}
+
+	// the palette the decoder builds; the endpoint order does not change the entries.
+	void ColorPalette(std::uint32_t c0, std::uint32_t c1, bool threeColor, std::uint32_t palette[4])
+	{
+		palette[0] = Expand565(c0);
+		palette[1] = Expand565(c1);
+
+		std::uint32_t c2[3], c3[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			std::uint32_t a = Channel(palette[0], c);
+			std::uint32_t b = Channel(palette[1], c);
+			c2[c] = threeColor ? (a + b + 1) >> 1 : (2 * a + b + 1) / 3;
+			c3[c] = threeColor ? 0 : (a + 2 * b + 1) / 3;
+		}
+		palette[2] = PackRGBA(c2[0], c2[1], c2[2], 255);
+		palette[3] = PackRGBA(c3[0], c3[1], c3[2], 255);
+	}
+
+	// For every 8-bit value, the 5 and 6 bit endpoint pairs whose index 2 (two thirds of the
+	// first, one of the second) comes closest: the best encoding of a single-color block.
+	struct SolidColorTables
+	{
+		std::uint8_t Ends5[256][2];
+		std::uint8_t Ends6[256][2];
+
+		SolidColorTables()
+		{
+			Build(5, Ends5);
+			Build(6, Ends6);
+		}
+
+		static void Build(std::uint32_t bits, std::uint8_t ends[256][2])
+		{
+			std::uint32_t max = (1u << bits) - 1;
+			for (int v = 0; v < 256; ++v)
+			{
+				int bestError = 256;
+				for (std::uint32_t a = 0; a <= max; ++a)
+				{
+					for (std::uint32_t b = 0; b <= max; ++b)
+					{
+						int ea = (int)((bits == 5) ? Expand5(a) : Expand6(a));
+						int eb = (int)((bits == 5) ? Expand5(b) : Expand6(b));
+						int error = std::abs((2 * ea + eb + 1) / 3 - v);
+						if (error < bestError)
+						{
+							bestError = error;
+							ends[v][0] = (std::uint8_t)a;
+							ends[v][1] = (std::uint8_t)b;
+						}
+					}
+				}
+			}
+		}
+	};
+
+	const SolidColorTables& SolidColors()
+	{
+		static const SolidColorTables tables;
+		return tables;
+	}
+
+	struct ColorFit
+	{
+		std::uint32_t C0 = 0;				// 565 endpoints
+		std::uint32_t C1 = 0;
+		bool ThreeColor = false;
+		std::uint8_t Indices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	// Assigns the 'mask' texels to the palette of c0 and c1; keeps the result in 'best' if better.
+	bool TryColorEndpoints(const BlockTexels& block, std::uint32_t mask, std::uint32_t c0, std::uint32_t c1,
+		bool threeColor, ColorFit& best)
+	{
+		std::uint32_t palette[4];
+		ColorPalette(c0, c1, threeColor, palette);
+
+		ColorFit fit;
+		fit.C0 = c0;
+		fit.C1 = c1;
+		fit.ThreeColor = threeColor;
+		fit.Error = AssignIndices(block, mask, palette, threeColor ? 3 : 4, ColorWeights, fit.Indices);
+		if (fit.Error >= best.Error)
+			return false;
+
+		best = fit;
+		return true;
+	}
+
+	// least-squares passes over 'best' until they stop helping.
+	void RefineColor(const BlockTexels& block, std::uint32_t mask, int iterations, ColorFit& best)
+	{
+		for (int iteration = 0; iteration < iterations && best.Error > 0.0f; ++iteration)
+		{
+			float ends[2][4];
+			if (!SolveEndpoints(block, mask, best.Indices, best.ThreeColor ? ThreeColorWeights : FourColorWeights, ends))
+				break;
+			if (!TryColorEndpoints(block, mask, Quantize565(ends[0]), Quantize565(ends[1]), best.ThreeColor, best))
+				break;
+		}
+	}
+
+	// moves each endpoint channel one step at a time while that lowers the error.
+	void SearchColorNeighbours(const BlockTexels& block, std::uint32_t mask, ColorFit& best)
+	{
+		static const std::uint32_t Shifts[3] = { 11, 5, 0 };
+		static const std::uint32_t Maxima[3] = { 31, 63, 31 };
+
+		for (int round = 0; round < 4 && best.Error > 0.0f; ++round)
+		{
+			bool improved = false;
+			for (int e = 0; e < 2; ++e)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					for (int step = -1; step <= 1; step += 2)
+					{
+						std::uint32_t ends[2] = { best.C0, best.C1 };
+						int value = (int)((ends[e] >> Shifts[c]) & Maxima[c]) + step;
+						if (value < 0 || value > (int)Maxima[c])
+							continue;
+
+						ends[e] = (ends[e] & ~(Maxima[c] << Shifts[c])) | ((std::uint32_t)value << Shifts[c]);
+						improved |= TryColorEndpoints(block, mask, ends[0], ends[1], best.ThreeColor, best);
+					}
+				}
+			}
+			if (!improved)
+				break;
+		}
+	}
+
+	void WriteColorBlock(const ColorFit& fit, std::uint32_t transparent, std::uint8_t* out)
+	{
+		std::uint32_t c0 = fit.C0, c1 = fit.C1;
+		std::uint8_t indices[16];
+		std::memcpy(indices, fit.Indices, sizeof(indices));
+
+		// the endpoint order selects the mode: c0 > c1 for four colors, c0 <= c1 for three.
+		static const std::uint8_t SwapFour[4] = { 1, 0, 3, 2 };
+		static const std::uint8_t SwapThree[4] = { 1, 0, 2, 3 };
+		if (fit.ThreeColor)
+		{
+			if (c0 > c1)
+			{
+				std::swap(c0, c1);
+				for (auto& index : indices)
+					index = SwapThree[index];
+			}
+		}
+		else if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			for (auto& index : indices)
+				index = SwapFour[index];
+		}
+		else if (c0 == c1)
+		{
+			// reads as three colors in BC1: only the first entry is safe.
+			std::memset(indices, 0, sizeof(indices));
+		}
+
+		std::uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			std::uint32_t index = ((transparent >> i) & 1) ? 3 : indices[i];
+			bits |= index << (2 * i);
+		}
+
+		out[0] = (std::uint8_t)c0;
+		out[1] = (std::uint8_t)(c0 >> 8);
+		out[2] = (std::uint8_t)c1;
+		out[3] = (std::uint8_t)(c1 >> 8);
+		std::memcpy(out + 4, &bits, 4);
+	}
+
+	// The color half of BC1-BC3.  BC1 ('punchThrough') makes texels with alpha below 128
+	// transparent, which needs the three color mode.
+	void EncodeColor(const BlockTexels& block, EncodeQuality quality, bool punchThrough, std::uint8_t* out)
+	{
+		std::uint32_t transparent = 0;
+		if (punchThrough)
+		{
+			for (int i = 0; i < 16; ++i)
+				transparent |= (block.Rgba[i][3] < 128) ? 1u << i : 0u;
+		}
+		std::uint32_t mask = ~transparent & 0xFFFF;
+		bool threeColor = (transparent != 0);
+
+		ColorFit best;
+		if (mask == 0)
+		{
+			best.ThreeColor = true;
+			WriteColorBlock(best, transparent, out);
+			return;
+		}
+
+		int first = 0;
+		while (((mask >> first) & 1) == 0)
+			++first;
+
+		bool solid = true;
+		for (int i = 0; i < 16 && solid; ++i)
+		{
+			if ((mask >> i) & 1)
+				solid = std::memcmp(block.Rgba[i], block.Rgba[first], 3) == 0;
+		}
+
+		if (solid)
+		{
+			const std::uint8_t* rgb = block.Rgba[first];
+			float color[4] = { (float)rgb[0], (float)rgb[1], (float)rgb[2], 0.0f };
+			std::uint32_t nearest = Quantize565(color);
+			TryColorEndpoints(block, mask, nearest, nearest, threeColor, best);
+
+			if (!threeColor)
+			{
+				const SolidColorTables& tables = SolidColors();
+				std::uint32_t c0 = (tables.Ends5[rgb[0]][0] << 11) | (tables.Ends6[rgb[1]][0] << 5) | tables.Ends5[rgb[2]][0];
+				std::uint32_t c1 = (tables.Ends5[rgb[0]][1] << 11) | (tables.Ends6[rgb[1]][1] << 5) | tables.Ends5[rgb[2]][1];
+				TryColorEndpoints(block, mask, c0, c1, false, best);
+			}
+
+			WriteColorBlock(best, transparent, out);
+			return;
+		}
+
+		float ends[2][4];
+		if (quality == EncodeQuality::Fast)
+		{
+			// bounding box, inset by a sixteenth, on the diagonal the colors follow.
+			float low[3] = { 255.0f, 255.0f, 255.0f }, high[3] = { 0.0f, 0.0f, 0.0f };
+			float mean[3] = {};
+			float count = 0.0f;
+			for (int i = 0; i < 16; ++i)
+			{
+				if ((mask >> i) & 1)
+				{
+					for (int c = 0; c < 3; ++c)
+					{
+						low[c] = std::min(low[c], block.Channels[c][i]);
+						high[c] = std::max(high[c], block.Channels[c][i]);
+						mean[c] += block.Channels[c][i];
+					}
+					count += 1.0f;
+				}
+			}
+
+			float covariance[3] = {};		// of red and blue with green
+			for (int i = 0; i < 16; ++i)
+			{
+				if ((mask >> i) & 1)
+				{
+					float g = block.Channels[1][i] - mean[1] / count;
+					covariance[0] += (block.Channels[0][i] - mean[0] / count) * g;
+					covariance[2] += (block.Channels[2][i] - mean[2] / count) * g;
+				}
+			}
+
+			for (int c = 0; c < 3; ++c)
+			{
+				float inset = (high[c] - low[c]) / 16.0f;
+				ends[0][c] = high[c] - inset;
+				ends[1][c] = low[c] + inset;
+			}
+			for (int c = 0; c < 3; c += 2)
+			{
+				if (covariance[c] < 0.0f)
+					std::swap(ends[0][c], ends[1][c]);
+			}
+		}
+		else
+		{
+			float mean[4], axis[4];
+			PrincipalAxis(block, mask, 7, mean, axis);
+			AxisEndpoints(block, mask, mean, axis, ends);
+		}
+
+		TryColorEndpoints(block, mask, Quantize565(ends[0]), Quantize565(ends[1]), threeColor, best);
+
+		int iterations = (quality == EncodeQuality::Fast) ? 0 : (quality == EncodeQuality::Normal) ? 2 : 8;
+		RefineColor(block, mask, iterations, best);
+
+		if (quality == EncodeQuality::Best)
+		{
+			// opaque BC1 blocks may still do better with three colors.
+			if (punchThrough && !threeColor)
+			{
+				ColorFit three = best;
+				three.Error = FLT_MAX;
+				TryColorEndpoints(block, mask, best.C0, best.C1, true, three);
+				RefineColor(block, mask, iterations, three);
+				if (three.Error < best.Error)
+					best = three;
+			}
+			SearchColorNeighbours(block, mask, best);
+		}
+
+		WriteColorBlock(best, transparent, out);
+	}
+
+	// ---------- BC2 alpha ----------
+
+	void EncodeExplicitAlpha(const BlockTexels& block, std::uint8_t* out)
+	{
+		std::memset(out, 0, 8);
+		for (int i = 0; i < 16; ++i)
+			out[i / 2] |= (std::uint8_t)(((block.Rgba[i][3] + 8) / 17) << (4 * (i & 1)));
+	}
+
+	// ---------- BC3 alpha, BC4 and BC5 channels ----------
+
+	// the decoder's palette: six values between e0 and e1 (e0 > e1), or four plus 0 and 255.
+	void ChannelPalette(std::uint32_t e0, std::uint32_t e1, std::uint8_t palette[8])
+	{
+		palette[0] = (std::uint8_t)e0;
+		palette[1] = (std::uint8_t)e1;
+		if (e0 > e1)
+		{
+			for (std::uint32_t i = 1; i < 7; ++i)
+				palette[i + 1] = (std::uint8_t)(((7 - i) * e0 + i * e1 + 3) / 7);
+		}
+		else
+		{
+			for (std::uint32_t i = 1; i < 5; ++i)
+				palette[i + 1] = (std::uint8_t)(((5 - i) * e0 + i * e1 + 2) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// nearest palette entry of every value; returns the squared error.
+	std::uint32_t ChannelIndices(const std::uint8_t values[16], const std::uint8_t palette[8], std::uint8_t indices[16])
+	{
+		std::uint8_t distances[16];
+#if defined(BLOCK_ENCODER_SSE2)
+		// all 16 texels in one register: byte distances are |v - p| through saturating subtracts.
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+		__m128i best = _mm_set1_epi8(-1);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int k = 0; k < 8; ++k)
+		{
+			__m128i p = _mm_set1_epi8((char)palette[k]);
+			__m128i d = _mm_or_si128(_mm_subs_epu8(v, p), _mm_subs_epu8(p, v));
+			__m128i notCloser = _mm_cmpeq_epi8(_mm_min_epu8(best, d), best);
+			best = _mm_min_epu8(best, d);
+			bestIndex = _mm_or_si128(_mm_and_si128(notCloser, bestIndex), _mm_andnot_si128(notCloser, _mm_set1_epi8((char)k)));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(distances), best);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+#else
+		for (int i = 0; i < 16; ++i)
+		{
+			distances[i] = 255;
+			for (int k = 0; k < 8; ++k)
+			{
+				std::uint8_t d = (std::uint8_t)std::abs((int)values[i] - (int)palette[k]);
+				if (d < distances[i] || k == 0)
+				{
+					distances[i] = d;
+					indices[i] = (std::uint8_t)k;
+				}
+			}
+		}
+#endif
+		std::uint32_t error = 0;
+		for (int i = 0; i < 16; ++i)
+			error += (std::uint32_t)distances[i] * distances[i];
+		return error;
+	}
+
+	struct ChannelFit
+	{
+		std::uint32_t E0 = 0;
+		std::uint32_t E1 = 0;
+		std::uint8_t Indices[16] = {};
+		std::uint32_t Error = ~0u;
+	};
+
+	void TryChannelEndpoints(const std::uint8_t values[16], int e0, int e1, ChannelFit& best)
+	{
+		if (e0 < 0 || e0 > 255 || e1 < 0 || e1 > 255)
+			return;
+
+		std::uint8_t palette[8];
+		ChannelPalette((std::uint32_t)e0, (std::uint32_t)e1, palette);
+
+		ChannelFit fit;
+		fit.E0 = (std::uint32_t)e0;
+		fit.E1 = (std::uint32_t)e1;
+		fit.Error = ChannelIndices(values, palette, fit.Indices);
+		if (fit.Error < best.Error)
+			best = fit;
+	}
+
+	// one BC4-style block (BC3 alpha, BC4, either half of BC5).
+	void EncodeChannel(const std::uint8_t values[16], EncodeQuality quality, std::uint8_t* out)
+	{
+		int low = 255, high = 0;				// all values
+		int innerLow = 255, innerHigh = 0;		// without 0 and 255, which six-value blocks have anyway
+		for (int i = 0; i < 16; ++i)
+		{
+			low = std::min(low, (int)values[i]);
+			high = std::max(high, (int)values[i]);
+			if (values[i] != 0 && values[i] != 255)
+			{
+				innerLow = std::min(innerLow, (int)values[i]);
+				innerHigh = std::max(innerHigh, (int)values[i]);
+			}
+		}
+
+		ChannelFit best;
+		TryChannelEndpoints(values, high, low, best);			// eight values (six values when high == low)
+
+		if (quality != EncodeQuality::Fast)
+		{
+			if (innerLow <= innerHigh)
+				TryChannelEndpoints(values, innerLow, innerHigh, best);
+
+			// a window around the ends of the range, both modes.
+			int radius = (quality == EncodeQuality::Best) ? 4 : 1;
+			for (int a = -radius; a <= radius && best.Error > 0; ++a)
+			{
+				for (int b = -radius; b <= radius; ++b)
+				{
+					if (high + a > low + b)
+						TryChannelEndpoints(values, high + a, low + b, best);
+					if (innerLow <= innerHigh && innerLow + a <= innerHigh + b)
+						TryChannelEndpoints(values, innerLow + a, innerHigh + b, best);
+				}
+			}
+		}
+
+		out[0] = (std::uint8_t)best.E0;
+		out[1] = (std::uint8_t)best.E1;
+		std::uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= (std::uint64_t)best.Indices[i] << (3 * i);
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = (std::uint8_t)(bits >> (8 * i));
+	}
+
+	void EncodeChannelOf(const BlockTexels& block, int channel, EncodeQuality quality, std::uint8_t* out)
+	{
+		std::uint8_t values[16];
+		for (int i = 0; i < 16; ++i)
+			values[i] = block.Rgba[i][channel];
+		EncodeChannel(values, quality, out);
+	}
+
+	// ---------- BC7 ----------
+
+	enum class PBitMode { None, PerEndpoint, Shared };
+
+	// what one pair of endpoints stores: the channels fitted (bit c: channel c), their bits
+	// without the p-bit, the p-bits and the index bits.
+	struct FitSpec
+	{
+		std::uint32_t Channels;
+		std::uint32_t ColorBits;
+		std::uint32_t AlphaBits;			// 0: alpha is not stored and decodes as 255
+		PBitMode PBits;
+		std::uint32_t IndexBits;
+	};
+
+	struct EndpointFit
+	{
+		std::uint8_t Ends[2][4] = {};		// quantized, p-bit not included
+		std::uint8_t PBits[2] = {};
+		std::uint8_t Indices[16] = {};
+		float Error = FLT_MAX;
+	};
+
+	// the stored value nearest to v once unquantized with p-bit 'pbit' appended (when hasPBit).
+	std::uint32_t QuantizeBc7(float v, std::uint32_t bits, bool hasPBit, std::uint32_t pbit, float& error)
+	{
+		std::uint32_t total = bits + (hasPBit ? 1 : 0);
+		int max = (1 << bits) - 1;
+		float scaled = v * (float)((1u << total) - 1) / 255.0f;
+		int guess = hasPBit ? (int)std::floor((scaled - pbit) * 0.5f + 0.5f) : (int)std::floor(scaled + 0.5f);
+
+		std::uint32_t best = 0;
+		error = FLT_MAX;
+		for (int q = std::max(guess - 1, 0); q <= std::min(guess + 1, max); ++q)
+		{
+			std::uint32_t stored = hasPBit ? ((std::uint32_t)q << 1) | pbit : (std::uint32_t)q;
+			float d = (float)Bc7Unquantize(stored, total) - v;
+			if (d * d < error)
+			{
+				error = d * d;
+				best = (std::uint32_t)q;
+			}
+		}
+		return best;
+	}
+
+	std::uint32_t Unquantized(const FitSpec& spec, const EndpointFit& fit, int e, int c)
+	{
+		if (((spec.Channels >> c) & 1) == 0)
+			return (c == 3) ? 255 : 0;
+
+		std::uint32_t bits = (c < 3) ? spec.ColorBits : spec.AlphaBits;
+		if (spec.PBits == PBitMode::None)
+			return Bc7Unquantize(fit.Ends[e][c], bits);
+		return Bc7Unquantize(((std::uint32_t)fit.Ends[e][c] << 1) | fit.PBits[e], bits + 1);
+	}
+
+	// quantizes 'ends' with the given p-bits; returns the squared error of the endpoints.
+	float QuantizeEndpoints(const FitSpec& spec, const float ends[2][4], std::uint32_t p0, std::uint32_t p1, EndpointFit& fit)
+	{
+		float total = 0.0f;
+		for (int e = 0; e < 2; ++e)
+		{
+			fit.PBits[e] = (std::uint8_t)(e == 0 ? p0 : p1);
+			for (int c = 0; c < 4; ++c)
+			{
+				if (((spec.Channels >> c) & 1) == 0)
+					continue;
+
+				float error;
+				fit.Ends[e][c] = (std::uint8_t)QuantizeBc7(ends[e][c], (c < 3) ? spec.ColorBits : spec.AlphaBits,
+					spec.PBits != PBitMode::None, fit.PBits[e], error);
+				total += error;
+			}
+		}
+		return total;
+	}
+
+	void EvaluateEndpoints(const BlockTexels& block, std::uint32_t mask, const FitSpec& spec, EndpointFit& fit)
+	{
+		std::uint32_t e0[4], e1[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			e0[c] = Unquantized(spec, fit, 0, c);
+			e1[c] = Unquantized(spec, fit, 1, c);
+		}
+
+		std::uint32_t count = 1u << spec.IndexBits;
+		const std::uint8_t* weights = Bc7WeightTable(spec.IndexBits);
+		std::uint32_t palette[16];
+		for (std::uint32_t k = 0; k < count; ++k)
+		{
+			std::uint32_t w = weights[k];
+			std::uint32_t rgba[4];
+			for (int c = 0; c < 4; ++c)
+				rgba[c] = ((64 - w) * e0[c] + w * e1[c] + 32) >> 6;
+			palette[k] = PackRGBA(rgba[0], rgba[1], rgba[2], rgba[3]);
+		}
+
+		// channels outside the fit belong to the other index set (modes 4 and 5), or are alpha
+		// that decodes as 255: the caller accounts for that.
+		float channelWeights[4];
+		for (int c = 0; c < 4; ++c)
+			channelWeights[c] = ((spec.Channels >> c) & 1) ? 1.0f : 0.0f;
+		fit.Error = AssignIndices(block, mask, palette, count, channelWeights, fit.Indices);
+	}
+
+	// Quantizes 'ends' and assigns the 'mask' texels; keeps the result in 'best' when better.
+	// Without 'searchPBits' only the p-bits that quantize the endpoints best are tried.
+	bool TryEndpoints(const BlockTexels& block, std::uint32_t mask, const FitSpec& spec, const float ends[2][4],
+		bool searchPBits, EndpointFit& best)
+	{
+		static const std::uint32_t Pairs[4][2] = { { 0, 0 }, { 1, 1 }, { 0, 1 }, { 1, 0 } };
+		std::uint32_t pairCount = (spec.PBits == PBitMode::None) ? 1 : (spec.PBits == PBitMode::Shared) ? 2 : 4;
+
+		std::uint32_t first = 0;
+		if (!searchPBits && pairCount > 1)
+		{
+			float bestError = FLT_MAX;
+			for (std::uint32_t p = 0; p < pairCount; ++p)
+			{
+				EndpointFit scratch;
+				float error = QuantizeEndpoints(spec, ends, Pairs[p][0], Pairs[p][1], scratch);
+				if (error < bestError)
+				{
+					bestError = error;
+					first = p;
+				}
+			}
+			pairCount = first + 1;
+		}
+
+		bool improved = false;
+		for (std::uint32_t p = first; p < pairCount; ++p)
+		{
+			EndpointFit fit;
+			QuantizeEndpoints(spec, ends, Pairs[p][0], Pairs[p][1], fit);
+			EvaluateEndpoints(block, mask, spec, fit);
+			if (fit.Error < best.Error)
+			{
+				best = fit;
+				improved = true;
+			}
+		}
+		return improved;
+	}
+
+	// endpoints for the 'mask' texels: the principal axis, then least-squares passes.
+	void FitEndpoints(const BlockTexels& block, std::uint32_t mask, const FitSpec& spec, int iterations,
+		bool searchPBits, EndpointFit& best)
+	{
+		best = EndpointFit();
+		if (mask == 0)
+		{
+			best.Error = 0.0f;
+			return;
+		}
+
+		float mean[4], axis[4], ends[2][4];
+		PrincipalAxis(block, mask, spec.Channels, mean, axis);
+		AxisEndpoints(block, mask, mean, axis, ends);
+		TryEndpoints(block, mask, spec, ends, searchPBits, best);
+
+		float weights[16];
+		const std::uint8_t* table = Bc7WeightTable(spec.IndexBits);
+		for (std::uint32_t k = 0; k < (1u << spec.IndexBits); ++k)
+			weights[k] = table[k] / 64.0f;
+
+		for (int iteration = 0; iteration < iterations && best.Error > 0.0f; ++iteration)
+		{
+			if (!SolveEndpoints(block, mask, best.Indices, weights, ends))
+				break;
+			if (!TryEndpoints(block, mask, spec, ends, searchPBits, best))
+				break;
+		}
+	}
+
+	// one candidate encoding; modes 4 and 5 keep color in Subsets[0] and alpha in Subsets[1].
+	struct Bc7Block
+	{
+		std::uint32_t Mode = 0;
+		std::uint32_t Partition = 0;
+		std::uint32_t Rotation = 0;
+		std::uint32_t IndexSelection = 0;
+		EndpointFit Subsets[3];
+		float Error = FLT_MAX;
+	};
+
+	// texels of every subset (bit i: texel i).
+	void SubsetMasks(std::uint32_t subsets, std::uint32_t partition, std::uint32_t masks[3])
+	{
+		masks[0] = masks[1] = masks[2] = 0;
+		if (subsets == 1)
+		{
+			masks[0] = 0xFFFF;
+		}
+		else if (subsets == 2)
+		{
+			masks[1] = Bc7Partitions2[partition];
+			masks[0] = ~masks[1] & 0xFFFF;
+		}
+		else
+		{
+			for (std::uint32_t i = 0; i < 16; ++i)
+				masks[(Bc7Partitions3[partition] >> (2 * i)) & 3] |= 1u << i;
+		}
+	}
+
+	// the error a partition leaves after fitting a line through each subset, unquantized: a
+	// cheap way to rank partitions.
+	float PartitionEstimate(const BlockTexels& block, std::uint32_t subsets, std::uint32_t partition, std::uint32_t channels)
+	{
+		std::uint32_t masks[3];
+		SubsetMasks(subsets, partition, masks);
+
+		float error = 0.0f;
+		for (std::uint32_t s = 0; s < subsets; ++s)
+		{
+			float mean[4], axis[4];
+			error += PrincipalAxis(block, masks[s], channels, mean, axis);
+		}
+		return error;
+	}
+
+	// Encodes the block in one mode (and partition, rotation, index selection); keeps the
+	// result in 'best' when better.  'opaqueError' is what decoding alpha as 255 costs.
+	void EncodeBc7Mode(const BlockTexels& block, std::uint32_t modeIndex, std::uint32_t partition, std::uint32_t rotation,
+		std::uint32_t indexSelection, int iterations, bool searchPBits, float opaqueError, Bc7Block& best)
+	{
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+
+		Bc7Block candidate;
+		candidate.Mode = modeIndex;
+		candidate.Partition = partition;
+		candidate.Rotation = rotation;
+		candidate.IndexSelection = indexSelection;
+
+		if (mode.SecondaryIndexBits != 0)
+		{
+			// modes 4 and 5: color and alpha fitted apart, after the rotation swaps alpha in.
+			BlockTexels rotated = block;
+			if (rotation != 0)
+			{
+				for (int i = 0; i < 16; ++i)
+				{
+					std::swap(rotated.Channels[3][i], rotated.Channels[rotation - 1][i]);
+					std::swap(rotated.Rgba[i][3], rotated.Rgba[i][rotation - 1]);
+				}
+			}
+
+			std::uint32_t colorIndexBits = indexSelection ? mode.SecondaryIndexBits : mode.IndexBits;
+			std::uint32_t alphaIndexBits = indexSelection ? mode.IndexBits : mode.SecondaryIndexBits;
+			FitSpec color = { 7, mode.ColorBits, 0, PBitMode::None, colorIndexBits };
+			FitSpec alpha = { 8, mode.ColorBits, mode.AlphaBits, PBitMode::None, alphaIndexBits };
+
+			FitEndpoints(rotated, 0xFFFF, color, iterations, false, candidate.Subsets[0]);
+			FitEndpoints(rotated, 0xFFFF, alpha, iterations, false, candidate.Subsets[1]);
+			candidate.Error = candidate.Subsets[0].Error + candidate.Subsets[1].Error;
+		}
+		else
+		{
+			PBitMode pbits = mode.EndpointPBits ? PBitMode::PerEndpoint : mode.SharedPBits ? PBitMode::Shared : PBitMode::None;
+			FitSpec spec = { mode.AlphaBits ? 15u : 7u, mode.ColorBits, mode.AlphaBits, pbits, mode.IndexBits };
+
+			std::uint32_t masks[3];
+			SubsetMasks(mode.Subsets, partition, masks);
+
+			candidate.Error = mode.AlphaBits ? 0.0f : opaqueError;
+			for (std::uint32_t s = 0; s < mode.Subsets && candidate.Error < best.Error; ++s)
+			{
+				FitEndpoints(block, masks[s], spec, iterations, searchPBits, candidate.Subsets[s]);
+				candidate.Error += candidate.Subsets[s].Error;
+			}
+		}
+
+		if (candidate.Error < best.Error)
+			best = candidate;
+	}
+
+	struct RankedPartition
+	{
+		float Error;
+		std::uint32_t Partition;
+	};
+
+	const std::uint32_t Finalists = 4;
+
+	// The partitions the line-fit estimate ranks first; modes with the same subset count and
+	// channels (1 and 3) share it.
+	struct PartitionShortlist
+	{
+		std::uint32_t Subsets = 0;
+		std::uint32_t Channels = 0;
+		std::uint32_t Count = 0;
+		std::uint32_t Partitions[Finalists];
+	};
+
+	// sorts the first 'finalists' of 'count' partitions to the front.
+	void RankPartitions(RankedPartition* ranked, std::uint32_t count, std::uint32_t finalists)
+	{
+		std::partial_sort(ranked, ranked + finalists, ranked + count,
+			[](const RankedPartition& a, const RankedPartition& b) { return a.Error < b.Error; });
+	}
+
+	// The partitioned modes: ranks the partitions (Best fits every one quickly, Normal only
+	// estimates), then fits the most promising ones fully.
+	void SearchPartitions(const BlockTexels& block, std::uint32_t modeIndex, EncodeQuality quality,
+		int iterations, float opaqueError, PartitionShortlist& shortlist, Bc7Block& best)
+	{
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+		const std::uint32_t partitions = 1u << mode.PartitionBits;
+		const std::uint32_t finalists = std::min(Finalists, partitions);
+		const std::uint32_t channels = mode.AlphaBits ? 15u : 7u;
+
+		RankedPartition ranked[64];
+		if (quality == EncodeQuality::Best)
+		{
+			for (std::uint32_t p = 0; p < partitions; ++p)
+			{
+				Bc7Block quick;
+				EncodeBc7Mode(block, modeIndex, p, 0, 0, 1, false, opaqueError, quick);
+				ranked[p] = { quick.Error, p };
+			}
+			RankPartitions(ranked, partitions, finalists);
+		}
+		else
+		{
+			if (shortlist.Subsets != mode.Subsets || shortlist.Channels != channels || shortlist.Count != finalists)
+			{
+				for (std::uint32_t p = 0; p < partitions; ++p)
+					ranked[p] = { PartitionEstimate(block, mode.Subsets, p, channels), p };
+				RankPartitions(ranked, partitions, finalists);
+
+				shortlist.Subsets = mode.Subsets;
+				shortlist.Channels = channels;
+				shortlist.Count = finalists;
+				for (std::uint32_t i = 0; i < finalists; ++i)
+					shortlist.Partitions[i] = ranked[i].Partition;
+			}
+			for (std::uint32_t i = 0; i < finalists; ++i)
+				ranked[i].Partition = shortlist.Partitions[i];
+		}
+
+		for (std::uint32_t i = 0; i < finalists && best.Error > 0.0f; ++i)
+			EncodeBc7Mode(block, modeIndex, ranked[i].Partition, 0, 0, iterations, quality == EncodeQuality::Best, opaqueError, best);
+	}
+
+	class BitWriter
+	{
+	public:
+		void Write(std::uint32_t value, std::uint32_t count)
+		{
+			for (std::uint32_t i = 0; i < count; ++i, ++mPosition)
+			{
+				if ((value >> i) & 1)
+					mBytes[mPosition / 8] |= (std::uint8_t)(1u << (mPosition % 8));
+			}
+		}
+
+		const std::uint8_t* Bytes()const { return mBytes; }
+
+	private:
+		std::uint8_t mBytes[16] = {};
+		std::uint32_t mPosition = 0;
+	};
+
+	// Anchor texels store their index with one bit less, which must be 0: when it is not, the
+	// subset's endpoints swap (on 'channels') and its indices flip.
+	void FixAnchor(EndpointFit& fit, std::uint32_t mask, std::uint32_t anchor, std::uint32_t indexBits, std::uint32_t channels)
+	{
+		std::uint32_t top = 1u << (indexBits - 1);
+		if (fit.Indices[anchor] < top)
+			return;
+
+		for (int c = 0; c < 4; ++c)
+		{
+			if ((channels >> c) & 1)
+				std::swap(fit.Ends[0][c], fit.Ends[1][c]);
+		}
+		std::swap(fit.PBits[0], fit.PBits[1]);
+
+		for (std::uint32_t i = 0; i < 16; ++i)
+		{
+			if ((mask >> i) & 1)
+				fit.Indices[i] = (std::uint8_t)(2 * top - 1 - fit.Indices[i]);
+		}
+	}
+
+	void WriteIndices(BitWriter& bits, const std::uint8_t indices[16], std::uint32_t indexBits, std::uint32_t anchors)
+	{
+		for (std::uint32_t i = 0; i < 16; ++i)
+			bits.Write(indices[i], indexBits - ((anchors >> i) & 1));
+	}
+
+	void PackBC7(Bc7Block& b, std::uint8_t* out)
+	{
+		const Bc7Mode& mode = Bc7Modes[b.Mode];
+
+		BitWriter bits;
+		bits.Write(1u << b.Mode, b.Mode + 1);
+		bits.Write(b.Partition, mode.PartitionBits);
+		bits.Write(b.Rotation, mode.RotationBits);
+		bits.Write(b.IndexSelection, mode.IndexSelectionBits);
+
+		if (mode.SecondaryIndexBits != 0)
+		{
+			EndpointFit& color = b.Subsets[0];
+			EndpointFit& alpha = b.Subsets[1];
+			FixAnchor(color, 0xFFFF, 0, b.IndexSelection ? mode.SecondaryIndexBits : mode.IndexBits, 7);
+			FixAnchor(alpha, 0xFFFF, 0, b.IndexSelection ? mode.IndexBits : mode.SecondaryIndexBits, 8);
+
+			for (int c = 0; c < 3; ++c)
+			{
+				for (int e = 0; e < 2; ++e)
+					bits.Write(color.Ends[e][c], mode.ColorBits);
+			}
+			for (int e = 0; e < 2; ++e)
+				bits.Write(alpha.Ends[e][3], mode.AlphaBits);
+
+			WriteIndices(bits, b.IndexSelection ? alpha.Indices : color.Indices, mode.IndexBits, 1);
+			WriteIndices(bits, b.IndexSelection ? color.Indices : alpha.Indices, mode.SecondaryIndexBits, 1);
+		}
+		else
+		{
+			std::uint32_t masks[3];
+			SubsetMasks(mode.Subsets, b.Partition, masks);
+
+			std::uint32_t anchors[3] = { 0, 0, 0 };
+			if (mode.Subsets == 2)
+			{
+				anchors[1] = Bc7Anchors2[b.Partition];
+			}
+			else if (mode.Subsets == 3)
+			{
+				anchors[1] = Bc7Anchors3Second[b.Partition];
+				anchors[2] = Bc7Anchors3Third[b.Partition];
+			}
+
+			std::uint32_t anchorMask = 0;
+			std::uint8_t indices[16];
+			for (std::uint32_t s = 0; s < mode.Subsets; ++s)
+			{
+				FixAnchor(b.Subsets[s], masks[s], anchors[s], mode.IndexBits, 15);
+				anchorMask |= 1u << anchors[s];
+				for (std::uint32_t i = 0; i < 16; ++i)
+				{
+					if ((masks[s] >> i) & 1)
+						indices[i] = b.Subsets[s].Indices[i];
+				}
+			}
+
+			for (int c = 0; c < 3; ++c)
+			{
+				for (std::uint32_t s = 0; s < mode.Subsets; ++s)
+				{
+					for (int e = 0; e < 2; ++e)
+						bits.Write(b.Subsets[s].Ends[e][c], mode.ColorBits);
+				}
+			}
+			for (std::uint32_t s = 0; s < mode.Subsets && mode.AlphaBits != 0; ++s)
+			{
+				for (int e = 0; e < 2; ++e)
+					bits.Write(b.Subsets[s].Ends[e][3], mode.AlphaBits);
+			}
+			for (std::uint32_t s = 0; s < mode.Subsets; ++s)
+			{
+				if (mode.EndpointPBits)
+				{
+					bits.Write(b.Subsets[s].PBits[0], 1);
+					bits.Write(b.Subsets[s].PBits[1], 1);
+				}
+				else if (mode.SharedPBits)
+				{
+					bits.Write(b.Subsets[s].PBits[0], 1);
+				}
+			}
+
+			WriteIndices(bits, indices, mode.IndexBits, anchorMask);
+		}
+
+		std::memcpy(out, bits.Bytes(), 16);
+	}
+
+	void EncodeBC7(const BlockTexels& block, EncodeQuality quality, std::uint8_t* out)
+	{
+		float opaqueError = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float d = 255.0f - block.Channels[3][i];
+			opaqueError += d * d;
+		}
+
+		int iterations = (quality == EncodeQuality::Fast) ? 1 : (quality == EncodeQuality::Normal) ? 2 : 4;
+		bool best = (quality == EncodeQuality::Best);
+
+		// mode 6, one subset with alpha and 4-bit indices, suits most blocks.
+		Bc7Block result;
+		EncodeBc7Mode(block, 6, 0, 0, 0, iterations, best, opaqueError, result);
+
+		if (quality != EncodeQuality::Fast && result.Error > 0.0f)
+		{
+			// the partitioned modes; those without alpha only pay off on opaque blocks.
+			static const std::uint32_t NormalOpaque[] = { 1, 3 };
+			static const std::uint32_t NormalAlpha[] = { 7 };
+			static const std::uint32_t Every[] = { 0, 1, 2, 3, 7 };
+
+			const std::uint32_t* modes = best ? Every : (opaqueError == 0.0f) ? NormalOpaque : NormalAlpha;
+			std::size_t modeCount = best ? 5 : (opaqueError == 0.0f) ? 2 : 1;
+			PartitionShortlist shortlist;
+			for (std::size_t m = 0; m < modeCount && result.Error > 0.0f; ++m)
+				SearchPartitions(block, modes[m], quality, iterations, opaqueError, shortlist, result);
+
+			// separate color and alpha indices, with alpha rotated into any channel at best.
+			if (opaqueError > 0.0f || best)
+			{
+				std::uint32_t rotations = best ? 4 : 1;
+				for (std::uint32_t rotation = 0; rotation < rotations; ++rotation)
+				{
+					EncodeBc7Mode(block, 5, 0, rotation, 0, iterations, best, opaqueError, result);
+					if (best)
+					{
+						EncodeBc7Mode(block, 4, 0, rotation, 0, iterations, best, opaqueError, result);
+						EncodeBc7Mode(block, 4, 0, rotation, 1, iterations, best, opaqueError, result);
+					}
+				}
+			}
+		}
+
+		PackBC7(result, out);
+	}
+
+	// ---------- blocks ----------
+
+	void LoadTexels(const std::uint8_t* texels, std::size_t rowPitch, BlockTexels& block)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			std::memcpy(block.Rgba[i], texels + (i / 4) * rowPitch + 4 * (i % 4), 4);
+			for (int c = 0; c < 4; ++c)
+				block.Channels[c][i] = block.Rgba[i][c];
+		}
+	}
+
+	void EncodeTexels(BlockFormat format, EncodeQuality quality, const BlockTexels& block, std::uint8_t* out)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			EncodeColor(block, quality, true, out);
+			break;
+
+		case BlockFormat::BC2:
+			EncodeExplicitAlpha(block, out);
+			EncodeColor(block, quality, false, out + 8);
+			break;
+
+		case BlockFormat::BC3:
+			EncodeChannelOf(block, 3, quality, out);
+			EncodeColor(block, quality, false, out + 8);
+			break;
+
+		case BlockFormat::BC4:
+			EncodeChannelOf(block, 0, quality, out);
+			break;
+
+		case BlockFormat::BC5:
+			EncodeChannelOf(block, 0, quality, out);
+			EncodeChannelOf(block, 1, quality, out + 8);
+			break;
+
+		case BlockFormat::BC7:
+			EncodeBC7(block, quality, out);
+			break;
+
+		default:
+			std::memset(out, 0, BlockBytes(format));
+			break;
+		}
+	}
+}
+
+bool CanEncode(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC2:
+	case BlockFormat::BC3:
+	case BlockFormat::BC4:
+	case BlockFormat::BC5:
+	case BlockFormat::BC7:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void EncodeBlock(BlockFormat format, EncodeQuality quality, const std::uint8_t* texels, std::size_t rowPitch,
+	std::uint8_t* block)
+{
+	BlockTexels loaded;
+	LoadTexels(texels, rowPitch, loaded);
+	EncodeTexels(format, quality, loaded, block);
+}
+
+bool EncodeBlocks(BlockFormat format, EncodeQuality quality, const void* texels, std::size_t rowPitch,
+	std::uint32_t width, std::uint32_t height, void* blocks, std::size_t blockRowPitch)
+{
+	if (!CanEncode(format))
+		return false;
+
+	const std::uint32_t blocksWide = (width + 3) / 4;
+	const std::uint32_t blocksHigh = (height + 3) / 4;
+	const std::uint32_t blockBytes = BlockBytes(format);
+	const std::uint8_t* src = static_cast<const std::uint8_t*>(texels);
+	std::uint8_t* dest = static_cast<std::uint8_t*>(blocks);
+
+	// a row of blocks is plenty of work for one chunk, the slow tiers especially.
+	ParallelFor(blocksHigh, 1, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t by = begin; by < end; ++by)
+		{
+			std::uint8_t* out = dest + blockRowPitch * by;
+			for (std::uint32_t bx = 0; bx < blocksWide; ++bx, out += blockBytes)
+			{
+				std::uint32_t x = 4 * bx;
+				std::uint32_t y = 4 * (std::uint32_t)by;
+
+				BlockTexels block;
+				if (x + 4 <= width && y + 4 <= height)
+				{
+					LoadTexels(src + rowPitch * y + 4 * x, rowPitch, block);
+				}
+				else
+				{
+					// partial block: the edge texels repeat.
+					std::uint8_t edge[64];
+					for (std::uint32_t i = 0; i < 16; ++i)
+					{
+						std::uint32_t sx = std::min(x + i % 4, width - 1);
+						std::uint32_t sy = std::min(y + i / 4, height - 1);
+						std::memcpy(edge + 4 * i, src + rowPitch * sy + 4 * sx, 4);
+					}
+					LoadTexels(edge, 16, block);
+				}
+
+				EncodeTexels(format, quality, block, out);
+			}
+		}
+	});
+	return true;
+}
@@ -0,0 +1,45 @@
+//***************************************************************************************
+// BlockEncoder.h
+//
+// CPU encoder for block-compressed textures, for cooking assets offline: RGBA8 texels in,
+// 4x4 blocks of BC1, BC2, BC3, BC4, BC5 or BC7 out (the unsigned formats; BC6H and the
+// signed ones are not supported).  The blocks decode with BlockDecoder and any GPU.
+//
+// Quality tiers trade time for error:
+//	Fast	bounding-box (BC1-BC5) or principal-axis endpoints fitted once; BC7 uses mode 6
+//	Normal	principal axis refined by least squares; BC7 also tries the 2-subset modes
+//			(and mode 5 on blocks with alpha), the partitions ranked by a line-fit estimate
+//	Best	more refinement and an endpoint neighbourhood search; BC7 tries every mode,
+//			every partition, rotation and p-bit combination
+//
+// The palette index search runs four texels per SSE2 iteration, and EncodeBlocks spreads
+// rows of blocks over threads (ParallelFor).  Errors are squared RGBA differences.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include "BlockDecoder.h"
+
+enum class EncodeQuality
+{
+	Fast,
+	Normal,
+	Best,
+};
+
+// True for the formats EncodeBlock and EncodeBlocks write.
+bool CanEncode(BlockFormat format);
+
+// Encodes 4 rows of 4 RGBA8 texels, 'rowPitch' bytes apart, into one block.  BC1 texels
+// with alpha below 128 become transparent; BC4 takes the red channel, BC5 red and green.
+void EncodeBlock(BlockFormat format, EncodeQuality quality, const std::uint8_t* texels, std::size_t rowPitch,
+	std::uint8_t* block);
+
+// Encodes a width x height RGBA8 surface whose rows are 'rowPitch' bytes apart.  Rows of
+// blocks go 'blockRowPitch' bytes apart; partial blocks at the right and bottom edges
+// repeat the edge texels.  False if the format cannot be encoded.
+bool EncodeBlocks(BlockFormat format, EncodeQuality quality, const void* texels, std::size_t rowPitch,
+	std::uint32_t width, std::uint32_t height, void* blocks, std::size_t blockRowPitch);
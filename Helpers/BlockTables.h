@@ -0,0 +1,55 @@
+//***************************************************************************************
+// BlockTables.h
+//
+// Tables of the BC6H and BC7 formats, shared by BlockDecoder and BlockEncoder: the
+// partitions of the multi-subset modes, their anchor texels, the interpolation weights
+// and the layout of the eight BC7 modes.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+// subset of every texel in the partitions of the 2-subset modes (bit i: texel i in subset 1).
+extern const std::uint16_t Bc7Partitions2[64];
+
+// the same for the 3-subset modes, 2 bits per texel.
+extern const std::uint32_t Bc7Partitions3[64];
+
+// texel whose index is stored with one bit less (its most significant bit is 0), per subset.
+extern const std::uint8_t Bc7Anchors2[64];
+extern const std::uint8_t Bc7Anchors3Second[64];
+extern const std::uint8_t Bc7Anchors3Third[64];
+
+// interpolation weights (out of 64) for 2, 3 and 4 bit indices.
+extern const std::uint8_t Bc7Weights2[4];
+extern const std::uint8_t Bc7Weights3[8];
+extern const std::uint8_t Bc7Weights4[16];
+
+const std::uint8_t* Bc7WeightTable(std::uint32_t indexBits);
+
+struct Bc7Mode
+{
+	std::uint8_t Subsets;
+	std::uint8_t PartitionBits;
+	std::uint8_t RotationBits;
+	std::uint8_t IndexSelectionBits;
+	std::uint8_t ColorBits;
+	std::uint8_t AlphaBits;
+	std::uint8_t EndpointPBits;				// one p-bit per endpoint
+	std::uint8_t SharedPBits;				// one p-bit per subset
+	std::uint8_t IndexBits;
+	std::uint8_t SecondaryIndexBits;
+};
+
+extern const Bc7Mode Bc7Modes[8];
+
+// a value of 'bits' bits to 8 bits, replicating its top bits into the low ones.
+inline std::uint32_t Bc7Unquantize(std::uint32_t value, std::uint32_t bits)
+{
+	value <<= 8 - bits;
+	return value | (value >> bits);
+}
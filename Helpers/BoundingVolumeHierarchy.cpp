@@ -0,0 +1,309 @@
+//***************************************************************************************
+// BoundingVolumeHierarchy.cpp
+//***************************************************************************************
+
+#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+#include <cfloat>
+#include <cassert>
+
+using namespace DirectX;
+
+namespace
+{
+	float SurfaceArea(const XMFLOAT3& bmin, const XMFLOAT3& bmax)
+	{
+		float ex = bmax.x - bmin.x;
+		float ey = bmax.y - bmin.y;
+		float ez = bmax.z - bmin.z;
+		return ex * ey + ey * ez + ez * ex;
+	}
+
+	float Component(const XMFLOAT3& v, int axis)
+	{
+		return (axis == 0) ? v.x : ((axis == 1) ? v.y : v.z);
+	}
+
+	// Slab test of a ray against an axis-aligned box.  Returns the entry distance,
+	// or FLT_MAX if the box is missed (or entered beyond maxDist).
+	float IntersectBox(const XMFLOAT3& bmin, const XMFLOAT3& bmax,
+		FXMVECTOR origin, FXMVECTOR invDir, float maxDist)
+	{
+		XMVECTOR t0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&bmin), origin), invDir);
+		XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&bmax), origin), invDir);
+
+		XMFLOAT3 tNear, tFar;
+		XMStoreFloat3(&tNear, XMVectorMin(t0, t1));
+		XMStoreFloat3(&tFar, XMVectorMax(t0, t1));
+
+		float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDist));
+
+		return (tEnter <= tExit) ? tEnter : FLT_MAX;
+	}
+}
+
+void BoundingVolumeHierarchy::Build(const std::vector<BoundingSphere>& bounds)
+{
+	mSpheres = bounds;
+	mNodes.clear();
+	mObjectIndices.resize(bounds.size());
+
+	if (bounds.empty())
+		return;
+
+	for (std::uint32_t i = 0; i < (std::uint32_t)bounds.size(); ++i)
+		mObjectIndices[i] = i;
+
+	// a binary tree with N leaves at most has 2N - 1 nodes.
+	mNodes.reserve(bounds.size() * 2);
+
+	Node root;
+	root.LeftOrFirst = 0;
+	root.Count = (std::uint32_t)bounds.size();
+	mNodes.push_back(root);
+
+	UpdateNodeBounds(0);
+	Subdivide(0);
+}
+
+void BoundingVolumeHierarchy::Refit(const std::vector<BoundingSphere>& bounds)
+{
+	assert(bounds.size() == mSpheres.size());
+	mSpheres = bounds;
+
+	// children are always stored after their parent, so a reverse sweep visits both
+	// children before the parent is merged from them.
+	for (size_t i = mNodes.size(); i-- > 0; )
+	{
+		Node& node = mNodes[i];
+		if (node.Count > 0)
+		{
+			UpdateNodeBounds((std::uint32_t)i);
+		}
+		else
+		{
+			const Node& left = mNodes[node.LeftOrFirst];
+			const Node& right = mNodes[node.LeftOrFirst + 1];
+			XMStoreFloat3(&node.BoxMin, XMVectorMin(XMLoadFloat3(&left.BoxMin), XMLoadFloat3(&right.BoxMin)));
+			XMStoreFloat3(&node.BoxMax, XMVectorMax(XMLoadFloat3(&left.BoxMax), XMLoadFloat3(&right.BoxMax)));
+		}
+	}
+}
+
+bool BoundingVolumeHierarchy::RayCast(FXMVECTOR rayOrigin, FXMVECTOR rayDir,
+	std::uint32_t& hitIndex, float& hitDist)const
+{
+	if (mNodes.empty())
+		return false;
+
+	// division by a zero component gives +-infinity, which the slab test handles.
+	XMVECTOR invDir = XMVectorReciprocal(rayDir);
+
+	float bestDist = FLT_MAX;
+	std::uint32_t bestIndex = UINT32_MAX;
+
+	std::uint32_t stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = mNodes[stack[--stackSize]];
+
+		if (IntersectBox(node.BoxMin, node.BoxMax, rayOrigin, invDir, bestDist) == FLT_MAX)
+			continue;
+
+		if (node.Count > 0)
+		{
+			for (std::uint32_t i = 0; i < node.Count; ++i)
+			{
+				std::uint32_t objectIndex = mObjectIndices[node.LeftOrFirst + i];
+
+				float dist = 0.0f;
+				if (mSpheres[objectIndex].Intersects(rayOrigin, rayDir, dist) && dist < bestDist)
+				{
+					bestDist = dist;
+					bestIndex = objectIndex;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first: push it last.
+		std::uint32_t first = node.LeftOrFirst;
+		std::uint32_t second = node.LeftOrFirst + 1;
+		float dFirst = IntersectBox(mNodes[first].BoxMin, mNodes[first].BoxMax, rayOrigin, invDir, bestDist);
+		float dSecond = IntersectBox(mNodes[second].BoxMin, mNodes[second].BoxMax, rayOrigin, invDir, bestDist);
+		if (dFirst > dSecond)
+		{
+			std::swap(first, second);
+			std::swap(dFirst, dSecond);
+		}
+
+		assert(stackSize + 2 <= _countof(stack));
+		if (dSecond != FLT_MAX)
+			stack[stackSize++] = second;
+		if (dFirst != FLT_MAX)
+			stack[stackSize++] = first;
+	}
+
+	if (bestIndex == UINT32_MAX)
+		return false;
+
+	hitIndex = bestIndex;
+	hitDist = bestDist;
+	return true;
+}
+
+void BoundingVolumeHierarchy::UpdateNodeBounds(std::uint32_t nodeIndex)
+{
+	Node& node = mNodes[nodeIndex];
+
+	XMVECTOR bmin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR bmax = XMVectorReplicate(-FLT_MAX);
+	for (std::uint32_t i = 0; i < node.Count; ++i)
+	{
+		const BoundingSphere& s = mSpheres[mObjectIndices[node.LeftOrFirst + i]];
+		XMVECTOR c = XMLoadFloat3(&s.Center);
+		XMVECTOR r = XMVectorReplicate(s.Radius);
+		bmin = XMVectorMin(bmin, XMVectorSubtract(c, r));
+		bmax = XMVectorMax(bmax, XMVectorAdd(c, r));
+	}
+
+	XMStoreFloat3(&node.BoxMin, bmin);
+	XMStoreFloat3(&node.BoxMax, bmax);
+}
+
+float BoundingVolumeHierarchy::FindSplit(const Node& node, int& axis, float& splitPos)const
+{
+	// bin the sphere centers along each axis and evaluate the SAH cost at every bin boundary.
+	float bestCost = FLT_MAX;
+
+	for (int a = 0; a < 3; ++a)
+	{
+		float cmin = FLT_MAX;
+		float cmax = -FLT_MAX;
+		for (std::uint32_t i = 0; i < node.Count; ++i)
+		{
+			float c = Component(mSpheres[mObjectIndices[node.LeftOrFirst + i]].Center, a);
+			cmin = std::min(cmin, c);
+			cmax = std::max(cmax, c);
+		}
+		if (cmax <= cmin)
+			continue;
+
+		struct Bin
+		{
+			XMVECTOR BoxMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR BoxMax = XMVectorReplicate(-FLT_MAX);
+			std::uint32_t Count = 0;
+		} bins[NumBins];
+
+		float scale = NumBins / (cmax - cmin);
+		for (std::uint32_t i = 0; i < node.Count; ++i)
+		{
+			const BoundingSphere& s = mSpheres[mObjectIndices[node.LeftOrFirst + i]];
+			int b = std::min(NumBins - 1, (int)((Component(s.Center, a) - cmin) * scale));
+
+			XMVECTOR c = XMLoadFloat3(&s.Center);
+			XMVECTOR r = XMVectorReplicate(s.Radius);
+			bins[b].BoxMin = XMVectorMin(bins[b].BoxMin, XMVectorSubtract(c, r));
+			bins[b].BoxMax = XMVectorMax(bins[b].BoxMax, XMVectorAdd(c, r));
+			bins[b].Count++;
+		}
+
+		// sweep from both sides to get the area and count on each side of every plane.
+		float leftArea[NumBins - 1], rightArea[NumBins - 1];
+		std::uint32_t leftCount[NumBins - 1], rightCount[NumBins - 1];
+
+		XMVECTOR lmin = XMVectorReplicate(FLT_MAX), lmax = XMVectorReplicate(-FLT_MAX);
+		XMVECTOR rmin = XMVectorReplicate(FLT_MAX), rmax = XMVectorReplicate(-FLT_MAX);
+		std::uint32_t lsum = 0, rsum = 0;
+		for (int i = 0; i < NumBins - 1; ++i)
+		{
+			XMFLOAT3 fmin, fmax;
+
+			lsum += bins[i].Count;
+			leftCount[i] = lsum;
+			lmin = XMVectorMin(lmin, bins[i].BoxMin);
+			lmax = XMVectorMax(lmax, bins[i].BoxMax);
+			XMStoreFloat3(&fmin, lmin);
+			XMStoreFloat3(&fmax, lmax);
+			leftArea[i] = (lsum > 0) ? SurfaceArea(fmin, fmax) : 0.0f;
+
+			rsum += bins[NumBins - 1 - i].Count;
+			rightCount[NumBins - 2 - i] = rsum;
+			rmin = XMVectorMin(rmin, bins[NumBins - 1 - i].BoxMin);
+			rmax = XMVectorMax(rmax, bins[NumBins - 1 - i].BoxMax);
+			XMStoreFloat3(&fmin, rmin);
+			XMStoreFloat3(&fmax, rmax);
+			rightArea[NumBins - 2 - i] = (rsum > 0) ? SurfaceArea(fmin, fmax) : 0.0f;
+		}
+
+		float binWidth = (cmax - cmin) / NumBins;
+		for (int i = 0; i < NumBins - 1; ++i)
+		{
+			float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				axis = a;
+				splitPos = cmin + binWidth * (i + 1);
+			}
+		}
+	}
+
+	return bestCost;
+}
+
+void BoundingVolumeHierarchy::Subdivide(std::uint32_t nodeIndex)
+{
+	// take a copy: push_back below may reallocate mNodes.
+	Node node = mNodes[nodeIndex];
+	if (node.Count <= MaxLeafSize)
+		return;
+
+	int axis = 0;
+	float splitPos = 0.0f;
+	float splitCost = FindSplit(node, axis, splitPos);
+
+	// do not split if keeping one leaf is cheaper than the best split.
+	float leafCost = node.Count * SurfaceArea(node.BoxMin, node.BoxMax);
+	if (splitCost >= leafCost)
+		return;
+
+	// partition the object indices in place around the split plane.
+	std::uint32_t* first = mObjectIndices.data() + node.LeftOrFirst;
+	std::uint32_t* last = first + node.Count;
+	std::uint32_t* mid = std::partition(first, last, [&](std::uint32_t i)
+		{
+			return Component(mSpheres[i].Center, axis) < splitPos;
+		});
+
+	std::uint32_t leftCount = (std::uint32_t)(mid - first);
+	if (leftCount == 0 || leftCount == node.Count)
+		return;
+
+	std::uint32_t leftIndex = (std::uint32_t)mNodes.size();
+
+	Node left;
+	left.LeftOrFirst = node.LeftOrFirst;
+	left.Count = leftCount;
+
+	Node right;
+	right.LeftOrFirst = node.LeftOrFirst + leftCount;
+	right.Count = node.Count - leftCount;
+
+	mNodes.push_back(left);
+	mNodes.push_back(right);
+
+	mNodes[nodeIndex].LeftOrFirst = leftIndex;
+	mNodes[nodeIndex].Count = 0;
+
+	UpdateNodeBounds(leftIndex);
+	UpdateNodeBounds(leftIndex + 1);
+
+	Subdivide(leftIndex);
+	Subdivide(leftIndex + 1);
+}
@@ -0,0 +1,57 @@
+//***************************************************************************************
+// BoundingVolumeHierarchy.h
+//
+// Bounding volume hierarchy over a set of bounding spheres, used to resolve mouse
+// picking rays against many objects.  Nodes are kept in one flat array (both children
+// of a node are stored next to each other), built with a binned surface area heuristic.
+// When objects move but the set stays the same, Refit() updates the boxes bottom-up
+// without rebuilding the tree.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include <cstdint>
+
+class BoundingVolumeHierarchy
+{
+public:
+	BoundingVolumeHierarchy() = default;
+
+	// Builds the tree.  Indices returned by RayCast refer to positions in 'bounds'.
+	void Build(const std::vector<DirectX::BoundingSphere>& bounds);
+
+	// Updates the node boxes for moved objects.  'bounds' must have the same size and
+	// order as in the last Build().
+	void Refit(const std::vector<DirectX::BoundingSphere>& bounds);
+
+	// Finds the closest object hit by the ray.  rayDir must be normalized.
+	bool RayCast(DirectX::FXMVECTOR rayOrigin, DirectX::FXMVECTOR rayDir,
+		std::uint32_t& hitIndex, float& hitDist)const;
+
+	size_t ObjectCount()const { return mSpheres.size(); }
+	size_t NodeCount()const { return mNodes.size(); }
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 BoxMin;
+		std::uint32_t LeftOrFirst = 0;	// inner node: index of the left child (right = left + 1), leaf: first entry in mObjectIndices
+		DirectX::XMFLOAT3 BoxMax;
+		std::uint32_t Count = 0;		// number of objects in a leaf, 0 for inner nodes
+	};
+
+	void UpdateNodeBounds(std::uint32_t nodeIndex);
+	void Subdivide(std::uint32_t nodeIndex);
+	float FindSplit(const Node& node, int& axis, float& splitPos)const;
+
+private:
+	static const std::uint32_t MaxLeafSize = 4;
+	static const int NumBins = 8;
+
+	std::vector<Node> mNodes;
+	std::vector<std::uint32_t> mObjectIndices;
+	std::vector<DirectX::BoundingSphere> mSpheres;
+};
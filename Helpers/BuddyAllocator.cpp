@@ -0,0 +1,165 @@
+//***************************************************************************************
+// BuddyAllocator.cpp
+//***************************************************************************************
+
+#include "BuddyAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+BuddyAllocator::BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize)
+	: mCapacity(capacity), mMinBlockSize(minBlockSize)
+{
+	assert(minBlockSize > 0 && (minBlockSize & (minBlockSize - 1)) == 0);
+	assert(capacity >= minBlockSize && (capacity & (capacity - 1)) == 0);
+
+	while (BlockBytes(mMaxOrder) < capacity)
+		++mMaxOrder;
+
+	mFreeLists.resize(mMaxOrder + 1);
+	mFreeLists[mMaxOrder].insert(0);
+}
+
+std::uint32_t BuddyAllocator::OrderFor(std::uint64_t size)const
+{
+	std::uint32_t order = 0;
+	while (BlockBytes(order) < size)
+		++order;
+	return order;
+}
+
+std::uint64_t BuddyAllocator::AllocateOrder(std::uint32_t order, std::uint32_t fromOrder, std::uint64_t offset)
+{
+	// take the free block 'offset' of size class fromOrder and split it down to 'order';
+	// the upper halves go back to the free lists.
+	mFreeLists[fromOrder].erase(offset);
+	while (fromOrder > order)
+	{
+		--fromOrder;
+		mFreeLists[fromOrder].insert(offset + BlockBytes(fromOrder));
+	}
+	return offset;
+}
+
+std::uint64_t BuddyAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	if (size == 0 || size > mCapacity || alignment > mCapacity)
+		return InvalidOffset;
+
+	// blocks are aligned to their own size, so a large enough block is aligned enough.
+	std::uint32_t order = OrderFor(std::max(size, alignment));
+
+	for (std::uint32_t k = order; k <= mMaxOrder; ++k)
+	{
+		if (mFreeLists[k].empty())
+			continue;
+
+		std::uint64_t offset = AllocateOrder(order, k, *mFreeLists[k].begin());
+
+		Block block;
+		block.Order = order;
+		block.Requested = size;
+		mAllocated[offset] = block;
+
+		mUsedBytes += BlockBytes(order);
+		mRequestedBytes += size;
+		return offset;
+	}
+
+	return InvalidOffset;
+}
+
+void BuddyAllocator::Free(std::uint64_t offset)
+{
+	auto it = mAllocated.find(offset);
+	assert(it != mAllocated.end());
+	if (it == mAllocated.end())
+		return;
+
+	std::uint32_t order = it->second.Order;
+	mUsedBytes -= BlockBytes(order);
+	mRequestedBytes -= it->second.Requested;
+	mAllocated.erase(it);
+
+	// merge with the buddy as long as it is free as a whole.
+	while (order < mMaxOrder)
+	{
+		std::uint64_t buddy = offset ^ BlockBytes(order);
+		auto buddyIt = mFreeLists[order].find(buddy);
+		if (buddyIt == mFreeLists[order].end())
+			break;
+
+		mFreeLists[order].erase(buddyIt);
+		offset = std::min(offset, buddy);
+		++order;
+	}
+
+	mFreeLists[order].insert(offset);
+}
+
+std::vector<BuddyAllocator::Move> BuddyAllocator::PlanCompaction(std::size_t maxMoves)
+{
+	std::vector<Move> moves;
+
+	// visit the allocations from the highest offset down.
+	std::vector<std::uint64_t> offsets;
+	offsets.reserve(mAllocated.size());
+	for (const auto& elem : mAllocated)
+		offsets.push_back(elem.first);
+	std::sort(offsets.begin(), offsets.end(), [](std::uint64_t a, std::uint64_t b) { return a > b; });
+
+	for (std::uint64_t from : offsets)
+	{
+		if (moves.size() >= maxMoves)
+			break;
+
+		Block block = mAllocated[from];
+
+		// the lowest free block that is large enough.
+		std::uint32_t bestOrder = 0;
+		std::uint64_t bestOffset = InvalidOffset;
+		for (std::uint32_t k = block.Order; k <= mMaxOrder; ++k)
+		{
+			if (!mFreeLists[k].empty() && *mFreeLists[k].begin() < bestOffset)
+			{
+				bestOffset = *mFreeLists[k].begin();
+				bestOrder = k;
+			}
+		}
+
+		// every move strictly lowers the offset, so this terminates.
+		if (bestOffset == InvalidOffset || bestOffset > from)
+			continue;
+
+		std::uint64_t to = AllocateOrder(block.Order, bestOrder, bestOffset);
+		mAllocated[to] = block;
+		mUsedBytes += BlockBytes(block.Order);
+		mRequestedBytes += block.Requested;
+		Free(from);
+
+		Move move;
+		move.From = from;
+		move.To = to;
+		move.Size = block.Requested;
+		moves.push_back(move);
+	}
+
+	return moves;
+}
+
+BuddyAllocator::Stats BuddyAllocator::GetStats()const
+{
+	Stats stats;
+	stats.Capacity = mCapacity;
+	stats.UsedBytes = mUsedBytes;
+	stats.RequestedBytes = mRequestedBytes;
+	stats.AllocationCount = (std::uint32_t)mAllocated.size();
+
+	for (std::uint32_t k = 0; k <= mMaxOrder; ++k)
+	{
+		stats.FreeBlockCount += (std::uint32_t)mFreeLists[k].size();
+		if (!mFreeLists[k].empty())
+			stats.LargestFreeBlock = BlockBytes(k);
+	}
+
+	return stats;
+}
@@ -0,0 +1,83 @@
+//***************************************************************************************
+// BuddyAllocator.h
+//
+// Allocation policy of the GPU heap suballocator (GpuMemoryAllocator.h).  Manages the
+// offsets of one power-of-two sized range with a binary buddy system: blocks are split
+// in halves down to the requested size class and merged with their buddy again when
+// freed.  Every block is naturally aligned to its own size, which covers the 64KB
+// placement alignment of D3D12 resources for free.
+//
+// This is a plain CPU data structure without any Direct3D dependency, so it can be
+// exercised and benchmarked on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <set>
+#include <unordered_map>
+
+class BuddyAllocator
+{
+public:
+	static const std::uint64_t InvalidOffset = ~0ull;
+
+	struct Stats
+	{
+		std::uint64_t Capacity = 0;
+		std::uint64_t UsedBytes = 0;			// sum of the allocated block sizes
+		std::uint64_t RequestedBytes = 0;		// sum of the requested sizes (UsedBytes - RequestedBytes is internal fragmentation)
+		std::uint64_t LargestFreeBlock = 0;
+		std::uint32_t AllocationCount = 0;
+		std::uint32_t FreeBlockCount = 0;
+	};
+
+	// A block to relocate, produced by PlanCompaction.
+	struct Move
+	{
+		std::uint64_t From = 0;
+		std::uint64_t To = 0;
+		std::uint64_t Size = 0;					// requested size of the allocation
+	};
+
+public:
+	// capacity and minBlockSize must be powers of two, capacity >= minBlockSize.
+	BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize);
+
+	// Returns the offset of the block, or InvalidOffset if no free block is large enough.
+	// alignment must be a power of two.
+	std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment = 1);
+	void Free(std::uint64_t offset);
+
+	// Moves allocations from high offsets into free blocks at lower offsets (at most
+	// maxMoves of them) and returns the moves.  The allocator state already reflects
+	// the new offsets; the caller has to copy the contents accordingly.
+	std::vector<Move> PlanCompaction(std::size_t maxMoves);
+
+	bool Empty()const { return mAllocated.empty(); }
+	std::uint64_t Capacity()const { return mCapacity; }
+	Stats GetStats()const;
+
+private:
+	struct Block
+	{
+		std::uint32_t Order = 0;
+		std::uint64_t Requested = 0;
+	};
+
+	std::uint64_t BlockBytes(std::uint32_t order)const { return mMinBlockSize << order; }
+	std::uint32_t OrderFor(std::uint64_t size)const;
+	std::uint64_t AllocateOrder(std::uint32_t order, std::uint32_t fromOrder, std::uint64_t offset);
+
+private:
+	std::uint64_t mCapacity = 0;
+	std::uint64_t mMinBlockSize = 0;
+	std::uint32_t mMaxOrder = 0;
+
+	std::vector<std::set<std::uint64_t>> mFreeLists;		// per order, ordered by offset
+	std::unordered_map<std::uint64_t, Block> mAllocated;	// keyed by offset
+
+	std::uint64_t mUsedBytes = 0;
+	std::uint64_t mRequestedBytes = 0;
+};
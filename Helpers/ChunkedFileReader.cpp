@@ -0,0 +1,288 @@
+//***************************************************************************************
+// ChunkedFileReader.cpp
+//***************************************************************************************
+
+#include "ChunkedFileReader.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+ChunkedFileReader::ChunkedFileReader(std::size_t chunkSize)
+	: mMaxChunkSize(std::max<std::size_t>(chunkSize, 1))
+{
+}
+
+ChunkedFileReader::~ChunkedFileReader()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool ChunkedFileReader::Open(const wchar_t* fileName)
+{
+	Close();
+	mLastError = 0;
+
+	HANDLE file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		mLastError = GetLastError();
+		return false;
+	}
+	mFile = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		mLastError = GetLastError();
+		CloseFile();
+		return false;
+	}
+
+	mSize = (std::uint64_t)fileSize.QuadPart;
+	return StartReading();
+}
+
+bool ChunkedFileReader::Open(const char* fileName)
+{
+	// ANSI code page path, for symmetry with the POSIX build.
+	int length = MultiByteToWideChar(CP_ACP, 0, fileName, -1, nullptr, 0);
+	if (length <= 0)
+	{
+		mLastError = GetLastError();
+		return false;
+	}
+
+	std::vector<wchar_t> wideName(length);
+	MultiByteToWideChar(CP_ACP, 0, fileName, -1, wideName.data(), length);
+	return Open(wideName.data());
+}
+
+bool ChunkedFileReader::ReadFromFile(std::uint8_t* dest, std::size_t size, std::size_t& bytesRead)
+{
+	bytesRead = 0;
+	while (bytesRead < size)
+	{
+		// ReadFile counts in DWORDs.
+		DWORD request = (DWORD)std::min<std::size_t>(size - bytesRead, 1u << 30);
+		DWORD read = 0;
+		if (!ReadFile((HANDLE)mFile, dest + bytesRead, request, &read, nullptr))
+		{
+			mLastError = GetLastError();
+			return false;
+		}
+		if (read == 0)
+			break;
+		bytesRead += read;
+	}
+	return true;
+}
+
+void ChunkedFileReader::CloseFile()
+{
+	if (mFile != nullptr)
+		CloseHandle((HANDLE)mFile);
+	mFile = nullptr;
+}
+
+#else
+
+bool ChunkedFileReader::Open(const char* fileName)
+{
+	Close();
+	mLastError = 0;
+
+	mFd = open(fileName, O_RDONLY);
+	if (mFd < 0)
+	{
+		mLastError = (unsigned long)errno;
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(mFd, &info) != 0)
+	{
+		mLastError = (unsigned long)errno;
+		CloseFile();
+		return false;
+	}
+
+	mSize = (std::uint64_t)info.st_size;
+#if defined(POSIX_FADV_SEQUENTIAL)
+	posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	return StartReading();
+}
+
+bool ChunkedFileReader::ReadFromFile(std::uint8_t* dest, std::size_t size, std::size_t& bytesRead)
+{
+	bytesRead = 0;
+	while (bytesRead < size)
+	{
+		ssize_t read = ::read(mFd, dest + bytesRead, size - bytesRead);
+		if (read < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			mLastError = (unsigned long)errno;
+			return false;
+		}
+		if (read == 0)
+			break;
+		bytesRead += (std::size_t)read;
+	}
+	return true;
+}
+
+void ChunkedFileReader::CloseFile()
+{
+	if (mFd >= 0)
+		close(mFd);
+	mFd = -1;
+}
+
+#endif
+
+bool ChunkedFileReader::StartReading()
+{
+	// no point in chunks larger than the file (an empty file still reads one empty chunk).
+	mChunkSize = (std::size_t)std::min<std::uint64_t>(mMaxChunkSize, std::max<std::uint64_t>(mSize, 1));
+	for (auto& chunk : mChunks)
+	{
+		chunk.Data.resize(mChunkSize);
+		chunk.Size = 0;
+		chunk.Filled = false;
+	}
+
+	mCurrent = 0;
+	mHolding = false;
+	mConsumed = 0;
+	mPosition = 0;
+	mQuit = false;
+	mOpen = true;
+
+	mReader = std::thread(&ChunkedFileReader::ReaderMain, this);
+	return true;
+}
+
+void ChunkedFileReader::Close()
+{
+	if (mReader.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mChunkFreed.notify_one();
+		mReader.join();
+	}
+
+	CloseFile();
+	for (auto& chunk : mChunks)
+	{
+		std::vector<std::uint8_t>().swap(chunk.Data);
+		chunk.Size = 0;
+		chunk.Filled = false;
+	}
+
+	mSize = 0;
+	mPosition = 0;
+	mOpen = false;
+}
+
+void ChunkedFileReader::ReaderMain()
+{
+	// the chunks are filled in turn, each as soon as the caller has given it back.
+	for (unsigned fill = 0; ; fill ^= 1)
+	{
+		Chunk& chunk = mChunks[fill];
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mChunkFreed.wait(lock, [&] { return mQuit || !chunk.Filled; });
+			if (mQuit)
+				return;
+		}
+
+		// the chunk belongs to this thread until it is marked filled.
+		std::size_t bytesRead = 0;
+		bool succeeded = ReadFromFile(chunk.Data.data(), mChunkSize, bytesRead);
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			chunk.Size = bytesRead;
+			chunk.Filled = true;
+		}
+		mChunkFilled.notify_one();
+
+		// a short chunk is the last one.
+		if (!succeeded || bytesRead < mChunkSize)
+			return;
+	}
+}
+
+std::size_t ChunkedFileReader::Next(std::size_t maxSize, const std::uint8_t*& data)
+{
+	data = nullptr;
+	if (!mOpen || maxSize == 0)
+		return 0;
+
+	for (;;)
+	{
+		Chunk& chunk = mChunks[mCurrent];
+		if (!mHolding)
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mChunkFilled.wait(lock, [&] { return chunk.Filled; });
+			mHolding = true;
+			mConsumed = 0;
+		}
+
+		if (mConsumed < chunk.Size)
+		{
+			std::size_t size = std::min(maxSize, chunk.Size - mConsumed);
+			data = chunk.Data.data() + mConsumed;
+			mConsumed += size;
+			mPosition += size;
+			return size;
+		}
+
+		// the end of the file, or a failed read.
+		if (chunk.Size < mChunkSize)
+			return 0;
+
+		// give the chunk back to be refilled; the other one is probably read already.
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			chunk.Filled = false;
+		}
+		mChunkFreed.notify_one();
+		mCurrent ^= 1;
+		mHolding = false;
+	}
+}
+
+bool ChunkedFileReader::Read(void* dest, std::size_t size)
+{
+	std::uint8_t* out = static_cast<std::uint8_t*>(dest);
+	while (size > 0)
+	{
+		const std::uint8_t* data;
+		std::size_t chunk = Next(size, data);
+		if (chunk == 0)
+			return false;
+
+		std::memcpy(out, data, chunk);
+		out += chunk;
+		size -= chunk;
+	}
+	return true;
+}
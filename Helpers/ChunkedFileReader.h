@@ -0,0 +1,93 @@
+//***************************************************************************************
+// ChunkedFileReader.h
+//
+// Reads a file front to back in fixed-size chunks, double-buffered: a reader thread fills
+// one chunk buffer while the caller parses the other, so the disk stays busy while the
+// data is being copied (into upload memory, say).  Memory use is two chunks whatever the
+// size of the file, which makes it the way to load files too large to read or map whole.
+//
+// No Direct3D dependency (the Windows build only needs the Win32 API).
+//***************************************************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ChunkedFileReader
+{
+public:
+	static const std::size_t DefaultChunkSize = 8 * 1024 * 1024;
+
+public:
+	explicit ChunkedFileReader(std::size_t chunkSize = DefaultChunkSize);
+	ChunkedFileReader(const ChunkedFileReader& rhs) = delete;
+	ChunkedFileReader& operator=(const ChunkedFileReader& rhs) = delete;
+	~ChunkedFileReader();
+
+	// Opens the file and starts reading its first two chunks; false on failure
+	// (LastError() tells why).
+#if defined(_WIN32)
+	bool Open(const wchar_t* fileName);
+#endif
+	bool Open(const char* fileName);
+	void Close();
+
+	// Hands out up to maxSize of the next bytes, from the current chunk: 'data' is valid
+	// until the next call.  Returns 0 at the end of the file or after a read error.
+	std::size_t Next(std::size_t maxSize, const std::uint8_t*& data);
+
+	// Copies the next 'size' bytes to 'dest'; false if the file ends (or fails) first.
+	bool Read(void* dest, std::size_t size);
+
+	bool IsOpen()const { return mOpen; }
+	std::uint64_t Size()const { return mSize; }
+	std::uint64_t Position()const { return mPosition; }		// bytes handed out so far
+
+	// GetLastError() on Windows, errno elsewhere; 0 if every read succeeded.
+	unsigned long LastError()const { return mLastError; }
+
+private:
+	struct Chunk
+	{
+		std::vector<std::uint8_t> Data;
+		std::size_t Size = 0;
+		bool Filled = false;			// written by the reader thread, not yet consumed
+	};
+
+	bool StartReading();
+	void ReaderMain();
+	bool ReadFromFile(std::uint8_t* dest, std::size_t size, std::size_t& bytesRead);
+	void CloseFile();
+
+private:
+	std::size_t mMaxChunkSize = 0;
+	std::size_t mChunkSize = 0;		// of the open file: no larger than the file
+	std::uint64_t mSize = 0;
+	std::uint64_t mPosition = 0;
+	bool mOpen = false;
+	unsigned long mLastError = 0;
+
+	// the caller's side: the chunk being handed out and how much of it is gone
+	unsigned mCurrent = 0;
+	bool mHolding = false;			// mChunks[mCurrent] has been filled and is ours
+	std::size_t mConsumed = 0;
+
+	// shared with the reader thread (guarded by mMutex)
+	Chunk mChunks[2];
+	std::thread mReader;
+	std::mutex mMutex;
+	std::condition_variable mChunkFilled;
+	std::condition_variable mChunkFreed;
+	bool mQuit = false;
+
+#if defined(_WIN32)
+	void* mFile = nullptr;			// HANDLE
+#else
+	int mFd = -1;
+#endif
+};
@@ -0,0 +1,22 @@
+//***************************************************************************************
+// ContentHash.h
+//
+// 64-bit hash of a block of memory, for telling files and payloads apart by content
+// (TextureCache).  It is XXH64: the input is consumed 32 bytes at a time by four
+// independent accumulators, so the multiplies of the lanes overlap in the pipeline and
+// hashing runs at memory speed rather than at the latency of one long dependency chain.
+// The result is identical to the reference xxHash XXH64 for the same seed.
+//
+// Not a cryptographic hash: equal hashes mean equal content only for data nobody
+// crafted to collide.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+std::uint64_t ContentHash64(const void* data, std::size_t size, std::uint64_t seed = 0);
@@ -0,0 +1,104 @@
+//***************************************************************************************
+// CopyQueue.cpp
+//***************************************************************************************
+
+#include "CopyQueue.h"
+
+CopyQueue::CopyQueue(ID3D12Device* device, GpuMemoryAllocator* allocator, UINT batchCount)
+	: mDevice(device), mAllocator(allocator)
+{
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&mQueue)));
+	mQueue->SetName(L"Copy Queue");
+
+	mFenceManager.Initialize(device);
+
+	mBatches.resize(std::max(batchCount, 1u));
+	for (auto& batch : mBatches)
+	{
+		ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+			IID_PPV_ARGS(batch.Allocator.GetAddressOf())));
+	}
+
+	// created closed, like the direct command list; Begin() resets it.
+	ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY,
+		mBatches[0].Allocator.Get(), nullptr, IID_PPV_ARGS(mCommandList.GetAddressOf())));
+	mCommandList->Close();
+}
+
+CopyQueue::~CopyQueue()
+{
+	if (mQueue != nullptr)
+		Flush();
+}
+
+ID3D12GraphicsCommandList* CopyQueue::Begin()
+{
+	assert(!mOpen);
+
+	Batch& batch = mBatches[mCurrentBatch];
+
+	// the allocator and the staging memory of this slot may still be read by the GPU.
+	if (batch.Fence != 0)
+		mFenceManager.Wait(batch.Fence);
+	batch.Staging.reset();
+
+	ThrowIfFailed(batch.Allocator->Reset());
+	ThrowIfFailed(mCommandList->Reset(batch.Allocator.Get(), nullptr));
+
+	// 1MB blocks: runtime batches are small; a large upload gets a block of its own anyway.
+	batch.Staging = std::make_unique<StagingArena>(mDevice, mAllocator, 1024 * 1024);
+
+	mOpen = true;
+	return mCommandList.Get();
+}
+
+StagingArena& CopyQueue::Staging()
+{
+	assert(mOpen);
+	return *mBatches[mCurrentBatch].Staging;
+}
+
+UINT64 CopyQueue::Submit()
+{
+	assert(mOpen);
+
+	ThrowIfFailed(mCommandList->Close());
+	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
+	mQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+
+	Batch& batch = mBatches[mCurrentBatch];
+	batch.Fence = mFenceManager.Signal(mQueue.Get());
+
+	mCurrentBatch = (mCurrentBatch + 1) % (UINT)mBatches.size();
+	mOpen = false;
+
+	return batch.Fence;
+}
+
+void CopyQueue::GpuWait(ID3D12CommandQueue* queue, UINT64 fenceValue)
+{
+	ThrowIfFailed(queue->Wait(mFenceManager.Fence(), fenceValue));
+}
+
+void CopyQueue::ReleaseCompleted()
+{
+	for (UINT i = 0; i < (UINT)mBatches.size(); ++i)
+	{
+		// the open batch is still being recorded.
+		if (mOpen && i == mCurrentBatch)
+			continue;
+
+		Batch& batch = mBatches[i];
+		if (batch.Staging != nullptr && mFenceManager.IsComplete(batch.Fence))
+			batch.Staging.reset();
+	}
+}
+
+void CopyQueue::Flush()
+{
+	mFenceManager.Flush(mQueue.Get());
+	ReleaseCompleted();
+}
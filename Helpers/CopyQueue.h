@@ -0,0 +1,75 @@
+//***************************************************************************************
+// CopyQueue.h
+//
+// Uploads on a D3D12 copy queue, so they run concurrently with rendering on the direct
+// queue.  The queue has its own fence timeline and a small ring of batches; every batch
+// owns a command allocator and a StagingArena, both recycled once the batch's fence
+// value has completed.  A consumer queue waits on the GPU for exactly the upload it
+// depends on (GpuWait), never for the whole copy queue, and the CPU does not block.
+//
+// Usage:  list = Begin();  record copies with list and Staging();  value = Submit();
+//         GpuWait(directQueue, value);  ...  ReleaseCompleted() once per frame.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "FenceManager.h"
+#include "StagingArena.h"
+
+class CopyQueue
+{
+public:
+	CopyQueue(ID3D12Device* device, GpuMemoryAllocator* allocator, UINT batchCount = 3);
+	CopyQueue(const CopyQueue& rhs) = delete;
+	CopyQueue& operator=(const CopyQueue& rhs) = delete;
+	~CopyQueue();
+
+	// Opens a batch and returns its (copy) command list.  Blocks only if every batch of
+	// the ring is still in flight.
+	ID3D12GraphicsCommandList* Begin();
+
+	// Command list and staging memory of the open batch.
+	ID3D12GraphicsCommandList* CommandList()const { return mCommandList.Get(); }
+	StagingArena& Staging();
+
+	// Closes and executes the open batch; returns the fence value that marks its completion.
+	UINT64 Submit();
+
+	// Makes 'queue' wait on the GPU until the upload marked by 'fenceValue' has completed.
+	void GpuWait(ID3D12CommandQueue* queue, UINT64 fenceValue);
+
+	bool IsComplete(UINT64 fenceValue) { return mFenceManager.IsComplete(fenceValue); }
+
+	// Gives the staging memory of completed batches back.
+	void ReleaseCompleted();
+
+	// Blocks until every submitted batch has completed.
+	void Flush();
+
+	ID3D12CommandQueue* Queue()const { return mQueue.Get(); }
+	GpuMemoryAllocator* Allocator()const { return mAllocator; }		// where Staging() places resources (null: committed)
+	UINT64 LastSubmitted()const { return mFenceManager.LastSignaledValue(); }
+	UINT64 NextValue()const { return mFenceManager.NextValue(); }		// what the next Submit() returns
+	UINT64 CompletedValue() { return mFenceManager.CompletedValue(); }
+
+private:
+	struct Batch
+	{
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+		std::unique_ptr<StagingArena> Staging;
+		UINT64 Fence = 0;				// 0: never submitted
+	};
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	GpuMemoryAllocator* mAllocator = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> mQueue;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+	FenceManager mFenceManager;
+
+	std::vector<Batch> mBatches;
+	UINT mCurrentBatch = 0;
+	bool mOpen = false;
+};
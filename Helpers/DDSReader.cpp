@@ -0,0 +1,108 @@
+//***************************************************************************************
+// DDSReader.cpp
+//***************************************************************************************
+
+#include "DDSReader.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	inline std::uint32_t Read32(const std::uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((std::uint32_t)p[3] << 24); }
+}
+
+bool ReadDdsImage(const std::uint8_t* data, std::size_t size, RgbaImage& image, std::string& error)
+{
+	const std::uint32_t FourCCDx10 = 0x30315844;		// "DX10"
+	if (size < 128 || Read32(data) != 0x20534444)
+	{
+		error = "not a DDS file";
+		return false;
+	}
+
+	image.Height = Read32(data + 12);
+	image.Width = Read32(data + 16);
+	const std::uint32_t pixelFlags = Read32(data + 80);
+	const std::uint32_t fourCC = Read32(data + 84);
+
+	std::size_t offset = 128;
+	std::uint32_t dxgiFormat = 0;
+	if ((pixelFlags & 0x4) && fourCC == FourCCDx10)
+	{
+		if (size < 148)
+		{
+			error = "the DDS file is truncated";
+			return false;
+		}
+		dxgiFormat = Read32(data + 128);
+		offset = 148;
+	}
+
+	// block formats
+	bool compressed = true;
+	BlockFormat blockFormat = BlockFormat::BC1;
+	bool swizzle = false;			// BGRA texels
+	bool opaque = false;			// no alpha channel
+	switch (dxgiFormat ? dxgiFormat : fourCC)
+	{
+	case 71: case 72: case 0x31545844:					// BC1, "DXT1"
+		blockFormat = BlockFormat::BC1; break;
+	case 74: case 75: case 0x32545844: case 0x33545844:	// BC2, "DXT2", "DXT3"
+		blockFormat = BlockFormat::BC2; break;
+	case 77: case 78: case 0x34545844: case 0x35545844:	// BC3, "DXT4", "DXT5"
+		blockFormat = BlockFormat::BC3; break;
+	case 80: case 0x31495441: case 0x55344342:			// BC4, "ATI1", "BC4U"
+		blockFormat = BlockFormat::BC4; break;
+	case 83: case 0x32495441: case 0x55354342:			// BC5, "ATI2", "BC5U"
+		blockFormat = BlockFormat::BC5; break;
+	case 98: case 99:
+		blockFormat = BlockFormat::BC7; break;
+	case 28: case 29:									// R8G8B8A8
+		compressed = false; break;
+	case 87: case 91:									// B8G8R8A8
+		compressed = false; swizzle = true; break;
+	case 88: case 93:									// B8G8R8X8
+		compressed = false; swizzle = true; opaque = true; break;
+	default:
+		if (dxgiFormat != 0 || (pixelFlags & 0x40) == 0 || Read32(data + 88) != 32)
+		{
+			error = "unsupported DDS pixel format";
+			return false;
+		}
+		// 32-bit RGB masks: red in the low or in the third byte.
+		compressed = false;
+		swizzle = (Read32(data + 92) == 0x00FF0000);
+		opaque = (pixelFlags & 0x1) == 0;
+		break;
+	}
+
+	const std::size_t texels = (std::size_t)image.Width * image.Height;
+	image.Rgba.resize(4 * texels);
+	if (compressed)
+	{
+		const std::size_t blockRowPitch = (std::size_t)BlockBytes(blockFormat) * ((image.Width + 3) / 4);
+		if (size - offset < blockRowPitch * ((image.Height + 3) / 4))
+		{
+			error = "the DDS file is truncated";
+			return false;
+		}
+		DecodeBlocks(blockFormat, data + offset, blockRowPitch, image.Width, image.Height, image.Rgba.data(), 4 * (std::size_t)image.Width);
+		return true;
+	}
+
+	if (size - offset < 4 * texels)
+	{
+		error = "the DDS file is truncated";
+		return false;
+	}
+	std::memcpy(image.Rgba.data(), data + offset, 4 * texels);
+	for (std::size_t i = 0; i < texels; ++i)
+	{
+		std::uint8_t* texel = &image.Rgba[4 * i];
+		if (swizzle)
+			std::swap(texel[0], texel[2]);
+		if (opaque)
+			texel[3] = 255;
+	}
+	return true;
+}
@@ -0,0 +1,26 @@
+//***************************************************************************************
+// DDSReader.h
+//
+// Reads the top level of a .dds file into RGBA8 texels on the CPU, for tools and for
+// textures the CPU works on before upload (atlases).  Uncompressed RGBA8/BGRA8/BGRX8 and
+// BC1-BC5 or BC7 files are supported; block-compressed data is decoded with BlockDecoder.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include "BlockDecoder.h"
+#include <string>
+#include <vector>
+
+struct RgbaImage
+{
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::vector<std::uint8_t> Rgba;			// rows packed tightly
+};
+
+// Parses the file contents; false with a reason in 'error' for other formats or truncated files.
+bool ReadDdsImage(const std::uint8_t* data, std::size_t size, RgbaImage& image, std::string& error);
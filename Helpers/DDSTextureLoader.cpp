@@ -24,6 +24,12 @@
 #include <wrl.h>
 
 #include "DDSTextureLoader.h" 
+#include "StagingArena.h"
+#include "CopyQueue.h"
+#include "MappedFile.h"
+#include "ChunkedFileReader.h"
+#include "WriteCombined.h"
+#include "ParallelFor.h"
 
 using namespace Microsoft::WRL;
 
@@ -268,6 +274,87 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
     return S_OK;
 }
 
+//--------------------------------------------------------------------------------------
+// Same as LoadTextureDataFromFile, but maps the file instead of reading it into a heap
+// buffer: the header is parsed in place and bitData points into the mapped view, so the
+// subresources are copied once, straight from the file cache into upload memory.  The
+// pointers are valid as long as 'file' stays open.
+//--------------------------------------------------------------------------------------
+static HRESULT LoadTextureDataFromMappedFile( _In_z_ const wchar_t* fileName,
+                                              MappedFile& file,
+                                              const DDS_HEADER** header,
+                                              const uint8_t** bitData,
+                                              size_t* bitSize
+                                            )
+{
+    if (!header || !bitData || !bitSize)
+    {
+        return E_POINTER;
+    }
+
+    if (!file.Open( fileName ))
+    {
+        return HRESULT_FROM_WIN32( file.LastError() );
+    }
+
+    // A 32-bit process cannot address the whole view (nor size_t the size)
+    if (file.Size() > SIZE_MAX)
+    {
+        return E_FAIL;
+    }
+
+    const size_t fileSize = static_cast<size_t>( file.Size() );
+    const uint8_t* data = file.Data();
+
+    // Need at least enough data to fill the header and magic number to be a valid DDS
+    if (fileSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) ) )
+    {
+        return E_FAIL;
+    }
+
+    // DDS files always start with the same magic number ("DDS ")
+    uint32_t dwMagicNumber = *( const uint32_t* )( data );
+    if (dwMagicNumber != DDS_MAGIC)
+    {
+        return E_FAIL;
+    }
+
+    auto hdr = reinterpret_cast<const DDS_HEADER*>( data + sizeof( uint32_t ) );
+
+    // Verify header to validate DDS file
+    if (hdr->size != sizeof(DDS_HEADER) ||
+        hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return E_FAIL;
+    }
+
+    // Check for DX10 extension
+    bool bDXT10Header = false;
+    if ((hdr->ddspf.flags & DDS_FOURCC) &&
+        (MAKEFOURCC( 'D', 'X', '1', '0' ) == hdr->ddspf.fourCC))
+    {
+        // Must be long enough for both headers and magic value
+        if (fileSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10) ) )
+        {
+            return E_FAIL;
+        }
+
+        bDXT10Header = true;
+    }
+
+    // setup the pointers in the process request
+    *header = hdr;
+    size_t offset = sizeof( uint32_t ) + sizeof( DDS_HEADER )
+                    + (bDXT10Header ? sizeof( DDS_HEADER_DXT10 ) : 0);
+    *bitData = data + offset;
+    *bitSize = fileSize - offset;
+
+    // the upload copy walks the subresources front to back
+    file.Prefetch( offset, *bitSize );
+
+    return S_OK;
+}
+
 
 //--------------------------------------------------------------------------------------
 // Return the BPP for a particular format
@@ -920,75 +1007,111 @@ static HRESULT FillInitData12(_In_ size_t width,
 	theight = 0;
 	tdepth = 0;
 
-	size_t NumBytes = 0;
-	size_t RowBytes = 0;
-	const uint8_t* pSrcBits = bitData;
-	const uint8_t* pEndBits = bitData + bitSize;
-
-	size_t index = 0;
-	for (size_t j = 0; j < arraySize; j++)
+	// Every array slice has the same mip chain, so lay the chain out once and fill the
+	// slices independently of each other.
+	struct MipLayout
 	{
-		size_t w = width;
-		size_t h = height;
-		size_t d = depth;
-		for (size_t i = 0; i < mipCount; i++)
-		{
-			GetSurfaceInfo(w,
-				h,
-				format,
-				&NumBytes,
-				&RowBytes,
-				nullptr
-				);
+		size_t NumBytes;
+		size_t RowBytes;
+		size_t Depth;
+		bool Kept;
+	};
+
+	std::vector<MipLayout> mips(mipCount);
+	size_t sliceBytes = 0;
+	size_t keptCount = 0;
+
+	size_t w = width;
+	size_t h = height;
+	size_t d = depth;
+	for (size_t i = 0; i < mipCount; i++)
+	{
+		size_t NumBytes = 0;
+		size_t RowBytes = 0;
+		GetSurfaceInfo(w,
+			h,
+			format,
+			&NumBytes,
+			&RowBytes,
+			nullptr
+			);
 
-			if ((mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize))
-			{
-				if (!twidth)
-				{
-					twidth = w;
-					theight = h;
-					tdepth = d;
-				}
+		mips[i].NumBytes = NumBytes;
+		mips[i].RowBytes = RowBytes;
+		mips[i].Depth = d;
+		mips[i].Kept = (mipCount <= 1) || !maxsize || (w <= maxsize && h <= maxsize && d <= maxsize);
 
-				assert(index < mipCount * arraySize);
-				_Analysis_assume_(index < mipCount * arraySize);
-				initData[index]./*pSysMem*/pData = (const void*)pSrcBits;
-				initData[index]./*SysMemPitch*/RowPitch = static_cast<UINT>(RowBytes);
-				initData[index]./*SysMemSlicePitch*/SlicePitch = static_cast<UINT>(NumBytes);
-				++index;
-			}
-			else if (!j)
+		if (mips[i].Kept)
+		{
+			if (!twidth)
 			{
-				// Count number of skipped mipmaps (first item only)
-				++skipMip;
+				twidth = w;
+				theight = h;
+				tdepth = d;
 			}
+			++keptCount;
+		}
+		else
+		{
+			// Count number of skipped mipmaps
+			++skipMip;
+		}
 
-			if (pSrcBits + (NumBytes*d) > pEndBits)
-			{
-				return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
-			}
+		sliceBytes += NumBytes * d;
 
-			pSrcBits += NumBytes * d;
+		w = w >> 1;
+		h = h >> 1;
+		d = d >> 1;
+		if (w == 0)
+		{
+			w = 1;
+		}
+		if (h == 0)
+		{
+			h = 1;
+		}
+		if (d == 0)
+		{
+			d = 1;
+		}
+	}
 
-			w = w >> 1;
-			h = h >> 1;
-			d = d >> 1;
-			if (w == 0)
-			{
-				w = 1;
-			}
-			if (h == 0)
-			{
-				h = 1;
-			}
-			if (d == 0)
+	if (keptCount == 0 || arraySize == 0)
+	{
+		return E_FAIL;
+	}
+
+	// all slices must be in the file (same as checking each subresource in turn)
+	if (sliceBytes > bitSize / arraySize)
+	{
+		return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+	}
+
+	ParallelFor(arraySize, 64, [&](size_t begin, size_t end)
+	{
+		for (size_t j = begin; j < end; j++)
+		{
+			const uint8_t* pSrcBits = bitData + j * sliceBytes;
+			size_t index = j * keptCount;
+
+			for (size_t i = 0; i < mipCount; i++)
 			{
-				d = 1;
+				if (mips[i].Kept)
+				{
+					assert(index < mipCount * arraySize);
+					_Analysis_assume_(index < mipCount * arraySize);
+					initData[index]./*pSysMem*/pData = (const void*)pSrcBits;
+					initData[index]./*SysMemPitch*/RowPitch = static_cast<UINT>(mips[i].RowBytes);
+					initData[index]./*SysMemSlicePitch*/SlicePitch = static_cast<UINT>(mips[i].NumBytes);
+					++index;
+				}
+
+				pSrcBits += mips[i].NumBytes * mips[i].Depth;
 			}
 		}
-	}
+	});
 
-	return (index > 0) ? S_OK : E_FAIL;
+	return S_OK;
 }
 
 //--------------------------------------------------------------------------------------
@@ -1241,7 +1364,8 @@ static HRESULT CreateD3DResources12(
 	_In_ bool isCubeMap,
 	_In_reads_opt_(mipCount*arraySize) D3D12_SUBRESOURCE_DATA* initData,
 	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap
+	ComPtr<ID3D12Resource>& textureUploadHeap,
+	_In_opt_ StagingArena* stagingArena
 	)
 {
 	if (device == nullptr)
@@ -1269,20 +1393,42 @@ static HRESULT CreateD3DResources12(
 		texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 		texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-		hr = device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-			D3D12_HEAP_FLAG_NONE,
-			&texDesc,
-			D3D12_RESOURCE_STATE_COMMON,
-			nullptr,
-			IID_PPV_ARGS(&texture)
-			);
+		if (stagingArena)
+		{
+			// may be placed in a shared heap (see GpuMemoryAllocator).
+			hr = stagingArena->CreateTexture(texDesc, D3D12_RESOURCE_STATE_COMMON, texture);
+		}
+		else
+		{
+			hr = device->CreateCommittedResource(
+				&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+				D3D12_HEAP_FLAG_NONE,
+				&texDesc,
+				D3D12_RESOURCE_STATE_COMMON,
+				nullptr,
+				IID_PPV_ARGS(&texture)
+				);
+		}
 
 		if (FAILED(hr))
 		{
 			texture = nullptr;
 			return hr;
 		}
+		else if (stagingArena)
+		{
+			// staged through the shared arena: no upload heap of its own.
+			const UINT num2DSubresources = texDesc.DepthOrArraySize * texDesc.MipLevels;
+
+			cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+				D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+
+			stagingArena->UploadSubresources(cmdList, texture.Get(), 0, num2DSubresources, initData);
+
+			cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				StagingArena::ReadyState(cmdList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)));
+		}
 		else
 		{
 			const UINT num2DSubresources = texDesc.DepthOrArraySize * texDesc.MipLevels;
@@ -1669,29 +1815,29 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D11Device* d3dDevice,
     return hr;
 }
 
-static HRESULT CreateTextureFromDDS12(
-	_In_ ID3D12Device* device,
-	_In_opt_ ID3D12GraphicsCommandList* cmdList,
+//--------------------------------------------------------------------------------------
+// Validates the header and returns the dimensions and format of the texture it describes.
+static HRESULT GetTextureInfo12(
 	_In_ const DDS_HEADER* header,
-	_In_reads_bytes_(bitSize) const uint8_t* bitData,
-	_In_ size_t bitSize,
-	_In_ size_t maxsize,
-	_In_ bool forceSRGB,
-	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap)
+	_Out_ uint32_t& resDim,
+	_Out_ UINT& width,
+	_Out_ UINT& height,
+	_Out_ UINT& depth,
+	_Out_ size_t& mipCount,
+	_Out_ UINT& arraySize,
+	_Out_ DXGI_FORMAT& format,
+	_Out_ bool& isCubeMap)
 {
-	HRESULT hr = S_OK;
-
-	UINT width = header->width;
-	UINT height = header->height;
-	UINT depth = header->depth;
+	width = header->width;
+	height = header->height;
+	depth = header->depth;
 
-	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
-	UINT arraySize = 1;
-	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-	bool isCubeMap = false;
+	resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	arraySize = 1;
+	format = DXGI_FORMAT_UNKNOWN;
+	isCubeMap = false;
 
-	size_t mipCount = header->mipMapCount;
+	mipCount = header->mipMapCount;
 	if (0 == mipCount) mipCount = 1;
 
 	if ((header->ddspf.flags & DDS_FOURCC) && (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
@@ -1835,6 +1981,34 @@ static HRESULT CreateTextureFromDDS12(
 		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 	}
 
+	return S_OK;
+}
+
+static HRESULT CreateTextureFromDDS12(
+	_In_ ID3D12Device* device,
+	_In_opt_ ID3D12GraphicsCommandList* cmdList,
+	_In_ const DDS_HEADER* header,
+	_In_reads_bytes_(bitSize) const uint8_t* bitData,
+	_In_ size_t bitSize,
+	_In_ size_t maxsize,
+	_In_ bool forceSRGB,
+	ComPtr<ID3D12Resource>& texture,
+	ComPtr<ID3D12Resource>& textureUploadHeap,
+	_In_opt_ StagingArena* stagingArena)
+{
+	UINT width = 0;
+	UINT height = 0;
+	UINT depth = 0;
+	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	size_t mipCount = 0;
+	UINT arraySize = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	bool isCubeMap = false;
+
+	HRESULT hr = GetTextureInfo12(header, resDim, width, height, depth, mipCount, arraySize, format, isCubeMap);
+	if (FAILED(hr))
+		return hr;
+
 	// Create the texture
 	std::unique_ptr<D3D12_SUBRESOURCE_DATA[]> initData(
 		new (std::nothrow) D3D12_SUBRESOURCE_DATA[mipCount * arraySize]
@@ -1867,7 +2041,8 @@ static HRESULT CreateTextureFromDDS12(
 			isCubeMap,
 			initData.get(),
 			texture, 
-			textureUploadHeap);
+			textureUploadHeap,
+			stagingArena);
 	}
 
 	return hr;
@@ -1926,7 +2101,8 @@ HRESULT DirectX::CreateDDSTextureFromMemory12(
 	ComPtr<ID3D12Resource>& texture,
 	ComPtr<ID3D12Resource>& textureUploadHeap,
 	_In_ size_t maxsize,
-	_Out_opt_ DDS_ALPHA_MODE* alphaMode
+	_Out_opt_ DDS_ALPHA_MODE* alphaMode,
+	_In_opt_ StagingArena* stagingArena
 	)
 {
 	if (alphaMode)
@@ -1979,7 +2155,8 @@ HRESULT DirectX::CreateDDSTextureFromMemory12(
 		maxsize,
 		false,
 		texture,
-		textureUploadHeap
+		textureUploadHeap,
+		stagingArena
 		);
 
 	if (SUCCEEDED(hr))
@@ -1991,6 +2168,103 @@ HRESULT DirectX::CreateDDSTextureFromMemory12(
 	return hr;
 }
 
+HRESULT DirectX::GetDDSTextureLayout12(
+	_In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+	_In_ size_t ddsDataSize,
+	_Out_ D3D12_RESOURCE_DESC& desc,
+	_Out_ std::vector<D3D12_SUBRESOURCE_DATA>& subresources
+	)
+{
+	ZeroMemory(&desc, sizeof(D3D12_RESOURCE_DESC));
+	subresources.clear();
+
+	if (!ddsData || ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+	{
+		return E_INVALIDARG;
+	}
+
+	uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
+	if (dwMagicNumber != DDS_MAGIC)
+	{
+		return E_FAIL;
+	}
+
+	auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+
+	// Verify header to validate DDS file
+	if (header->size != sizeof(DDS_HEADER) ||
+		header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+	{
+		return E_FAIL;
+	}
+
+	// Check for DX10 extension
+	bool bDXT10Header = false;
+	if ((header->ddspf.flags & DDS_FOURCC) &&
+		(MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+	{
+		// Must be long enough for both headers and magic value
+		if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
+		{
+			return E_FAIL;
+		}
+
+		bDXT10Header = true;
+	}
+
+	size_t offset = sizeof(uint32_t)
+		+ sizeof(DDS_HEADER)
+		+ (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
+
+	UINT width = 0;
+	UINT height = 0;
+	UINT depth = 0;
+	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	size_t mipCount = 0;
+	UINT arraySize = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	bool isCubeMap = false;
+
+	HRESULT hr = GetTextureInfo12(header, resDim, width, height, depth, mipCount, arraySize, format, isCubeMap);
+	if (FAILED(hr))
+		return hr;
+
+	// same restriction as CreateD3DResources12
+	if (resDim != D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+	subresources.resize(mipCount * arraySize);
+
+	size_t skipMip = 0;
+	size_t twidth = 0;
+	size_t theight = 0;
+	size_t tdepth = 0;
+
+	hr = FillInitData12(
+		width, height, depth, mipCount, arraySize, format, 0, ddsDataSize - offset, ddsData + offset,
+		twidth, theight, tdepth, skipMip, subresources.data()
+		);
+	if (FAILED(hr))
+	{
+		subresources.clear();
+		return hr;
+	}
+
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	desc.Alignment = 0;
+	desc.Width = twidth;
+	desc.Height = (uint32_t)theight;
+	desc.DepthOrArraySize = (uint16_t)arraySize;
+	desc.MipLevels = (uint16_t)mipCount;
+	desc.Format = format;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT DirectX::CreateDDSTextureFromMemory( ID3D11Device* d3dDevice,
                                              ID3D11DeviceContext* d3dContext,
@@ -2140,7 +2414,8 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 	_Out_ ComPtr<ID3D12Resource>& texture,
 	_Out_ ComPtr<ID3D12Resource>& textureUploadHeap,
 	_In_ size_t maxsize,
-	_Out_opt_ DDS_ALPHA_MODE* alphaMode)
+	_Out_opt_ DDS_ALPHA_MODE* alphaMode,
+	_In_opt_ StagingArena* stagingArena)
 {
 	if (texture)
 	{
@@ -2160,19 +2435,21 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 		return E_INVALIDARG;
 	}
 
-	DDS_HEADER* header = nullptr;
-	uint8_t* bitData = nullptr;
+	const DDS_HEADER* header = nullptr;
+	const uint8_t* bitData = nullptr;
 	size_t bitSize = 0;
 
-	std::unique_ptr<uint8_t[]> ddsData;
-	HRESULT hr = LoadTextureDataFromFile(szFileName, ddsData, &header, &bitData, &bitSize);
+	// the subresource data is read from the mapping by the upload copy recorded below,
+	// so the file only has to stay mapped until CreateTextureFromDDS12 returns.
+	MappedFile ddsFile;
+	HRESULT hr = LoadTextureDataFromMappedFile(szFileName, ddsFile, &header, &bitData, &bitSize);
 	if (FAILED(hr))
 	{
 		return hr;
 	}
 
 	hr = CreateTextureFromDDS12(device, cmdList, header,
-		bitData, bitSize, maxsize, false, texture, textureUploadHeap);
+		bitData, bitSize, maxsize, false, texture, textureUploadHeap, stagingArena);
 
 	if (SUCCEEDED(hr))
 	{
@@ -2228,6 +2505,234 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 	return hr;
 }
 
+HRESULT DirectX::CreateDDSTextureFromFileChunked12(_In_ ID3D12Device* device,
+	_In_ CopyQueue* copyQueue,
+	_In_z_ const wchar_t* szFileName,
+	_Out_ ComPtr<ID3D12Resource>& texture,
+	_In_ UINT64 batchBytes,
+	_Out_opt_ DDS_ALPHA_MODE* alphaMode)
+{
+	// largest single copy: the copy queue's staging blocks are 1MB, and copies that fit
+	// them leave no large blocks of their own behind.
+	const UINT64 MaxCopyBytes = 1024 * 1024;
+
+	texture = nullptr;
+	if (alphaMode)
+	{
+		*alphaMode = DDS_ALPHA_MODE_UNKNOWN;
+	}
+
+	if (!device || !copyQueue || !szFileName)
+	{
+		return E_INVALIDARG;
+	}
+
+	ChunkedFileReader file;
+	if (!file.Open(szFileName))
+	{
+		return HRESULT_FROM_WIN32(file.LastError());
+	}
+
+	// the headers are read up front: GetTextureInfo12 expects the DX10 one right after the other.
+	uint8_t headers[sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10)] = {};
+	if (!file.Read(headers, sizeof(uint32_t) + sizeof(DDS_HEADER)))
+	{
+		return E_FAIL;
+	}
+
+	uint32_t dwMagicNumber = *(const uint32_t*)(headers);
+	if (dwMagicNumber != DDS_MAGIC)
+	{
+		return E_FAIL;
+	}
+
+	auto header = reinterpret_cast<const DDS_HEADER*>(headers + sizeof(uint32_t));
+
+	// Verify header to validate DDS file
+	if (header->size != sizeof(DDS_HEADER) ||
+		header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+	{
+		return E_FAIL;
+	}
+
+	// Check for DX10 extension
+	if ((header->ddspf.flags & DDS_FOURCC) &&
+		(MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+	{
+		if (!file.Read(headers + sizeof(uint32_t) + sizeof(DDS_HEADER), sizeof(DDS_HEADER_DXT10)))
+		{
+			return E_FAIL;
+		}
+	}
+
+	UINT width = 0;
+	UINT height = 0;
+	UINT depth = 0;
+	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	size_t mipCount = 0;
+	UINT arraySize = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	bool isCubeMap = false;
+
+	HRESULT hr = GetTextureInfo12(header, resDim, width, height, depth, mipCount, arraySize, format, isCubeMap);
+	if (FAILED(hr))
+		return hr;
+
+	// the file must hold every subresource before anything is created.
+	UINT64 bitSize = 0;
+	for (UINT slice = 0; slice < arraySize; ++slice)
+	{
+		for (size_t mip = 0; mip < mipCount; ++mip)
+		{
+			size_t numBytes = 0;
+			GetSurfaceInfo(std::max<size_t>(width >> mip, 1), std::max<size_t>(height >> mip, 1), format, &numBytes, nullptr, nullptr);
+			bitSize += (UINT64)numBytes * std::max<UINT>(depth >> mip, 1);
+		}
+	}
+	if (file.Size() - file.Position() < bitSize)
+	{
+		return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+	}
+
+	D3D12_RESOURCE_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+	texDesc.Dimension = static_cast<D3D12_RESOURCE_DIMENSION>(resDim);
+	texDesc.Alignment = 0;
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.DepthOrArraySize = (resDim == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? (uint16_t)depth : (uint16_t)arraySize;
+	texDesc.MipLevels = (uint16_t)mipCount;
+	texDesc.Format = format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	hr = copyQueue->Staging().CreateTexture(texDesc, D3D12_RESOURCE_STATE_COPY_DEST, texture);
+	if (FAILED(hr))
+	{
+		texture = nullptr;
+		return hr;
+	}
+
+	// the subresources in file order: array slices, their mips, then the depth slices of
+	// each mip.  A copy covers whole depth slices while one fits in MaxCopyBytes, a band of
+	// rows of a single slice otherwise.
+	ID3D12GraphicsCommandList* cmdList = copyQueue->CommandList();
+	UINT64 batchStaged = 0;
+	for (UINT slice = 0; slice < arraySize; ++slice)
+	{
+		for (UINT mip = 0; mip < (UINT)mipCount; ++mip)
+		{
+			const UINT subresource = D3D12CalcSubresource(mip, slice, 0, (UINT)mipCount, arraySize);
+
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+			UINT numRows = 0;
+			UINT64 rowSize = 0;
+			device->GetCopyableFootprints(&texDesc, subresource, 1, 0, &layout, &numRows, &rowSize, nullptr);
+
+			size_t rowBytes = 0;
+			GetSurfaceInfo(std::max<size_t>(width >> mip, 1), std::max<size_t>(height >> mip, 1), format, nullptr, &rowBytes, nullptr);
+
+			const UINT rowPitch = layout.Footprint.RowPitch;
+			const UINT blockHeight = (layout.Footprint.Height + numRows - 1) / numRows;
+			const UINT64 slicePitch = (UINT64)rowPitch * numRows;
+			const UINT depthSlices = layout.Footprint.Depth;
+
+			UINT z = 0;
+			UINT row = 0;
+			while (z < depthSlices)
+			{
+				UINT slices = 1;
+				UINT rows = numRows;
+				if (slicePitch <= MaxCopyBytes)
+					slices = std::min(depthSlices - z, (UINT)(MaxCopyBytes / slicePitch));
+				else
+					rows = std::min(numRows - row, std::max((UINT)(MaxCopyBytes / rowPitch), 1u));
+
+				// a full batch goes to the GPU; Begin() waits for the oldest one when the ring is busy.
+				const UINT64 copyBytes = slicePitch * (slices - 1) + (UINT64)rowPitch * (rows - 1) + rowSize;
+				if (batchStaged > 0 && batchStaged + copyBytes > batchBytes)
+				{
+					copyQueue->Submit();
+					cmdList = copyQueue->Begin();
+					batchStaged = 0;
+				}
+
+				// the rows go straight from the file chunks to the write-combined staging memory.
+				StagingArena::Allocation staging = copyQueue->Staging().Allocate(copyBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+				const UINT64 bandPitch = (rows == numRows) ? slicePitch : (UINT64)rowPitch * rows;
+				bool shortRead = false;
+				{
+					StagingArena::WriteScope scope(copyQueue->Staging(), staging);
+					for (UINT s = 0; s < slices && !shortRead; ++s)
+					{
+						for (UINT r = 0; r < rows && !shortRead; ++r)
+						{
+							BYTE* dest = staging.CPU + bandPitch * s + (UINT64)rowPitch * r;
+							for (size_t left = rowBytes; left > 0; )
+							{
+								const uint8_t* data;
+								size_t size = file.Next(left, data);
+								if (size == 0)
+								{
+									shortRead = true;
+									break;
+								}
+
+								WriteCombined::StreamCopy(dest, data, size);
+								dest += size;
+								left -= size;
+							}
+						}
+					}
+				}
+
+				if (shortRead)
+				{
+					// the file shrank or a read failed: the recorded copies must not outlive the texture,
+					// whose range goes back to the allocator once they are done.
+					copyQueue->Submit();
+					copyQueue->Flush();
+					copyQueue->Begin();
+					if (copyQueue->Allocator() != nullptr)
+						copyQueue->Allocator()->Release(texture);
+					texture = nullptr;
+					return (file.LastError() != 0) ? HRESULT_FROM_WIN32(file.LastError()) : HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+				}
+
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT band = layout;
+				band.Offset = staging.Offset;
+				band.Footprint.Height = (rows == numRows) ? layout.Footprint.Height : rows * blockHeight;
+				band.Footprint.Depth = slices;
+
+				CD3DX12_TEXTURE_COPY_LOCATION dst(texture.Get(), subresource);
+				CD3DX12_TEXTURE_COPY_LOCATION src(staging.Resource, band);
+				cmdList->CopyTextureRegion(&dst, 0, row * blockHeight, z, &src, nullptr);
+				batchStaged += copyBytes;
+
+				if (rows == numRows)
+				{
+					z += slices;
+				}
+				else if ((row += rows) == numRows)
+				{
+					row = 0;
+					++z;
+				}
+			}
+		}
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, StagingArena::ReadyState(cmdList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)));
+
+	if (alphaMode)
+		*alphaMode = GetAlphaMode(header);
+
+	return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT DirectX::CreateDDSTextureFromFile( ID3D11Device* d3dDevice,
                                            ID3D11DeviceContext* d3dContext,
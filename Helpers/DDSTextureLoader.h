@@ -32,6 +32,11 @@
 
 #pragma warning(pop)
 
+#include <vector>
+
+class StagingArena;
+class CopyQueue;
+
 #if defined(_MSC_VER) && (_MSC_VER<1610) && !defined(_In_reads_)
 #define _In_reads_(exp)
 #define _Out_writes_(exp)
@@ -72,9 +77,20 @@ namespace DirectX
 		                                 _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
 		                                 _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap,
 		                                 _In_ size_t maxsize = 0,
-		                                 _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
+		                                 _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
+		                                 _In_opt_ StagingArena* stagingArena = nullptr
 		                                 );
 
+	// Describes a DDS file held in memory (e.g. mapped) without creating anything, for
+	// uploading it a few subresources at a time: 'desc' is the texture to create and
+	// 'subresources' has one entry per subresource (mip-major within each array slice),
+	// pointing into ddsData.  2D textures only.
+	HRESULT GetDDSTextureLayout12(_In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+		                          _In_ size_t ddsDataSize,
+		                          _Out_ D3D12_RESOURCE_DESC& desc,
+		                          _Out_ std::vector<D3D12_SUBRESOURCE_DATA>& subresources
+		                          );
+
     HRESULT CreateDDSTextureFromFile( _In_ ID3D11Device* d3dDevice,
                                       _In_z_ const wchar_t* szFileName,
                                       _Outptr_opt_ ID3D11Resource** texture,
@@ -89,9 +105,27 @@ namespace DirectX
 		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
 		                               _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap,
 		                               _In_ size_t maxsize = 0,
-		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
+		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr,
+		                               _In_opt_ StagingArena* stagingArena = nullptr
 		                               );
 
+	// Loads a DDS file of any size (2D, array, cube or volume texture) with constant memory
+	// use: the file is read in chunks (ChunkedFileReader), the next one while the current
+	// one is copied to staging memory, and uploaded through copyQueue in batches of about
+	// batchBytes, submitted as they fill up.  A batch of copyQueue must be open; the last
+	// one is left open, so the caller's Submit() returns the fence value of the whole
+	// texture.  The texture ends up in ReadyState(PIXEL_SHADER_RESOURCE); on failure no
+	// texture is returned and its memory is given back to copyQueue->Allocator().
+	// TextureStreamer falls back to it for the files it does not map (too large, or the
+	// mapping failed).
+	HRESULT CreateDDSTextureFromFileChunked12(_In_ ID3D12Device* device,
+		                                      _In_ CopyQueue* copyQueue,
+		                                      _In_z_ const wchar_t* szFileName,
+		                                      _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+		                                      _In_ UINT64 batchBytes = 32 * 1024 * 1024,
+		                                      _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
+		                                      );
+
     // Standard version with optional auto-gen mipmap support
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -0,0 +1,195 @@
+//***************************************************************************************
+// DDSWriter.cpp
+//***************************************************************************************
+
+#include "DDSWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// header flags and caps (the DDSD_, DDPF_ and DDSCAPS_ values of ddraw.h)
+	const std::uint32_t DdsMagic = 0x20534444;			// "DDS "
+	const std::uint32_t HeaderCaps = 0x1;
+	const std::uint32_t HeaderHeight = 0x2;
+	const std::uint32_t HeaderWidth = 0x4;
+	const std::uint32_t HeaderPitch = 0x8;
+	const std::uint32_t HeaderPixelFormat = 0x1000;
+	const std::uint32_t HeaderMipCount = 0x20000;
+	const std::uint32_t HeaderLinearSize = 0x80000;
+	const std::uint32_t PixelAlphaPixels = 0x1;
+	const std::uint32_t PixelFourCC = 0x4;
+	const std::uint32_t PixelRgb = 0x40;
+	const std::uint32_t CapsComplex = 0x8;
+	const std::uint32_t CapsTexture = 0x1000;
+	const std::uint32_t CapsMipMap = 0x400000;
+	const std::uint32_t Texture2D = 3;					// D3D10_RESOURCE_DIMENSION_TEXTURE2D
+
+	constexpr std::uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return (std::uint32_t)(std::uint8_t)a | ((std::uint32_t)(std::uint8_t)b << 8) |
+			((std::uint32_t)(std::uint8_t)c << 16) | ((std::uint32_t)(std::uint8_t)d << 24);
+	}
+
+	// the classic FourCC of a format, 0 if it needs the DX10 header.
+	std::uint32_t LegacyFourCC(DdsFormat format, bool srgb)
+	{
+		if (srgb)
+			return 0;
+
+		switch (format)
+		{
+		case DdsFormat::BC1: return FourCC('D', 'X', 'T', '1');
+		case DdsFormat::BC2: return FourCC('D', 'X', 'T', '3');
+		case DdsFormat::BC3: return FourCC('D', 'X', 'T', '5');
+		case DdsFormat::BC4: return FourCC('B', 'C', '4', 'U');
+		case DdsFormat::BC5: return FourCC('A', 'T', 'I', '2');
+		default: return 0;
+		}
+	}
+
+	void Put(std::vector<std::uint8_t>& out, std::uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+			out.push_back((std::uint8_t)(value >> (8 * i)));
+	}
+}
+
+bool DdsBlockFormat(DdsFormat format, BlockFormat& blockFormat)
+{
+	switch (format)
+	{
+	case DdsFormat::BC1: blockFormat = BlockFormat::BC1; return true;
+	case DdsFormat::BC2: blockFormat = BlockFormat::BC2; return true;
+	case DdsFormat::BC3: blockFormat = BlockFormat::BC3; return true;
+	case DdsFormat::BC4: blockFormat = BlockFormat::BC4; return true;
+	case DdsFormat::BC5: blockFormat = BlockFormat::BC5; return true;
+	case DdsFormat::BC7: blockFormat = BlockFormat::BC7; return true;
+	default: return false;
+	}
+}
+
+std::uint32_t DdsDxgiFormat(DdsFormat format, bool srgb)
+{
+	// BC4 and BC5 have no sRGB variant.
+	switch (format)
+	{
+	case DdsFormat::RGBA8: return srgb ? 29 : 28;	// DXGI_FORMAT_R8G8B8A8_UNORM(_SRGB)
+	case DdsFormat::BC1: return srgb ? 72 : 71;		// DXGI_FORMAT_BC1_UNORM(_SRGB)
+	case DdsFormat::BC2: return srgb ? 75 : 74;
+	case DdsFormat::BC3: return srgb ? 78 : 77;
+	case DdsFormat::BC4: return 80;					// DXGI_FORMAT_BC4_UNORM
+	case DdsFormat::BC5: return 83;					// DXGI_FORMAT_BC5_UNORM
+	case DdsFormat::BC7: return srgb ? 99 : 98;		// DXGI_FORMAT_BC7_UNORM(_SRGB)
+	default: return 0;
+	}
+}
+
+std::size_t DdsRowBytes(DdsFormat format, std::uint32_t width)
+{
+	BlockFormat blockFormat;
+	if (!DdsBlockFormat(format, blockFormat))
+		return 4 * (std::size_t)width;
+	return (std::size_t)BlockBytes(blockFormat) * ((width + 3) / 4);
+}
+
+std::uint32_t DdsRowCount(DdsFormat format, std::uint32_t height)
+{
+	BlockFormat blockFormat;
+	return DdsBlockFormat(format, blockFormat) ? (height + 3) / 4 : height;
+}
+
+std::vector<std::uint8_t> DdsHeader(DdsFormat format, bool srgb, std::uint32_t width, std::uint32_t height,
+	std::uint32_t mipCount)
+{
+	const bool compressed = (format != DdsFormat::RGBA8);
+	const std::uint32_t fourCC = LegacyFourCC(format, srgb);
+	const bool dx10 = (fourCC == 0) && (compressed || srgb);
+
+	std::vector<std::uint8_t> out;
+	out.reserve(4 + 124 + 20);
+	Put(out, DdsMagic);
+
+	std::uint32_t flags = HeaderCaps | HeaderHeight | HeaderWidth | HeaderPixelFormat;
+	flags |= compressed ? HeaderLinearSize : HeaderPitch;
+	if (mipCount > 1)
+		flags |= HeaderMipCount;
+
+	Put(out, 124);
+	Put(out, flags);
+	Put(out, height);
+	Put(out, width);
+	Put(out, (std::uint32_t)(compressed ? DdsRowBytes(format, width) * DdsRowCount(format, height) : DdsRowBytes(format, width)));
+	Put(out, 0);											// depth
+	Put(out, mipCount);
+	for (int i = 0; i < 11; ++i)
+		Put(out, 0);
+
+	// pixel format
+	Put(out, 32);
+	if (dx10)
+	{
+		Put(out, PixelFourCC);
+		Put(out, FourCC('D', 'X', '1', '0'));
+		for (int i = 0; i < 5; ++i)
+			Put(out, 0);
+	}
+	else if (compressed)
+	{
+		Put(out, PixelFourCC);
+		Put(out, fourCC);
+		for (int i = 0; i < 5; ++i)
+			Put(out, 0);
+	}
+	else
+	{
+		Put(out, PixelRgb | PixelAlphaPixels);
+		Put(out, 0);
+		Put(out, 32);
+		Put(out, 0x000000FF);
+		Put(out, 0x0000FF00);
+		Put(out, 0x00FF0000);
+		Put(out, 0xFF000000);
+	}
+
+	Put(out, CapsTexture | ((mipCount > 1) ? CapsComplex | CapsMipMap : 0));
+	for (int i = 0; i < 4; ++i)
+		Put(out, 0);											// caps2-4, reserved
+
+	if (dx10)
+	{
+		Put(out, DdsDxgiFormat(format, srgb));
+		Put(out, Texture2D);
+		Put(out, 0);											// misc flags
+		Put(out, 1);											// array size
+		Put(out, 0);											// alpha mode unknown
+	}
+	return out;
+}
+
+bool WriteDds(const char* fileName, DdsFormat format, bool srgb, std::uint32_t width, std::uint32_t height,
+	const DdsLevel* levels, std::uint32_t mipCount)
+{
+	std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	std::vector<std::uint8_t> header = DdsHeader(format, srgb, width, height, mipCount);
+	out.write(reinterpret_cast<const char*>(header.data()), (std::streamsize)header.size());
+
+	for (std::uint32_t level = 0; level < mipCount; ++level)
+	{
+		std::uint32_t levelWidth = std::max(width >> level, 1u);
+		std::uint32_t levelHeight = std::max(height >> level, 1u);
+		std::size_t rowBytes = DdsRowBytes(format, levelWidth);
+		std::uint32_t rows = DdsRowCount(format, levelHeight);
+
+		const std::uint8_t* row = static_cast<const std::uint8_t*>(levels[level].Data);
+		for (std::uint32_t r = 0; r < rows; ++r, row += levels[level].RowPitch)
+			out.write(reinterpret_cast<const char*>(row), (std::streamsize)rowBytes);
+	}
+
+	out.flush();
+	return (bool)out;
+}
@@ -0,0 +1,54 @@
+//***************************************************************************************
+// DDSWriter.h
+//
+// Writes 2D textures with their mip chains as .dds files that DDSTextureLoader and the
+// TextureStreamer read back.  BC1-BC5 UNORM and uncompressed RGBA8 go out with the
+// classic header (DXT1, DXT3, DXT5, BC4U, ATI2 or RGB masks) that every DDS tool reads;
+// BC7 and the sRGB formats need the DX10 extension header.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include "BlockDecoder.h"
+#include <vector>
+
+enum class DdsFormat
+{
+	RGBA8,
+	BC1,
+	BC2,
+	BC3,
+	BC4,
+	BC5,
+	BC7,
+};
+
+// One mip level: rows of texels (RGBA8) or of 4x4 blocks, 'RowPitch' bytes apart.
+struct DdsLevel
+{
+	const void* Data = nullptr;
+	std::size_t RowPitch = 0;
+};
+
+// The block format of a compressed DdsFormat; false for RGBA8.
+bool DdsBlockFormat(DdsFormat format, BlockFormat& blockFormat);
+
+// The DXGI_FORMAT value the file is loaded as ('srgb' picks the _SRGB variant).
+std::uint32_t DdsDxgiFormat(DdsFormat format, bool srgb);
+
+// Bytes of one tightly packed row of texels or blocks of a level 'width' texels wide,
+// and the number of those rows in a level 'height' texels high.
+std::size_t DdsRowBytes(DdsFormat format, std::uint32_t width);
+std::uint32_t DdsRowCount(DdsFormat format, std::uint32_t height);
+
+// The magic number and header(s) of a file with 'mipCount' levels of a width x height texture.
+std::vector<std::uint8_t> DdsHeader(DdsFormat format, bool srgb, std::uint32_t width, std::uint32_t height,
+	std::uint32_t mipCount);
+
+// Writes the header and levels[0, mipCount) (level i is max(width >> i, 1) x
+// max(height >> i, 1) texels), rows packed tightly.  False if the file cannot be written.
+bool WriteDds(const char* fileName, DdsFormat format, bool srgb, std::uint32_t width, std::uint32_t height,
+	const DdsLevel* levels, std::uint32_t mipCount);
@@ -0,0 +1,80 @@
+//***************************************************************************************
+// DeferredReleaseQueue.cpp
+//***************************************************************************************
+
+#include "DeferredReleaseQueue.h"
+
+using Microsoft::WRL::ComPtr;
+
+DeferredReleaseQueue::DeferredReleaseQueue(GpuMemoryAllocator* allocator)
+	: mAllocator(allocator)
+{
+}
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+	// the owner is expected to have flushed the GPU by now.
+	ReleaseAll();
+}
+
+void DeferredReleaseQueue::Retire(ComPtr<ID3D12Resource>& resource, UINT64 fenceValue)
+{
+	if (resource == nullptr)
+		return;
+
+	Entry entry;
+	entry.Resource = resource;
+	Push(entry, fenceValue);
+	resource.Reset();
+}
+
+void DeferredReleaseQueue::Retire(std::function<void()> release, UINT64 fenceValue)
+{
+	Entry entry;
+	entry.Callback = std::move(release);
+	Push(entry, fenceValue);
+}
+
+void DeferredReleaseQueue::Push(Entry& entry, UINT64 fenceValue)
+{
+	// keep the queue sorted: an entry retired against an older fence than its predecessor
+	// simply waits a little longer.
+	if (!mPending.empty())
+		fenceValue = std::max(fenceValue, mPending.back().Fence);
+
+	entry.Fence = fenceValue;
+	mPending.push_back(std::move(entry));
+}
+
+void DeferredReleaseQueue::ReleaseCompleted(UINT64 completedFenceValue)
+{
+	while (!mPending.empty() && mPending.front().Fence <= completedFenceValue)
+	{
+		Release(mPending.front());
+		mPending.pop_front();
+	}
+}
+
+void DeferredReleaseQueue::ReleaseAll()
+{
+	while (!mPending.empty())
+	{
+		Release(mPending.front());
+		mPending.pop_front();
+	}
+}
+
+void DeferredReleaseQueue::Release(Entry& entry)
+{
+	if (entry.Resource != nullptr)
+	{
+		if (mAllocator != nullptr)
+			mAllocator->Release(entry.Resource);
+		entry.Resource.Reset();
+	}
+
+	entry.Object.Reset();
+
+	if (entry.Callback)
+		entry.Callback();
+}
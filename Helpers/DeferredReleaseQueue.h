@@ -0,0 +1,64 @@
+//***************************************************************************************
+// DeferredReleaseQueue.h
+//
+// Keeps GPU objects alive until the fence value of their last use has completed, so a
+// resource, pipeline state or descriptor slot can be replaced while frames that still
+// reference it are in flight, without flushing the queue.  Retire() takes the caller's
+// reference; ReleaseCompleted() drops the ones whose fence has passed.  Resources placed
+// by a GpuMemoryAllocator are given back to it.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "GpuMemoryAllocator.h"
+#include <deque>
+#include <functional>
+
+class DeferredReleaseQueue
+{
+public:
+	explicit DeferredReleaseQueue(GpuMemoryAllocator* allocator = nullptr);
+	DeferredReleaseQueue(const DeferredReleaseQueue& rhs) = delete;
+	DeferredReleaseQueue& operator=(const DeferredReleaseQueue& rhs) = delete;
+	~DeferredReleaseQueue();
+
+	// 'fenceValue' is the value signaled after the last submission that uses the object.
+	// The caller's pointer is reset.
+	void Retire(Microsoft::WRL::ComPtr<ID3D12Resource>& resource, UINT64 fenceValue);
+
+	template<typename T>
+	void Retire(Microsoft::WRL::ComPtr<T>& object, UINT64 fenceValue)
+	{
+		Entry entry;
+		entry.Object = object;
+		Push(entry, fenceValue);
+		object.Reset();
+	}
+
+	// For things that are not COM objects, e.g. freeing a descriptor slot.
+	void Retire(std::function<void()> release, UINT64 fenceValue);
+
+	void ReleaseCompleted(UINT64 completedFenceValue);
+
+	// Only once the GPU is idle (after a flush).
+	void ReleaseAll();
+
+	size_t PendingCount()const { return mPending.size(); }
+
+private:
+	struct Entry
+	{
+		UINT64 Fence = 0;
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		Microsoft::WRL::ComPtr<IUnknown> Object;
+		std::function<void()> Callback;
+	};
+
+	void Push(Entry& entry, UINT64 fenceValue);
+	void Release(Entry& entry);
+
+private:
+	GpuMemoryAllocator* mAllocator = nullptr;
+	std::deque<Entry> mPending;				// ordered by fence value
+};
@@ -0,0 +1,96 @@
+//***************************************************************************************
+// DescriptorAllocator.cpp
+//***************************************************************************************
+
+#include "DescriptorAllocator.h"
+
+DescriptorAllocator::DescriptorAllocator(ID3D12Device* device, UINT persistentCount)
+	: mDevice(device), mPersistentCount(persistentCount)
+{
+	mDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = persistentCount;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mShaderVisibleHeap)));
+
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&mStagingHeap)));
+
+	// hand out low indices first, so the slots in use stay dense.
+	mFreeList.reserve(persistentCount);
+	for (UINT i = persistentCount; i > 0; --i)
+		mFreeList.push_back(i - 1);
+
+	mStagedDirty.assign(persistentCount, false);
+}
+
+UINT DescriptorAllocator::AllocatePersistent()
+{
+	if (mFreeList.empty())
+		ThrowIfFailed(E_OUTOFMEMORY);
+
+	UINT index = mFreeList.back();
+	mFreeList.pop_back();
+	return index;
+}
+
+void DescriptorAllocator::FreePersistent(UINT index)
+{
+	assert(index < mPersistentCount);
+	mStagedDirty[index] = false;
+	mFreeList.push_back(index);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::StagingHandle(UINT index)
+{
+	assert(index < mPersistentCount);
+
+	// the caller is about to write through this handle.
+	mStagedDirty[index] = true;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mStagingHeap->GetCPUDescriptorHandleForHeapStart());
+	handle.Offset(index, mDescriptorSize);
+	return handle;
+}
+
+void DescriptorAllocator::CommitStaged()
+{
+	// one CopyDescriptorsSimple per run of contiguous dirty slots.
+	for (UINT first = 0; first < mPersistentCount; )
+	{
+		if (!mStagedDirty[first])
+		{
+			++first;
+			continue;
+		}
+
+		UINT last = first + 1;
+		while (last < mPersistentCount && mStagedDirty[last])
+			++last;
+
+		CD3DX12_CPU_DESCRIPTOR_HANDLE src(mStagingHeap->GetCPUDescriptorHandleForHeapStart());
+		src.Offset(first, mDescriptorSize);
+		mDevice->CopyDescriptorsSimple(last - first, CpuHandle(first), src, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		for (UINT i = first; i < last; ++i)
+			mStagedDirty[i] = false;
+
+		first = last;
+	}
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::CpuHandle(UINT index)const
+{
+	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(mShaderVisibleHeap->GetCPUDescriptorHandleForHeapStart());
+	handle.Offset(index, mDescriptorSize);
+	return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorAllocator::GpuHandle(UINT index)const
+{
+	CD3DX12_GPU_DESCRIPTOR_HANDLE handle(mShaderVisibleHeap->GetGPUDescriptorHandleForHeapStart());
+	handle.Offset(index, mDescriptorSize);
+	return handle;
+}
@@ -0,0 +1,49 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Owns the shader-visible CBV/SRV/UAV heap.  Its descriptors (textures, ...) are handed
+// out and returned through a free list; a replaced view gets a new slot and its old one is
+// freed once the GPU no longer uses it (DeferredReleaseQueue).
+//
+// Descriptors are written into a CPU-only staging heap (shader-visible heaps are
+// write-combined and must not be read) and copied to the shader-visible heap in bulk by
+// CommitStaged().
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator(ID3D12Device* device, UINT persistentCount);
+	DescriptorAllocator(const DescriptorAllocator& rhs) = delete;
+	DescriptorAllocator& operator=(const DescriptorAllocator& rhs) = delete;
+
+	ID3D12DescriptorHeap* Heap()const { return mShaderVisibleHeap.Get(); }
+	UINT DescriptorSize()const { return mDescriptorSize; }
+
+	// Create the view at StagingHandle(index), then CommitStaged().
+	// An index may only be freed once the GPU no longer uses it.
+	UINT AllocatePersistent();
+	void FreePersistent(UINT index);
+	D3D12_CPU_DESCRIPTOR_HANDLE StagingHandle(UINT index);
+	void CommitStaged();
+
+	D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT index)const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT index)const;
+
+	UINT PersistentInUse()const { return mPersistentCount - (UINT)mFreeList.size(); }
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	UINT mDescriptorSize = 0;
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mShaderVisibleHeap;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mStagingHeap;		// CPU-only mirror of the heap
+
+	UINT mPersistentCount = 0;
+	std::vector<UINT> mFreeList;			// free persistent indices, lowest on top
+	std::vector<bool> mStagedDirty;			// persistent indices written since the last CommitStaged
+};
@@ -0,0 +1,89 @@
+//***************************************************************************************
+// FenceManager.cpp
+//***************************************************************************************
+
+#include "FenceManager.h"
+
+FenceManager::FenceManager()
+{
+	__int64 countsPerSec;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
+	mSecondsPerCount = 1.0 / (double)countsPerSec;
+}
+
+FenceManager::~FenceManager()
+{
+	if (mEvent != nullptr)
+		CloseHandle(mEvent);
+}
+
+void FenceManager::Initialize(ID3D12Device* device)
+{
+	ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+
+	// auto-reset, so one event serves every wait.
+	mEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+	if (mEvent == nullptr)
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+
+	mLastSignaled = 0;
+	mLastCompleted = 0;
+}
+
+UINT64 FenceManager::Signal(ID3D12CommandQueue* queue)
+{
+	// the new fence point is set on the GPU timeline, once all prior work on 'queue' is done.
+	ThrowIfFailed(queue->Signal(mFence.Get(), ++mLastSignaled));
+	return mLastSignaled;
+}
+
+void FenceManager::Wait(UINT64 value)
+{
+	mWindowStats.Waits++;
+	mLastWait = 0.0;
+
+	if (IsComplete(value))
+		return;
+
+	__int64 start;
+	QueryPerformanceCounter((LARGE_INTEGER*)&start);
+
+	ThrowIfFailed(mFence->SetEventOnCompletion(value, mEvent));
+	WaitForSingleObject(mEvent, INFINITE);
+
+	__int64 end;
+	QueryPerformanceCounter((LARGE_INTEGER*)&end);
+
+	mLastWait = (end - start) * mSecondsPerCount;
+	mLastCompleted = mFence->GetCompletedValue();
+
+	mWindowStats.Stalls++;
+	mWindowStats.TotalWait += mLastWait;
+	if (mLastWait > mWindowStats.MaxWait)
+		mWindowStats.MaxWait = mLastWait;
+}
+
+void FenceManager::Flush(ID3D12CommandQueue* queue)
+{
+	Wait(Signal(queue));
+}
+
+bool FenceManager::IsComplete(UINT64 value)
+{
+	if (value > mLastCompleted)
+		mLastCompleted = mFence->GetCompletedValue();
+
+	return value <= mLastCompleted;
+}
+
+UINT64 FenceManager::CompletedValue()
+{
+	mLastCompleted = mFence->GetCompletedValue();
+	return mLastCompleted;
+}
+
+void FenceManager::PublishStats()
+{
+	mLastStats = mWindowStats;
+	mWindowStats = Stats();
+}
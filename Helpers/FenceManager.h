@@ -0,0 +1,67 @@
+//***************************************************************************************
+// FenceManager.h
+//
+// Owns a D3D12 fence together with the timeline of values signaled on it and one
+// reusable wait event, so waiting on the GPU does not create and destroy a kernel event
+// every time.  Every CPU wait is timed; the statistics tell how long the CPU sat idle
+// waiting for the GPU, i.e. whether more frames in flight would help throughput or
+// fewer would cut latency.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class FenceManager
+{
+public:
+	// CPU wait statistics accumulated over one report window (see PublishStats).
+	struct Stats
+	{
+		UINT Waits = 0;					// calls to Wait()
+		UINT Stalls = 0;				// waits where the fence had not completed yet
+		double TotalWait = 0.0;			// in seconds
+		double MaxWait = 0.0;			// in seconds
+	};
+
+public:
+	FenceManager();
+	FenceManager(const FenceManager& rhs) = delete;
+	FenceManager& operator=(const FenceManager& rhs) = delete;
+	~FenceManager();
+
+	void Initialize(ID3D12Device* device);
+
+	// Signals the next timeline value on 'queue' and returns it.
+	UINT64 Signal(ID3D12CommandQueue* queue);
+
+	// Blocks the calling thread until the fence reaches 'value'.
+	void Wait(UINT64 value);
+
+	// Signal + Wait: returns when the GPU has finished all work submitted to 'queue'.
+	void Flush(ID3D12CommandQueue* queue);
+
+	bool IsComplete(UINT64 value);
+	UINT64 CompletedValue();
+	UINT64 LastSignaledValue()const { return mLastSignaled; }
+	UINT64 NextValue()const { return mLastSignaled + 1; }		// the value the next Signal() will use
+	ID3D12Fence* Fence()const { return mFence.Get(); }
+
+	double LastWait()const { return mLastWait; }	// duration of the most recent Wait(), in seconds
+
+	// Closes the current report window; call about once per second.
+	void PublishStats();
+	const Stats& LastStats()const { return mLastStats; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
+	HANDLE mEvent = nullptr;
+
+	UINT64 mLastSignaled = 0;
+	UINT64 mLastCompleted = 0;		// cached, GetCompletedValue() is not free
+
+	double mSecondsPerCount = 0.0;
+	double mLastWait = 0.0;
+	Stats mWindowStats;
+	Stats mLastStats;
+};
@@ -0,0 +1,165 @@
+//***************************************************************************************
+// FrameLimiter.cpp
+//***************************************************************************************
+
+#include "FrameLimiter.h"
+#include <timeapi.h>
+#include <algorithm>
+#include <cmath>
+
+#pragma comment(lib, "winmm.lib")
+
+FrameLimiter::FrameLimiter()
+{
+	// Raise the scheduler resolution to 1ms so that Sleep() in the coarse phase wakes
+	// up close to where we asked; with the default 15.6ms quantum the spin phase
+	// would have to cover a whole quantum and waste a lot of CPU time.
+	mTimerPeriodRaised = (timeBeginPeriod(1) == TIMERR_NOERROR);
+}
+
+FrameLimiter::~FrameLimiter()
+{
+	if (mTimerPeriodRaised)
+		timeEndPeriod(1);
+}
+
+void FrameLimiter::SetTargetFrameRate(float framesPerSecond)
+{
+	mTargetInterval = (framesPerSecond > 0.0f) ? 1.0 / (double)framesPerSecond : 0.0;
+	mNextDeadline = 0.0;
+}
+
+float FrameLimiter::TargetFrameRate()const
+{
+	return (mTargetInterval > 0.0) ? (float)(1.0 / mTargetInterval) : 0.0f;
+}
+
+void FrameLimiter::SetSpinThreshold(double seconds)
+{
+	mSpinThreshold = std::max(seconds, 0.0);
+}
+
+void FrameLimiter::Reset(const GameTimer& timer)
+{
+	double now = timer.Now();
+
+	mNextDeadline = 0.0;
+	mLastRelease = now;
+
+	mWindowStart = now;
+	mFrameCount = 0;
+	mMissedDeadlines = 0;
+	mIntervalSum = 0.0;
+	mMinInterval = 0.0;
+	mMaxInterval = 0.0;
+	mJitterSum = 0.0;
+	mMaxJitter = 0.0;
+}
+
+void FrameLimiter::Wait(const GameTimer& timer)
+{
+	double now = timer.Now();
+	mStatsUpdated = false;
+
+	if (mTargetInterval <= 0.0)
+	{
+		Record(now, false);
+		return;
+	}
+
+	// the first frame after a reset only establishes the cadence.
+	if (mNextDeadline == 0.0)
+		mNextDeadline = now + mTargetInterval;
+
+	// coarse phase: sleep in whole milliseconds until we are inside the spin threshold.
+	for (;;)
+	{
+		double remaining = mNextDeadline - now - mSpinThreshold;
+		if (remaining < 0.001)
+			break;
+
+		Sleep((DWORD)(remaining * 1000.0));
+		now = timer.Now();
+	}
+
+	// fine phase: spin on the performance counter for the final stretch.
+	while (now < mNextDeadline)
+	{
+		YieldProcessor();
+		now = timer.Now();
+	}
+
+	// if we are more than a whole interval late (a hitch, a window drag, ...), do not
+	// try to catch up by releasing a burst of frames; re-anchor the cadence instead.
+	bool missed = (now - mNextDeadline) > mTargetInterval;
+	Record(now, missed);
+
+	if (missed)
+		mNextDeadline = now + mTargetInterval;
+	else
+		mNextDeadline += mTargetInterval;
+}
+
+bool FrameLimiter::StatsUpdated()const
+{
+	return mStatsUpdated;
+}
+
+const FrameLimiter::Stats& FrameLimiter::LastStats()const
+{
+	return mLastStats;
+}
+
+void FrameLimiter::Record(double releaseTime, bool missed)
+{
+	double interval = releaseTime - mLastRelease;
+	mLastRelease = releaseTime;
+
+	if (mFrameCount == 0)
+	{
+		mMinInterval = interval;
+		mMaxInterval = interval;
+	}
+	else
+	{
+		mMinInterval = std::min(mMinInterval, interval);
+		mMaxInterval = std::max(mMaxInterval, interval);
+	}
+
+	++mFrameCount;
+	mIntervalSum += interval;
+
+	if (missed)
+	{
+		++mMissedDeadlines;
+	}
+	else if (mTargetInterval > 0.0)
+	{
+		// mNextDeadline still holds the deadline this frame was released against.
+		double jitter = fabs(releaseTime - mNextDeadline);
+		mJitterSum += jitter;
+		mMaxJitter = std::max(mMaxJitter, jitter);
+	}
+
+	// publish the statistics once per second.
+	if (releaseTime - mWindowStart >= 1.0)
+	{
+		UINT pacedFrames = mFrameCount - mMissedDeadlines;
+
+		mLastStats.FrameCount = mFrameCount;
+		mLastStats.MissedDeadlines = mMissedDeadlines;
+		mLastStats.AvgInterval = mIntervalSum / mFrameCount;
+		mLastStats.MinInterval = mMinInterval;
+		mLastStats.MaxInterval = mMaxInterval;
+		mLastStats.AvgJitter = (pacedFrames > 0) ? mJitterSum / pacedFrames : 0.0;
+		mLastStats.MaxJitter = mMaxJitter;
+		mStatsUpdated = true;
+
+		mWindowStart = releaseTime;
+		mFrameCount = 0;
+		mMissedDeadlines = 0;
+		mIntervalSum = 0.0;
+		mJitterSum = 0.0;
+		mMaxJitter = 0.0;
+	}
+}
@@ -0,0 +1,73 @@
+//***************************************************************************************
+// FrameLimiter.h
+//
+// Hybrid sleep/spin frame limiter.  The bulk of the remaining frame interval is given
+// back to the OS with Sleep() (cheap on power), and only the last stretch before the
+// deadline is spun on the performance counter so that frames are released with
+// sub-millisecond precision.
+//***************************************************************************************
+
+#pragma once
+
+#include <windows.h>
+#include "GameTimer.h"
+
+class FrameLimiter
+{
+public:
+	// Pacing statistics accumulated over one report window (about a second).
+	struct Stats
+	{
+		UINT FrameCount = 0;
+		UINT MissedDeadlines = 0;		// frames that started later than one whole interval after their deadline
+		double AvgInterval = 0.0;		// in seconds
+		double MinInterval = 0.0;		// in seconds
+		double MaxInterval = 0.0;		// in seconds
+		double AvgJitter = 0.0;			// mean absolute deviation of the release time from its deadline, in seconds
+		double MaxJitter = 0.0;			// worst deviation of the release time from its deadline, in seconds
+	};
+
+public:
+	FrameLimiter();
+	FrameLimiter(const FrameLimiter& rhs) = delete;
+	FrameLimiter& operator=(const FrameLimiter& rhs) = delete;
+	~FrameLimiter();
+
+	void SetTargetFrameRate(float framesPerSecond);	// 0 disables the limiter (unbounded rendering).
+	float TargetFrameRate()const;
+
+	// How long before the deadline we stop sleeping and start spinning.  Sleep() wakes
+	// up to one scheduler quantum late, so this must cover the timer resolution.
+	void SetSpinThreshold(double seconds);
+
+	void Reset(const GameTimer& timer);		// Call before the message loop and after the app is unpaused.
+	void Wait(const GameTimer& timer);		// Call once per frame, after presenting.
+
+	// Returns true once per report window, when new statistics are available.
+	bool StatsUpdated()const;
+	const Stats& LastStats()const;
+
+private:
+	void Record(double releaseTime, bool missed);
+
+private:
+	double mTargetInterval = 0.0;			// 0 : unbounded
+	double mSpinThreshold = 0.002;
+	double mNextDeadline = 0.0;
+	double mLastRelease = 0.0;
+
+	bool mTimerPeriodRaised = false;
+
+	// running sums for the current report window.
+	double mWindowStart = 0.0;
+	UINT mFrameCount = 0;
+	UINT mMissedDeadlines = 0;
+	double mIntervalSum = 0.0;
+	double mMinInterval = 0.0;
+	double mMaxInterval = 0.0;
+	double mJitterSum = 0.0;
+	double mMaxJitter = 0.0;
+
+	Stats mLastStats;
+	bool mStatsUpdated = false;
+};
@@ -0,0 +1,90 @@
+//***************************************************************************************
+// FrameRingAllocator.cpp
+//***************************************************************************************
+
+#include "FrameRingAllocator.h"
+#include <algorithm>
+
+FrameRingAllocator::FrameRingAllocator(ID3D12Device* device, UINT64 capacity)
+	: mCapacity(capacity)
+{
+	CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(capacity);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&uploadHeap,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&mBuffer)));
+
+	// stays mapped for the lifetime of the allocator.
+	ThrowIfFailed(mBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+	mProtection = WriteCombined::Protect(mMappedData, (size_t)mCapacity);
+	mGpuBase = mBuffer->GetGPUVirtualAddress();
+}
+
+FrameRingAllocator::~FrameRingAllocator()
+{
+	if (mBuffer != nullptr)
+	{
+		WriteCombined::Unprotect(mMappedData, (size_t)mCapacity, mProtection);
+		mBuffer->Unmap(0, nullptr);
+	}
+
+	mMappedData = nullptr;
+}
+
+FrameRingAllocator::Allocation FrameRingAllocator::Allocate(UINT64 size, UINT64 alignment)
+{
+	UINT64 offset = (mHead + alignment - 1) & ~(alignment - 1);
+	if (offset + size > mCapacity)
+	{
+		// does not fit before the end of the buffer: skip the remainder and start over at 0.
+		offset = 0;
+	}
+
+	UINT64 consumed = (offset >= mHead) ? (offset + size - mHead) : (mCapacity - mHead + size);
+	if (size > mCapacity || mUsed + consumed > mCapacity)
+	{
+		// the GPU still reads every byte in use; growing would need a new buffer and a flush.
+		ThrowIfFailed(E_OUTOFMEMORY);
+	}
+
+	mHead = offset + size;
+	if (mHead == mCapacity)
+		mHead = 0;
+
+	mUsed += consumed;
+	mFrameBytes += consumed;
+
+	Allocation alloc;
+	alloc.CPU = mMappedData + offset;
+	alloc.GPU = mGpuBase + offset;
+	alloc.Size = size;
+	return alloc;
+}
+
+void FrameRingAllocator::FinishFrame(UINT64 fenceValue)
+{
+	FrameMark mark;
+	mark.Fence = fenceValue;
+	mark.Bytes = mFrameBytes;
+	mPendingFrames.push(mark);
+
+	mPeakFrameBytes = std::max(mPeakFrameBytes, mFrameBytes);
+	mFrameBytes = 0;
+}
+
+void FrameRingAllocator::ReleaseCompleted(UINT64 completedFenceValue)
+{
+	while (!mPendingFrames.empty() && mPendingFrames.front().Fence <= completedFenceValue)
+	{
+		mUsed -= mPendingFrames.front().Bytes;
+		mPendingFrames.pop();
+	}
+
+	// nothing in flight and nothing recorded: rewind so the next frame does not straddle the end.
+	if (mUsed == 0)
+		mHead = 0;
+}
@@ -0,0 +1,87 @@
+//***************************************************************************************
+// FrameRingAllocator.h
+//
+// Linear suballocator for per-frame transient data (pass constants, dynamic vertices).
+// One large upload heap is created and mapped once; every allocation is a bump of the
+// head pointer, so allocating costs nothing but an add.  At the end of a frame the bytes
+// allocated during that frame are tagged with the frame's fence value, and they are given
+// back to the ring once that fence has completed on the GPU.
+//
+// Write through Allocation::CPU only while a WriteScope is open (WriteCombined validation).
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "WriteCombined.h"
+#include <queue>
+
+class FrameRingAllocator
+{
+public:
+	struct Allocation
+	{
+		BYTE* CPU = nullptr;						// write-only mapped memory (upload heap is write-combined)
+		D3D12_GPU_VIRTUAL_ADDRESS GPU = 0;
+		UINT64 Size = 0;
+	};
+
+public:
+	FrameRingAllocator(ID3D12Device* device, UINT64 capacity);
+	FrameRingAllocator(const FrameRingAllocator& rhs) = delete;
+	FrameRingAllocator& operator=(const FrameRingAllocator& rhs) = delete;
+	~FrameRingAllocator();
+
+	// alignment must be a power of two.  Throws if the ring is full, which means that
+	// the capacity is too small for the number of frames in flight.
+	Allocation Allocate(UINT64 size, UINT64 alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+	// Opens the mapped ring for CPU writes for the lifetime of the scope.
+	class WriteScope : public WriteCombined::WriteScope
+	{
+	public:
+		explicit WriteScope(FrameRingAllocator& ring)
+			: WriteCombined::WriteScope(ring.mMappedData, (size_t)ring.mCapacity, ring.mProtection) {}
+	};
+
+	// Copies one constant buffer's worth of data and returns the address to bind as a root CBV.
+	template<typename T>
+	D3D12_GPU_VIRTUAL_ADDRESS PushConstants(const T& data)
+	{
+		Allocation alloc = Allocate(d3dUtil::CalcConstantBufferByteSize(sizeof(T)));
+		WriteScope scope(*this);
+		WriteCombined::StreamCopy(alloc.CPU, &data, sizeof(T));
+		return alloc.GPU;
+	}
+
+	// Closes the current frame: everything allocated since the last call is retired
+	// once the GPU has passed 'fenceValue'.
+	void FinishFrame(UINT64 fenceValue);
+
+	// Returns the memory of all frames whose fence value is <= completedFenceValue.
+	void ReleaseCompleted(UINT64 completedFenceValue);
+
+	UINT64 Capacity()const { return mCapacity; }
+	UINT64 BytesInUse()const { return mUsed; }
+	UINT64 PeakFrameBytes()const { return mPeakFrameBytes; }
+
+private:
+	struct FrameMark
+	{
+		UINT64 Fence = 0;
+		UINT64 Bytes = 0;			// bytes consumed by the frame, alignment and wrap padding included
+	};
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mBuffer;
+	BYTE* mMappedData = nullptr;
+	DWORD mProtection = 0;			// of the mapping while it is protected (WriteCombined::Protect)
+	D3D12_GPU_VIRTUAL_ADDRESS mGpuBase = 0;
+
+	UINT64 mCapacity = 0;
+	UINT64 mHead = 0;				// next free byte; the in-use region runs backwards from here, mUsed bytes long
+	UINT64 mUsed = 0;
+	UINT64 mFrameBytes = 0;			// consumed by the frame currently being recorded
+	UINT64 mPeakFrameBytes = 0;
+
+	std::queue<FrameMark> mPendingFrames;
+};
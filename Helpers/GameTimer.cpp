@@ -53,6 +53,16 @@ float GameTimer::DeltaTime()const
 	return (float)mDeltaTime;
 }
 
+// Returns the current performance counter time in seconds.  Unlike TotalTime()
+// this does not wait for Tick(), so it can be polled in a tight loop (frame pacing).
+double GameTimer::Now()const
+{
+	__int64 currTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+
+	return currTime*mSecondsPerCount;
+}
+
 void GameTimer::Reset()
 {
 	__int64 currTime;
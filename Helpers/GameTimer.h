@@ -12,6 +12,7 @@ public:
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
+	double Now()const;      // in seconds, raw performance counter time (ignores Stop/Start)
 
 	void Reset(); // Call before message loop.
 	void Start(); // Call when unpaused.
@@ -0,0 +1,295 @@
+//***************************************************************************************
+// GpuMemoryAllocator.cpp
+//***************************************************************************************
+
+#include "GpuMemoryAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// {5B0C6E44-8E1A-4F0B-9C63-2D6A7F1E3B42}
+	const GUID PlacementOwnerGuid = { 0x5b0c6e44, 0x8e1a, 0x4f0b, { 0x9c, 0x63, 0x2d, 0x6a, 0x7f, 0x1e, 0x3b, 0x42 } };
+
+	D3D12_HEAP_TYPE HeapTypeOf(GpuMemoryAllocator::Category category)
+	{
+		return (category == GpuMemoryAllocator::Category::UploadBuffer) ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT;
+	}
+
+	D3D12_HEAP_FLAGS HeapFlagsOf(GpuMemoryAllocator::Category category)
+	{
+		switch (category)
+		{
+		case GpuMemoryAllocator::Category::UploadBuffer:
+		case GpuMemoryAllocator::Category::Buffer:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		case GpuMemoryAllocator::Category::Texture:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		default:
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		}
+	}
+
+	UINT64 NextPowerOfTwo(UINT64 x)
+	{
+		UINT64 p = 1;
+		while (p < x)
+			p <<= 1;
+		return p;
+	}
+}
+
+// Held by a placed resource (SetPrivateDataInterface) and released with it; the last
+// release gives the range back unless the allocator let go of the resource already.
+class GpuMemoryAllocator::PlacementOwner : public IUnknown
+{
+public:
+	PlacementOwner(GpuMemoryAllocator* allocator, ID3D12Resource* resource)
+		: mAllocator(allocator), mResource(resource)
+	{
+	}
+
+	void Detach() { mAllocator = nullptr; }
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (riid != __uuidof(IUnknown))
+		{
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+		AddRef();
+		*object = static_cast<IUnknown*>(this);
+		return S_OK;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return InterlockedIncrement(&mRefCount);
+	}
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		ULONG count = InterlockedDecrement(&mRefCount);
+		if (count == 0)
+		{
+			// the resource is being destroyed: its address is only a key here.
+			if (mAllocator != nullptr)
+			{
+				auto it = mAllocator->mPlacements.find(mResource);
+				if (it != mAllocator->mPlacements.end() && it->second.Owner == this)
+					mAllocator->FreePlacement(it);
+			}
+			delete this;
+		}
+		return count;
+	}
+
+private:
+	volatile LONG mRefCount = 1;
+	GpuMemoryAllocator* mAllocator = nullptr;
+	ID3D12Resource* mResource = nullptr;
+};
+
+GpuMemoryAllocator::GpuMemoryAllocator(ID3D12Device* device, UINT64 heapSize)
+	: mDevice(device), mHeapSize(NextPowerOfTwo(heapSize))
+{
+}
+
+GpuMemoryAllocator::~GpuMemoryAllocator()
+{
+	// resources that outlive the allocator go with their heaps' last reference.
+	for (auto& elem : mPlacements)
+		elem.second.Owner->Detach();
+}
+
+GpuMemoryAllocator::Heap& GpuMemoryAllocator::AddHeap(Category category, UINT64 size)
+{
+	// 4MB alignment makes the heap usable for MSAA resources as well.
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = size;
+	heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(HeapTypeOf(category));
+	heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+	heapDesc.Flags = HeapFlagsOf(category);
+
+	Heap heap;
+	ThrowIfFailed(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.D3DHeap)));
+	heap.Offsets = std::make_unique<BuddyAllocator>(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	Pool& pool = mPools[(int)category];
+	pool.Heaps.push_back(std::move(heap));
+	return pool.Heaps.back();
+}
+
+HRESULT GpuMemoryAllocator::CreateResource(
+	Category category,
+	const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState,
+	const D3D12_CLEAR_VALUE* optimizedClearValue,
+	ComPtr<ID3D12Resource>& resource)
+{
+	D3D12_RESOURCE_ALLOCATION_INFO info = mDevice->GetResourceAllocationInfo(0, 1, &desc);
+	if (info.SizeInBytes == UINT64_MAX)
+		return E_INVALIDARG;
+
+	// first fit over the existing heaps, then a new heap (a dedicated one if the
+	// resource is larger than the regular heap size).
+	Pool& pool = mPools[(int)category];
+	Heap* heap = nullptr;
+	UINT64 offset = BuddyAllocator::InvalidOffset;
+	for (auto& elem : pool.Heaps)
+	{
+		offset = elem.Offsets->Allocate(info.SizeInBytes, info.Alignment);
+		if (offset != BuddyAllocator::InvalidOffset)
+		{
+			heap = &elem;
+			break;
+		}
+	}
+
+	if (heap == nullptr)
+	{
+		heap = &AddHeap(category, std::max(mHeapSize, NextPowerOfTwo(info.SizeInBytes)));
+		offset = heap->Offsets->Allocate(info.SizeInBytes, info.Alignment);
+	}
+
+	HRESULT hr = mDevice->CreatePlacedResource(heap->D3DHeap.Get(), offset, &desc, initialState,
+		optimizedClearValue, IID_PPV_ARGS(resource.ReleaseAndGetAddressOf()));
+	if (FAILED(hr))
+	{
+		heap->Offsets->Free(offset);
+		return hr;
+	}
+
+	Placement placement;
+	placement.Cat = category;
+	placement.D3DHeap = heap->D3DHeap.Get();
+	placement.Offset = offset;
+	hr = AttachOwner(resource.Get(), placement);
+	if (FAILED(hr))
+	{
+		// without an owner nobody would give the range back.
+		resource = nullptr;
+		heap->Offsets->Free(offset);
+		RemoveEmptyHeaps(category);
+		return hr;
+	}
+
+	UpdatePeak(category);
+	return S_OK;
+}
+
+HRESULT GpuMemoryAllocator::AttachOwner(ID3D12Resource* resource, Placement& placement)
+{
+	// a live key here means the books are wrong: two resources would own one range.
+	if (mPlacements.find(resource) != mPlacements.end())
+		return E_UNEXPECTED;
+
+	placement.Owner = new PlacementOwner(this, resource);
+	HRESULT hr = resource->SetPrivateDataInterface(PlacementOwnerGuid, placement.Owner);
+	placement.Owner->Release();
+	if (FAILED(hr))
+		return hr;
+
+	mPlacements[resource] = placement;
+	return S_OK;
+}
+
+void GpuMemoryAllocator::FreePlacement(std::unordered_map<ID3D12Resource*, Placement>::iterator it)
+{
+	Pool& pool = mPools[(int)it->second.Cat];
+	for (auto& heap : pool.Heaps)
+	{
+		if (heap.D3DHeap.Get() == it->second.D3DHeap)
+		{
+			heap.Offsets->Free(it->second.Offset);
+			break;
+		}
+	}
+
+	Category category = it->second.Cat;
+	mPlacements.erase(it);
+	RemoveEmptyHeaps(category);
+}
+
+void GpuMemoryAllocator::Release(ComPtr<ID3D12Resource>& resource)
+{
+	if (resource == nullptr)
+		return;
+
+	// freed now; the owner must not free the range again when the resource goes.
+	auto it = mPlacements.find(resource.Get());
+	if (it != mPlacements.end())
+	{
+		it->second.Owner->Detach();
+		FreePlacement(it);
+	}
+
+	// not placed by this allocator (e.g. a committed fallback) otherwise.
+	resource = nullptr;
+}
+
+ID3D12Pageable* GpuMemoryAllocator::ResidencyObject(ID3D12Resource* resource, UINT64& size)const
+{
+	auto it = mPlacements.find(resource);
+	if (it != mPlacements.end())
+	{
+		size = it->second.D3DHeap->GetDesc().SizeInBytes;
+		return it->second.D3DHeap;
+	}
+
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	size = mDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+	return resource;
+}
+
+void GpuMemoryAllocator::RemoveEmptyHeaps(Category category)
+{
+	// keep the first heap around so that steady create/release cycles do not churn heaps.
+	auto& heaps = mPools[(int)category].Heaps;
+	for (size_t i = heaps.size(); i-- > 1; )
+	{
+		if (heaps[i].Offsets->Empty())
+			heaps.erase(heaps.begin() + i);
+	}
+}
+
+void GpuMemoryAllocator::UpdatePeak(Category category)
+{
+	Stats stats = GetStats(category);
+	Pool& pool = mPools[(int)category];
+	pool.PeakUsedBytes = std::max(pool.PeakUsedBytes, stats.UsedBytes);
+}
+
+GpuMemoryAllocator::Stats GpuMemoryAllocator::GetStats(Category category)const
+{
+	const Pool& pool = mPools[(int)category];
+
+	Stats stats;
+	stats.HeapCount = (UINT)pool.Heaps.size();
+	stats.PeakUsedBytes = pool.PeakUsedBytes;
+	for (const auto& heap : pool.Heaps)
+	{
+		BuddyAllocator::Stats heapStats = heap.Offsets->GetStats();
+		stats.HeapBytes += heapStats.Capacity;
+		stats.UsedBytes += heapStats.UsedBytes;
+		stats.RequestedBytes += heapStats.RequestedBytes;
+		stats.AllocationCount += heapStats.AllocationCount;
+		stats.LargestFreeBlock = std::max(stats.LargestFreeBlock, heapStats.LargestFreeBlock);
+	}
+	stats.PeakUsedBytes = std::max(stats.PeakUsedBytes, stats.UsedBytes);
+
+	return stats;
+}
+
+const char* GpuMemoryAllocator::CategoryName(Category category)
+{
+	switch (category)
+	{
+	case Category::UploadBuffer: return "upload buffers";
+	case Category::Buffer: return "buffers";
+	case Category::Texture: return "textures";
+	case Category::RenderTarget: return "render targets";
+	default: return "?";
+	}
+}
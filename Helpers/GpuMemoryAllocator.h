@@ -0,0 +1,107 @@
+//***************************************************************************************
+// GpuMemoryAllocator.h
+//
+// Places resources inside a few large ID3D12Heaps instead of giving every resource a
+// committed heap of its own.  Resources are grouped in categories that map to the heap
+// type and the heap flags required on resource heap tier 1 hardware (buffers, non render
+// target textures and render target/depth textures cannot share a heap there).  Offsets
+// within each heap are managed by a BuddyAllocator.
+//
+// Every placed resource carries a small owner object (private data of the resource) that
+// gives its range back when the resource is destroyed, so a resource dropped without
+// Release() does not leak its range or leave its address behind as a stale key.
+// Release() remains the way to free a range the moment the GPU is done with it.  The
+// allocator and the last references to its resources are used from one thread.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "BuddyAllocator.h"
+
+class GpuMemoryAllocator
+{
+public:
+	enum class Category : int
+	{
+		UploadBuffer = 0,		// CPU written buffers in upload heaps
+		Buffer,					// vertex/index/constant buffers in default heaps
+		Texture,				// sampled textures
+		RenderTarget,			// render target and depth/stencil textures
+		Count
+	};
+
+	struct Stats
+	{
+		UINT HeapCount = 0;
+		UINT64 HeapBytes = 0;				// memory reserved from the driver
+		UINT64 UsedBytes = 0;				// bytes of heap blocks handed out
+		UINT64 RequestedBytes = 0;			// bytes the resources actually need
+		UINT64 LargestFreeBlock = 0;
+		UINT AllocationCount = 0;
+		UINT64 PeakUsedBytes = 0;
+	};
+
+public:
+	GpuMemoryAllocator(ID3D12Device* device, UINT64 heapSize = 4 * 1024 * 1024);
+	GpuMemoryAllocator(const GpuMemoryAllocator& rhs) = delete;
+	GpuMemoryAllocator& operator=(const GpuMemoryAllocator& rhs) = delete;
+	~GpuMemoryAllocator();
+
+	// Same contract as ID3D12Device::CreatePlacedResource/CreateCommittedResource.
+	HRESULT CreateResource(
+		Category category,
+		const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState,
+		const D3D12_CLEAR_VALUE* optimizedClearValue,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+
+	// Releases the caller's reference and returns the memory of the resource to its heap
+	// right away, even if other references remain.  The GPU must be done with the resource.
+	void Release(Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+
+	Stats GetStats(Category category)const;
+
+	// The object residency is managed at for 'resource': its heap if the resource was placed
+	// by this allocator (shared with the other resources of that heap), otherwise the
+	// resource itself.  'size' receives the size of that object.
+	ID3D12Pageable* ResidencyObject(ID3D12Resource* resource, UINT64& size)const;
+
+	static const char* CategoryName(Category category);
+
+private:
+	struct Heap
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> D3DHeap;
+		std::unique_ptr<BuddyAllocator> Offsets;
+	};
+
+	struct Pool
+	{
+		std::vector<Heap> Heaps;
+		UINT64 PeakUsedBytes = 0;
+	};
+
+	class PlacementOwner;
+
+	struct Placement
+	{
+		PlacementOwner* Owner = nullptr;		// private data of the resource; frees the range with it
+		Category Cat = Category::Buffer;
+		ID3D12Heap* D3DHeap = nullptr;
+		UINT64 Offset = 0;
+	};
+
+	Heap& AddHeap(Category category, UINT64 size);
+	HRESULT AttachOwner(ID3D12Resource* resource, Placement& placement);
+	void FreePlacement(std::unordered_map<ID3D12Resource*, Placement>::iterator it);
+	void RemoveEmptyHeaps(Category category);
+	void UpdatePeak(Category category);
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	UINT64 mHeapSize = 0;
+
+	Pool mPools[(int)Category::Count];
+	std::unordered_map<ID3D12Resource*, Placement> mPlacements;
+};
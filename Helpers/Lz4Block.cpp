@@ -0,0 +1,204 @@
+//***************************************************************************************
+// Lz4Block.cpp
+//***************************************************************************************
+
+#include "Lz4Block.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const std::size_t MinMatch = 4;
+	const std::size_t LastLiterals = 5;			// the block always ends with this many literals
+	const std::size_t MatchSafeLimit = 12;		// no match starts in the last 12 bytes
+	const std::size_t MaxOffset = 65535;
+	const unsigned HashBits = 14;
+
+	inline std::uint32_t Read32(const std::uint8_t* p)
+	{
+		std::uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline std::uint32_t Hash(std::uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// 15 in the token's nibble, the rest in bytes of 255 and a final byte below it.
+	inline std::uint8_t* WriteLength(std::uint8_t* out, std::size_t length)
+	{
+		for (; length >= 255; length -= 255)
+			*out++ = 255;
+		*out++ = (std::uint8_t)length;
+		return out;
+	}
+
+	std::uint8_t* WriteSequence(std::uint8_t* out, const std::uint8_t* literals, std::size_t literalLength,
+		std::size_t offset, std::size_t matchLength)
+	{
+		std::uint8_t* token = out++;
+		if (literalLength >= 15)
+		{
+			*token = 15 << 4;
+			out = WriteLength(out, literalLength - 15);
+		}
+		else
+		{
+			*token = (std::uint8_t)(literalLength << 4);
+		}
+
+		if (literalLength != 0)
+			std::memcpy(out, literals, literalLength);
+		out += literalLength;
+
+		// the last sequence has literals only.
+		if (matchLength == 0)
+			return out;
+
+		*out++ = (std::uint8_t)(offset & 0xFF);
+		*out++ = (std::uint8_t)(offset >> 8);
+
+		std::size_t length = matchLength - MinMatch;
+		if (length >= 15)
+		{
+			*token |= 15;
+			out = WriteLength(out, length - 15);
+		}
+		else
+		{
+			*token |= (std::uint8_t)length;
+		}
+		return out;
+	}
+
+	// false if the length runs past the end of the input.
+	inline bool ReadLength(const std::uint8_t*& in, const std::uint8_t* end, std::size_t& length)
+	{
+		for (;;)
+		{
+			if (in >= end)
+				return false;
+			std::uint8_t byte = *in++;
+			length += byte;
+			if (byte != 255)
+				return true;
+		}
+	}
+}
+
+std::size_t Lz4CompressBound(std::size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+std::size_t Lz4Compress(const void* src, std::size_t size, void* dest)
+{
+	const std::uint8_t* in = static_cast<const std::uint8_t*>(src);
+	std::uint8_t* out = static_cast<std::uint8_t*>(dest);
+	std::size_t anchor = 0;
+
+	if (size > MatchSafeLimit)
+	{
+		// positions by the hash of the 4 bytes there; the most recent one wins.
+		std::vector<std::uint32_t> table((std::size_t)1 << HashBits, UINT32_MAX);
+		const std::size_t matchEnd = size - LastLiterals;
+		const std::size_t lastStart = size - MatchSafeLimit;
+
+		std::size_t pos = 0;
+		while (pos <= lastStart)
+		{
+			const std::uint32_t sequence = Read32(in + pos);
+			std::uint32_t& slot = table[Hash(sequence)];
+			std::size_t candidate = slot;
+			slot = (std::uint32_t)pos;
+
+			if (candidate == UINT32_MAX || pos - candidate > MaxOffset || Read32(in + candidate) != sequence)
+			{
+				// the longer nothing matches, the faster the scan skips ahead.
+				pos += 1 + ((pos - anchor) >> 6);
+				continue;
+			}
+
+			// extend backwards over the pending literals, then forwards.
+			while (pos > anchor && candidate > 0 && in[pos - 1] == in[candidate - 1])
+			{
+				--pos;
+				--candidate;
+			}
+			std::size_t length = MinMatch;
+			while (pos + length < matchEnd && in[candidate + length] == in[pos + length])
+				++length;
+
+			out = WriteSequence(out, in + anchor, pos - anchor, pos - candidate, length);
+			pos += length;
+			anchor = pos;
+
+			// a neighbour of the next position, so runs keep matching.
+			if (pos - 2 <= lastStart)
+				table[Hash(Read32(in + pos - 2))] = (std::uint32_t)(pos - 2);
+		}
+	}
+
+	out = WriteSequence(out, in + anchor, size - anchor, 0, 0);
+	return (std::size_t)(out - static_cast<std::uint8_t*>(dest));
+}
+
+bool Lz4Decompress(const void* src, std::size_t srcSize, void* dest, std::size_t size)
+{
+	const std::uint8_t* in = static_cast<const std::uint8_t*>(src);
+	const std::uint8_t* inEnd = in + srcSize;
+	std::uint8_t* const outBegin = static_cast<std::uint8_t*>(dest);
+	std::uint8_t* out = outBegin;
+	std::uint8_t* const outEnd = outBegin + size;
+
+	for (;;)
+	{
+		if (in >= inEnd)
+			return false;
+		const std::uint8_t token = *in++;
+
+		std::size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(in, inEnd, literalLength))
+			return false;
+		if (literalLength > (std::size_t)(inEnd - in) || literalLength > (std::size_t)(outEnd - out))
+			return false;
+
+		if (literalLength != 0)
+			std::memcpy(out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// the last sequence ends the block.
+		if (in == inEnd)
+			return out == outEnd;
+
+		if (inEnd - in < 2)
+			return false;
+		const std::size_t offset = in[0] | ((std::size_t)in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > (std::size_t)(out - outBegin))
+			return false;
+
+		std::size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+			return false;
+		matchLength += MinMatch;
+		if (matchLength > (std::size_t)(outEnd - out))
+			return false;
+
+		// the copy may overlap what it writes (a run); then it goes byte by byte.
+		const std::uint8_t* match = out - offset;
+		if (offset >= matchLength)
+		{
+			std::memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else
+		{
+			for (std::size_t i = 0; i < matchLength; ++i)
+				*out++ = match[i];
+		}
+	}
+}
@@ -0,0 +1,30 @@
+//***************************************************************************************
+// Lz4Block.h
+//
+// Compression in the LZ4 block format (no frame): a stream of sequences, each a run of
+// literal bytes followed by a copy of at least 4 earlier bytes at most 64KB back.  The
+// compressor is the fast greedy kind (a hash table of 4-byte sequences, no search
+// chains); decompression is a few byte copies per sequence and runs at memory speed,
+// which is what matters for assets compressed once and loaded many times.  The output
+// is compatible with the reference LZ4_decompress_safe.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Largest compressed size of 'size' bytes (incompressible data grows a little).
+std::size_t Lz4CompressBound(std::size_t size);
+
+// Compresses src[0, size) into 'dest', which holds at least Lz4CompressBound(size)
+// bytes; returns the compressed size.
+std::size_t Lz4Compress(const void* src, std::size_t size, void* dest);
+
+// Decompresses src[0, srcSize) into exactly 'size' bytes at 'dest'.  False if the data
+// is damaged or does not decompress to 'size' bytes; it never reads or writes out of
+// bounds either way.
+bool Lz4Decompress(const void* src, std::size_t srcSize, void* dest, std::size_t size);
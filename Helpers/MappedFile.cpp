@@ -0,0 +1,194 @@
+//***************************************************************************************
+// MappedFile.cpp
+//***************************************************************************************
+
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <vector>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	HANDLE file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		mLastError = GetLastError();
+		return false;
+	}
+
+	mFile = file;
+	return MapOpenedFile();
+}
+
+bool MappedFile::Open(const char* fileName)
+{
+	// ANSI code page path, for symmetry with the POSIX build.
+	int length = MultiByteToWideChar(CP_ACP, 0, fileName, -1, nullptr, 0);
+	if (length <= 0)
+	{
+		mLastError = GetLastError();
+		return false;
+	}
+
+	std::vector<wchar_t> wideName(length);
+	MultiByteToWideChar(CP_ACP, 0, fileName, -1, wideName.data(), length);
+	return Open(wideName.data());
+}
+
+bool MappedFile::MapOpenedFile()
+{
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx((HANDLE)mFile, &fileSize))
+	{
+		mLastError = GetLastError();
+		Close();
+		return false;
+	}
+
+	mSize = (std::uint64_t)fileSize.QuadPart;
+	mOpen = true;
+
+	// a zero sized mapping is an error for CreateFileMapping; an empty file simply has no data.
+	if (mSize == 0)
+		return true;
+
+	mMapping = CreateFileMappingW((HANDLE)mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mMapping == nullptr)
+	{
+		mLastError = GetLastError();
+		Close();
+		return false;
+	}
+
+	mData = reinterpret_cast<const std::uint8_t*>(MapViewOfFile((HANDLE)mMapping, FILE_MAP_READ, 0, 0, 0));
+	if (mData == nullptr)
+	{
+		mLastError = GetLastError();
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData != nullptr)
+		UnmapViewOfFile(mData);
+	if (mMapping != nullptr)
+		CloseHandle((HANDLE)mMapping);
+	if (mFile != nullptr)
+		CloseHandle((HANDLE)mFile);
+
+	mData = nullptr;
+	mMapping = nullptr;
+	mFile = nullptr;
+	mSize = 0;
+	mOpen = false;
+}
+
+void MappedFile::Prefetch(std::uint64_t offset, std::uint64_t size)const
+{
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+	if (mData == nullptr || offset >= mSize)
+		return;
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<std::uint8_t*>(mData + offset);
+	range.NumberOfBytes = (SIZE_T)((offset + size > mSize) ? mSize - offset : size);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	(void)offset;
+	(void)size;
+#endif
+}
+
+#else
+
+bool MappedFile::Open(const char* fileName)
+{
+	Close();
+
+	mFd = open(fileName, O_RDONLY);
+	if (mFd < 0)
+	{
+		mLastError = (unsigned long)errno;
+		return false;
+	}
+
+	return MapOpenedFile();
+}
+
+bool MappedFile::MapOpenedFile()
+{
+	struct stat info;
+	if (fstat(mFd, &info) != 0)
+	{
+		mLastError = (unsigned long)errno;
+		Close();
+		return false;
+	}
+
+	mSize = (std::uint64_t)info.st_size;
+	mOpen = true;
+
+	if (mSize == 0)
+		return true;
+
+	void* data = mmap(nullptr, (size_t)mSize, PROT_READ, MAP_PRIVATE, mFd, 0);
+	if (data == MAP_FAILED)
+	{
+		mLastError = (unsigned long)errno;
+		Close();
+		return false;
+	}
+
+	mData = reinterpret_cast<const std::uint8_t*>(data);
+	madvise(data, (size_t)mSize, MADV_SEQUENTIAL);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData != nullptr)
+		munmap(const_cast<std::uint8_t*>(mData), (size_t)mSize);
+	if (mFd >= 0)
+		close(mFd);
+
+	mData = nullptr;
+	mFd = -1;
+	mSize = 0;
+	mOpen = false;
+}
+
+void MappedFile::Prefetch(std::uint64_t offset, std::uint64_t size)const
+{
+	if (mData == nullptr || offset >= mSize)
+		return;
+
+	// madvise wants a page aligned start.
+	const std::uint64_t pageSize = (std::uint64_t)sysconf(_SC_PAGESIZE);
+	std::uint64_t begin = offset & ~(pageSize - 1);
+	std::uint64_t end = (offset + size > mSize) ? mSize : offset + size;
+	madvise(const_cast<std::uint8_t*>(mData + begin), (size_t)(end - begin), MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,58 @@
+//***************************************************************************************
+// MappedFile.h
+//
+// Read-only memory mapping of a whole file: a file mapping view on Windows, mmap on
+// POSIX systems.  The contents are paged in on first touch straight from the file cache,
+// so a loader that parses the data in place and copies it once into upload memory saves
+// the allocation and the copy of reading the file into a buffer first.
+//
+// No Direct3D dependency (the Windows build only needs the Win32 API).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	~MappedFile();
+
+	// Maps the file; false on failure (LastError() tells why).  An empty file opens
+	// successfully with Data() == nullptr.
+#if defined(_WIN32)
+	bool Open(const wchar_t* fileName);
+#endif
+	bool Open(const char* fileName);
+	void Close();
+
+	// Hints that [offset, offset + size) will be read soon and sequentially.
+	void Prefetch(std::uint64_t offset, std::uint64_t size)const;
+
+	bool IsOpen()const { return mOpen; }
+	const std::uint8_t* Data()const { return mData; }
+	std::uint64_t Size()const { return mSize; }
+
+	// GetLastError() on Windows, errno elsewhere.
+	unsigned long LastError()const { return mLastError; }
+
+private:
+	bool MapOpenedFile();
+
+private:
+	const std::uint8_t* mData = nullptr;
+	std::uint64_t mSize = 0;
+	bool mOpen = false;
+	unsigned long mLastError = 0;
+
+#if defined(_WIN32)
+	void* mFile = nullptr;			// HANDLE
+	void* mMapping = nullptr;		// HANDLE
+#else
+	int mFd = -1;
+#endif
+};
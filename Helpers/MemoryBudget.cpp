@@ -0,0 +1,131 @@
+//***************************************************************************************
+// MemoryBudget.cpp
+//***************************************************************************************
+
+#include "MemoryBudget.h"
+
+void MemoryBudget::Initialize(ID3D12Device* device, IDXGIFactory4* factory)
+{
+	// without an IDXGIAdapter3 (pre Windows 10) the OS budget is simply not reported.
+	LUID luid = device->GetAdapterLuid();
+	if (FAILED(factory->EnumAdapterByLuid(luid, IID_PPV_ARGS(mAdapter.ReleaseAndGetAddressOf()))))
+		mAdapter = nullptr;
+
+	DXGI_ADAPTER_DESC desc;
+	if (mAdapter != nullptr && SUCCEEDED(mAdapter->GetDesc(&desc)))
+		mVideoBytes = desc.DedicatedVideoMemory;
+
+	MEMORYSTATUSEX status = {};
+	status.dwLength = sizeof(status);
+	if (GlobalMemoryStatusEx(&status))
+		mPhysicalBytes = status.ullTotalPhys;
+}
+
+UINT64 MemoryBudget::SuggestedBudget(Pool pool)const
+{
+	return (pool == Pool::Cpu) ? mPhysicalBytes / 4 : mVideoBytes / 2;
+}
+
+void MemoryBudget::Track(Pool pool, Category category, UINT64 bytes)
+{
+	mTracked[(int)pool][(int)category] += bytes;
+	mTrackedPeak[(int)pool] = std::max(mTrackedPeak[(int)pool], TrackedTotal(pool));
+}
+
+void MemoryBudget::Untrack(Pool pool, Category category, UINT64 bytes)
+{
+	UINT64& tracked = mTracked[(int)pool][(int)category];
+	assert(tracked >= bytes);
+	tracked -= std::min(tracked, bytes);
+}
+
+bool MemoryBudget::Fits(Pool pool, UINT64 bytes)const
+{
+	// tracking since the report counts at once, so several requests in one frame add up.
+	UINT64 tracked = TrackedTotal(pool);
+	UINT64 total = mReport.Total[(int)pool] - mTrackedAtReport[(int)pool] + tracked;
+	UINT64 growth = (tracked > mTrackedAtReport[(int)pool]) ? tracked - mTrackedAtReport[(int)pool] : 0;
+
+	UINT64 budget = mBudget[(int)pool];
+	if (budget != 0 && total + bytes > budget)
+		return false;
+
+	if (pool == Pool::Gpu && mReport.OsBudget != 0 && mReport.OsUsage + growth + bytes > mReport.OsBudget)
+		return false;
+
+	return true;
+}
+
+void MemoryBudget::EndFrame(const GpuMemoryAllocator* allocator)
+{
+	Report report;
+
+	for (int p = 0; p < (int)Pool::Count; ++p)
+	{
+		for (int c = 0; c < (int)Category::Count; ++c)
+			report.Bytes[p][c] = mTracked[p][c];
+	}
+
+	// placed resources: the heap memory reserved from the driver is what counts against the budget.
+	if (allocator != nullptr)
+	{
+		UINT64* gpu = report.Bytes[(int)Pool::Gpu];
+		gpu[(int)Category::Constants] += allocator->GetStats(GpuMemoryAllocator::Category::UploadBuffer).HeapBytes;
+		gpu[(int)Category::Geometry] += allocator->GetStats(GpuMemoryAllocator::Category::Buffer).HeapBytes;
+		gpu[(int)Category::Texture] += allocator->GetStats(GpuMemoryAllocator::Category::Texture).HeapBytes;
+		gpu[(int)Category::RenderTarget] += allocator->GetStats(GpuMemoryAllocator::Category::RenderTarget).HeapBytes;
+	}
+
+	for (int p = 0; p < (int)Pool::Count; ++p)
+	{
+		for (int c = 0; c < (int)Category::Count; ++c)
+			report.Total[p] += report.Bytes[p][c];
+
+		// memory tracked and untracked again within the frame counts for the peak too.
+		UINT64 tracked = TrackedTotal((Pool)p);
+		UINT64 framePeak = report.Total[p] - tracked + std::max(mTrackedPeak[p], tracked);
+		mTrackedAtReport[p] = tracked;
+		mTrackedPeak[p] = tracked;
+
+		report.Budget[p] = mBudget[p];
+		report.Peak[p] = std::max(mReport.Peak[p], framePeak);
+
+		if (report.Budget[p] != 0 && report.Total[p] > report.Budget[p])
+			report.OverBudget = true;
+	}
+
+	if (mAdapter != nullptr)
+	{
+		DXGI_QUERY_VIDEO_MEMORY_INFO info;
+		if (SUCCEEDED(mAdapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+		{
+			report.OsUsage = info.CurrentUsage;
+			report.OsBudget = info.Budget;
+			if (info.CurrentUsage > info.Budget)
+				report.OverBudget = true;
+		}
+	}
+
+	mReport = report;
+}
+
+UINT64 MemoryBudget::TrackedTotal(Pool pool)const
+{
+	UINT64 total = 0;
+	for (int c = 0; c < (int)Category::Count; ++c)
+		total += mTracked[(int)pool][c];
+	return total;
+}
+
+const char* MemoryBudget::CategoryName(Category category)
+{
+	switch (category)
+	{
+	case Category::Geometry:		return "geometry";
+	case Category::Texture:			return "texture";
+	case Category::Constants:		return "constants";
+	case Category::RenderTarget:	return "render target";
+	case Category::Other:			return "other";
+	default:						return "?";
+	}
+}
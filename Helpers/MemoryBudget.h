@@ -0,0 +1,95 @@
+//***************************************************************************************
+// MemoryBudget.h
+//
+// Per-category accounting of CPU and GPU memory against a budget.  Placed resources are
+// sampled from the GpuMemoryAllocator at the end of every frame; memory the allocator
+// does not own (committed upload rings, CPU-side copies, ...) is reported with Track().
+// The GPU side is also checked against the budget the OS grants the process for local
+// video memory (IDXGIAdapter3::QueryVideoMemoryInfo), which shrinks when other
+// applications need memory.  Use Fits() before creating large optional content.
+//
+// Without budgets of its own an application can take SuggestedBudget(): a share of the
+// machine's physical memory and of the adapter's dedicated video memory.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "GpuMemoryAllocator.h"
+
+class MemoryBudget
+{
+public:
+	enum class Pool : int
+	{
+		Cpu = 0,
+		Gpu,
+		Count
+	};
+
+	enum class Category : int
+	{
+		Geometry = 0,			// vertex/index buffers and their CPU copies
+		Texture,
+		Constants,				// constant buffers and per-frame upload rings
+		RenderTarget,
+		Other,
+		Count
+	};
+
+	struct Report
+	{
+		UINT64 Bytes[(int)Pool::Count][(int)Category::Count] = {};
+		UINT64 Total[(int)Pool::Count] = {};
+		UINT64 Peak[(int)Pool::Count] = {};
+		UINT64 Budget[(int)Pool::Count] = {};		// 0: no budget set
+
+		UINT64 OsUsage = 0;						// local video memory of the process, as seen by the OS
+		UINT64 OsBudget = 0;					// 0 if the adapter cannot tell
+
+		bool OverBudget = false;
+	};
+
+public:
+	MemoryBudget() = default;
+	MemoryBudget(const MemoryBudget& rhs) = delete;
+	MemoryBudget& operator=(const MemoryBudget& rhs) = delete;
+
+	// Finds the DXGI adapter of 'device' for the OS budget queries, and the memory sizes
+	// SuggestedBudget() is taken from.
+	void Initialize(ID3D12Device* device, IDXGIFactory4* factory);
+
+	void SetBudget(Pool pool, UINT64 bytes) { mBudget[(int)pool] = bytes; }
+
+	// A quarter of the physical memory for the CPU, half the adapter's dedicated video memory
+	// for the GPU (held to the OS budget besides); 0 (no budget) if the size is not known.
+	UINT64 SuggestedBudget(Pool pool)const;
+
+	// Memory not owned by the GpuMemoryAllocator.
+	void Track(Pool pool, Category category, UINT64 bytes);
+	void Untrack(Pool pool, Category category, UINT64 bytes);
+
+	// True if 'bytes' more in 'pool' stay within the budget (and the OS budget for the GPU),
+	// as of the last report plus what has been tracked and untracked since.
+	bool Fits(Pool pool, UINT64 bytes)const;
+
+	// Closes the frame: samples the allocator and the OS budget and publishes the report.
+	void EndFrame(const GpuMemoryAllocator* allocator);
+	const Report& LastReport()const { return mReport; }
+
+	static const char* CategoryName(Category category);
+
+private:
+	UINT64 TrackedTotal(Pool pool)const;
+
+private:
+	Microsoft::WRL::ComPtr<IDXGIAdapter3> mAdapter;
+	UINT64 mPhysicalBytes = 0;
+	UINT64 mVideoBytes = 0;
+
+	UINT64 mTracked[(int)Pool::Count][(int)Category::Count] = {};
+	UINT64 mTrackedAtReport[(int)Pool::Count] = {};
+	UINT64 mTrackedPeak[(int)Pool::Count] = {};		// since the last report: memory held only within a frame
+	UINT64 mBudget[(int)Pool::Count] = {};
+	Report mReport;
+};
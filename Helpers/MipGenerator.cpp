@@ -0,0 +1,385 @@
+//***************************************************************************************
+// MipGenerator.cpp
+//***************************************************************************************
+
+#include "MipGenerator.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+namespace
+{
+	const double KaiserRadius = 3.0;		// destination texels on either side
+	const double KaiserAlpha = 4.0;
+	const std::size_t RowTexels = 16 * 1024;	// texels per ParallelFor chunk, about
+
+	// ---------- one texel, four float channels ----------
+
+#ifdef MIP_GENERATOR_SSE2
+	typedef __m128 Float4;
+
+	inline Float4 Load4(const float* p) { return _mm_loadu_ps(p); }
+	inline void Store4(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+	inline Float4 Zero4() { return _mm_setzero_ps(); }
+	inline Float4 MulAdd(Float4 sum, Float4 v, float w) { return _mm_add_ps(sum, _mm_mul_ps(v, _mm_set1_ps(w))); }
+#else
+	struct Float4 { float V[4]; };
+
+	inline Float4 Load4(const float* p) { Float4 r; std::memcpy(r.V, p, sizeof(r.V)); return r; }
+	inline void Store4(float* p, Float4 v) { std::memcpy(p, v.V, sizeof(v.V)); }
+	inline Float4 Zero4() { return Float4{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+	inline Float4 MulAdd(Float4 sum, Float4 v, float w)
+	{
+		for (int c = 0; c < 4; ++c)
+			sum.V[c] += v.V[c] * w;
+		return sum;
+	}
+#endif
+
+	// ---------- channel conversions ----------
+
+	float HalfToFloat(std::uint16_t half)
+	{
+		std::uint32_t sign = (std::uint32_t)(half & 0x8000u) << 16;
+		std::uint32_t exponent = (half >> 10) & 0x1F;
+		std::uint32_t mantissa = half & 0x3FF;
+
+		if (exponent == 0)
+		{
+			// zero or denormal: mantissa * 2^-24.
+			float value = (float)mantissa * (1.0f / 16777216.0f);
+			return sign ? -value : value;
+		}
+
+		std::uint32_t bits = (exponent == 31)
+			? sign | 0x7F800000u | (mantissa << 13)
+			: sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// rounds to nearest even; out-of-range values become infinities.
+	std::uint16_t FloatToHalf(float value)
+	{
+		std::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		std::uint16_t sign = (std::uint16_t)((bits >> 16) & 0x8000u);
+		std::uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+		if (magnitude >= 0x7F800000u)
+			return sign | ((magnitude > 0x7F800000u) ? 0x7E00 : 0x7C00);
+		if (magnitude >= 0x477FF000u)			// 65520 and up round to infinity
+			return sign | 0x7C00;
+
+		if (magnitude < 0x38800000u)
+		{
+			// denormal: the scaled value rounds straight to the mantissa (1024 is the
+			// smallest normal, which has the same encoding).
+			float scaled;
+			std::memcpy(&scaled, &magnitude, sizeof(scaled));
+			return sign | (std::uint16_t)std::nearbyint(scaled * 16777216.0f);
+		}
+
+		// rebias the exponent and round the 13 dropped bits to nearest even.
+		magnitude += 0xC8000FFFu + ((magnitude >> 13) & 1);
+		return sign | (std::uint16_t)(magnitude >> 13);
+	}
+
+	struct SrgbTables
+	{
+		static const std::uint32_t LinearSteps = 65535;
+
+		float ToLinear[256];
+		std::uint8_t FromLinear[LinearSteps + 1];		// indexed by linear * LinearSteps
+
+		SrgbTables()
+		{
+			for (std::uint32_t i = 0; i < 256; ++i)
+			{
+				double s = i / 255.0;
+				ToLinear[i] = (float)((s <= 0.04045) ? s / 12.92 : std::pow((s + 0.055) / 1.055, 2.4));
+			}
+
+			for (std::uint32_t i = 0; i <= LinearSteps; ++i)
+			{
+				double l = (double)i / LinearSteps;
+				double s = (l <= 0.0031308) ? l * 12.92 : 1.055 * std::pow(l, 1.0 / 2.4) - 0.055;
+				FromLinear[i] = (std::uint8_t)std::lround(s * 255.0);
+			}
+		}
+	};
+
+	const SrgbTables& Srgb()
+	{
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	// ---------- rows ----------
+
+	// row y of 'image' as floats (linear light for sRGB), four per texel.
+	void LoadRow(MipFormat format, bool srgb, const MipImage& image, std::uint32_t y, float* row)
+	{
+		const std::uint8_t* texels = static_cast<const std::uint8_t*>(image.Data) + image.RowPitch * y;
+
+		if (format == MipFormat::RGBA16F)
+		{
+			for (std::uint32_t i = 0; i < 4 * image.Width; ++i)
+			{
+				std::uint16_t half;
+				std::memcpy(&half, texels + 2 * i, sizeof(half));
+				row[i] = HalfToFloat(half);
+			}
+			return;
+		}
+
+		if (srgb)
+		{
+			const float* toLinear = Srgb().ToLinear;
+			for (std::uint32_t x = 0; x < image.Width; ++x, texels += 4, row += 4)
+			{
+				row[0] = toLinear[texels[0]];
+				row[1] = toLinear[texels[1]];
+				row[2] = toLinear[texels[2]];
+				row[3] = texels[3] * (1.0f / 255.0f);
+			}
+			return;
+		}
+
+#ifdef MIP_GENERATOR_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+		for (std::uint32_t x = 0; x < image.Width; ++x, texels += 4, row += 4)
+		{
+			std::int32_t rgba;
+			std::memcpy(&rgba, texels, sizeof(rgba));
+			__m128i channels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(rgba), zero), zero);
+			_mm_storeu_ps(row, _mm_mul_ps(_mm_cvtepi32_ps(channels), scale));
+		}
+#else
+		for (std::uint32_t i = 0; i < 4 * image.Width; ++i)
+			row[i] = texels[i] * (1.0f / 255.0f);
+#endif
+	}
+
+	// writes the float row 'row' (linear light for sRGB) as row y of 'image'.
+	void StoreRow(MipFormat format, bool srgb, const float* row, const MipImage& image, std::uint32_t y)
+	{
+		std::uint8_t* texels = static_cast<std::uint8_t*>(image.Data) + image.RowPitch * y;
+
+		if (format == MipFormat::RGBA16F)
+		{
+			for (std::uint32_t i = 0; i < 4 * image.Width; ++i)
+			{
+				std::uint16_t half = FloatToHalf(row[i]);
+				std::memcpy(texels + 2 * i, &half, sizeof(half));
+			}
+			return;
+		}
+
+		// sRGB color goes through the table, so it is scaled to table indices instead of bytes.
+		const float colorScale = srgb ? (float)SrgbTables::LinearSteps : 255.0f;
+		const std::uint8_t* fromLinear = Srgb().FromLinear;
+
+#ifdef MIP_GENERATOR_SSE2
+		const __m128 scale = _mm_set_ps(255.0f, colorScale, colorScale, colorScale);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (std::uint32_t x = 0; x < image.Width; ++x, texels += 4, row += 4)
+		{
+			// the Kaiser filter overshoots; clamp before rounding.
+			__m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row), zero), one);
+			__m128i rounded = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+
+			if (srgb)
+			{
+				std::int32_t indices[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), rounded);
+				texels[0] = fromLinear[indices[0]];
+				texels[1] = fromLinear[indices[1]];
+				texels[2] = fromLinear[indices[2]];
+				texels[3] = (std::uint8_t)indices[3];
+			}
+			else
+			{
+				__m128i words = _mm_packs_epi32(rounded, rounded);
+				std::int32_t rgba = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+				std::memcpy(texels, &rgba, sizeof(rgba));
+			}
+		}
+#else
+		for (std::uint32_t x = 0; x < image.Width; ++x, texels += 4, row += 4)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				float v = std::min(std::max(row[c], 0.0f), 1.0f);
+				std::uint32_t rounded = (std::uint32_t)(v * ((c < 3) ? colorScale : 255.0f) + 0.5f);
+				texels[c] = (srgb && c < 3) ? fromLinear[rounded] : (std::uint8_t)rounded;
+			}
+		}
+#endif
+	}
+
+	// ---------- filter kernels ----------
+
+	struct Tap
+	{
+		std::uint32_t Index;		// source texel
+		float Weight;
+	};
+
+	// the taps of every destination texel along one axis.
+	struct Kernel
+	{
+		std::vector<std::uint32_t> Start;		// taps of texel i: [Start[i], Start[i + 1])
+		std::vector<Tap> Taps;
+	};
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (x * x) / (4.0 * k * k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	// 't' in destination texels.
+	double KaiserWeight(double t)
+	{
+		if (std::fabs(t) >= KaiserRadius)
+			return 0.0;
+
+		const double pi = 3.14159265358979323846;
+		double sinc = (t == 0.0) ? 1.0 : std::sin(pi * t) / (pi * t);
+		double r = t / KaiserRadius;
+		return sinc * BesselI0(KaiserAlpha * std::sqrt(1.0 - r * r)) / BesselI0(KaiserAlpha);
+	}
+
+	Kernel BuildKernel(MipFilter filter, std::uint32_t sourceSize, std::uint32_t destSize)
+	{
+		Kernel kernel;
+		double scale = (double)sourceSize / destSize;
+		double radius = ((filter == MipFilter::Box) ? 0.5 : KaiserRadius) * scale;
+
+		for (std::uint32_t d = 0; d < destSize; ++d)
+		{
+			kernel.Start.push_back((std::uint32_t)kernel.Taps.size());
+			std::size_t begin = kernel.Taps.size();
+
+			double center = (d + 0.5) * scale;
+			int first = (int)std::floor(center - radius);
+			int last = (int)std::ceil(center + radius);
+
+			double total = 0.0;
+			for (int s = first; s < last; ++s)
+			{
+				// Box: the part of source texel s the destination texel covers.
+				double weight = (filter == MipFilter::Box)
+					? std::min(s + 1.0, center + radius) - std::max((double)s, center - radius)
+					: KaiserWeight((s + 0.5 - center) / scale);
+				if (weight == 0.0)
+					continue;
+
+				// texels past the edges repeat the edge texel.
+				std::uint32_t index = (std::uint32_t)std::min(std::max(s, 0), (int)sourceSize - 1);
+				if (kernel.Taps.size() > begin && kernel.Taps.back().Index == index)
+					kernel.Taps.back().Weight += (float)weight;
+				else
+					kernel.Taps.push_back({ index, (float)weight });
+				total += weight;
+			}
+
+			for (std::size_t i = begin; i < kernel.Taps.size(); ++i)
+				kernel.Taps[i].Weight = (float)(kernel.Taps[i].Weight / total);
+		}
+
+		kernel.Start.push_back((std::uint32_t)kernel.Taps.size());
+		return kernel;
+	}
+
+	std::size_t RowGrain(std::uint32_t width)
+	{
+		return std::max<std::size_t>(RowTexels / std::max(width, 1u), 1);
+	}
+}
+
+std::uint32_t FullMipCount(std::uint32_t width, std::uint32_t height)
+{
+	std::uint32_t count = 1;
+	for (std::uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		++count;
+	return count;
+}
+
+void GenerateMips(MipFormat format, MipFilter filter, bool srgb, const MipImage* levels, std::uint32_t count)
+{
+	if (count < 2)
+		return;
+
+	srgb = srgb && (format == MipFormat::RGBA8);
+
+	// the level being filtered from, as floats.
+	const MipImage& top = levels[0];
+	std::vector<float> source(4 * (std::size_t)top.Width * top.Height);
+	ParallelFor(top.Height, RowGrain(top.Width), [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t y = begin; y < end; ++y)
+			LoadRow(format, srgb, top, (std::uint32_t)y, &source[4 * y * top.Width]);
+	});
+
+	std::vector<float> dest;
+	for (std::uint32_t level = 1; level < count; ++level)
+	{
+		const MipImage& above = levels[level - 1];
+		const MipImage& image = levels[level];
+
+		Kernel columns = BuildKernel(filter, above.Width, image.Width);
+		Kernel rows = BuildKernel(filter, above.Height, image.Height);
+		dest.resize(4 * (std::size_t)image.Width * image.Height);
+
+		ParallelFor(image.Height, RowGrain(image.Width), [&](std::size_t begin, std::size_t end)
+		{
+			std::vector<float> column(4 * (std::size_t)above.Width);
+			for (std::size_t y = begin; y < end; ++y)
+			{
+				// vertical pass: the weighted source rows, summed a row at a time.
+				std::fill(column.begin(), column.end(), 0.0f);
+				for (std::uint32_t t = rows.Start[y]; t < rows.Start[y + 1]; ++t)
+				{
+					const float* in = &source[4 * (std::size_t)rows.Taps[t].Index * above.Width];
+					float weight = rows.Taps[t].Weight;
+					for (std::size_t i = 0; i < column.size(); i += 4)
+						Store4(&column[i], MulAdd(Load4(&column[i]), Load4(in + i), weight));
+				}
+
+				// horizontal pass.
+				float* out = &dest[4 * y * image.Width];
+				for (std::uint32_t x = 0; x < image.Width; ++x)
+				{
+					Float4 sum = Zero4();
+					for (std::uint32_t t = columns.Start[x]; t < columns.Start[x + 1]; ++t)
+						sum = MulAdd(sum, Load4(&column[4 * (std::size_t)columns.Taps[t].Index]), columns.Taps[t].Weight);
+					Store4(out + 4 * x, sum);
+				}
+
+				StoreRow(format, srgb, out, image, (std::uint32_t)y);
+			}
+		});
+
+		source.swap(dest);
+	}
+}
@@ -0,0 +1,50 @@
+//***************************************************************************************
+// MipGenerator.h
+//
+// Builds the mip chain of an RGBA image on the CPU, for textures stored without one.
+// Each level is filtered from a float copy of the level above, so rounding does not add
+// up down the chain.  8-bit color can be marked sRGB-encoded: the filter then works in
+// linear light (alpha is always linear), which keeps the smaller mips from darkening.
+//
+// Two filters: Box averages the area every texel covers (odd sizes included), Kaiser is
+// a Kaiser-windowed sinc three texels wide that keeps distant mips sharper.  Both are
+// separable, texels are processed four channels per SSE2 register, and the rows of a level
+// are spread over threads (ParallelFor).
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+enum class MipFormat
+{
+	RGBA8,				// 4 x 8-bit UNORM (the channel order does not matter)
+	RGBA16F,			// 4 x half float
+};
+
+enum class MipFilter
+{
+	Box,
+	Kaiser,
+};
+
+// One level of the chain: level i of a width x height image is max(width >> i, 1) x
+// max(height >> i, 1) texels.
+struct MipImage
+{
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::size_t RowPitch = 0;			// bytes between rows
+	void* Data = nullptr;
+};
+
+// Number of levels of a full chain, down to 1x1.
+std::uint32_t FullMipCount(std::uint32_t width, std::uint32_t height);
+
+// Fills levels[1, count) from levels[0].  'srgb' marks the first three channels of RGBA8
+// images as sRGB-encoded; it is ignored for RGBA16F, which is linear already.
+void GenerateMips(MipFormat format, MipFilter filter, bool srgb, const MipImage* levels, std::uint32_t count);
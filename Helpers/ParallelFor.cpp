@@ -0,0 +1,152 @@
+//***************************************************************************************
+// ParallelFor.cpp
+//***************************************************************************************
+
+#include "ParallelFor.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// one loop being run; shared by the caller and the workers that pick it up.
+	struct Loop
+	{
+		const std::function<void(std::size_t, std::size_t)>* Body = nullptr;
+		std::size_t Count = 0;
+		std::size_t Grain = 1;
+		std::atomic<std::size_t> Next;
+		std::atomic<unsigned> Active;		// workers inside Run()
+
+		Loop() : Next(0), Active(0) {}
+
+		void Run()
+		{
+			for (;;)
+			{
+				std::size_t begin = Next.fetch_add(Grain);
+				if (begin >= Count)
+					return;
+				(*Body)(begin, std::min(begin + Grain, Count));
+			}
+		}
+	};
+
+	thread_local bool tInsideLoop = false;
+
+	class WorkerPool
+	{
+	public:
+		WorkerPool()
+		{
+			unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+			for (unsigned i = 0; i + 1 < hardware; ++i)
+				mThreads.emplace_back(&WorkerPool::WorkerMain, this);
+		}
+
+		~WorkerPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mQuit = true;
+			}
+			mWake.notify_all();
+			for (auto& thread : mThreads)
+				thread.join();
+		}
+
+		unsigned ThreadCount()const { return (unsigned)mThreads.size() + 1; }
+
+		void Run(const std::shared_ptr<Loop>& loop, unsigned helpers)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				for (unsigned i = 0; i < helpers; ++i)
+					mQueue.push_back(loop);
+			}
+			mWake.notify_all();
+
+			tInsideLoop = true;
+			loop->Run();
+			tInsideLoop = false;
+
+			// every index is taken; wait for the chunks still being processed, and take back
+			// the helper slots nobody picked up (they would find no work anyway).
+			std::unique_lock<std::mutex> lock(mMutex);
+			mQueue.erase(std::remove(mQueue.begin(), mQueue.end(), loop), mQueue.end());
+			mDone.wait(lock, [&loop]() { return loop->Active == 0; });
+		}
+
+	private:
+		void WorkerMain()
+		{
+			tInsideLoop = true;
+
+			std::unique_lock<std::mutex> lock(mMutex);
+			for (;;)
+			{
+				mWake.wait(lock, [this]() { return mQuit || !mQueue.empty(); });
+				if (mQuit)
+					return;
+
+				std::shared_ptr<Loop> loop = mQueue.front();
+				mQueue.pop_front();
+				++loop->Active;
+				lock.unlock();
+
+				loop->Run();
+
+				lock.lock();
+				if (--loop->Active == 0)
+					mDone.notify_all();
+			}
+		}
+
+	private:
+		std::vector<std::thread> mThreads;
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::condition_variable mDone;
+		std::deque<std::shared_ptr<Loop>> mQueue;
+		bool mQuit = false;
+	};
+
+	WorkerPool& Pool()
+	{
+		static WorkerPool pool;
+		return pool;
+	}
+}
+
+void ParallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	grain = std::max(grain, (std::size_t)1);
+	std::size_t chunks = (count + grain - 1) / grain;
+
+	if (chunks == 1 || tInsideLoop || Pool().ThreadCount() == 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	auto loop = std::make_shared<Loop>();
+	loop->Body = &body;
+	loop->Count = count;
+	loop->Grain = grain;
+
+	unsigned helpers = (unsigned)std::min<std::size_t>(chunks - 1, Pool().ThreadCount() - 1);
+	Pool().Run(loop, helpers);
+}
+
+unsigned ParallelForThreadCount()
+{
+	return Pool().ThreadCount();
+}
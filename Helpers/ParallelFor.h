@@ -0,0 +1,25 @@
+//***************************************************************************************
+// ParallelFor.h
+//
+// Runs a loop body over [0, count) on a small pool of worker threads shared by the whole
+// program (one per hardware thread, less the caller's).  The calling thread works on the
+// loop as well and returns once every index has been processed.  Indices are handed out
+// in chunks of 'grain' through an atomic counter, so uneven iterations balance out.
+//
+// Calls from inside a loop body run serially on that thread, which keeps nested loops
+// from waiting on workers that are all busy with the outer one.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// body(begin, end) processes the indices [begin, end).
+void ParallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body);
+
+// Number of threads a ParallelFor may run on, the caller included.
+unsigned ParallelForThreadCount();
@@ -0,0 +1,125 @@
+//***************************************************************************************
+// ResidencyManager.cpp
+//***************************************************************************************
+
+#include "ResidencyManager.h"
+
+ResidencyManager::ResidencyManager(ID3D12Device* device, GpuMemoryAllocator* allocator)
+	: mDevice(device), mAllocator(allocator)
+{
+	if (FAILED(device->QueryInterface(IID_PPV_ARGS(mDevice3.GetAddressOf()))))
+		mDevice3 = nullptr;
+
+	ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&mFence)));
+}
+
+ID3D12Pageable* ResidencyManager::Find(ID3D12Resource* resource)const
+{
+	auto it = mResources.find(resource);
+	return (it != mResources.end()) ? it->second : nullptr;
+}
+
+void ResidencyManager::Track(ID3D12Resource* resource, UINT64 useStamp)
+{
+	if (resource == nullptr || mResources.count(resource) != 0)
+		return;
+
+	UINT64 size = 0;
+	ID3D12Pageable* pageable = resource;
+	if (mAllocator != nullptr)
+	{
+		pageable = mAllocator->ResidencyObject(resource, size);
+	}
+	else
+	{
+		D3D12_RESOURCE_DESC desc = resource->GetDesc();
+		size = mDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+	}
+
+	mResources[resource] = pageable;
+
+	Object& object = mObjects[pageable];
+	if (object.RefCount++ == 0)
+	{
+		object.Handle = mPolicy.Register(size, useStamp);
+		if (object.Handle >= mPageables.size())
+			mPageables.resize(object.Handle + 1, nullptr);
+		mPageables[object.Handle] = pageable;
+	}
+}
+
+void ResidencyManager::Untrack(ID3D12Resource* resource)
+{
+	auto it = mResources.find(resource);
+	if (it == mResources.end())
+		return;
+
+	ID3D12Pageable* pageable = it->second;
+	mResources.erase(it);
+
+	auto obj = mObjects.find(pageable);
+	if (--obj->second.RefCount == 0)
+	{
+		// the remaining resources of an evicted heap may still be created into; bring it back first.
+		if (!mPolicy.IsResident(obj->second.Handle))
+			ThrowIfFailed(mDevice->MakeResident(1, &pageable));
+
+		mPageables[obj->second.Handle] = nullptr;
+		mPolicy.Unregister(obj->second.Handle);
+		mObjects.erase(obj);
+	}
+}
+
+void ResidencyManager::MarkUsed(ID3D12Resource* resource, UINT64 useStamp)
+{
+	ID3D12Pageable* pageable = Find(resource);
+	if (pageable != nullptr)
+		mPolicy.MarkUsed(mObjects[pageable].Handle, useStamp);
+}
+
+void ResidencyManager::MarkCopied(ID3D12Resource* resource, UINT64 copyStamp)
+{
+	ID3D12Pageable* pageable = Find(resource);
+	if (pageable != nullptr && mPolicy.MarkCopied(mObjects[pageable].Handle, copyStamp))
+		ThrowIfFailed(mDevice->MakeResident(1, &pageable));
+}
+
+void ResidencyManager::Prefetch(ID3D12Resource* resource)
+{
+	ID3D12Pageable* pageable = Find(resource);
+	if (pageable != nullptr)
+		mPolicy.Prefetch(mObjects[pageable].Handle);
+}
+
+void ResidencyManager::Update(ID3D12CommandQueue* queue, UINT64 budget, UINT64 completedStamp, UINT64 completedCopyStamp)
+{
+	mPolicy.Plan(budget, completedStamp, completedCopyStamp, mEvict, mRestore);
+
+	if (!mEvict.empty())
+	{
+		mBatch.clear();
+		for (ResidencyPolicy::Handle h : mEvict)
+			mBatch.push_back(mPageables[h]);
+
+		ThrowIfFailed(mDevice->Evict((UINT)mBatch.size(), mBatch.data()));
+	}
+
+	if (!mRestore.empty())
+	{
+		mBatch.clear();
+		for (ResidencyPolicy::Handle h : mRestore)
+			mBatch.push_back(mPageables[h]);
+
+		if (mDevice3 != nullptr)
+		{
+			// paged in asynchronously; only the GPU waits, right before this frame's work.
+			ThrowIfFailed(mDevice3->EnqueueMakeResident(D3D12_RESIDENCY_FLAG_NONE,
+				(UINT)mBatch.size(), mBatch.data(), mFence.Get(), ++mFenceValue));
+			ThrowIfFailed(queue->Wait(mFence.Get(), mFenceValue));
+		}
+		else
+		{
+			ThrowIfFailed(mDevice->MakeResident((UINT)mBatch.size(), mBatch.data()));
+		}
+	}
+}
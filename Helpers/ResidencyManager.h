@@ -0,0 +1,81 @@
+//***************************************************************************************
+// ResidencyManager.h
+//
+// Keeps the GPU memory of textures and buffers within a budget by evicting the least
+// recently used ones (ID3D12Device::Evict) and making them resident again before a frame
+// that uses them executes (ID3D12Device3::EnqueueMakeResident, so the CPU does not block;
+// the frame's queue waits on the GPU instead).  The decisions are made by ResidencyPolicy;
+// this class only maps resources to the objects residency works on.
+//
+// Residency is managed per heap for placed resources, so every resource that shares a
+// heap with a tracked resource has to be tracked as well: they are evicted together.
+// Use stamps are fence values of the queue that executes the frames.  Resources written
+// by the copy queue (streamed textures) are tracked from the moment they are created and
+// stamped with the copy queue's fence value for every batch that writes them, so their
+// heaps are neither evicted under a copy in flight nor left evicted when one is recorded.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "GpuMemoryAllocator.h"
+#include "ResidencyPolicy.h"
+
+class ResidencyManager
+{
+public:
+	ResidencyManager(ID3D12Device* device, GpuMemoryAllocator* allocator);
+	ResidencyManager(const ResidencyManager& rhs) = delete;
+	ResidencyManager& operator=(const ResidencyManager& rhs) = delete;
+
+	void Track(ID3D12Resource* resource, UINT64 useStamp);
+
+	// Before the resource is released.
+	void Untrack(ID3D12Resource* resource);
+
+	// 'resource' is used by the frame that will signal 'useStamp'.
+	void MarkUsed(ID3D12Resource* resource, UINT64 useStamp);
+
+	// 'resource' is written by copy queue work that signals 'copyStamp' on the copy queue;
+	// call before that work is submitted.  An evicted heap is made resident right away
+	// (blocking: the copy queue does not wait for EnqueueMakeResident).
+	void MarkCopied(ID3D12Resource* resource, UINT64 copyStamp);
+
+	// 'resource' will probably be used soon (a hint from culling).
+	void Prefetch(ID3D12Resource* resource);
+
+	// Once per frame, before the frame's command lists are executed on 'queue': evicts
+	// down to 'budget' bytes (tracked objects only) and restores what the frame uses.
+	// 'completedStamp' is the last completed fence value of 'queue', 'completedCopyStamp'
+	// that of the copy queue.
+	void Update(ID3D12CommandQueue* queue, UINT64 budget, UINT64 completedStamp, UINT64 completedCopyStamp);
+
+	ResidencyPolicy::Stats GetStats()const { return mPolicy.GetStats(); }
+
+private:
+	struct Object
+	{
+		ResidencyPolicy::Handle Handle = ResidencyPolicy::InvalidHandle;
+		UINT RefCount = 0;				// tracked resources living in the object
+	};
+
+	ID3D12Pageable* Find(ID3D12Resource* resource)const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+	Microsoft::WRL::ComPtr<ID3D12Device3> mDevice3;		// null before Windows 10 1709: MakeResident blocks then
+	GpuMemoryAllocator* mAllocator = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12Fence> mFence;			// signaled by EnqueueMakeResident
+	UINT64 mFenceValue = 0;
+
+	ResidencyPolicy mPolicy;
+	std::unordered_map<ID3D12Resource*, ID3D12Pageable*> mResources;
+	std::unordered_map<ID3D12Pageable*, Object> mObjects;
+	std::vector<ID3D12Pageable*> mPageables;			// indexed by policy handle
+
+	// per-update scratch, kept to avoid allocations
+	std::vector<ResidencyPolicy::Handle> mEvict;
+	std::vector<ResidencyPolicy::Handle> mRestore;
+	std::vector<ID3D12Pageable*> mBatch;
+};
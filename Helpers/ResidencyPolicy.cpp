@@ -0,0 +1,234 @@
+//***************************************************************************************
+// ResidencyPolicy.cpp
+//***************************************************************************************
+
+#include "ResidencyPolicy.h"
+#include <algorithm>
+#include <cassert>
+
+ResidencyPolicy::Handle ResidencyPolicy::Register(std::uint64_t size, std::uint64_t useStamp)
+{
+	Handle handle;
+	if (!mFreeHandles.empty())
+	{
+		handle = mFreeHandles.back();
+		mFreeHandles.pop_back();
+	}
+	else
+	{
+		handle = (Handle)mEntries.size();
+		mEntries.emplace_back();
+	}
+
+	Entry& e = mEntries[handle];
+	e = Entry();
+	e.Size = size;
+	e.LastUse = useStamp;
+	e.Registered = true;
+	e.Resident = true;
+	Link(handle);
+
+	mTotalBytes += size;
+	mResidentBytes += size;
+	return handle;
+}
+
+void ResidencyPolicy::Unregister(Handle handle)
+{
+	Entry& e = mEntries[handle];
+	assert(e.Registered);
+
+	Unlink(handle);
+	mTotalBytes -= e.Size;
+	if (e.Resident)
+		mResidentBytes -= e.Size;
+
+	if (e.Requested || e.Prefetched)
+		mPending.erase(std::remove(mPending.begin(), mPending.end(), handle), mPending.end());
+
+	e = Entry();
+	mFreeHandles.push_back(handle);
+}
+
+void ResidencyPolicy::MarkUsed(Handle handle, std::uint64_t useStamp)
+{
+	Entry& e = mEntries[handle];
+	assert(e.Registered);
+
+	if (useStamp > e.LastUse)
+		e.LastUse = useStamp;
+
+	if (mHead != handle)
+	{
+		Unlink(handle);
+		Link(handle);
+	}
+
+	if (!e.Resident && !e.Requested)
+	{
+		if (!e.Prefetched)
+			mPending.push_back(handle);
+		e.Requested = true;
+	}
+}
+
+void ResidencyPolicy::Prefetch(Handle handle)
+{
+	Entry& e = mEntries[handle];
+	assert(e.Registered);
+
+	if (!e.Resident && !e.Requested && !e.Prefetched)
+	{
+		mPending.push_back(handle);
+		e.Prefetched = true;
+	}
+}
+
+bool ResidencyPolicy::MarkCopied(Handle handle, std::uint64_t copyStamp)
+{
+	Entry& e = mEntries[handle];
+	assert(e.Registered);
+
+	if (copyStamp > e.LastCopy)
+		e.LastCopy = copyStamp;
+
+	if (mHead != handle)
+	{
+		Unlink(handle);
+		Link(handle);
+	}
+
+	if (e.Resident)
+		return false;
+
+	// a pending request, if any, is dropped by Plan() (it skips resident objects).
+	e.Resident = true;
+	mResidentBytes += e.Size;
+	++mRestores;
+	return true;
+}
+
+void ResidencyPolicy::Plan(std::uint64_t budget, std::uint64_t completedStamp, std::uint64_t completedCopyStamp,
+	std::vector<Handle>& evict, std::vector<Handle>& restore)
+{
+	evict.clear();
+	restore.clear();
+
+	// what has to come back no matter what.
+	std::uint64_t requiredBytes = 0;
+	for (Handle h : mPending)
+	{
+		const Entry& e = mEntries[h];
+		if (e.Registered && !e.Resident && e.Requested)
+			requiredBytes += e.Size;
+	}
+
+	// evict from the least recently used end until the required objects fit, skipping
+	// objects a frame or a copy in flight may still use.
+	Handle h = mTail;
+	while (h != InvalidHandle && mResidentBytes + requiredBytes > budget)
+	{
+		Entry& e = mEntries[h];
+		Handle prev = e.Prev;
+
+		if (e.Resident && e.LastUse <= completedStamp && e.LastCopy <= completedCopyStamp)
+		{
+			e.Resident = false;
+			mResidentBytes -= e.Size;
+			++mEvictions;
+			evict.push_back(h);
+		}
+
+		h = prev;
+	}
+
+	// used objects first, then the hints that still fit.
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (Handle p : mPending)
+		{
+			Entry& e = mEntries[p];
+			if (!e.Registered || e.Resident)
+				continue;
+
+			bool required = e.Requested;
+			if ((pass == 0) != required)
+				continue;
+
+			if (!required && mResidentBytes + e.Size > budget)
+				continue;
+
+			e.Resident = true;
+			mResidentBytes += e.Size;
+			++mRestores;
+			restore.push_back(p);
+
+			// a restored hint should not be the next victim.
+			if (!required && mHead != p)
+			{
+				Unlink(p);
+				Link(p);
+			}
+		}
+	}
+
+	// hints are one-shot; culling hints again next frame.
+	for (Handle p : mPending)
+	{
+		mEntries[p].Requested = false;
+		mEntries[p].Prefetched = false;
+	}
+	mPending.clear();
+}
+
+ResidencyPolicy::Stats ResidencyPolicy::GetStats()const
+{
+	Stats stats;
+	for (const Entry& e : mEntries)
+	{
+		if (!e.Registered)
+			continue;
+
+		stats.ObjectCount++;
+		if (e.Resident)
+			stats.ResidentCount++;
+	}
+
+	stats.TotalBytes = mTotalBytes;
+	stats.ResidentBytes = mResidentBytes;
+	stats.Evictions = mEvictions;
+	stats.Restores = mRestores;
+	return stats;
+}
+
+void ResidencyPolicy::Link(Handle handle)
+{
+	Entry& e = mEntries[handle];
+	e.Prev = InvalidHandle;
+	e.Next = mHead;
+
+	if (mHead != InvalidHandle)
+		mEntries[mHead].Prev = handle;
+	mHead = handle;
+
+	if (mTail == InvalidHandle)
+		mTail = handle;
+}
+
+void ResidencyPolicy::Unlink(Handle handle)
+{
+	Entry& e = mEntries[handle];
+
+	if (e.Prev != InvalidHandle)
+		mEntries[e.Prev].Next = e.Next;
+	else
+		mHead = e.Next;
+
+	if (e.Next != InvalidHandle)
+		mEntries[e.Next].Prev = e.Prev;
+	else
+		mTail = e.Prev;
+
+	e.Prev = InvalidHandle;
+	e.Next = InvalidHandle;
+}
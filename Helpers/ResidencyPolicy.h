@@ -0,0 +1,101 @@
+//***************************************************************************************
+// ResidencyPolicy.h
+//
+// Eviction policy of the residency manager (ResidencyManager.h).  Objects are kept in
+// least-recently-used order of their last use, stamped with the fence value of the frame
+// that used them.  Plan() picks the least recently used resident objects to evict until
+// the resident bytes fit the budget, and the evicted objects that are used or were
+// hinted (Prefetch) to bring back.  An object is never evicted while a frame that uses
+// it may still be executing, i.e. while its last use stamp is above the completed value.
+// Copy queue work writing into an object is stamped on the copy queue's own timeline
+// (MarkCopied) and holds the object resident the same way.
+//
+// This is a plain CPU data structure without any Direct3D dependency, so it can be
+// exercised and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class ResidencyPolicy
+{
+public:
+	typedef std::uint32_t Handle;
+	static const Handle InvalidHandle = ~0u;
+
+	struct Stats
+	{
+		std::uint32_t ObjectCount = 0;
+		std::uint32_t ResidentCount = 0;
+		std::uint64_t TotalBytes = 0;
+		std::uint64_t ResidentBytes = 0;
+		std::uint64_t Evictions = 0;			// since construction
+		std::uint64_t Restores = 0;				// objects made resident again, since construction
+	};
+
+public:
+	ResidencyPolicy() = default;
+
+	// New objects are resident and most recently used.
+	Handle Register(std::uint64_t size, std::uint64_t useStamp);
+	void Unregister(Handle handle);
+
+	// The object is used by the frame stamped 'useStamp'; it must be resident before that
+	// frame executes, so an evicted object is queued for Plan() to restore.
+	void MarkUsed(Handle handle, std::uint64_t useStamp);
+
+	// The object will probably be used soon (e.g. it came into view); an evicted object is
+	// restored by Plan() if the budget allows it, without counting as a use.
+	void Prefetch(Handle handle);
+
+	// The object is written by copy queue work that signals 'copyStamp' (a value of the
+	// copy queue's timeline).  It has to be resident before that work is submitted: true
+	// if it was evicted, in which case the caller makes it resident at once (the policy
+	// counts it as resident on return).
+	bool MarkCopied(Handle handle, std::uint64_t copyStamp);
+
+	// Decides what to evict and what to restore.  Used objects are always restored, even
+	// over budget; prefetched ones only if they fit.  'completedCopyStamp' is the last
+	// completed value of the copy queue.  The policy state already reflects the decisions
+	// when Plan() returns.
+	void Plan(std::uint64_t budget, std::uint64_t completedStamp, std::uint64_t completedCopyStamp,
+		std::vector<Handle>& evict, std::vector<Handle>& restore);
+
+	bool IsResident(Handle handle)const { return mEntries[handle].Resident; }
+	std::uint64_t Size(Handle handle)const { return mEntries[handle].Size; }
+	std::uint64_t LastUse(Handle handle)const { return mEntries[handle].LastUse; }
+
+	Stats GetStats()const;
+
+private:
+	struct Entry
+	{
+		std::uint64_t Size = 0;
+		std::uint64_t LastUse = 0;
+		std::uint64_t LastCopy = 0;			// copy queue timeline
+		Handle Prev = InvalidHandle;		// towards the most recently used end
+		Handle Next = InvalidHandle;		// towards the least recently used end
+		bool Registered = false;
+		bool Resident = false;
+		bool Requested = false;				// evicted, and used since
+		bool Prefetched = false;			// evicted, and hinted since
+	};
+
+	void Link(Handle handle);				// insert at the most recently used end
+	void Unlink(Handle handle);
+
+private:
+	std::vector<Entry> mEntries;
+	std::vector<Handle> mFreeHandles;
+	std::vector<Handle> mPending;			// evicted objects with Requested or Prefetched set
+
+	Handle mHead = InvalidHandle;			// most recently used
+	Handle mTail = InvalidHandle;			// least recently used
+
+	std::uint64_t mTotalBytes = 0;
+	std::uint64_t mResidentBytes = 0;
+	std::uint64_t mEvictions = 0;
+	std::uint64_t mRestores = 0;
+};
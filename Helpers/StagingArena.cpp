@@ -0,0 +1,191 @@
+//***************************************************************************************
+// StagingArena.cpp
+//***************************************************************************************
+
+#include "StagingArena.h"
+#include "SubresourceCopy.h"
+#include "WriteCombined.h"
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+StagingArena::StagingArena(ID3D12Device* device, GpuMemoryAllocator* allocator, UINT64 blockSize)
+	: mDevice(device), mAllocator(allocator), mBlockSize(blockSize)
+{
+	AddBlock(mBlockSize);
+}
+
+StagingArena::~StagingArena()
+{
+	for (auto& block : mBlocks)
+	{
+		WriteCombined::Unprotect(block.MappedData, (size_t)block.Size, block.Protection);
+		block.Buffer->Unmap(0, nullptr);
+		block.MappedData = nullptr;
+	}
+}
+
+void StagingArena::AddBlock(UINT64 size)
+{
+	Block block;
+	block.Size = size;
+
+	CD3DX12_HEAP_PROPERTIES uploadHeap(D3D12_HEAP_TYPE_UPLOAD);
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&uploadHeap,
+		D3D12_HEAP_FLAG_NONE,
+		&bufferDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&block.Buffer)));
+
+	ThrowIfFailed(block.Buffer->Map(0, nullptr, reinterpret_cast<void**>(&block.MappedData)));
+	block.Protection = WriteCombined::Protect(block.MappedData, (size_t)size);
+
+	mBlocks.push_back(block);
+}
+
+StagingArena::Allocation StagingArena::Allocate(UINT64 size, UINT64 alignment)
+{
+	Block* block = &mBlocks.back();
+
+	UINT64 offset = (block->Offset + alignment - 1) & ~(alignment - 1);
+	if (offset + size > block->Size)
+	{
+		// the current block is full; its tail is wasted, which is fine for a one-shot arena.
+		AddBlock(std::max(mBlockSize, size));
+		block = &mBlocks.back();
+		offset = 0;
+	}
+
+	mBytesAllocated += offset + size - block->Offset;
+	block->Offset = offset + size;
+
+	Allocation alloc;
+	alloc.Resource = block->Buffer.Get();
+	alloc.Offset = offset;
+	alloc.CPU = block->MappedData + offset;
+	alloc.BlockIndex = mBlocks.size() - 1;
+	return alloc;
+}
+
+ComPtr<ID3D12Resource> StagingArena::CreateDefaultBuffer(
+	ID3D12GraphicsCommandList* cmdList,
+	const void* initData,
+	UINT64 byteSize)
+{
+	ComPtr<ID3D12Resource> defaultBuffer;
+
+	CD3DX12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	if (mAllocator != nullptr)
+	{
+		ThrowIfFailed(mAllocator->CreateResource(GpuMemoryAllocator::Category::Buffer,
+			bufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, defaultBuffer));
+	}
+	else
+	{
+		CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
+		ThrowIfFailed(mDevice->CreateCommittedResource(
+			&defaultHeap,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
+	}
+
+	// buffer copies only need 4 byte aligned offsets; 16 keeps the streaming stores aligned.
+	Allocation staging = Allocate(byteSize, 16);
+	{
+		WriteScope scope(*this, staging);
+		WriteCombined::StreamCopy(staging.CPU, initData, (size_t)byteSize);
+	}
+
+	CD3DX12_RESOURCE_BARRIER toCopyDest = CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+	cmdList->ResourceBarrier(1, &toCopyDest);
+
+	cmdList->CopyBufferRegion(defaultBuffer.Get(), 0, staging.Resource, staging.Offset, byteSize);
+
+	CD3DX12_RESOURCE_BARRIER toReady = CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, ReadyState(cmdList, D3D12_RESOURCE_STATE_GENERIC_READ));
+	cmdList->ResourceBarrier(1, &toReady);
+
+	return defaultBuffer;
+}
+
+D3D12_RESOURCE_STATES StagingArena::ReadyState(ID3D12GraphicsCommandList* cmdList, D3D12_RESOURCE_STATES readState)
+{
+	return (cmdList->GetType() == D3D12_COMMAND_LIST_TYPE_COPY) ? D3D12_RESOURCE_STATE_COMMON : readState;
+}
+
+HRESULT StagingArena::CreateTexture(
+	const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState,
+	ComPtr<ID3D12Resource>& texture)
+{
+	if (mAllocator != nullptr)
+		return mAllocator->CreateResource(GpuMemoryAllocator::Category::Texture, desc, initialState, nullptr, texture);
+
+	CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
+	return mDevice->CreateCommittedResource(
+		&defaultHeap,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		initialState,
+		nullptr,
+		IID_PPV_ARGS(texture.ReleaseAndGetAddressOf()));
+}
+
+void StagingArena::UploadSubresources(
+	ID3D12GraphicsCommandList* cmdList,
+	ID3D12Resource* dest,
+	UINT firstSubresource,
+	UINT numSubresources,
+	const D3D12_SUBRESOURCE_DATA* srcData)
+{
+	D3D12_RESOURCE_DESC desc = dest->GetDesc();
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(numSubresources);
+	std::vector<UINT> numRows(numSubresources);
+	std::vector<UINT64> rowSizes(numSubresources);
+	UINT64 requiredSize = 0;
+	mDevice->GetCopyableFootprints(&desc, firstSubresource, numSubresources, 0,
+		layouts.data(), numRows.data(), rowSizes.data(), &requiredSize);
+
+	Allocation staging = Allocate(requiredSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+	// lays the rows out with the copyable footprints of 'dest', spread over threads.
+	std::vector<SubresourceFootprint> footprints(numSubresources);
+	std::vector<SubresourceSource> sources(numSubresources);
+	for (UINT i = 0; i < numSubresources; ++i)
+	{
+		footprints[i].Offset = layouts[i].Offset;
+		footprints[i].Width = layouts[i].Footprint.Width;
+		footprints[i].Height = layouts[i].Footprint.Height;
+		footprints[i].Depth = layouts[i].Footprint.Depth;
+		footprints[i].RowPitch = layouts[i].Footprint.RowPitch;
+		footprints[i].NumRows = numRows[i];
+		footprints[i].RowSize = rowSizes[i];
+
+		sources[i].Data = srcData[i].pData;
+		sources[i].RowPitch = srcData[i].RowPitch;
+		sources[i].SlicePitch = srcData[i].SlicePitch;
+	}
+	{
+		WriteScope scope(*this, staging);
+		CopySubresources(staging.CPU, footprints.data(), sources.data(), numSubresources);
+	}
+
+	// one copy per subresource.
+	for (UINT i = 0; i < numSubresources; ++i)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = layouts[i];
+		layout.Offset += staging.Offset;
+
+		CD3DX12_TEXTURE_COPY_LOCATION dst(dest, firstSubresource + i);
+		CD3DX12_TEXTURE_COPY_LOCATION src(staging.Resource, layout);
+		cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+}
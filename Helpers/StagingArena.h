@@ -0,0 +1,98 @@
+//***************************************************************************************
+// StagingArena.h
+//
+// Upload staging memory for one batch of uploads.  Instead of one committed upload heap
+// per vertex buffer, index buffer and texture, all uploads of a batch are suballocated
+// from a few large persistently mapped upload buffers and recorded into the same command
+// list.  The whole arena is released at once when the fence of that submission has
+// completed.  The command list may be a direct or a copy command list.
+//
+// Write through Allocation::CPU only while a WriteScope is open (WriteCombined validation).
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "GpuMemoryAllocator.h"
+#include "WriteCombined.h"
+#include <deque>
+
+class StagingArena
+{
+public:
+	struct Allocation
+	{
+		ID3D12Resource* Resource = nullptr;			// upload buffer the allocation lives in
+		UINT64 Offset = 0;							// byte offset into Resource
+		BYTE* CPU = nullptr;
+		size_t BlockIndex = 0;						// of the block it lives in, for WriteScope
+	};
+
+	// Opens the block 'alloc' lives in for CPU writes for the lifetime of the scope.
+	class WriteScope : public WriteCombined::WriteScope
+	{
+	public:
+		WriteScope(StagingArena& arena, const Allocation& alloc)
+			: WriteCombined::WriteScope(arena.mBlocks[alloc.BlockIndex].MappedData,
+				(size_t)arena.mBlocks[alloc.BlockIndex].Size, arena.mBlocks[alloc.BlockIndex].Protection) {}
+	};
+
+public:
+	// Default resources created through the arena are placed with 'allocator' when it is
+	// not null, otherwise they are committed resources.
+	StagingArena(ID3D12Device* device, GpuMemoryAllocator* allocator, UINT64 blockSize = 4 * 1024 * 1024);
+	StagingArena(const StagingArena& rhs) = delete;
+	StagingArena& operator=(const StagingArena& rhs) = delete;
+	~StagingArena();
+
+	// Requests larger than the block size get a block of their own.
+	Allocation Allocate(UINT64 size, UINT64 alignment);
+
+	// Same as d3dUtil::CreateDefaultBuffer, but staged through the arena.  The buffer
+	// ends up in ReadyState(cmdList, D3D12_RESOURCE_STATE_GENERIC_READ) once cmdList has executed.
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+		ID3D12GraphicsCommandList* cmdList,
+		const void* initData,
+		UINT64 byteSize);
+
+	// Creates a sampled texture in a default heap; fill it with UploadSubresources.
+	HRESULT CreateTexture(
+		const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& texture);
+
+	// Records copies of srcData into subresources of 'dest', which must be in
+	// D3D12_RESOURCE_STATE_COPY_DEST.
+	void UploadSubresources(
+		ID3D12GraphicsCommandList* cmdList,
+		ID3D12Resource* dest,
+		UINT firstSubresource,
+		UINT numSubresources,
+		const D3D12_SUBRESOURCE_DATA* srcData);
+
+	// The state to leave a freshly uploaded resource in.  Copy command lists only know the
+	// copy states, so there it is COMMON and the first use on the direct queue promotes it.
+	static D3D12_RESOURCE_STATES ReadyState(ID3D12GraphicsCommandList* cmdList, D3D12_RESOURCE_STATES readState);
+
+	UINT BlockCount()const { return (UINT)mBlocks.size(); }
+	UINT64 BytesAllocated()const { return mBytesAllocated; }		// alignment padding included
+
+private:
+	struct Block
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Buffer;
+		BYTE* MappedData = nullptr;
+		DWORD Protection = 0;	// of the mapping while it is protected (WriteCombined::Protect)
+		UINT64 Size = 0;
+		UINT64 Offset = 0;		// bump pointer
+	};
+
+	void AddBlock(UINT64 size);
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	GpuMemoryAllocator* mAllocator = nullptr;
+	UINT64 mBlockSize = 0;
+	UINT64 mBytesAllocated = 0;
+	std::deque<Block> mBlocks;		// a deque: an open WriteScope keeps its block's address
+};
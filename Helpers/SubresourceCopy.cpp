@@ -0,0 +1,100 @@
+//***************************************************************************************
+// SubresourceCopy.cpp
+//***************************************************************************************
+
+#include "SubresourceCopy.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// a run of rows of one subresource: the unit of work handed to a thread.
+	struct RowRun
+	{
+		std::size_t Subresource;
+		std::uint32_t FirstRow;			// counted across the depth slices
+		std::uint32_t RowCount;
+	};
+
+	const std::uint64_t RunBytes = 64 * 1024;		// rows per run: about this much data
+}
+
+void CopySubresources(std::uint8_t* dest, const SubresourceFootprint* footprints,
+	const SubresourceSource* sources, std::size_t count)
+{
+	std::vector<RowRun> runs;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const SubresourceFootprint& fp = footprints[i];
+		std::uint32_t rows = fp.NumRows * fp.Depth;
+		std::uint32_t rowsPerRun = (std::uint32_t)std::max<std::uint64_t>(RunBytes / std::max<std::uint64_t>(fp.RowSize, 1), 1);
+
+		for (std::uint32_t row = 0; row < rows; row += rowsPerRun)
+			runs.push_back({ i, row, std::min(rowsPerRun, rows - row) });
+	}
+
+	ParallelFor(runs.size(), 1, [&](std::size_t begin, std::size_t end)
+	{
+		for (std::size_t r = begin; r < end; ++r)
+		{
+			const RowRun& run = runs[r];
+			const SubresourceFootprint& fp = footprints[run.Subresource];
+			const SubresourceSource& src = sources[run.Subresource];
+
+			for (std::uint32_t row = run.FirstRow; row < run.FirstRow + run.RowCount; ++row)
+			{
+				std::uint32_t z = row / fp.NumRows;
+				std::uint32_t y = row % fp.NumRows;
+
+				// the rows of all depth slices are packed back to back in the footprint.
+				std::uint8_t* d = dest + fp.Offset + (std::uint64_t)fp.RowPitch * row;
+				const std::uint8_t* s = static_cast<const std::uint8_t*>(src.Data)
+					+ src.SlicePitch * z + src.RowPitch * y;
+				std::memcpy(d, s, (std::size_t)fp.RowSize);
+			}
+		}
+	});
+}
+
+std::uint64_t ComputeFootprints(std::uint32_t width, std::uint32_t height, std::uint32_t depth,
+	std::uint32_t mipLevels, std::uint32_t blockSize, std::uint32_t bytesPerBlock,
+	std::uint32_t firstSubresource, std::uint32_t count, std::uint64_t baseOffset,
+	SubresourceFootprint* footprints)
+{
+	std::uint64_t offset = baseOffset;
+	std::uint64_t end = baseOffset;
+
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		std::uint32_t mip = (firstSubresource + i) % mipLevels;
+
+		SubresourceFootprint& fp = footprints[i];
+		fp.Width = std::max(width >> mip, 1u);
+		fp.Height = std::max(height >> mip, 1u);
+		fp.Depth = std::max(depth >> mip, 1u);
+
+		// compressed footprints cover whole blocks.
+		std::uint32_t blocksWide = (fp.Width + blockSize - 1) / blockSize;
+		fp.NumRows = (fp.Height + blockSize - 1) / blockSize;
+		if (blockSize > 1)
+		{
+			fp.Width = blocksWide * blockSize;
+			fp.Height = fp.NumRows * blockSize;
+		}
+
+		fp.RowSize = (std::uint64_t)blocksWide * bytesPerBlock;
+		fp.RowPitch = (std::uint32_t)((fp.RowSize + SubresourcePitchAlignment - 1) / SubresourcePitchAlignment * SubresourcePitchAlignment);
+
+		offset = (offset + SubresourcePlacementAlignment - 1) / SubresourcePlacementAlignment * SubresourcePlacementAlignment;
+		fp.Offset = offset;
+
+		// the last row of the last slice only needs its data, not a full pitch.
+		std::uint64_t rows = (std::uint64_t)fp.NumRows * fp.Depth;
+		end = offset + (rows - 1) * fp.RowPitch + fp.RowSize;
+		offset += rows * fp.RowPitch;
+	}
+
+	return end - baseOffset;
+}
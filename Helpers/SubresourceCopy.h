@@ -0,0 +1,57 @@
+//***************************************************************************************
+// SubresourceCopy.h
+//
+// Copies texture subresources into staging memory laid out for CopyTextureRegion, with
+// the rows spread over threads (ParallelFor).  The destination layout is what
+// ID3D12Device::GetCopyableFootprints returns: every subresource starts at a 512 byte
+// aligned offset and its rows are RowPitch (a multiple of 256) apart, while only RowSize
+// bytes of each row are data.
+//
+// ComputeFootprints is a CPU stand-in for GetCopyableFootprints (non-planar 2D/3D
+// textures), for code that has no device at hand, such as offline tools and tests.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Destination layout of one subresource (D3D12_PLACED_SUBRESOURCE_FOOTPRINT together with
+// the row count and row size GetCopyableFootprints returns beside it).
+struct SubresourceFootprint
+{
+	std::uint64_t Offset = 0;			// from the start of the staging memory
+	std::uint32_t Width = 0;			// texels
+	std::uint32_t Height = 0;
+	std::uint32_t Depth = 0;
+	std::uint32_t RowPitch = 0;			// bytes between rows
+	std::uint32_t NumRows = 0;			// rows per depth slice (rows of blocks for compressed formats)
+	std::uint64_t RowSize = 0;			// bytes of data in a row
+};
+
+// Source of one subresource; the same fields as D3D12_SUBRESOURCE_DATA.
+struct SubresourceSource
+{
+	const void* Data = nullptr;
+	std::int64_t RowPitch = 0;
+	std::int64_t SlicePitch = 0;
+};
+
+static const std::uint32_t SubresourcePitchAlignment = 256;			// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+static const std::uint32_t SubresourcePlacementAlignment = 512;		// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+// Copies 'count' subresources to 'dest' + footprints[i].Offset.
+void CopySubresources(std::uint8_t* dest, const SubresourceFootprint* footprints,
+	const SubresourceSource* sources, std::size_t count);
+
+// Lays out the subresources [firstSubresource, firstSubresource + count) of a texture
+// (mip-major within each array slice) from 'baseOffset' on, like GetCopyableFootprints.
+// blockSize is 4 for block-compressed formats and 1 otherwise; bytesPerBlock is the size
+// of a block (or a texel).  Returns the total size, 'baseOffset' not included.
+std::uint64_t ComputeFootprints(std::uint32_t width, std::uint32_t height, std::uint32_t depth,
+	std::uint32_t mipLevels, std::uint32_t blockSize, std::uint32_t bytesPerBlock,
+	std::uint32_t firstSubresource, std::uint32_t count, std::uint64_t baseOffset,
+	SubresourceFootprint* footprints);
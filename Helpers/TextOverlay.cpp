@@ -0,0 +1,294 @@
+//***************************************************************************************
+// TextOverlay.cpp
+//***************************************************************************************
+
+#include "TextOverlay.h"
+
+using Microsoft::WRL::ComPtr;
+using namespace DirectX;
+
+//--------------------------------------------------------------------------------------
+// TextLine
+//--------------------------------------------------------------------------------------
+
+void TextLine::Put(char c)
+{
+	// silently truncate; a HUD line is never worth an allocation.
+	if (mLength < Capacity - 1)
+	{
+		mText[mLength++] = c;
+		mText[mLength] = '\0';
+	}
+}
+
+TextLine& TextLine::Append(const char* str)
+{
+	while (*str)
+		Put(*str++);
+
+	return *this;
+}
+
+TextLine& TextLine::Append(int value)
+{
+	long long v = value;
+	if (v < 0)
+	{
+		Put('-');
+		v = -v;
+	}
+
+	// digits come out in reverse order.
+	char digits[20];
+	int n = 0;
+	do
+	{
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v > 0);
+
+	while (n > 0)
+		Put(digits[--n]);
+
+	return *this;
+}
+
+TextLine& TextLine::Append(float value, int decimals)
+{
+	static const unsigned long long powersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+	if (value != value)
+		return Append("nan");
+
+	if (value < 0.0f)
+	{
+		Put('-');
+		value = -value;
+	}
+
+	decimals = MathHelper::Clamp(decimals, 0, 6);
+	unsigned long long scale = powersOf10[decimals];
+
+	double scaled = (double)value * scale + 0.5;
+	if (scaled >= 9.0e18)
+		return Append("inf");
+
+	unsigned long long fixed = (unsigned long long)scaled;
+	unsigned long long integerPart = fixed / scale;
+	unsigned long long fractionPart = fixed % scale;
+
+	char digits[20];
+	int n = 0;
+	do
+	{
+		digits[n++] = (char)('0' + integerPart % 10);
+		integerPart /= 10;
+	} while (integerPart > 0);
+
+	while (n > 0)
+		Put(digits[--n]);
+
+	if (decimals > 0)
+	{
+		Put('.');
+		for (int i = decimals - 1; i >= 0; --i)
+			Put((char)('0' + (fractionPart / powersOf10[i]) % 10));
+	}
+
+	return *this;
+}
+
+//--------------------------------------------------------------------------------------
+// TextOverlay
+//--------------------------------------------------------------------------------------
+
+TextOverlay::TextOverlay()
+{
+	// the only allocation the overlay ever makes.
+	mVertices.reserve(MaxVertices);
+}
+
+void TextOverlay::BuildGlyphAtlas(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, StagingArena& staging,
+	const wchar_t* fontFace, int pixelHeight, Texture& atlas)
+{
+	const int atlasWidth = 512;
+	const int padding = 1;			// a point tap landing on a glyph's edge texel never reads the neighbour glyph
+
+	HDC dc = CreateCompatibleDC(nullptr);
+	HFONT font = CreateFontW(-pixelHeight, 0, 0, 0, FW_SEMIBOLD, FALSE, FALSE, FALSE,
+		ANSI_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY,
+		DEFAULT_PITCH | FF_DONTCARE, fontFace);
+	HGDIOBJ oldFont = SelectObject(dc, font);
+
+	TEXTMETRICW metrics;
+	GetTextMetricsW(dc, &metrics);
+	mLineHeight = metrics.tmHeight;
+
+	// 1st pass: measure the glyphs and pack them into rows.
+	int glyphX[LastGlyph - FirstGlyph + 1];
+	int glyphY[LastGlyph - FirstGlyph + 1];
+
+	int x = padding;
+	int y = padding;
+	for (int c = FirstGlyph; c <= LastGlyph; ++c)
+	{
+		wchar_t wc = (wchar_t)c;
+		SIZE extent;
+		GetTextExtentPoint32W(dc, &wc, 1, &extent);
+
+		if (x + extent.cx + padding > atlasWidth)
+		{
+			x = padding;
+			y += mLineHeight + padding;
+		}
+
+		Glyph& g = mGlyphs[c - FirstGlyph];
+		g.Width = extent.cx;
+		g.Height = mLineHeight;
+		glyphX[c - FirstGlyph] = x;
+		glyphY[c - FirstGlyph] = y;
+
+		x += extent.cx + padding;
+	}
+	const int atlasHeight = y + mLineHeight + padding;
+
+	// 2nd pass: rasterize white-on-black into a top-down 32bpp DIB section.
+	BITMAPINFO bmi = {};
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = atlasWidth;
+	bmi.bmiHeader.biHeight = -atlasHeight;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	void* bits = nullptr;
+	HBITMAP bitmap = CreateDIBSection(dc, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+	HGDIOBJ oldBitmap = SelectObject(dc, bitmap);
+	ZeroMemory(bits, atlasWidth * atlasHeight * sizeof(UINT));
+
+	SetTextColor(dc, RGB(255, 255, 255));
+	SetBkMode(dc, TRANSPARENT);
+
+	const float invWidth = 1.0f / atlasWidth;
+	const float invHeight = 1.0f / atlasHeight;
+	for (int c = FirstGlyph; c <= LastGlyph; ++c)
+	{
+		wchar_t wc = (wchar_t)c;
+		int gx = glyphX[c - FirstGlyph];
+		int gy = glyphY[c - FirstGlyph];
+		TextOutW(dc, gx, gy, &wc, 1);
+
+		Glyph& g = mGlyphs[c - FirstGlyph];
+		g.U0 = gx * invWidth;
+		g.V0 = gy * invHeight;
+		g.U1 = (gx + g.Width) * invWidth;
+		g.V1 = (gy + g.Height) * invHeight;
+	}
+	GdiFlush();
+
+	// grey-scale antialiased text: any channel is the glyph coverage.
+	std::vector<BYTE> coverage(atlasWidth * atlasHeight);
+	const UINT* pixels = reinterpret_cast<const UINT*>(bits);
+	for (size_t i = 0; i < coverage.size(); ++i)
+		coverage[i] = (BYTE)(pixels[i] & 0xff);
+
+	SelectObject(dc, oldBitmap);
+	SelectObject(dc, oldFont);
+	DeleteObject(bitmap);
+	DeleteObject(font);
+	DeleteDC(dc);
+
+	// create the atlas texture and record the upload.
+	atlas.Name = "glyphAtlasTex";
+	atlas.Filename.clear();
+
+	CD3DX12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8_UNORM, atlasWidth, atlasHeight, 1, 1);
+	ThrowIfFailed(staging.CreateTexture(texDesc, D3D12_RESOURCE_STATE_COPY_DEST, atlas.Resource));
+
+	atlas.UploadHeap = nullptr;
+
+	D3D12_SUBRESOURCE_DATA subResourceData = {};
+	subResourceData.pData = coverage.data();
+	subResourceData.RowPitch = atlasWidth;
+	subResourceData.SlicePitch = atlasWidth * atlasHeight;
+
+	// the rows are copied into the staging arena right away, so 'coverage' may go out of scope.
+	staging.UploadSubresources(cmdList, atlas.Resource.Get(), 0, 1, &subResourceData);
+
+	CD3DX12_RESOURCE_BARRIER toShaderResource = CD3DX12_RESOURCE_BARRIER::Transition(atlas.Resource.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, StagingArena::ReadyState(cmdList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	cmdList->ResourceBarrier(1, &toShaderResource);
+}
+
+D3D12_INPUT_ELEMENT_DESC const* TextOverlay::InputLayout(UINT& count)
+{
+	static const D3D12_INPUT_ELEMENT_DESC layout[] =
+	{
+		{"POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	};
+
+	count = _countof(layout);
+	return layout;
+}
+
+void TextOverlay::Begin(int screenWidth, int screenHeight)
+{
+	mVertices.clear();
+
+	mInvHalfWidth = 2.0f / (float)screenWidth;
+	mInvHalfHeight = 2.0f / (float)screenHeight;
+}
+
+void TextOverlay::DrawString(float x, float y, const char* text, const XMFLOAT4& color)
+{
+	float penX = x;
+	for (const char* c = text; *c != '\0'; ++c)
+	{
+		if (*c == '\n')
+		{
+			penX = x;
+			y += (float)mLineHeight;
+			continue;
+		}
+
+		char ch = (*c < FirstGlyph || *c > LastGlyph) ? '?' : *c;
+		const Glyph& g = mGlyphs[ch - FirstGlyph];
+
+		if (ch != ' ')
+		{
+			if (mVertices.size() + 6 > MaxVertices)
+				return;
+
+			// pixel coordinates (origin at top-left, y down) -> normalized device coordinates.
+			float left = penX * mInvHalfWidth - 1.0f;
+			float right = (penX + g.Width) * mInvHalfWidth - 1.0f;
+			float top = 1.0f - y * mInvHalfHeight;
+			float bottom = 1.0f - (y + g.Height) * mInvHalfHeight;
+
+			TextVertex tl = { XMFLOAT2(left, top), XMFLOAT2(g.U0, g.V0), color };
+			TextVertex tr = { XMFLOAT2(right, top), XMFLOAT2(g.U1, g.V0), color };
+			TextVertex bl = { XMFLOAT2(left, bottom), XMFLOAT2(g.U0, g.V1), color };
+			TextVertex br = { XMFLOAT2(right, bottom), XMFLOAT2(g.U1, g.V1), color };
+
+			mVertices.push_back(tl);
+			mVertices.push_back(tr);
+			mVertices.push_back(bl);
+			mVertices.push_back(bl);
+			mVertices.push_back(tr);
+			mVertices.push_back(br);
+		}
+
+		penX += (float)g.Width;
+	}
+}
+
+UINT TextOverlay::Flush(TextVertex* dest)
+{
+	// one bulk streaming copy; dest is write-combined upload memory, so never read it back.
+	if (!mVertices.empty())
+		WriteCombined::StreamCopy(dest, mVertices.data(), mVertices.size() * sizeof(TextVertex));
+
+	return (UINT)mVertices.size();
+}
@@ -0,0 +1,96 @@
+//***************************************************************************************
+// TextOverlay.h
+//
+// In-scene text/HUD overlay.  A glyph atlas for printable ASCII is baked on the CPU with
+// GDI at startup and uploaded as a single-channel texture.  Every frame the text is
+// turned into screen-space quads in a preallocated vertex array, so drawing text does
+// not allocate.  TextLine formats numbers into a fixed-size character buffer for the
+// same reason.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "WriteCombined.h"
+#include "StagingArena.h"
+
+// pair to the VertexInput structure in TextOverlay.hlsl
+struct TextVertex
+{
+	DirectX::XMFLOAT2 Position;		// normalized device coordinates
+	DirectX::XMFLOAT2 TexC;
+	DirectX::XMFLOAT4 Color;
+};
+
+// Fixed capacity, allocation-free string builder for HUD lines.
+class TextLine
+{
+public:
+	static const int Capacity = 128;
+
+	TextLine() { mText[0] = '\0'; }
+
+	TextLine& Append(const char* str);
+	TextLine& Append(int value);
+	TextLine& Append(float value, int decimals);
+
+	void Clear() { mLength = 0; mText[0] = '\0'; }
+	const char* c_str()const { return mText; }
+	int Length()const { return mLength; }
+
+private:
+	void Put(char c);
+
+private:
+	char mText[Capacity];
+	int mLength = 0;
+};
+
+class TextOverlay
+{
+public:
+	static const UINT MaxCharacters = 1024;
+	static const UINT MaxVertices = MaxCharacters * 6;	// two triangles per character, no index buffer
+
+public:
+	TextOverlay();
+	TextOverlay(const TextOverlay& rhs) = delete;
+	TextOverlay& operator=(const TextOverlay& rhs) = delete;
+
+	// Bakes the glyph atlas with the given font and records its upload into cmdList,
+	// staged through 'staging' (which must stay alive until the command list has executed).
+	void BuildGlyphAtlas(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, StagingArena& staging,
+		const wchar_t* fontFace, int pixelHeight, Texture& atlas);
+
+	static D3D12_INPUT_ELEMENT_DESC const* InputLayout(UINT& count);
+
+	// Per frame: Begin, any number of DrawString calls, then Flush VertexCount() vertices
+	// into this frame's (mapped) vertex memory.
+	void Begin(int screenWidth, int screenHeight);
+	void DrawString(float x, float y, const char* text,
+		const DirectX::XMFLOAT4& color = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+	UINT Flush(TextVertex* dest);
+
+	int LineHeight()const { return mLineHeight; }
+	UINT VertexCount()const { return (UINT)mVertices.size(); }
+
+private:
+	struct Glyph
+	{
+		float U0 = 0.0f, V0 = 0.0f, U1 = 0.0f, V1 = 0.0f;
+		int Width = 0;
+		int Height = 0;
+	};
+
+	static const char FirstGlyph = ' ';
+	static const char LastGlyph = '~';
+
+private:
+	Glyph mGlyphs[LastGlyph - FirstGlyph + 1];
+	int mLineHeight = 0;
+
+	float mInvHalfWidth = 0.0f;
+	float mInvHalfHeight = 0.0f;
+
+	std::vector<TextVertex> mVertices;		// capacity reserved once, cleared every frame
+};
@@ -0,0 +1,119 @@
+//***************************************************************************************
+// TextureAtlas.cpp
+//***************************************************************************************
+
+#include "TextureAtlas.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+void BuildTextureAtlases(const AtlasSettings& settings, const AtlasImage* images, std::uint32_t count,
+	std::vector<AtlasPage>& pages, std::vector<AtlasPlacement>& placements)
+{
+	pages.clear();
+	placements.assign(count, AtlasPlacement());
+
+	// cells are packed in units of the alignment, which makes every cell aligned.
+	const std::uint32_t mipLevels = std::max(settings.MipLevels, 1u);
+	const std::uint32_t gutter = 1u << (mipLevels - 1);
+	const std::uint32_t align = gutter;
+	const std::uint32_t pageUnits = std::max(settings.PageSize / align, 1u);
+
+	auto cellUnits = [&](std::uint32_t texels) { return (texels + 2 * gutter + align - 1) / align; };
+
+	// tallest first packs a skyline best.
+	std::vector<std::uint32_t> order(count);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b)
+	{
+		if (images[a].Height != images[b].Height)
+			return images[a].Height > images[b].Height;
+		return images[a].Width > images[b].Width;
+	});
+
+	std::vector<AtlasPacker> packers;
+	std::vector<AtlasRect> cells(count);
+	for (std::uint32_t i : order)
+	{
+		std::uint32_t width = cellUnits(images[i].Width);
+		std::uint32_t height = cellUnits(images[i].Height);
+		if (images[i].Width == 0 || images[i].Height == 0 || width > pageUnits || height > pageUnits)
+			continue;
+
+		std::uint32_t page = 0;
+		while (page < packers.size() && !packers[page].Insert(width, height, cells[i]))
+			++page;
+		if (page == packers.size())
+		{
+			packers.emplace_back(pageUnits, pageUnits);
+			packers.back().Insert(width, height, cells[i]);
+		}
+		placements[i].Page = page;
+	}
+
+	// every page only as large as its contents.
+	pages.resize(packers.size());
+	std::vector<std::vector<MipImage>> mips(packers.size());
+	for (std::size_t p = 0; p < packers.size(); ++p)
+	{
+		AtlasPage& page = pages[p];
+		page.Width = packers[p].UsedWidth() * align;
+		page.Height = packers[p].UsedHeight() * align;
+		page.Levels.resize(std::min(mipLevels, FullMipCount(page.Width, page.Height)));
+
+		mips[p].resize(page.Levels.size());
+		for (std::size_t level = 0; level < page.Levels.size(); ++level)
+		{
+			MipImage& mip = mips[p][level];
+			mip.Width = std::max(page.Width >> level, 1u);
+			mip.Height = std::max(page.Height >> level, 1u);
+			mip.RowPitch = 4 * (std::size_t)mip.Width;
+			page.Levels[level].assign(mip.RowPitch * mip.Height, 0);
+			mip.Data = page.Levels[level].data();
+		}
+	}
+
+	// each cell holds its image, the edge texels repeated out to the cell's border.
+	for (std::uint32_t i = 0; i < count; ++i)
+	{
+		AtlasPlacement& placement = placements[i];
+		if (placement.Page == AtlasPlacement::NotPacked)
+			continue;
+
+		const AtlasImage& image = images[i];
+		AtlasPage& page = pages[placement.Page];
+		const std::uint32_t cellX = cells[i].X * align;
+		const std::uint32_t cellY = cells[i].Y * align;
+		const std::uint32_t cellWidth = cells[i].Width * align;
+		const std::uint32_t cellHeight = cells[i].Height * align;
+
+		placement.Rect.X = cellX + gutter;
+		placement.Rect.Y = cellY + gutter;
+		placement.Rect.Width = image.Width;
+		placement.Rect.Height = image.Height;
+		placement.Scale[0] = (float)image.Width / (float)page.Width;
+		placement.Scale[1] = (float)image.Height / (float)page.Height;
+		placement.Offset[0] = (float)placement.Rect.X / (float)page.Width;
+		placement.Offset[1] = (float)placement.Rect.Y / (float)page.Height;
+
+		const std::uint8_t* src = static_cast<const std::uint8_t*>(image.Data);
+		for (std::uint32_t y = 0; y < cellHeight; ++y)
+		{
+			std::uint32_t srcY = (std::uint32_t)std::min(std::max((int)y - (int)gutter, 0), (int)image.Height - 1);
+			const std::uint8_t* srcRow = src + image.RowPitch * srcY;
+			std::uint8_t* destRow = page.Levels[0].data() + 4 * ((std::size_t)page.Width * (cellY + y) + cellX);
+
+			// left gutter, the row, right gutter.
+			for (std::uint32_t x = 0; x < gutter; ++x)
+				std::memcpy(destRow + 4 * x, srcRow, 4);
+			std::memcpy(destRow + 4 * gutter, srcRow, 4 * (std::size_t)image.Width);
+			for (std::uint32_t x = gutter + image.Width; x < cellWidth; ++x)
+				std::memcpy(destRow + 4 * x, srcRow + 4 * (std::size_t)(image.Width - 1), 4);
+		}
+	}
+
+	// box filtering on aligned cells never mixes two images.
+	for (std::size_t p = 0; p < pages.size(); ++p)
+		GenerateMips(MipFormat::RGBA8, MipFilter::Box, settings.Srgb, mips[p].data(), (std::uint32_t)mips[p].size());
+}
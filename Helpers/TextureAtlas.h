@@ -0,0 +1,58 @@
+//***************************************************************************************
+// TextureAtlas.h
+//
+// Packs small RGBA8 images into shared atlas pages (AtlasPacker), so the materials using
+// them can share one texture and one SRV.  A material samples its image through the
+// placement's scale and offset (uv * Scale + Offset), which fits in its MatTransform; the
+// images must be sampled inside [0, 1], tiling would reach into the neighbours.
+//
+// Mips stay clean: every image is surrounded by a gutter of 2^(MipLevels - 1) texels
+// repeating its edge, and cells start and end on multiples of that.  Each box-filtered
+// level down to the last then averages texels of one image only, and still has a texel of
+// gutter for the bilinear taps at the image border.
+//
+// This is a plain CPU helper without any Direct3D dependency, so it can be exercised
+// and tested on its own (any platform with a C++14 compiler).
+//***************************************************************************************
+
+#pragma once
+
+#include "AtlasPacker.h"
+#include <cstddef>
+
+struct AtlasSettings
+{
+	std::uint32_t PageSize = 1024;			// largest page, in texels per side
+	std::uint32_t MipLevels = 4;			// mips of every page (fewer for tiny pages)
+	bool Srgb = true;						// color is sRGB-encoded: mips are filtered in linear light
+};
+
+// RGBA8 texels, rows 'RowPitch' bytes apart.
+struct AtlasImage
+{
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::size_t RowPitch = 0;
+	const void* Data = nullptr;
+};
+
+struct AtlasPlacement
+{
+	static const std::uint32_t NotPacked = UINT32_MAX;
+
+	std::uint32_t Page = NotPacked;			// NotPacked: larger than a page
+	AtlasRect Rect;							// the image's texels in the page (gutter excluded)
+	float Scale[2] = { 1.0f, 1.0f };		// uv in the page = uv * Scale + Offset
+	float Offset[2] = { 0.0f, 0.0f };
+};
+
+struct AtlasPage
+{
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::vector<std::vector<std::uint8_t>> Levels;		// RGBA8 mips, rows packed tightly
+};
+
+// Packs images[0, count) into as few pages as it takes; placements[i] tells where image i went.
+void BuildTextureAtlases(const AtlasSettings& settings, const AtlasImage* images, std::uint32_t count,
+	std::vector<AtlasPage>& pages, std::vector<AtlasPlacement>& placements);
@@ -0,0 +1,233 @@
+//***************************************************************************************
+// TextureCache.cpp
+//***************************************************************************************
+
+#include "TextureCache.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+
+namespace
+{
+	const UINT32 IndexMagic = 0x49435854;		// 'TXCI'
+	const UINT32 IndexVersion = 1;
+
+	std::wstring FullPath(const std::wstring& filename)
+	{
+		DWORD length = GetFullPathNameW(filename.c_str(), 0, nullptr, nullptr);
+		if (length == 0)
+			return filename;
+
+		std::wstring path(length, L'\0');
+		length = GetFullPathNameW(filename.c_str(), length, &path[0], nullptr);
+		path.resize(length);
+		return path;
+	}
+
+	template<typename T>
+	bool ReadValue(std::ifstream& in, T& value)
+	{
+		return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	void WriteValue(std::ofstream& out, const T& value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+}
+
+TextureCache::TextureCache(const std::wstring& indexFile)
+	: mIndexFile(indexFile)
+{
+	LoadIndex();
+}
+
+TextureCache::~TextureCache()
+{
+	if (mIndexChanged)
+		SaveIndex();
+
+	if (mBudget != nullptr)
+		mBudget->Untrack(MemoryBudget::Pool::Cpu, MemoryBudget::Category::Texture, mTrackedBytes);
+}
+
+void TextureCache::SetBudget(MemoryBudget* budget)
+{
+	mBudget = budget;
+	mTrackedBytes = 0;
+	TrackMemory();
+}
+
+std::shared_ptr<Texture> TextureCache::Acquire(const std::string& name, const std::wstring& filename, bool& created)
+{
+	UINT64 hash = 0;
+	UINT64 size = 0;
+	bool hashed = HashFile(filename, hash, size);
+
+	if (hashed)
+	{
+		auto it = mLive.find(hash);
+		if (it != mLive.end() && it->second.Size == size)
+		{
+			std::shared_ptr<Texture> tex = it->second.Tex.lock();
+			if (tex != nullptr)
+			{
+				++mSharedCount;
+				created = false;
+				TrackMemory();
+				return tex;
+			}
+		}
+	}
+
+	auto tex = std::make_shared<Texture>();
+	tex->Name = name;
+	tex->Filename = filename;
+
+	// an unreadable file is left to the loader to report; it is not shared.
+	if (hashed)
+	{
+		tex->ContentHash = hash;
+
+		LiveEntry& entry = mLive[hash];
+		entry.Size = size;
+		entry.Tex = tex;
+	}
+
+	created = true;
+	TrackMemory();
+	return tex;
+}
+
+void TextureCache::Forget(const std::shared_ptr<Texture>& tex)
+{
+	auto it = mLive.find(tex->ContentHash);
+	if (it != mLive.end() && it->second.Tex.lock() == tex)
+		mLive.erase(it);
+	TrackMemory();
+}
+
+bool TextureCache::HashFile(const std::wstring& filename, UINT64& hash, UINT64& size)
+{
+	// packed: the archive was hashed when it was built.
+	UINT32 packed = mArchive != nullptr ? mArchive->Find(filename.c_str()) : AssetArchive::NotFound;
+	if (packed != AssetArchive::NotFound)
+	{
+		hash = mArchive->ContentHash(packed);
+		size = mArchive->Size(packed);
+		return true;
+	}
+
+	std::wstring path = FullPath(filename);
+
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+
+	size = ((UINT64)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	UINT64 writeTime = ((UINT64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+
+	// unchanged since it was last hashed: trust the index.
+	auto it = mIndex.find(path);
+	if (it != mIndex.end() && it->second.Size == size && it->second.WriteTime == writeTime)
+	{
+		hash = it->second.Hash;
+		return true;
+	}
+
+	MappedFile file;
+	if (!file.Open(path.c_str()))
+		return false;
+
+	size = file.Size();
+	file.Prefetch(0, size);
+	hash = ContentHash64(file.Data(), (size_t)size);
+	++mFilesHashed;
+
+	IndexEntry& entry = mIndex[path];
+	entry.Size = size;
+	entry.WriteTime = writeTime;
+	entry.Hash = hash;
+	mIndexChanged = true;
+	return true;
+}
+
+void TextureCache::LoadIndex()
+{
+	std::ifstream in(mIndexFile.c_str(), std::ios::binary);
+	if (!in)
+		return;
+
+	// a missing, stale or damaged index only costs hashing the files again.
+	UINT32 magic = 0, version = 0, count = 0;
+	if (!ReadValue(in, magic) || magic != IndexMagic ||
+		!ReadValue(in, version) || version != IndexVersion ||
+		!ReadValue(in, count))
+	{
+		return;
+	}
+
+	for (UINT32 i = 0; i < count; ++i)
+	{
+		IndexEntry entry;
+		UINT32 pathLength = 0;
+		if (!ReadValue(in, entry.Size) || !ReadValue(in, entry.WriteTime) || !ReadValue(in, entry.Hash) ||
+			!ReadValue(in, pathLength) || pathLength > 32767)
+		{
+			mIndex.clear();
+			return;
+		}
+
+		std::wstring path(pathLength, L'\0');
+		if (pathLength != 0 && !in.read(reinterpret_cast<char*>(&path[0]), pathLength * sizeof(wchar_t)))
+		{
+			mIndex.clear();
+			return;
+		}
+
+		mIndex[path] = entry;
+	}
+}
+
+bool TextureCache::SaveIndex()
+{
+	std::ofstream out(mIndexFile.c_str(), std::ios::binary | std::ios::trunc);
+	if (!out)
+		return false;
+
+	WriteValue(out, IndexMagic);
+	WriteValue(out, IndexVersion);
+	WriteValue(out, (UINT32)mIndex.size());
+
+	for (auto& elem : mIndex)
+	{
+		WriteValue(out, elem.second.Size);
+		WriteValue(out, elem.second.WriteTime);
+		WriteValue(out, elem.second.Hash);
+		WriteValue(out, (UINT32)elem.first.size());
+		out.write(reinterpret_cast<const char*>(elem.first.data()), elem.first.size() * sizeof(wchar_t));
+	}
+
+	if (!out)
+		return false;
+
+	mIndexChanged = false;
+	return true;
+}
+
+void TextureCache::TrackMemory()
+{
+	if (mBudget == nullptr)
+		return;
+
+	// about what the tables hold: their nodes (a value and two links), bucket arrays and paths.
+	const UINT64 links = 2 * sizeof(void*);
+	UINT64 bytes = mIndex.bucket_count() * sizeof(void*) + mLive.bucket_count() * sizeof(void*);
+	bytes += mLive.size() * (sizeof(std::pair<const UINT64, LiveEntry>) + links);
+	for (auto& elem : mIndex)
+		bytes += sizeof(elem) + links + elem.first.capacity() * sizeof(wchar_t);
+
+	mBudget->Untrack(MemoryBudget::Pool::Cpu, MemoryBudget::Category::Texture, mTrackedBytes);
+	mBudget->Track(MemoryBudget::Pool::Cpu, MemoryBudget::Category::Texture, bytes);
+	mTrackedBytes = bytes;
+}
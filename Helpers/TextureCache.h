@@ -0,0 +1,88 @@
+//***************************************************************************************
+// TextureCache.h
+//
+// Hands out textures by file content rather than by name: files with identical contents
+// (the same file under two names, or copies of it) share one Texture, and with it one
+// resource and one SRV.  Textures are shared through std::shared_ptr; the cache only
+// keeps weak references, so a texture goes away with its last handle (its owner retires
+// the GPU resource first, as for any other texture).
+//
+// The content hash (ContentHash64) of every file is remembered in an index file together
+// with the file's size and last write time.  On the next launch an unchanged file is
+// recognized from its directory entry and not read at all.  Files packed into an asset
+// archive (SetArchive) need neither: the archive's table of contents has their hashes.
+//
+// All methods are called from the main thread.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "AssetArchive.h"
+#include "MemoryBudget.h"
+#include <memory>
+
+class TextureCache
+{
+public:
+	// The index is read from 'indexFile' if it exists and written back on destruction.
+	explicit TextureCache(const std::wstring& indexFile);
+	TextureCache(const TextureCache& rhs) = delete;
+	TextureCache& operator=(const TextureCache& rhs) = delete;
+	~TextureCache();
+
+	// Files found in 'archive' are hashed from its table of contents (the streamer reads
+	// them from there as well).  The archive stays open while the cache is in use.
+	void SetArchive(const AssetArchive* archive) { mArchive = archive; }
+
+	// Tracks the memory of the index and the live table with 'budget' (CPU, Texture) as
+	// they grow and shrink.  The budget must outlive the cache.
+	void SetBudget(MemoryBudget* budget);
+
+	// Returns the live texture with the contents of 'filename', or a new texture with
+	// Name and Filename set (created = true), which the caller loads.  A file that cannot
+	// be read gets a texture of its own.
+	std::shared_ptr<Texture> Acquire(const std::string& name, const std::wstring& filename, bool& created);
+
+	// Stops handing out 'tex' (its files are about to be loaded again, and may have
+	// changed on disk): the next Acquire of its contents creates a new texture.  Every
+	// name that shared it has to be acquired again, since the files may differ now.
+	void Forget(const std::shared_ptr<Texture>& tex);
+
+	// Writes the index now; false if the file could not be written.
+	bool SaveIndex();
+
+	UINT64 FilesHashed()const { return mFilesHashed; }		// files read this run (not in the index, or changed)
+	UINT64 SharedCount()const { return mSharedCount; }		// acquisitions answered with an existing texture
+
+private:
+	struct IndexEntry
+	{
+		UINT64 Size = 0;
+		UINT64 WriteTime = 0;		// FILETIME
+		UINT64 Hash = 0;
+	};
+
+	struct LiveEntry
+	{
+		UINT64 Size = 0;
+		std::weak_ptr<Texture> Tex;
+	};
+
+	// false if the file cannot be read.
+	bool HashFile(const std::wstring& filename, UINT64& hash, UINT64& size);
+	void LoadIndex();
+	void TrackMemory();
+
+private:
+	std::wstring mIndexFile;
+	const AssetArchive* mArchive = nullptr;
+	MemoryBudget* mBudget = nullptr;
+	UINT64 mTrackedBytes = 0;
+	bool mIndexChanged = false;
+	std::unordered_map<std::wstring, IndexEntry> mIndex;		// by full path
+	std::unordered_map<UINT64, LiveEntry> mLive;				// by content hash
+
+	UINT64 mFilesHashed = 0;
+	UINT64 mSharedCount = 0;
+};
@@ -0,0 +1,701 @@
+//***************************************************************************************
+// TextureStreamer.cpp
+//***************************************************************************************
+
+#include "TextureStreamer.h"
+#include "BlockEncoder.h"
+#include "ChunkedFileReader.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// how a texture stored without mips gets its chain.
+	struct MipSource
+	{
+		bool Compressed;			// decoded to texels (BlockDecoder) first
+		BlockFormat Blocks;
+		MipFormat Format;
+		bool Srgb;					// color filtered in linear light
+		DXGI_FORMAT Result;			// format of the generated chain if it is not encoded back to the source's
+	};
+
+	// UNORM color is taken as sRGB-encoded, which is what the artwork in it is; BC4/BC5 hold
+	// data and are filtered as is.  False for the formats that keep their single mip.
+	bool GetMipSource(DXGI_FORMAT format, MipSource& source)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:				source = { true, BlockFormat::BC1, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM }; return true;
+		case DXGI_FORMAT_BC1_UNORM_SRGB:		source = { true, BlockFormat::BC1, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB }; return true;
+		case DXGI_FORMAT_BC2_UNORM:				source = { true, BlockFormat::BC2, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM }; return true;
+		case DXGI_FORMAT_BC2_UNORM_SRGB:		source = { true, BlockFormat::BC2, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB }; return true;
+		case DXGI_FORMAT_BC3_UNORM:				source = { true, BlockFormat::BC3, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM }; return true;
+		case DXGI_FORMAT_BC3_UNORM_SRGB:		source = { true, BlockFormat::BC3, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB }; return true;
+		case DXGI_FORMAT_BC7_UNORM:				source = { true, BlockFormat::BC7, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM }; return true;
+		case DXGI_FORMAT_BC7_UNORM_SRGB:		source = { true, BlockFormat::BC7, MipFormat::RGBA8, true, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB }; return true;
+		case DXGI_FORMAT_BC4_UNORM:				source = { true, BlockFormat::BC4, MipFormat::RGBA8, false, DXGI_FORMAT_R8G8B8A8_UNORM }; return true;
+		case DXGI_FORMAT_BC5_UNORM:				source = { true, BlockFormat::BC5, MipFormat::RGBA8, false, DXGI_FORMAT_R8G8B8A8_UNORM }; return true;
+		case DXGI_FORMAT_BC6H_UF16:				source = { true, BlockFormat::BC6H, MipFormat::RGBA16F, false, DXGI_FORMAT_R16G16B16A16_FLOAT }; return true;
+		case DXGI_FORMAT_BC6H_SF16:				source = { true, BlockFormat::BC6HSigned, MipFormat::RGBA16F, false, DXGI_FORMAT_R16G16B16A16_FLOAT }; return true;
+
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+			source = { false, BlockFormat::BC1, MipFormat::RGBA8, true, format };
+			return true;
+
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			source = { false, BlockFormat::BC1, MipFormat::RGBA16F, false, format };
+			return true;
+
+		default:
+			return false;
+		}
+	}
+}
+
+TextureStreamer::TextureStreamer(ID3D12Device* device, GpuMemoryAllocator* allocator, CopyQueue* copyQueue,
+	UINT64 bytesPerFrame)
+	: mDevice(device), mAllocator(allocator), mCopyQueue(copyQueue), mBytesPerFrame(bytesPerFrame)
+{
+	mWorker = std::thread(&TextureStreamer::WorkerMain, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+	mWake.notify_one();
+	mWorker.join();
+
+	// resources that never reached their texture; their copies must be done first.  (The
+	// textures themselves may be gone already.)
+	mCopyQueue->Flush();
+	for (auto& elem : mStreams)
+	{
+		Stream& stream = *elem.second;
+		TrackMemory(stream, 0);
+		if (stream.Resource != nullptr && !stream.Published)
+		{
+			if (mResidency != nullptr)
+				mResidency->Untrack(stream.Resource.Get());
+			if (mAllocator != nullptr)
+				mAllocator->Release(stream.Resource);
+			stream.Resource = nullptr;
+		}
+	}
+}
+
+void TextureStreamer::Load(Texture* tex)
+{
+	auto stream = std::make_shared<Stream>();
+	stream->Tex = tex;
+	stream->Filename = tex->Filename;
+	mStreams[tex] = stream;
+
+	Job job;
+	job.Type = JobType::Open;
+	job.Target = stream;
+	Post(job);
+}
+
+void TextureStreamer::Unload(Texture* tex, ID3D12CommandQueue* queue)
+{
+	auto it = mStreams.find(tex);
+	if (it == mStreams.end())
+		return;
+
+	Stream& stream = *it->second;
+	stream.Cancelled = true;
+
+	// the caller retires the resource, loaded or not, after 'queue' has waited for its copies.
+	if (stream.CopyFence != 0)
+		mCopyQueue->GpuWait(queue, stream.CopyFence);
+	if (stream.Resource != nullptr)
+		tex->Resource = stream.Resource;
+
+	// the worker drops its jobs for the stream; reads already queued still count as in flight
+	// until their results come back.
+	mReadyReads.erase(std::remove_if(mReadyReads.begin(), mReadyReads.end(),
+		[&stream](const Job& job) { return job.Target.get() == &stream; }), mReadyReads.end());
+	if (stream.LoadingMip < stream.ResidentMip && stream.CopyFence == 0 && mReadsInFlight > 0)
+		--mReadsInFlight;
+
+	TrackMemory(stream, 0);
+	mStreams.erase(it);
+}
+
+void TextureStreamer::RequestScreenSize(Texture* tex, float pixels)
+{
+	auto it = mStreams.find(tex);
+	if (it != mStreams.end())
+		it->second->ScreenSize = std::max(it->second->ScreenSize, pixels);
+}
+
+void TextureStreamer::Update(ID3D12CommandQueue* queue, std::vector<Texture*>& changed)
+{
+	changed.clear();
+
+	std::deque<Job> results;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		results.swap(mResults);
+	}
+
+	for (Job& result : results)
+	{
+		Stream& stream = *result.Target;
+		if (stream.Cancelled)
+			continue;		// counted out by Unload
+
+		if (result.Type == JobType::Read)
+		{
+			mReadyReads.push_back(result);
+			continue;
+		}
+
+		if (FAILED(stream.Status))
+		{
+			// the texture keeps its null SRV.
+			std::wstring text = L"TextureStreamer: cannot load " + stream.Filename + L"\n";
+			OutputDebugStringW(text.c_str());
+			mStreams.erase(stream.Tex);
+			continue;
+		}
+
+		// all mips in one go, read front to back with constant memory; the frame waits for the
+		// file, which only happens for the files the worker could not map.
+		if (stream.Chunked)
+		{
+			// its two chunk buffers, counted while they exist (the budget keeps the peak).
+			const UINT64 chunkBytes = 2 * ChunkedFileReader::DefaultChunkSize;
+			TrackMemory(stream, chunkBytes);
+			mCopyQueue->Begin();
+			HRESULT hr = DirectX::CreateDDSTextureFromFileChunked12(mDevice, mCopyQueue, stream.Filename.c_str(), stream.Resource);
+			TrackMemory(stream, 0);
+			if (SUCCEEDED(hr) && mResidency != nullptr)
+			{
+				mResidency->Track(stream.Resource.Get(), 0);
+				mResidency->MarkCopied(stream.Resource.Get(), mCopyQueue->NextValue());
+			}
+			stream.CopyFence = mCopyQueue->Submit();
+
+			if (FAILED(hr))
+			{
+				std::wstring text = L"TextureStreamer: cannot load " + stream.Filename + L"\n";
+				OutputDebugStringW(text.c_str());
+				mStreams.erase(stream.Tex);
+				continue;
+			}
+
+			// published whole once the copies complete.
+			stream.Desc = stream.Resource->GetDesc();
+			stream.ResidentMip = stream.Desc.MipLevels;
+			stream.LoadingMip = 0;
+
+			UINT64 bytes = 0;
+			UINT subresources = stream.Desc.MipLevels *
+				((stream.Desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D) ? 1 : stream.Desc.DepthOrArraySize);
+			mDevice->GetCopyableFootprints(&stream.Desc, 0, subresources, 0, nullptr, nullptr, nullptr, &bytes);
+			mBytesUploaded += bytes;
+			continue;
+		}
+
+		// a single mip shimmers when minified: the worker builds the chain, if it fits the CPU
+		// budget.  Its memory is counted from now on, so the next texture sees it taken.
+		if (result.Type == JobType::Open && stream.Desc.MipLevels == 1)
+		{
+			UINT64 chainBytes = GeneratedMipBytes(stream);
+			if (chainBytes != 0 && (mBudget == nullptr || mBudget->Fits(MemoryBudget::Pool::Cpu, chainBytes)))
+			{
+				TrackMemory(stream, stream.Unpacked.capacity() + chainBytes);
+
+				Job generate;
+				generate.Type = JobType::Generate;
+				generate.Target = result.Target;
+				Post(generate);
+				continue;
+			}
+
+			if (chainBytes != 0)
+			{
+				std::wstring text = L"TextureStreamer: no memory for the mips of " + stream.Filename + L"\n";
+				OutputDebugStringW(text.c_str());
+			}
+		}
+
+		TrackMemory(stream, stream.Unpacked.capacity() + stream.GeneratedMips.capacity());
+
+		// the full mip chain, filled from the tail up.
+		if (mAllocator != nullptr)
+		{
+			ThrowIfFailed(mAllocator->CreateResource(GpuMemoryAllocator::Category::Texture,
+				stream.Desc, D3D12_RESOURCE_STATE_COMMON, nullptr, stream.Resource));
+		}
+		else
+		{
+			CD3DX12_HEAP_PROPERTIES defaultHeap(D3D12_HEAP_TYPE_DEFAULT);
+			ThrowIfFailed(mDevice->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE,
+				&stream.Desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(stream.Resource.GetAddressOf())));
+		}
+
+		// its heap holds published textures: it is evicted with them, never under a copy.
+		if (mResidency != nullptr)
+			mResidency->Track(stream.Resource.Get(), 0);
+
+		UINT mipLevels = stream.Desc.MipLevels;
+		stream.TailMip = mipLevels - 1;
+		while (stream.TailMip > 0 && MipSize(stream, stream.TailMip - 1) <= TailSize)
+			--stream.TailMip;
+
+		stream.ResidentMip = mipLevels;
+		stream.LoadingMip = stream.TailMip;
+
+		// the tail goes ahead of every other read.
+		Job read;
+		read.Type = JobType::Read;
+		read.Target = result.Target;
+		read.FirstMip = stream.TailMip;
+		read.LastMip = mipLevels;
+		++mReadsInFlight;
+		Post(read);
+	}
+
+	// publish the copies that have completed.
+	UINT64 waitFence = 0;
+	for (auto it = mStreams.begin(); it != mStreams.end(); )
+	{
+		Stream& stream = *it->second;
+		if (stream.CopyFence == 0 || !mCopyQueue->IsComplete(stream.CopyFence))
+		{
+			++it;
+			continue;
+		}
+
+		waitFence = std::max(waitFence, stream.CopyFence);
+		stream.CopyFence = 0;
+		stream.ResidentMip = stream.LoadingMip;
+
+		stream.Tex->Resource = stream.Resource;
+		stream.Tex->ResidentMip = stream.ResidentMip;
+		stream.Published = true;
+		changed.push_back(stream.Tex);
+
+		// fully loaded: the mapping is not needed any more.
+		if (stream.ResidentMip == 0)
+		{
+			TrackMemory(stream, 0);
+			it = mStreams.erase(it);
+		}
+		else
+			++it;
+	}
+
+	// already complete on the CPU timeline; orders the consumer's reads after the copies on the GPU.
+	if (waitFence != 0)
+		mCopyQueue->GpuWait(queue, waitFence);
+
+	// record as many read mips as the frame's upload budget allows, at least one.
+	std::vector<Stream*> recorded;
+	UINT64 bytes = 0;
+	while (!mReadyReads.empty())
+	{
+		const Job& read = mReadyReads.front();
+		UINT64 cost = MipBytes(*read.Target, read.FirstMip, read.LastMip);
+		if (!recorded.empty() && bytes + cost > mBytesPerFrame)
+			break;
+
+		if (recorded.empty())
+			mCopyQueue->Begin();
+
+		// resident before the batch is submitted, and held so until it completes.
+		if (mResidency != nullptr)
+			mResidency->MarkCopied(read.Target->Resource.Get(), mCopyQueue->NextValue());
+
+		RecordUpload(read);
+		recorded.push_back(read.Target.get());
+		bytes += cost;
+
+		--mReadsInFlight;
+		mReadyReads.pop_front();
+	}
+
+	if (!recorded.empty())
+	{
+		UINT64 fence = mCopyQueue->Submit();
+		for (Stream* stream : recorded)
+			stream->CopyFence = fence;
+
+		mBytesUploaded += bytes;
+	}
+
+	ScheduleReads();
+
+	// screen sizes are requested anew every frame.
+	for (auto& elem : mStreams)
+		elem.second->ScreenSize = 0.0f;
+}
+
+void TextureStreamer::ScheduleReads()
+{
+	struct Candidate
+	{
+		Stream* Target;
+		UINT Gap;			// mips between the resident and the wanted one
+	};
+
+	std::vector<Candidate> candidates;
+	for (auto& elem : mStreams)
+	{
+		Stream& stream = *elem.second;
+
+		// one read or copy at a time per texture, and only after its tail.
+		if (stream.LoadingMip != stream.ResidentMip || stream.ResidentMip > stream.TailMip)
+			continue;
+
+		UINT wanted = stream.TailMip;
+		while (wanted > 0 && (float)MipSize(stream, wanted) < stream.ScreenSize)
+			--wanted;
+
+		if (wanted < stream.ResidentMip)
+			candidates.push_back({ &stream, stream.ResidentMip - wanted });
+	}
+
+	// the textures that are blurriest on screen first, then the ones covering more pixels.
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+	{
+		if (a.Gap != b.Gap)
+			return a.Gap > b.Gap;
+		return a.Target->ScreenSize > b.Target->ScreenSize;
+	});
+
+	for (const Candidate& candidate : candidates)
+	{
+		if (mReadsInFlight >= MaxReadsInFlight)
+			break;
+
+		Stream& stream = *candidate.Target;
+		stream.LoadingMip = stream.ResidentMip - 1;
+
+		Job read;
+		read.Type = JobType::Read;
+		read.Target = mStreams[stream.Tex];
+		read.FirstMip = stream.LoadingMip;
+		read.LastMip = stream.ResidentMip;
+		++mReadsInFlight;
+		Post(read);
+	}
+}
+
+void TextureStreamer::RecordUpload(const Job& read)
+{
+	Stream& stream = *read.Target;
+	ID3D12GraphicsCommandList* cmdList = mCopyQueue->CommandList();
+
+	// only the subresources being written change state: the consumer queue keeps sampling the
+	// resident mips (which the SRV clamp keeps it to) while the copy queue fills the next one.
+	UINT mipLevels = stream.Desc.MipLevels;
+	UINT mipCount = read.LastMip - read.FirstMip;
+
+	std::vector<D3D12_RESOURCE_BARRIER> toCopy;
+	std::vector<D3D12_RESOURCE_BARRIER> toCommon;
+	for (UINT slice = 0; slice < stream.Desc.DepthOrArraySize; ++slice)
+	{
+		for (UINT mip = read.FirstMip; mip < read.LastMip; ++mip)
+		{
+			UINT subresource = D3D12CalcSubresource(mip, slice, 0, mipLevels, stream.Desc.DepthOrArraySize);
+			toCopy.push_back(CD3DX12_RESOURCE_BARRIER::Transition(stream.Resource.Get(),
+				D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST, subresource));
+			toCommon.push_back(CD3DX12_RESOURCE_BARRIER::Transition(stream.Resource.Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON, subresource));
+		}
+	}
+
+	cmdList->ResourceBarrier((UINT)toCopy.size(), toCopy.data());
+
+	for (UINT slice = 0; slice < stream.Desc.DepthOrArraySize; ++slice)
+	{
+		UINT first = D3D12CalcSubresource(read.FirstMip, slice, 0, mipLevels, stream.Desc.DepthOrArraySize);
+		mCopyQueue->Staging().UploadSubresources(cmdList, stream.Resource.Get(), first, mipCount,
+			&stream.Subresources[first]);
+	}
+
+	cmdList->ResourceBarrier((UINT)toCommon.size(), toCommon.data());
+}
+
+bool TextureStreamer::GenerateMipChain(Stream& stream)
+{
+	MipSource source;
+	if (!GetMipSource(stream.Desc.Format, source))
+		return false;
+
+	UINT width = (UINT)stream.Desc.Width;
+	UINT height = stream.Desc.Height;
+	UINT mipLevels = FullMipCount(width, height);
+	UINT slices = stream.Desc.DepthOrArraySize;
+	if (mipLevels == 1)
+		return false;
+
+	// a block-compressed file gets its chain encoded back to its own format, so the texture
+	// keeps its 4 or 8 bits per texel instead of growing to RGBA8's 32.  The Fast tier keeps
+	// the worker's time per texture close to that of the decode and the filter; BC6H has no
+	// encoder and stays RGBA16F.
+	bool encode = source.Compressed && CanEncode(source.Blocks);
+	UINT blockBytes = encode ? BlockBytes(source.Blocks) : 0;
+
+	// one slice's chain in texels (the output itself unless it is encoded), rows unpadded.
+	UINT texelBytes = (source.Format == MipFormat::RGBA16F) ? 8 : 4;
+	std::vector<MipImage> chain(mipLevels);
+	size_t chainSize = 0;
+	for (UINT mip = 0; mip < mipLevels; ++mip)
+	{
+		chain[mip].Width = std::max(width >> mip, 1u);
+		chain[mip].Height = std::max(height >> mip, 1u);
+		chain[mip].RowPitch = (size_t)chain[mip].Width * texelBytes;
+		chainSize += chain[mip].RowPitch * chain[mip].Height;
+	}
+
+	// every level of every slice packed back to back: rows of texels, or rows of blocks.
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(mipLevels * slices);
+	size_t size = 0;
+	for (UINT i = 0; i < subresources.size(); ++i)
+	{
+		const MipImage& level = chain[i % mipLevels];
+		size_t rowPitch = encode ? (size_t)((level.Width + 3) / 4) * blockBytes : level.RowPitch;
+		size_t rows = encode ? (level.Height + 3) / 4 : level.Height;
+		subresources[i].RowPitch = (LONG_PTR)rowPitch;
+		subresources[i].SlicePitch = (LONG_PTR)(rowPitch * rows);
+		size += rowPitch * rows;
+	}
+
+	stream.GeneratedMips.resize(size);
+	size_t offset = 0;
+	for (auto& subresource : subresources)
+	{
+		subresource.pData = stream.GeneratedMips.data() + offset;
+		offset += (size_t)subresource.SlicePitch;
+	}
+
+	std::vector<uint8_t> texels(encode ? chainSize : 0);
+	for (UINT slice = 0; slice < slices; ++slice)
+	{
+		D3D12_SUBRESOURCE_DATA* out = &subresources[slice * mipLevels];
+		uint8_t* data = texels.data();
+		for (UINT mip = 0; mip < mipLevels; ++mip)
+		{
+			chain[mip].Data = encode ? data : const_cast<void*>(out[mip].pData);
+			data += chain[mip].RowPitch * chain[mip].Height;
+		}
+
+		const D3D12_SUBRESOURCE_DATA& top = stream.Subresources[slice];
+		if (source.Compressed)
+		{
+			DecodeBlocks(source.Blocks, top.pData, (size_t)top.RowPitch, width, height, chain[0].Data, chain[0].RowPitch);
+		}
+		else
+		{
+			for (UINT y = 0; y < height; ++y)
+			{
+				memcpy(static_cast<uint8_t*>(chain[0].Data) + chain[0].RowPitch * y,
+					static_cast<const uint8_t*>(top.pData) + top.RowPitch * y, chain[0].RowPitch);
+			}
+		}
+
+		GenerateMips(source.Format, GeneratedMipFilter, source.Srgb, chain.data(), mipLevels);
+
+		if (encode)
+		{
+			// the file's own blocks stay the top level; only the generated levels are encoded.
+			size_t blockRows = (height + 3) / 4;
+			for (size_t y = 0; y < blockRows; ++y)
+			{
+				memcpy(static_cast<uint8_t*>(const_cast<void*>(out[0].pData)) + out[0].RowPitch * y,
+					static_cast<const uint8_t*>(top.pData) + top.RowPitch * y, (size_t)out[0].RowPitch);
+			}
+
+			for (UINT mip = 1; mip < mipLevels; ++mip)
+			{
+				EncodeBlocks(source.Blocks, EncodeQuality::Fast, chain[mip].Data, chain[mip].RowPitch,
+					chain[mip].Width, chain[mip].Height, const_cast<void*>(out[mip].pData), (size_t)out[mip].RowPitch);
+			}
+		}
+	}
+
+	stream.Subresources.swap(subresources);
+	stream.Desc.MipLevels = (UINT16)mipLevels;
+	stream.Desc.Format = encode ? stream.Desc.Format : source.Result;
+	return true;
+}
+
+// what GenerateMipChain allocates: the chain of every slice, and the texels of one slice's
+// chain while it is encoded.  0 if the texture gets no chain.
+UINT64 TextureStreamer::GeneratedMipBytes(const Stream& stream)const
+{
+	MipSource source;
+	UINT width = (UINT)stream.Desc.Width;
+	UINT height = stream.Desc.Height;
+	UINT mipLevels = FullMipCount(width, height);
+	if (!GetMipSource(stream.Desc.Format, source) || mipLevels == 1)
+		return 0;
+
+	bool encode = source.Compressed && CanEncode(source.Blocks);
+	UINT64 texelBytes = (source.Format == MipFormat::RGBA16F) ? 8 : 4;
+	UINT64 chain = 0;
+	UINT64 texels = 0;
+	for (UINT mip = 0; mip < mipLevels; ++mip)
+	{
+		UINT64 levelWidth = std::max(width >> mip, 1u);
+		UINT64 levelHeight = std::max(height >> mip, 1u);
+		texels += levelWidth * levelHeight * texelBytes;
+		chain += encode ? ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * BlockBytes(source.Blocks) :
+			levelWidth * levelHeight * texelBytes;
+	}
+	return chain * stream.Desc.DepthOrArraySize + (encode ? texels : 0);
+}
+
+void TextureStreamer::TrackMemory(Stream& stream, UINT64 bytes)
+{
+	if (mBudget != nullptr)
+	{
+		mBudget->Untrack(MemoryBudget::Pool::Cpu, MemoryBudget::Category::Texture, stream.TrackedBytes);
+		mBudget->Track(MemoryBudget::Pool::Cpu, MemoryBudget::Category::Texture, bytes);
+	}
+	stream.TrackedBytes = bytes;
+}
+
+UINT TextureStreamer::MipSize(const Stream& stream, UINT mip)const
+{
+	UINT width = std::max((UINT)(stream.Desc.Width >> mip), 1u);
+	UINT height = std::max(stream.Desc.Height >> mip, 1u);
+	return std::max(width, height);
+}
+
+UINT64 TextureStreamer::MipBytes(const Stream& stream, UINT firstMip, UINT lastMip)const
+{
+	UINT64 bytes = 0;
+	for (UINT slice = 0; slice < stream.Desc.DepthOrArraySize; ++slice)
+	{
+		for (UINT mip = firstMip; mip < lastMip; ++mip)
+			bytes += stream.Subresources[slice * stream.Desc.MipLevels + mip].SlicePitch;
+	}
+	return bytes;
+}
+
+void TextureStreamer::Post(const Job& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back(job);
+	}
+	mWake.notify_one();
+}
+
+void TextureStreamer::WorkerMain()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWake.wait(lock, [this]() { return mQuit || !mJobs.empty(); });
+			if (mQuit)
+				return;
+
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+
+		if (!job.Target->Cancelled)
+			Execute(job);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mResults.push_back(std::move(job));
+	}
+}
+
+void TextureStreamer::Execute(Job& job)
+{
+	Stream& stream = *job.Target;
+
+	if (job.Type == JobType::Open)
+	{
+		// the archive first: an uncompressed entry is used in place, a compressed one unpacked.
+		UINT32 entry = mArchive != nullptr ? mArchive->Find(stream.Filename.c_str()) : AssetArchive::NotFound;
+		if (entry != AssetArchive::NotFound)
+		{
+			if (!mArchive->Map(entry, stream.Contents))
+			{
+				if (!mArchive->Read(entry, stream.Unpacked))
+				{
+					stream.Status = HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+					return;
+				}
+				stream.Contents.Data = stream.Unpacked.data();
+				stream.Contents.Size = stream.Unpacked.size();
+			}
+		}
+		else
+		{
+			// a file that cannot be mapped, or is too large to keep mapped while it streams, is
+			// loaded in chunks by the main thread instead (which reports a missing file).
+			if (!stream.File.Open(stream.Filename.c_str()) || stream.File.Size() > ChunkedFileSize ||
+				stream.File.Size() > SIZE_MAX)
+			{
+				stream.File.Close();
+				stream.Chunked = true;
+				return;
+			}
+			stream.Contents.Data = stream.File.Data();
+			stream.Contents.Size = (size_t)stream.File.Size();
+		}
+
+		stream.Status = DirectX::GetDDSTextureLayout12(stream.Contents.Data, stream.Contents.Size,
+			stream.Desc, stream.Subresources);
+		return;
+	}
+
+	// the mip chain of a single mip file (posted by Update if it fits); the file is done with.
+	if (job.Type == JobType::Generate)
+	{
+		if (GenerateMipChain(stream))
+		{
+			stream.File.Close();
+			stream.Contents = ArchiveSpan();
+			std::vector<uint8_t>().swap(stream.Unpacked);
+		}
+		return;
+	}
+
+	// generated and unpacked mips are in memory already.
+	if (!stream.GeneratedMips.empty() || !stream.Unpacked.empty())
+		return;
+
+	// page the mips in here, so the main thread's copy into staging memory does not fault on
+	// the disk: one byte per page is enough.
+	const size_t pageSize = 4096;
+	volatile uint8_t sink = 0;
+	for (UINT slice = 0; slice < stream.Desc.DepthOrArraySize; ++slice)
+	{
+		for (UINT mip = job.FirstMip; mip < job.LastMip; ++mip)
+		{
+			const D3D12_SUBRESOURCE_DATA& data = stream.Subresources[slice * stream.Desc.MipLevels + mip];
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.pData);
+			size_t size = (size_t)data.SlicePitch;
+
+			if (stream.File.Data() != nullptr)
+				stream.File.Prefetch((UINT64)(bytes - stream.File.Data()), size);
+			else if (mArchive != nullptr)
+				mArchive->Prefetch({ bytes, size });
+			for (size_t offset = 0; offset < size; offset += pageSize)
+				sink = sink + bytes[offset];
+			if (size > 0)
+				sink = sink + bytes[size - 1];
+		}
+	}
+}
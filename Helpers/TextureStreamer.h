@@ -0,0 +1,181 @@
+//***************************************************************************************
+// TextureStreamer.h
+//
+// Loads DDS textures in the background and a few mips at a time, so startup does not
+// wait for texture data and its cost does not grow with texture sizes.  A worker thread
+// maps the file, parses the header and pages the mips in; the main thread creates the
+// resource with its full mip chain, copies the mips that have been read through the copy
+// queue (a bounded number of bytes per frame) and publishes them by lowering the
+// texture's ResidentMip, which the SRV uses as its ResourceMinLODClamp.
+//
+// The mip tail (every mip no larger than TailSize, or the last mip) comes first, so a
+// texture becomes usable almost at once; after that one more detailed mip is loaded at
+// a time, for the textures furthest from the size they cover on screen first.  Until
+// the tail has landed a texture has no Resource and should be bound as a null SRV.
+//
+// Files stored with a single mip get a full chain generated on the worker (MipGenerator).
+// Block-compressed ones are decoded first and the generated levels encoded back to the
+// file's format (BlockEncoder, Fast tier); BC6H, which has no encoder, ends up RGBA16F.
+// They then stream like any other texture, only from memory.  With a memory budget set
+// (SetBudget) the chain is optional content: it is only built if its memory Fits() the
+// CPU budget, and the texture keeps its single mip otherwise.
+//
+// A loose file that cannot be mapped, or is larger than ChunkedFileSize, does not stream:
+// the main thread reads it in chunks with constant memory (CreateDDSTextureFromFileChunked12)
+// and publishes all its mips at once.
+//
+// With an archive set (SetArchive), files packed into it are read from there: an
+// uncompressed entry streams from the archive's mapping like a file of its own, a
+// compressed one is unpacked on the worker and streams from memory.
+//
+// The CPU memory the streams hold (unpacked entries, generated mips, the chunk buffers of
+// a chunked load while it runs) is tracked with the budget as Texture memory.
+//
+// With a residency manager set (SetResidency), every resource is tracked from the moment
+// it is created and each batch of mips copied into it is stamped with its copy queue
+// fence value, so its heap is not evicted while the copy queue writes to it.  Once
+// published the resource belongs to the texture: whoever releases it untracks it.
+//
+// All methods are called from the main thread.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "AssetArchive.h"
+#include "CopyQueue.h"
+#include "ResidencyManager.h"
+#include "MappedFile.h"
+#include "MemoryBudget.h"
+#include "MipGenerator.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class TextureStreamer
+{
+public:
+	static const UINT TailSize = 64;					// texels; mips up to this size form the tail
+	static const UINT MaxReadsInFlight = 4;				// mip reads queued on the worker
+	static const MipFilter GeneratedMipFilter = MipFilter::Kaiser;	// for files without mips
+	static const UINT64 ChunkedFileSize = 1024ull * 1024 * 1024;		// larger loose files are not mapped
+
+public:
+	TextureStreamer(ID3D12Device* device, GpuMemoryAllocator* allocator, CopyQueue* copyQueue,
+		UINT64 bytesPerFrame = 2 * 1024 * 1024);
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer();
+
+	// Files found in 'archive' are read from it instead of from disk; set before the first
+	// Load.  The archive stays open while the streamer is in use.
+	void SetArchive(const AssetArchive* archive) { mArchive = archive; }
+
+	// Tracks the resources the streamer creates (see above); set before the first Update.
+	// The manager must outlive the streamer.
+	void SetResidency(ResidencyManager* residency) { mResidency = residency; }
+
+	// Tracks the streams' CPU memory and holds generated mip chains to the CPU budget (see
+	// above); set before the first Load.  The budget must outlive the streamer.
+	void SetBudget(MemoryBudget* budget) { mBudget = budget; }
+
+	// Starts streaming tex->Filename into 'tex'.  tex->Resource is created (and the
+	// texture reported by Update) once its mip tail is on the GPU.
+	void Load(Texture* tex);
+
+	// Stops streaming into 'tex'.  Copies to tex->Resource may still be executing: 'queue'
+	// is made to wait for them, so the resource can be retired against a fence value of
+	// 'queue' signaled after this call.
+	void Unload(Texture* tex, ID3D12CommandQueue* queue);
+
+	// 'tex' covers about 'pixels' screen pixels across this frame; the most detailed mip
+	// worth loading is the smallest one that still has that many texels.  Textures not
+	// requested in a frame keep what they have and stop loading more.
+	void RequestScreenSize(Texture* tex, float pixels);
+
+	// Once per frame: records the uploads of the mips the worker has read, submits them,
+	// and publishes the mips whose copies have completed.  'queue' (the consumer) waits
+	// on the GPU for those copies.  'changed' receives the textures whose Resource or
+	// ResidentMip changed; their SRVs need to be rewritten.
+	void Update(ID3D12CommandQueue* queue, std::vector<Texture*>& changed);
+
+	UINT PendingCount()const { return (UINT)mStreams.size(); }		// textures not fully loaded yet
+	UINT64 BytesUploaded()const { return mBytesUploaded; }
+
+private:
+	struct Stream
+	{
+		Texture* Tex = nullptr;
+		std::wstring Filename;
+
+		// written by the worker before it posts the Opened result, read-only afterwards
+		MappedFile File;						// a loose file (not in the archive)
+		ArchiveSpan Contents;					// the DDS file: in File, the archive or Unpacked
+		std::vector<uint8_t> Unpacked;			// a compressed archive entry, decompressed
+		D3D12_RESOURCE_DESC Desc = {};
+		std::vector<D3D12_SUBRESOURCE_DATA> Subresources;
+		std::vector<uint8_t> GeneratedMips;		// what Subresources point to when the file had no mips
+		bool Chunked = false;					// not mapped: loaded whole by CreateDDSTextureFromFileChunked12
+		HRESULT Status = S_OK;
+
+		std::atomic<bool> Cancelled;
+
+		// main thread only
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;	// handed to Tex once the tail is resident
+		bool Published = false;
+		UINT TailMip = 0;
+		UINT ResidentMip = 0;			// mips >= ResidentMip are on the GPU (MipLevels: none)
+		UINT LoadingMip = 0;			// mips >= LoadingMip are read, being read or copied
+		float ScreenSize = 0.0f;		// largest size requested this frame, in pixels
+		UINT64 CopyFence = 0;			// copy queue value that makes [LoadingMip, ResidentMip) resident
+		UINT64 TrackedBytes = 0;		// CPU memory tracked with the budget
+
+		Stream() : Cancelled(false) {}
+	};
+
+	enum class JobType { Open, Generate, Read };
+
+	struct Job
+	{
+		JobType Type = JobType::Open;
+		std::shared_ptr<Stream> Target;
+		UINT FirstMip = 0;				// Read: the mips [FirstMip, LastMip)
+		UINT LastMip = 0;
+	};
+
+	void WorkerMain();
+	void Execute(Job& job);
+	void Post(const Job& job);
+	void RecordUpload(const Job& read);
+	void ScheduleReads();
+	bool GenerateMipChain(Stream& stream);
+	UINT64 GeneratedMipBytes(const Stream& stream)const;
+	void TrackMemory(Stream& stream, UINT64 bytes);
+
+	UINT MipSize(const Stream& stream, UINT mip)const;
+	UINT64 MipBytes(const Stream& stream, UINT firstMip, UINT lastMip)const;
+
+private:
+	ID3D12Device* mDevice = nullptr;
+	GpuMemoryAllocator* mAllocator = nullptr;
+	CopyQueue* mCopyQueue = nullptr;
+	const AssetArchive* mArchive = nullptr;
+	ResidencyManager* mResidency = nullptr;
+	MemoryBudget* mBudget = nullptr;
+	UINT64 mBytesPerFrame = 0;
+	UINT64 mBytesUploaded = 0;
+
+	std::unordered_map<Texture*, std::shared_ptr<Stream>> mStreams;
+	std::deque<Job> mReadyReads;		// read by the worker, waiting for upload budget
+	UINT mReadsInFlight = 0;			// posted to the worker or waiting in mReadyReads
+
+	// worker thread and the queues shared with it (guarded by mMutex)
+	std::thread mWorker;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::deque<Job> mJobs;
+	std::deque<Job> mResults;
+	bool mQuit = false;
+};
@@ -3,13 +3,19 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "WriteCombined.h"
+#include "GpuMemoryAllocator.h"
+#include <new>
 
 template<typename T>
 class UploadBuffer
 {
 public:
-    UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer) : 
-        mIsConstantBuffer(isConstantBuffer)
+    // With an allocator the buffer is placed in one of its upload heaps, otherwise it is
+    // a committed resource.
+    UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer,
+        GpuMemoryAllocator* allocator = nullptr) : 
+        mIsConstantBuffer(isConstantBuffer), mAllocator(allocator)
     {
         //mElementByteSize = sizeof(T);
 
@@ -29,15 +35,31 @@ public:
             mElementByteSize = sizeof(T);
         }
 
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,  
-            &CD3DX12_RESOURCE_DESC::Buffer(mElementByteSize*elementCount),
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&mUploadBuffer)));
+        if(mAllocator != nullptr)
+        {
+            ThrowIfFailed(mAllocator->CreateResource(
+                GpuMemoryAllocator::Category::UploadBuffer,
+                CD3DX12_RESOURCE_DESC::Buffer(mElementByteSize*elementCount),
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                mUploadBuffer));
+        }
+        else
+        {
+            ThrowIfFailed(device->CreateCommittedResource(
+                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+                D3D12_HEAP_FLAG_NONE,  
+                &CD3DX12_RESOURCE_DESC::Buffer(mElementByteSize*elementCount),
+			    D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(&mUploadBuffer)));
+        }
 
         ThrowIfFailed(mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
+        mMappedByteSize = (size_t)mElementByteSize*elementCount;
+
+        // validation mode: no CPU access outside of the write APIs below.
+        mProtection = WriteCombined::Protect(mMappedData, mMappedByteSize);
 
         // We do not need to unmap until we are done with the resource.  However, we must not write to
         // the resource while it is in use by the GPU (so we must use synchronization techniques).
@@ -48,8 +70,14 @@ public:
     ~UploadBuffer()
     {
         if(mUploadBuffer != nullptr)
+        {
+            WriteCombined::Unprotect(mMappedData, mMappedByteSize, mProtection);
             mUploadBuffer->Unmap(0, nullptr);
 
+            if(mAllocator != nullptr)
+                mAllocator->Release(mUploadBuffer);
+        }
+
         mMappedData = nullptr;
     }
 
@@ -58,15 +86,68 @@ public:
         return mUploadBuffer.Get();
     }
 
+    // Single element write.  Prefer CopyRange/WriteBatch for more than a couple of elements:
+    // a lone sizeof(T) memcpy usually leaves partially written 64-byte lines behind.
     void CopyData(int elementIndex, const T& data)
     {
+        WriteCombined::WriteScope scope(mMappedData, mMappedByteSize, mProtection);
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // Copies 'count' consecutive elements with streaming stores.  'src' must already be laid
+    // out with ElementByteSize() stride (i.e. padded to 256 bytes for constant buffers).
+    void CopyRange(int firstElement, int count, const void* src)
+    {
+        assert(firstElement >= 0 && (size_t)(firstElement + count)*mElementByteSize <= mMappedByteSize);
+
+        WriteCombined::WriteScope scope(mMappedData, mMappedByteSize, mProtection);
+        WriteCombined::StreamCopy(&mMappedData[firstElement*mElementByteSize], src, (size_t)count*mElementByteSize);
+    }
+
+    // Writes 'count' consecutive elements produced by fill(int elementIndex, T& element).
+    // Elements are built in a small cache-resident chunk with the buffer's stride and
+    // streamed out a chunk at a time, so the caller needs no padded staging array of its own.
+    template<typename Fn>
+    void WriteBatch(int firstElement, int count, Fn fill)
+    {
+        assert(firstElement >= 0 && (size_t)(firstElement + count)*mElementByteSize <= mMappedByteSize);
+
+        alignas(64) BYTE chunk[BatchChunkByteSize];
+        const int chunkElements = (int)(BatchChunkByteSize / mElementByteSize);
+
+        // padding bytes of constant buffer elements are never read; zero them once anyway.
+        memset(chunk, 0, sizeof(chunk));
+
+        WriteCombined::WriteScope scope(mMappedData, mMappedByteSize, mProtection);
+        for(int first = firstElement; first < firstElement + count; first += chunkElements)
+        {
+            int n = std::min(chunkElements, firstElement + count - first);
+            for(int i = 0; i < n; ++i)
+            {
+                T* element = new(&chunk[i*mElementByteSize]) T();
+                fill(first + i, *element);
+            }
+
+            WriteCombined::StreamCopy(&mMappedData[first*mElementByteSize], chunk, (size_t)n*mElementByteSize);
+        }
+    }
+
+    UINT ElementByteSize()const
+    {
+        return mElementByteSize;
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
+    size_t mMappedByteSize = 0;
+    DWORD mProtection = 0;          // of the mapping while it is protected (WriteCombined::Protect)
+
+    // big enough for at least one element at constant buffer stride.
+    static const size_t BatchChunkByteSize =
+        ((sizeof(T) + 255) & ~(size_t)255) > 4096 ? ((sizeof(T) + 255) & ~(size_t)255) : 4096;
 
     UINT mElementByteSize = 0;
     bool mIsConstantBuffer = false;
+    GpuMemoryAllocator* mAllocator = nullptr;
 };
\ No newline at end of file
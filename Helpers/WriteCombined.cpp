@@ -0,0 +1,117 @@
+//***************************************************************************************
+// WriteCombined.cpp
+//***************************************************************************************
+
+#include "WriteCombined.h"
+#include "d3dUtil.h"
+#include <cstring>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define WRITECOMBINED_SSE2
+#endif
+
+bool WriteCombined::sValidation = false;
+
+void WriteCombined::StreamCopy(void* dest, const void* src, size_t byteSize)
+{
+#ifdef WRITECOMBINED_SSE2
+	BYTE* d = static_cast<BYTE*>(dest);
+	const BYTE* s = static_cast<const BYTE*>(src);
+
+	// head: plain stores up to the first 64-byte line boundary of the destination, so the
+	// streaming stores below fill whole lines instead of straddling two.
+	size_t head = (64 - (reinterpret_cast<uintptr_t>(d) & 63)) & 63;
+	if (head > byteSize)
+		head = byteSize;
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	byteSize -= head;
+
+	// body: whole 64-byte lines, four 16-byte streaming stores each.
+	while (byteSize >= 64)
+	{
+		__m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+		__m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+		__m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+		__m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), r0);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), r1);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), r2);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), r3);
+		d += 64;
+		s += 64;
+		byteSize -= 64;
+	}
+
+	while (byteSize >= 16)
+	{
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+		d += 16;
+		s += 16;
+		byteSize -= 16;
+	}
+
+	// tail: less than 16 bytes of the last, partial line.
+	memcpy(d, s, byteSize);
+
+	// streaming stores are weakly ordered; make them visible before the caller signals the GPU.
+	_mm_sfence();
+#else
+	memcpy(dest, src, byteSize);
+#endif
+}
+
+void WriteCombined::SetValidation(bool enable)
+{
+	sValidation = enable;
+}
+
+bool WriteCombined::Validation()
+{
+	return sValidation;
+}
+
+DWORD WriteCombined::Protect(void* mappedData, size_t byteSize)
+{
+	if (!sValidation || mappedData == nullptr)
+		return 0;
+
+	DWORD oldProtect = 0;
+	if (!VirtualProtect(mappedData, byteSize, PAGE_NOACCESS, &oldProtect))
+	{
+		// some drivers map upload heaps in a way that cannot be reprotected; keep going unvalidated.
+		OutputDebugStringW(L"WriteCombined: VirtualProtect failed, upload memory is not validated.\n");
+		return 0;
+	}
+	return oldProtect;
+}
+
+bool WriteCombined::Unprotect(void* mappedData, size_t byteSize, DWORD protection)
+{
+	if (protection == 0 || mappedData == nullptr)
+		return true;
+
+	DWORD oldProtect = 0;
+	if (!VirtualProtect(mappedData, byteSize, protection, &oldProtect))
+	{
+		OutputDebugStringW(L"WriteCombined: VirtualProtect failed to restore access to upload memory.\n");
+		return false;
+	}
+	return true;
+}
+
+WriteCombined::WriteScope::WriteScope(void* mappedData, size_t byteSize, DWORD& protection)
+	: mMappedData(mappedData), mByteSize(byteSize), mProtection(protection)
+{
+	if (!Unprotect(mMappedData, mByteSize, mProtection))
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+}
+
+WriteCombined::WriteScope::~WriteScope()
+{
+	// 0 if it cannot be protected again: the range is then left open and unvalidated.
+	mProtection = Protect(mMappedData, mByteSize);
+}
@@ -0,0 +1,62 @@
+//***************************************************************************************
+// WriteCombined.h
+//
+// Helpers for writing to mapped upload heap memory.  Upload heaps are CPU write-combined:
+// writes are gathered in a few 64-byte buffers and sent over the bus when a line is
+// complete, while reads are uncached and very slow.  Streaming whole 64-byte lines with
+// non-temporal stores avoids partial line flushes and does not pollute the CPU caches.
+//
+// In validation mode the mapped memory of UploadBuffer, FrameRingAllocator and
+// StagingArena is kept PAGE_NOACCESS except while one of their write scopes is open, so any CPU read from (or stray write to) mapped upload memory faults
+// right at the offending instruction.  The protection the mapping had is kept by its
+// owner and restored exactly (upload heaps may be mapped write-combined); a range that
+// cannot be reprotected is left accessible and no longer validated.
+//***************************************************************************************
+
+#pragma once
+
+#include <windows.h>
+#include <cstddef>
+
+class WriteCombined
+{
+public:
+	// Copies byteSize bytes to write-combined memory.  'dest' and 'src' may have any
+	// alignment; the bulk of the data is written as full 64-byte lines with streaming
+	// stores, followed by a store fence so the data is globally visible on return.
+	static void StreamCopy(void* dest, const void* src, size_t byteSize);
+
+	// Set once at startup, before any upload buffer is created.
+	static void SetValidation(bool enable);
+	static bool Validation();
+
+	// Revokes CPU access to a mapped range and returns the protection it had, to be
+	// handed back to Unprotect; 0 if validation is off or the range cannot be reprotected
+	// (it then stays accessible and is not validated).
+	static DWORD Protect(void* mappedData, size_t byteSize);
+
+	// Restores 'protection' as returned by Protect (nothing to do for 0); false if it
+	// could not be restored, in which case the range is still inaccessible.
+	static bool Unprotect(void* mappedData, size_t byteSize, DWORD protection);
+
+	// Opens a mapped range for writing for the lifetime of the scope.  'protection' is the
+	// owner's record of the range's protection (see Protect); the constructor throws if
+	// access cannot be restored, rather than let the writes fault.
+	class WriteScope
+	{
+	public:
+		WriteScope(void* mappedData, size_t byteSize, DWORD& protection);
+		~WriteScope();
+
+		WriteScope(const WriteScope& rhs) = delete;
+		WriteScope& operator=(const WriteScope& rhs) = delete;
+
+	private:
+		void* mMappedData;
+		size_t mByteSize;
+		DWORD& mProtection;
+	};
+
+private:
+	static bool sValidation;
+};
@@ -3,6 +3,7 @@
 //***************************************************************************************
 
 #include "d3dApp.h"
+#include "WriteCombined.h"
 #include <WindowsX.h>
 
 using Microsoft::WRL::ComPtr;
@@ -39,7 +40,10 @@ D3DApp::D3DApp(HINSTANCE hInstance)
 D3DApp::~D3DApp()
 {
 	if(md3dDevice != nullptr)
+	{
 		FlushCommandQueue();
+		mDeferredRelease->ReleaseAll();
+	}
 }
 
 HINSTANCE D3DApp::AppInst()const
@@ -80,6 +84,10 @@ int D3DApp::Run()
  
 	mTimer.Reset();
 
+	mFrameLimiter.SetTargetFrameRate(mTargetFrameRate);
+	mFrameLimiter.Reset(mTimer);
+	bool pacingStale = false;
+
 	SetDlgItemText(mhDialogWnd, IDC_EDIT1, L"0.0");
 
 	while(msg.message != WM_QUIT)
@@ -100,13 +108,35 @@ int D3DApp::Run()
 
 			if( !mAppPaused )
 			{
+				// the time spent paused is not a pacing miss; start a fresh cadence.
+				if( pacingStale )
+				{
+					mFrameLimiter.Reset(mTimer);
+					pacingStale = false;
+				}
+
+				// resize requests of this message batch are coalesced into one resize, and a
+				// request that did not change the client size (moving the window) costs nothing.
+				if( mResizePending )
+				{
+					mResizePending = false;
+					if( mScreenViewport.Width != (float)mClientWidth || mScreenViewport.Height != (float)mClientHeight )
+						OnResize();
+				}
+
 				CalculateFrameStats();
 				Update(mTimer);	
                 Draw(mTimer);
+				mMemoryBudget.EndFrame(mGpuAllocator.get());
+
+				mFrameLimiter.Wait(mTimer);
 			}
 			else
 			{
-				Sleep(100); // check app-paused status in 0.1 sceond
+				// block until a message arrives instead of polling; the 0.1 second
+				// timeout is only a safety net for missed state changes.
+				MsgWaitForMultipleObjects(0, nullptr, FALSE, 100, QS_ALLINPUT);
+				pacingStale = true;
 			}
         }
     }
@@ -154,15 +184,15 @@ void D3DApp::OnResize()
 	assert(mSwapChain);
     assert(mDirectCmdListAlloc);
 
-	// Flush before changing any resources.
-	FlushCommandQueue();
+	// DXGI requires every reference to the back buffers to be gone before ResizeBuffers,
+	// the GPU's included, so the direct queue has to drain: wait for the last frame that
+	// rendered to them.  Unlike FlushCommandQueue this signals nothing new and does not wait
+	// for work on other queues (uploads).  The old depth buffer is idle then as well.
+	mFenceManager.Wait(mFenceManager.LastSignaledValue());
 
-    ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
-
-	// Release the previous resources we will be recreating.
+	mGpuAllocator->Release(mDepthStencilBuffer);
 	for (int i = 0; i < SwapChainBufferCount; ++i)
 		mSwapChainBuffer[i].Reset();
-    mDepthStencilBuffer.Reset();
 	
 	// Resize the swap chain.
     ThrowIfFailed(mSwapChain->ResizeBuffers(
@@ -206,13 +236,14 @@ void D3DApp::OnResize()
     optClear.Format = mDepthStencilFormat;
     optClear.DepthStencil.Depth = 1.0f;
     optClear.DepthStencil.Stencil = 0;
-    ThrowIfFailed(md3dDevice->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-        &depthStencilDesc,
-		D3D12_RESOURCE_STATE_COMMON,
-        &optClear,
-        IID_PPV_ARGS(mDepthStencilBuffer.GetAddressOf())));
+
+	// created directly in the depth write state, so no command list has to run for it.
+	ThrowIfFailed(mGpuAllocator->CreateResource(
+		GpuMemoryAllocator::Category::RenderTarget,
+		depthStencilDesc,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
+		&optClear,
+		mDepthStencilBuffer));
 
     // Create descriptor to mip level 0 of entire resource using the format of the resource.
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
@@ -222,18 +253,6 @@ void D3DApp::OnResize()
 	dsvDesc.Texture2D.MipSlice = 0;
     md3dDevice->CreateDepthStencilView(mDepthStencilBuffer.Get(), &dsvDesc, DepthStencilView());
 
-    // Transition the resource from its initial state to be used as a depth buffer.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mDepthStencilBuffer.Get(),
-		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_DEPTH_WRITE));
-	
-    // Execute the resize commands.
-    ThrowIfFailed(mCommandList->Close());
-    ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
-
-	// Wait until resize is complete.
-	FlushCommandQueue();
-
 	// Update the viewport transform to cover the client area.
 	mScreenViewport.TopLeftX = 0;
 	mScreenViewport.TopLeftY = 0;
@@ -286,7 +305,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				mAppPaused = false;
 				mMinimized = false;
 				mMaximized = true;
-				OnResize();
+				mResizePending = true;
 			}
 			else if( wParam == SIZE_RESTORED )
 			{
@@ -296,7 +315,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				{
 					mAppPaused = false;
 					mMinimized = false;
-					OnResize();
+					mResizePending = true;
 				}
 
 				// Restoring from maximized state?
@@ -304,7 +323,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				{
 					mAppPaused = false;
 					mMaximized = false;
-					OnResize();
+					mResizePending = true;
 				}
 				else if( mResizing )
 				{
@@ -319,7 +338,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				}
 				else // API call such as SetWindowPos or mSwapChain->SetFullscreenState.
 				{
-					OnResize();
+					mResizePending = true;
 				}
 			}
 		}
@@ -344,7 +363,7 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		mAppPaused = false;
 		mResizing  = false;
 		mTimer.Start();
-		OnResize();
+		mResizePending = true;
 		return 0;
  
 	// WM_DESTROY is sent when the window is being destroyed.
@@ -384,6 +403,8 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         else if((int)wParam == VK_F2)
             Set4xMsaaState(!m4xMsaaState);
+		else
+			OnKeyUp(wParam);
 
         return 0;
 	}
@@ -477,6 +498,8 @@ bool D3DApp::InitDirect3D()
 	ThrowIfFailed(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)));
 	debugController->EnableDebugLayer();
 }
+	// Fault on CPU reads from mapped upload heaps (see WriteCombined.h).
+	WriteCombined::SetValidation(true);
 #endif
 
 	ThrowIfFailed(CreateDXGIFactory1(IID_PPV_ARGS(&mdxgiFactory)));
@@ -500,8 +523,10 @@ bool D3DApp::InitDirect3D()
 	}
 
 	// Create Fence object and obtain sizes of associated descriptors
-	ThrowIfFailed(md3dDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE,
-		IID_PPV_ARGS(&mFence)));
+	mFenceManager.Initialize(md3dDevice.Get());
+	mGpuAllocator = std::make_unique<GpuMemoryAllocator>(md3dDevice.Get());
+	mDeferredRelease = std::make_unique<DeferredReleaseQueue>(mGpuAllocator.get());
+	mMemoryBudget.Initialize(md3dDevice.Get(), mdxgiFactory.Get());
 
 	mRtvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);						// Render Target view size
 	mDsvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);						// Depth/Stencil view sizes
@@ -590,26 +615,9 @@ void D3DApp::CreateSwapChain()
 
 void D3DApp::FlushCommandQueue()
 {
-	// Advance the fence value to mark commands up to this fence point.
-    mCurrentFence++;
-
-    // Add an instruction to the command queue to set a new fence point.  Because we 
-	// are on the GPU timeline, the new fence point won't be set until the GPU finishes
-	// processing all the commands prior to this Signal().
-    ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
-
-	// Wait until the GPU has completed commands up to this fence point.
-    if(mFence->GetCompletedValue() < mCurrentFence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-
-        // Fire event when GPU hits current fence.  
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFence, eventHandle));
-
-        // Wait until the GPU hits current fence event is fired.
-		WaitForSingleObject(eventHandle, INFINITE);
-        CloseHandle(eventHandle);
-	}
+	// Set a new fence point after all commands submitted so far and wait until the
+	// GPU has completed commands up to this fence point.
+	mFenceManager.Flush(mCommandQueue.Get());
 }
 
 ID3D12Resource* D3DApp::CurrentBackBuffer()const
@@ -634,7 +642,7 @@ void D3DApp::CalculateFrameStats()
 {
 	// Code computes the average frames per second, and also the 
 	// average time it takes to render one frame.  These stats 
-	// are appended to the window caption bar.
+	// are stored for the derived class to display (text overlay).
     
 	static int frameCnt = 0;
 	static float timeElapsed = 0.0f;
@@ -644,17 +652,9 @@ void D3DApp::CalculateFrameStats()
 	// Compute averages over one second period.
 	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
 	{
-		float fps = (float)frameCnt; // fps = frameCnt / 1
-		float mspf = 1000.0f / fps;
-
-        wstring fpsStr = to_wstring(fps);
-        wstring mspfStr = to_wstring(mspf);
-
-        wstring windowText = mMainWndCaption +
-            L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
-
-        SetWindowText(mhMainWnd, windowText.c_str());
+		mFramesPerSecond = (float)frameCnt; // fps = frameCnt / 1
+		mMillisecondsPerFrame = 1000.0f / mFramesPerSecond;
+		mFenceManager.PublishStats();
 		
 		// Reset for next average.
 		frameCnt = 0;
@@ -17,6 +17,11 @@
 
 #include "d3dUtil.h"
 #include "GameTimer.h"
+#include "FrameLimiter.h"
+#include "FenceManager.h"
+#include "GpuMemoryAllocator.h"
+#include "DeferredReleaseQueue.h"
+#include "MemoryBudget.h"
 #include "../Resource.h"
 
 // Link necessary d3d12 libraries.
@@ -60,6 +65,7 @@ protected:
 	virtual void OnMouseDown(WPARAM btnState, int x, int y){ }
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)  { }
 	virtual void OnMouseMove(WPARAM btnState, int x, int y){ }
+	virtual void OnKeyUp(WPARAM key){ }
 
 protected:
 
@@ -91,6 +97,7 @@ protected:
 	bool      mMinimized = false;  // is the application minimized?
 	bool      mMaximized = false;  // is the application maximized?
 	bool      mResizing = false;   // are the resize bars being dragged?
+	bool      mResizePending = false;  // a resize is applied at the start of the next frame
     bool      mFullscreenState = false;// fullscreen enabled
 
     RECT mWindow;                   // window rectangle represented on the entire screen;
@@ -105,13 +112,26 @@ protected:
 
 	// Used to keep track of the Delta-time and game time (?.4).
 	GameTimer mTimer;
+
+	// Paces the main loop to mTargetFrameRate (sleep, then spin for the last stretch).
+	FrameLimiter mFrameLimiter;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
     Microsoft::WRL::ComPtr<ID3D12Device> md3dDevice;
 
-    Microsoft::WRL::ComPtr<ID3D12Fence> mFence;
-    UINT64 mCurrentFence = 0;
+	// Heaps for placed resources.  Declared before any resource so that it is destroyed
+	// after them: placed resources must not outlive their heap.
+	std::unique_ptr<GpuMemoryAllocator> mGpuAllocator;
+
+	// Objects replaced while frames in flight may still use them, keyed by mFenceManager values.
+	std::unique_ptr<DeferredReleaseQueue> mDeferredRelease;
+
+	// CPU/GPU memory per category against a budget, reported at the end of every frame.
+	MemoryBudget mMemoryBudget;
+
+	// Fence timeline of mCommandQueue, with a reusable wait event and CPU wait statistics.
+	FenceManager mFenceManager;
 	
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> mCommandQueue;                   // representing command queue resource
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;         // representing command allocator resource
@@ -139,6 +159,11 @@ protected:
     DXGI_FORMAT mDepthStencilFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 	int mClientWidth = 1280;
 	int mClientHeight = 720;
+	float mTargetFrameRate = 60.0f;		// 0 renders unbounded
+
+	// Frame statistics computed by CalculateFrameStats, averaged over one second.
+	float mFramesPerSecond = 0.0f;
+	float mMillisecondsPerFrame = 0.0f;
 
     float inheritValue1 = 0.0f;
     bool mStatusChange = false;
@@ -1,10 +1,57 @@
  
 #include "d3dUtil.h"
+#include "AssetArchive.h"
 #include <comdef.h>
+#include <deque>
 #include <fstream>
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+    // Resolves #include "file" in the archive, relative to the directory of the including file.
+    class ArchiveInclude : public ID3DInclude
+    {
+    public:
+        ArchiveInclude(const AssetArchive& archive, const std::string& directory)
+            : mArchive(archive), mSourceDirectory(directory)
+        {
+        }
+
+        HRESULT __stdcall Open(D3D_INCLUDE_TYPE type, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+        {
+            auto parent = mDirectories.find(parentData);
+            std::string name = (parent != mDirectories.end() ? parent->second : mSourceDirectory) + fileName;
+
+            UINT32 entry = mArchive.Find(name.c_str());
+            if (entry == AssetArchive::NotFound)
+                return E_FAIL;
+
+            mFiles.emplace_back();
+            if (!mArchive.Read(entry, mFiles.back()))
+                return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+
+            std::string normalized = mArchive.Name(entry);
+            mDirectories[mFiles.back().data()] = normalized.substr(0, normalized.rfind('/') + 1);
+
+            *data = mFiles.back().data();
+            *bytes = (UINT)mFiles.back().size();
+            return S_OK;
+        }
+
+        HRESULT __stdcall Close(LPCVOID data) override
+        {
+            return S_OK;
+        }
+
+    private:
+        const AssetArchive& mArchive;
+        std::string mSourceDirectory;
+        std::deque<std::vector<uint8_t>> mFiles;                // kept until the compile is done
+        std::unordered_map<LPCVOID, std::string> mDirectories;  // of every file opened
+    };
+}
+
 DxException::DxException(HRESULT hr, const std::wstring& functionName, const std::wstring& filename, int lineNumber) :
     ErrorCode(hr),
     FunctionName(functionName),
@@ -113,6 +160,42 @@ ComPtr<ID3DBlob> d3dUtil::CompileShader(
     return byteCode;
 }
 
+ComPtr<ID3DBlob> d3dUtil::CompileShader(
+    const AssetArchive* archive,
+    const std::wstring& filename,
+    const D3D_SHADER_MACRO* defines,
+    const std::string& entrypoint,
+    const std::string& target)
+{
+    UINT32 entry = archive != nullptr ? archive->Find(filename.c_str()) : AssetArchive::NotFound;
+    if (entry == AssetArchive::NotFound)
+        return CompileShader(filename, defines, entrypoint, target);
+
+    std::vector<uint8_t> source;
+    if (!archive->Read(entry, source))
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT));
+
+    UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)  
+    compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+    std::string name = archive->Name(entry);
+    ArchiveInclude include(*archive, name.substr(0, name.rfind('/') + 1));
+
+    ComPtr<ID3DBlob> byteCode = nullptr;
+    ComPtr<ID3DBlob> errors;
+    HRESULT hr = D3DCompile(source.data(), source.size(), name.c_str(), defines, &include,
+        entrypoint.c_str(), target.c_str(), compileFlags, 0, &byteCode, &errors);
+
+    if (errors != nullptr)
+        OutputDebugStringA((char*)errors->GetBufferPointer());
+
+    ThrowIfFailed(hr);
+
+    return byteCode;
+}
+
 std::wstring DxException::ToString()const
 {
     // Get the string description of the error code.
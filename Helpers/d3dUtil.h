@@ -29,8 +29,10 @@
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
 
+class AssetArchive;
+
 //extern const int gNumFrameResources;
-extern const int gNumFrameBuffers;
+extern int gNumFrameBuffers;			// frames in flight, fixed once the app is initialized
 
 inline void d3dSetDebugName(IDXGIObject* obj, const char* name)
 {
@@ -132,6 +134,15 @@ public:
 		const D3D_SHADER_MACRO* defines,
 		const std::string& entrypoint,
 		const std::string& target);
+
+	// Compiles 'filename' from the archive when it holds it (its #includes are looked up
+	// there too, relative to the including file), from the file otherwise.
+	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
+		const AssetArchive* archive,
+		const std::wstring& filename,
+		const D3D_SHADER_MACRO* defines,
+		const std::string& entrypoint,
+		const std::string& target);
 };
 
 class DxException
@@ -169,9 +180,11 @@ struct MeshGeometry
 	std::string Name;
 
 	// System memory copies.  Use Blobs because the vertex/index format can be generic.
-	// It is up to the client to cast appropriately.  
+	// It is up to the client to cast appropriately.  Only geometry the CPU reads back
+	// (picking, collision) needs them; GPU-only geometry drops them in DisposeUploaders.
 	Microsoft::WRL::ComPtr<ID3DBlob> VertexBufferCPU = nullptr;
 	Microsoft::WRL::ComPtr<ID3DBlob> IndexBufferCPU  = nullptr;
+	bool GpuOnly = true;
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferGPU = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferGPU = nullptr;
@@ -215,6 +228,19 @@ struct MeshGeometry
 	{
 		VertexBufferUploader = nullptr;
 		IndexBufferUploader = nullptr;
+
+		if (GpuOnly)
+		{
+			VertexBufferCPU = nullptr;
+			IndexBufferCPU = nullptr;
+		}
+	}
+
+	// System memory held by the CPU copies.
+	UINT64 CpuByteSize()const
+	{
+		return (VertexBufferCPU ? VertexBufferCPU->GetBufferSize() : 0) +
+			(IndexBufferCPU ? IndexBufferCPU->GetBufferSize() : 0);
 	}
 };
 
@@ -279,6 +305,15 @@ struct Texture
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr; // Resource for texture to be stored
 	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
+
+	// Index of the texture's SRV in the shader-visible descriptor heap (DescriptorAllocator).
+	int SrvHeapIndex = -1;
+
+	// Most detailed mip whose data is on the GPU; the SRV clamps sampling to it (TextureStreamer).
+	UINT ResidentMip = 0;
+
+	// Hash of the file contents (TextureCache); 0 for generated textures.
+	UINT64 ContentHash = 0;
 };
 
 #ifndef ThrowIfFailed
@@ -11,6 +11,18 @@
 #include "./Helpers/MathHelper.h"
 #include "./Helpers/UploadBuffer.h"
 #include "./Helpers/GeometryGenerator.h"
+#include "./Helpers/BoundingVolumeHierarchy.h"
+#include "./Helpers/FrameRingAllocator.h"
+#include "./Helpers/TextOverlay.h"
+#include "./Helpers/CopyQueue.h"
+#include "./Helpers/AssetArchive.h"
+#include "./Helpers/TextureStreamer.h"
+#include "./Helpers/TextureCache.h"
+#include "./Helpers/TextureAtlas.h"
+#include "./Helpers/DDSReader.h"
+#include "./Helpers/MappedFile.h"
+#include "./Helpers/ResidencyManager.h"
+#include "./Helpers/DescriptorAllocator.h"
 #include "FrameBuffer.h"
 
 using Microsoft::WRL::ComPtr;
@@ -21,7 +33,9 @@ using namespace std;
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 
-const int gNumFrameBuffers = 3;			// the size of the circular array to store resources per frame
+int gNumFrameBuffers = 3;				// the size of the circular array to store resources per frame (frames in flight)
+UINT64 gCpuBudget = 0;					// memory envelope from the command line; 0: a share of the machine's memory
+UINT64 gGpuBudget = 0;
 
 const float gravConst = 9.8;			// gravitational acceleration constant (g = 9.8m/s^2 for earh)
 
@@ -34,11 +48,13 @@ public:
 	XMFLOAT4X4 World = MathHelper::Identity4x4();
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
-	int numFrameBufferFill = gNumFrameBuffers;		// for static objects
+	int numFrameBufferFill = gNumFrameBuffers;		// number of frame buffers whose object constants are still stale
 
 	UINT ObjCBIndex = -1;							// object Constant Buffer Index
 	Material* Mat = nullptr;						// Material characteristics assigned to this render item.
 	MeshGeometry* Geo = nullptr;					// Geometry data of this render item.
+	BoundingBox Bounds;								// object space bounds of the submesh (screen size for texture streaming, culling)
+	bool Visible = true;							// in the view frustum this frame: drawn, and its resources used
 	D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
 	// parameters of ID3D12GraphicsCommandList::DrawIndexedInstanced method
@@ -86,6 +102,7 @@ private:
 	virtual void OnMouseDown(WPARAM btnState, int x, int y) override;
 	virtual void OnMouseUp(WPARAM btnState, int x, int y) override;
 	virtual void OnMouseMove(WPARAM btnState, int x, int y) override;
+	virtual void OnKeyUp(WPARAM key) override;
 
 	void UpdateCamera(const GameTimer& gt);						// update the camera position complying mouse input.
 	void UpdateObjectCBs(const GameTimer& gt);					// update object constant buffer.
@@ -97,10 +114,25 @@ private:
 
 	void EulerUpdate(float dt);									// update the pendulum's newtonian equation of motion.				
 
+	// ----- mouse picking -----
+	void SetPickingBvh();										// build the BVH over the pendulum bob bounds.
+	void UpdatePickingBvh();									// refit the BVH to the bobs' current positions.
+	void ComputePickRay(int sx, int sy, XMVECTOR& origin, XMVECTOR& dir);	// world space ray through a screen point.
+	bool PickPendulum(int sx, int sy, UINT& bobIndex);			// find the bob under the mouse pointer.
+	void DragPendulum(int sx, int sy);							// set the pendulum angle so that the bob follows the mouse pointer.
+
 	// ----- preparatory methods -----
 	void PrepareTextures();										// prepare various textures used in drawing a scene.
+	void LoadTexture(const string& name, const wstring& filename);	// stream a texture file in, or share the texture with its contents.
+	vector<pair<string, wstring>> PackSmallTextures(const vector<pair<string, wstring>>& files);	// pack small textures into shared atlas pages; returns the files left out.
+	void RepackSmallTextures(UINT64 lastUseFence);				// reload the packed files into new atlas pages; the old ones go after lastUseFence.
+	void SetDiffuseTexture(Material* mat, const string& texName);	// bind a material to a texture, through its atlas rectangle if it was packed.
 	void SetRootSignature();									// set root signature to notify the shader what resources are going to be used.
 	void SetDescriptorHeaps();									// set shader resource descriptor heap (for textures)
+	void CreateTextureSrv(Texture* tex);						// write the SRV of a texture into a new persistent descriptor slot.
+	void ReplaceTextureSrv(Texture* tex, UINT64 lastUseFence);	// move a texture to a new SRV slot; the old one is freed after lastUseFence.
+	void ReloadTextures();										// reload the texture files and swap them in while frames are in flight.
+	vector<shared_ptr<Texture>> DistinctTextures();				// the textures of mTextures, each once (names may share one).
 	void SetShadersAndInputLayout();							// compile shader hlsl file and set up inputLayout(vertex, index structure).
 	void SetBackgroundGeometry();								// set up the geometry of background(floor, wall, and mirror).
 	void SetPendulumGeometry();									// set up the pendulum geometry composed of a ceiling, a wire, and a ball attached at the end of the wire)
@@ -108,7 +140,11 @@ private:
 	void SetFrameBuffers();										// set frame buffers which carry several rendering resources.
 	void SetMaterials();										// set material properties each to-be-rendered object carries.
 	void SetRenderingItems();									// set up rendering items to be supplied to ID3D12GraphicsCommandList::DrawIndexedInstanced method.
-	void WriteCaption();										// write captions regarding pendulum info.
+	void UpdateOverlay();										// write pendulum info. and frame statistics into the text overlay.
+	void TrackResidency();										// hand the textures and geometry buffers to the residency manager.
+	void CullRenderItems();										// test the render items against the view frustum and a wider one around it.
+	void UpdateResidency();										// mark what this frame uses, then evict/restore within the budget.
+	void UpdateTextureStreaming();								// request texture mips by screen size and swap in the ones that landed.
 	void DrawRenderingItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);		// it really draw a object.
 
 	array<const CD3DX12_STATIC_SAMPLER_DESC, 6> GetStaticSamplers();				// get static samplers used in sampling texture data
@@ -117,19 +153,41 @@ private:
 private:
 	vector<unique_ptr<FrameBuffer>> mFrameBuffers;	// for accesing frame buffer in a circular array format.
 	FrameBuffer* mCurrentFrameBuffer = nullptr;
+
+	vector<RenderItem*> mObjectCBSlots;				// render items indexed by ObjCBIndex
+
+	unique_ptr<CopyQueue> mCopyQueue;				// uploads, executed concurrently with rendering
+	unique_ptr<AssetArchive> mArchive;				// packed textures and shaders (Assets.pak), if present
+	unique_ptr<TextureCache> mTextureCache;			// shares one texture between files with the same contents
+	unique_ptr<TextureStreamer> mTextureStreamer;	// loads the texture files in the background, mip tail first
+	vector<Texture*> mStreamedTextures;				// textures whose mips changed this frame
+	unique_ptr<ResidencyManager> mResidency;		// evicts least recently used textures/geometry over budget
+	unique_ptr<FrameRingAllocator> mFrameAllocator;	// per-frame transient constants and vertices
+	D3D12_GPU_VIRTUAL_ADDRESS mCommonCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS mReflectedCommonCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS mTextVBAddress = 0;
 	int mCurrentFrameBufferIndex = 0;
 
-	UINT mCbvSrvDescriptorSize = 0;					// for caching CB view, SR view descriptor size
 
 	ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
+	unique_ptr<DescriptorAllocator> mDescriptorAllocator;			// shader-visible CBV/SRV/UAV heap
 
 	unordered_map<string, unique_ptr<MeshGeometry>> mGeometries;		// categorize mesh geometries by name.
 	unordered_map<string, unique_ptr<Material>> mMaterials;				// material characteristics categorized by name
-	unordered_map<string, unique_ptr<Texture>> mTextures;				// textues categorized by name
+	unordered_map<string, shared_ptr<Texture>> mTextures;				// textues categorized by name; names with the same file contents share one
+	unordered_map<string, wstring> mTextureFiles;						// the file each streamed texture name was loaded from
+	unordered_map<Material*, string> mMaterialTextures;					// the texture name each material was bound to
+	unordered_map<string, AtlasPlacement> mAtlasPlacements;				// where the textures packed into atlas pages are, by texture name
+	vector<pair<string, wstring>> mAtlasSources;						// names and files of the packed textures
+	vector<shared_ptr<Texture>> mAtlasPages;							// the atlas page textures
+	unordered_map<Material*, pair<string, XMFLOAT4X4>> mAtlasMaterials;	// materials sampling a page: texture name and own MatTransform
 	unordered_map<string, ComPtr<ID3DBlob>> mShaders;					// to store compiled shader in ComPtr with the type ID3DBlob
 	unordered_map<string, ComPtr<ID3D12PipelineState>> mPSOs;			// to store pipeline state object in ComPtr(ID3D12PipelineState)
 
+	TextOverlay mTextOverlay;						// in-scene text/HUD
+	UINT mTextVertexCount = 0;						// number of text vertices written for the current frame
+	int mGlyphAtlasSrvHeapIndex = -1;				// index of the glyph atlas SRV in the descriptor heap
+
 	vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;						// vertex, index buffer format supplied to the Input Assembler.
 
 	// cache rendering items of a pendulum-related objects
@@ -137,11 +195,17 @@ private:
 	RenderItem* mWireRenderItem[3];				// index 0: object itself, index 1: its reflected object, index 2: its shadow object
 	RenderItem* mBallRenderItem[3];				// index 0: object itself, index 1: its reflected object, index 2: its shadow object
 
+	// bounds of the pendulum bobs (balls) for mouse picking, and the BVH over them.
+	vector<BoundingSphere> mBobBounds;
+	BoundingVolumeHierarchy mBobBvh;
+	bool mDraggingBob = false;					// a bob is being dragged with the left mouse button
+
 	// List of all the rendering items
 	vector<unique_ptr<RenderItem>> mAllRitems;
 
 	// Rendering items categorized by PSO
 	vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
+	vector<RenderItem*> mNearViewRitems;			// just outside the view frustum: their resources are prefetched
 
 	CommonConstants mCommonCB;
 	CommonConstants mReflectedCommonCB;
@@ -161,6 +225,35 @@ private:
 };
 
 // windows app's main function
+// frames in flight from the command line: "-latency" lets the CPU run one frame ahead of
+// the GPU, "-throughput" (the default) two, "-frames N" picks any count from 1 to 4.
+static int ChooseFrameBufferCount(const char* cmdLine)
+{
+	int count = 3;
+
+	if (strstr(cmdLine, "-latency") != nullptr)
+		count = 2;
+	if (strstr(cmdLine, "-throughput") != nullptr)
+		count = 3;
+
+	const char* frames = strstr(cmdLine, "-frames");
+	if (frames != nullptr)
+		count = atoi(frames + strlen("-frames"));
+
+	return MathHelper::Clamp(count, 1, 4);
+}
+
+// a memory budget from the command line: "-cpubudget N" or "-gpubudget N", in MB; 0 if absent.
+static UINT64 ChooseMemoryBudget(const char* cmdLine, const char* option)
+{
+	const char* budget = strstr(cmdLine, option);
+	if (budget == nullptr)
+		return 0;
+
+	int megabytes = atoi(budget + strlen(option));
+	return (megabytes > 0) ? (UINT64)megabytes * 1024 * 1024 : 0;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, int showCmd)
 {
 	// enable run-time memory check for debug builds.
@@ -168,6 +261,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, in
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// must be chosen before any frame buffer, material or render item is created.
+	gNumFrameBuffers = ChooseFrameBufferCount(cmdLine);
+	gCpuBudget = ChooseMemoryBudget(cmdLine, "-cpubudget");
+	gGpuBudget = ChooseMemoryBudget(cmdLine, "-gpubudget");
+
 	try
 	{
 		PendulumMotion thisApp(hInstance);
@@ -200,6 +298,14 @@ PendulumMotion::~PendulumMotion()
 	if (md3dDevice != nullptr)
 	{
 		FlushCommandQueue();
+		if (mCopyQueue != nullptr)
+			mCopyQueue->Flush();		// texture mips may still be streaming in
+
+		// the streamer untracks the resources it still owns; the residency manager goes first otherwise.
+		mTextureStreamer.reset();
+
+		// retired objects may refer to members of this class (descriptor slots).
+		mDeferredRelease->ReleaseAll();
 	}
 }
 
@@ -212,6 +318,13 @@ void PendulumMotion::EulerUpdate(float dt)
 		D3DApp::mStatusChange = false;
 	}
 
+	// the pendulum is held by the mouse pointer while being dragged.
+	if (mDraggingBob)
+	{
+		mSimplePend.omega = 0.0f;
+		return;
+	}
+
 	// sample the newtonian differential equation into difference equation and update it every given delta time. (Euler method)
 	this->mSimplePend.omega = this->mSimplePend.omega -
 		(dt / 1.0f) * (gravConst / this->mSimplePend.wLength) * sinf(this->mSimplePend.theta);		// update angular speed.
@@ -220,13 +333,126 @@ void PendulumMotion::EulerUpdate(float dt)
 		(dt / 1.0f) * this->mSimplePend.omega;														// update angle.
 }
 
-void PendulumMotion::WriteCaption()
+void PendulumMotion::UpdateOverlay()
 {
-	wostringstream outStr;
-	outStr.precision(5);
-	outStr << L"Pendulum demo: pendulum angle : " << mSimplePend.theta << L" in radians.";
+	// TextLine formats into a fixed buffer, so building the HUD does not allocate.
+	const XMFLOAT4 white(1.0f, 1.0f, 1.0f, 1.0f);
+	const XMFLOAT4 yellow(1.0f, 0.9f, 0.3f, 1.0f);
+	float x = 10.0f;
+	float y = 10.0f;
+	float lineHeight = (float)mTextOverlay.LineHeight();
+
+	mTextOverlay.Begin(mClientWidth, mClientHeight);
+
+	TextLine line;
+	line.Append("pendulum angle: ").Append(mSimplePend.theta, 5).Append(" rad");
+	mTextOverlay.DrawString(x, y, line.c_str(), yellow);
+	y += lineHeight;
+
+	line.Clear();
+	line.Append("fps: ").Append(mFramesPerSecond, 1).Append("   mspf: ").Append(mMillisecondsPerFrame, 3);
+	mTextOverlay.DrawString(x, y, line.c_str(), white);
+	y += lineHeight;
+
+	if (mFrameLimiter.TargetFrameRate() > 0.0f)
+	{
+		const FrameLimiter::Stats& pacing = mFrameLimiter.LastStats();
+
+		line.Clear();
+		line.Append("pacing jitter avg/max: ").Append((int)(pacing.AvgJitter * 1.0e6))
+			.Append("/").Append((int)(pacing.MaxJitter * 1.0e6))
+			.Append(" us   missed: ").Append((int)pacing.MissedDeadlines);
+		mTextOverlay.DrawString(x, y, line.c_str(), white);
+		y += lineHeight;
+	}
+
+	// how long the CPU was blocked on frame fences: high means the GPU is the bottleneck
+	// (fewer frames in flight cost little), zero means the GPU may be starved.
+	const FenceManager::Stats& fenceStats = mFenceManager.LastStats();
+	float avgWaitMs = (fenceStats.Waits > 0) ? (float)(fenceStats.TotalWait * 1000.0 / fenceStats.Waits) : 0.0f;
+
+	line.Clear();
+	line.Append("frames in flight: ").Append(gNumFrameBuffers)
+		.Append("   cpu wait avg/max: ").Append(avgWaitMs, 2)
+		.Append("/").Append((float)(fenceStats.MaxWait * 1000.0), 2).Append(" ms");
+	mTextOverlay.DrawString(x, y, line.c_str(), white);
+	y += lineHeight;
+
+	// placed resource heaps: memory reserved from the driver vs. handed out to resources.
+	GpuMemoryAllocator::Stats heapTotals;
+	for (int i = 0; i < (int)GpuMemoryAllocator::Category::Count; ++i)
+	{
+		GpuMemoryAllocator::Stats stats = mGpuAllocator->GetStats((GpuMemoryAllocator::Category)i);
+		heapTotals.HeapCount += stats.HeapCount;
+		heapTotals.HeapBytes += stats.HeapBytes;
+		heapTotals.UsedBytes += stats.UsedBytes;
+		heapTotals.AllocationCount += stats.AllocationCount;
+	}
+
+	line.Clear();
+	line.Append("gpu heaps: ").Append((int)heapTotals.HeapCount)
+		.Append("   resources: ").Append((int)heapTotals.AllocationCount)
+		.Append("   used/reserved: ").Append(heapTotals.UsedBytes / (1024.0f * 1024.0f), 1)
+		.Append("/").Append(heapTotals.HeapBytes / (1024.0f * 1024.0f), 1).Append(" MB");
+	mTextOverlay.DrawString(x, y, line.c_str(), white);
+	y += lineHeight;
+
+	// memory against the budget, as of the end of the last frame.
+	const MemoryBudget::Report& memory = mMemoryBudget.LastReport();
+	const float mb = 1.0f / (1024.0f * 1024.0f);
+	ResidencyPolicy::Stats residency = mResidency->GetStats();
+
+	line.Clear();
+	line.Append("gpu memory: ").Append(memory.Total[(int)MemoryBudget::Pool::Gpu] * mb, 1)
+		.Append("/").Append(memory.Budget[(int)MemoryBudget::Pool::Gpu] * mb, 0)
+		.Append(" MB   os: ").Append(memory.OsUsage * mb, 1)
+		.Append("/").Append(memory.OsBudget * mb, 0).Append(" MB");
+	mTextOverlay.DrawString(x, y, line.c_str(), memory.OverBudget ? yellow : white);
+	y += lineHeight;
+
+	line.Clear();
+	line.Append("resident: ").Append(residency.ResidentBytes * mb, 1)
+		.Append("/").Append(residency.TotalBytes * mb, 1)
+		.Append(" MB   evictions: ").Append((int)residency.Evictions);
+	mTextOverlay.DrawString(x, y, line.c_str(), white);
+	y += lineHeight;
+
+	if (mTextureStreamer->PendingCount() > 0)
+	{
+		line.Clear();
+		line.Append("streaming textures: ").Append((int)mTextureStreamer->PendingCount())
+			.Append("   uploaded: ").Append(mTextureStreamer->BytesUploaded() * mb, 2).Append(" MB");
+		mTextOverlay.DrawString(x, y, line.c_str(), white);
+		y += lineHeight;
+	}
+
+	if (mTextureCache->SharedCount() > 0)
+	{
+		line.Clear();
+		line.Append("shared textures: ").Append((int)mTextureCache->SharedCount())
+			.Append("   files hashed: ").Append((int)mTextureCache->FilesHashed());
+		mTextOverlay.DrawString(x, y, line.c_str(), white);
+		y += lineHeight;
+	}
+
+	line.Clear();
+	line.Append("cpu memory: ").Append(memory.Total[(int)MemoryBudget::Pool::Cpu] * mb, 2)
+		.Append("/").Append(memory.Budget[(int)MemoryBudget::Pool::Cpu] * mb, 0).Append(" MB");
+	if (memory.OverBudget)
+		line.Append("   OVER BUDGET");
+	mTextOverlay.DrawString(x, y, line.c_str(), memory.OverBudget ? yellow : white);
+	y += lineHeight;
 
-	D3DApp::mMainWndCaption = outStr.str();
+	mTextOverlay.DrawString(x, y, "drag the ball to set the pendulum angle", white);
+
+	mTextVertexCount = mTextOverlay.VertexCount();
+	if (mTextVertexCount > 0)
+	{
+		auto textVB = mFrameAllocator->Allocate(mTextVertexCount * sizeof(TextVertex));
+		FrameRingAllocator::WriteScope scope(*mFrameAllocator);
+		mTextOverlay.Flush(reinterpret_cast<TextVertex*>(textVB.CPU));
+		mTextVBAddress = textVB.GPU;
+	}
 }
 
 bool PendulumMotion::Initialize()
@@ -234,10 +460,33 @@ bool PendulumMotion::Initialize()
 	if (!D3DApp::Initialize())
 		return false;
 
-	ThrowIfFailed(mCommandList->Reset(D3DApp::mDirectCmdListAlloc.Get(), nullptr));
-	
-	// query descriptor block size
-	mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	// every texture and geometry upload below is recorded into one copy queue batch.
+	mCopyQueue = make_unique<CopyQueue>(md3dDevice.Get(), mGpuAllocator.get());
+	mCopyQueue->Begin();
+
+	// with an asset archive beside the Textures and Shaders folders, textures and shaders come from
+	// that one file, read front to back, instead of from a file each.  Files it does not hold are loaded loose.
+	mArchive = make_unique<AssetArchive>();
+	if (mArchive->Open(L"Assets.pak"))
+		mArchive->PrefetchAll();
+	else
+		mArchive.reset();
+
+	// texture files are only opened here; their data streams in while the first frames render.
+	// The cache remembers file hashes across launches, so unchanged files are not read to find duplicates.
+	mTextureCache = make_unique<TextureCache>(L"Textures/TextureCache.idx");
+	mTextureStreamer = make_unique<TextureStreamer>(md3dDevice.Get(), mGpuAllocator.get(), mCopyQueue.get());
+	mTextureCache->SetArchive(mArchive.get());
+	mTextureStreamer->SetArchive(mArchive.get());
+
+	// memory envelope of the demo, from the command line or sized to the machine; the GPU side
+	// is also held to the OS budget.  Generated mip chains are only built if they fit.
+	UINT64 cpuBudget = (gCpuBudget != 0) ? gCpuBudget : mMemoryBudget.SuggestedBudget(MemoryBudget::Pool::Cpu);
+	UINT64 gpuBudget = (gGpuBudget != 0) ? gGpuBudget : mMemoryBudget.SuggestedBudget(MemoryBudget::Pool::Gpu);
+	mMemoryBudget.SetBudget(MemoryBudget::Pool::Cpu, cpuBudget);
+	mMemoryBudget.SetBudget(MemoryBudget::Pool::Gpu, gpuBudget);
+	mTextureCache->SetBudget(&mMemoryBudget);
+	mTextureStreamer->SetBudget(&mMemoryBudget);
 
 	// preparatory actions: prepare render items, root signature and set pipeline state object
 	PrepareTextures();
@@ -248,16 +497,25 @@ bool PendulumMotion::Initialize()
 	SetPendulumGeometry();
 	SetMaterials();
 	SetRenderingItems();
+	SetPickingBvh();
 	SetFrameBuffers();
 	SetPSOs();
 
-	// execute the initialization commands.
-	ThrowIfFailed(mCommandList->Close());
-	ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
-	mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	// the uploads run on the copy queue; the CPU does not wait for them.  The direct queue
+	// waits on the GPU for exactly this batch before it executes the first frame.
+	UINT64 uploadFence = mCopyQueue->Submit();
+	mCopyQueue->GpuWait(mCommandQueue.Get(), uploadFence);
 
-	// wait until the initialization is done.
-	FlushCommandQueue();
+	// the CPU copies the demo keeps: overlay vertices and geometry.
+	mMemoryBudget.Track(MemoryBudget::Pool::Cpu, MemoryBudget::Category::Other, TextOverlay::MaxVertices * sizeof(TextVertex));
+
+	for (auto& geo : mGeometries)
+	{
+		geo.second->DisposeUploaders();
+		mMemoryBudget.Track(MemoryBudget::Pool::Cpu, MemoryBudget::Category::Geometry, geo.second->CpuByteSize());
+	}
+
+	TrackResidency();
 
 	return true;		// initialization is complete.
 }
@@ -273,24 +531,176 @@ void PendulumMotion::OnResize()
 void PendulumMotion::Update(const GameTimer& gt)
 {
 	UpdateCamera(gt);
-	WriteCaption();
 
 	// cycle through the frame buffer in a circular array format.
 	mCurrentFrameBufferIndex = (mCurrentFrameBufferIndex + 1) % gNumFrameBuffers;
 	mCurrentFrameBuffer = mFrameBuffers[mCurrentFrameBufferIndex].get();
 
-	if (mCurrentFrameBuffer->Fence != 0 && mFence->GetCompletedValue() < mCurrentFrameBuffer->Fence)
-	{
-		HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
-		ThrowIfFailed(mFence->SetEventOnCompletion(mCurrentFrameBuffer->Fence, eventHandle));
-		WaitForSingleObject(eventHandle, INFINITE);
-		CloseHandle(eventHandle);
-	}
+	// wait until the GPU has finished with this frame buffer (returns at once if it already has).
+	mFenceManager.Wait(mCurrentFrameBuffer->Fence);
+
+	// transient allocations of the frames the GPU has finished can be reused now.
+	UINT64 completedFence = mFenceManager.CompletedValue();
+	mFrameAllocator->ReleaseCompleted(completedFence);
+	mDeferredRelease->ReleaseCompleted(completedFence);
+	mCopyQueue->ReleaseCompleted();
 
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
 	UpdateCommonCB(gt);
 	UpdateReflectedCommonCB(gt);
+	CullRenderItems();
+	UpdateTextureStreaming();
+	UpdateResidency();
+	UpdateOverlay();
+}
+
+void PendulumMotion::TrackResidency()
+{
+	// residency works per heap, so everything placed in the Texture and Buffer heaps is tracked:
+	// the textures (atlas pages and glyph atlas included) and geometry buffers loaded so far,
+	// which the first frame uses after the startup copies, and the streamed textures, which
+	// the streamer tracks as soon as it creates them and stamps with their pending copies.
+	mResidency = make_unique<ResidencyManager>(md3dDevice.Get(), mGpuAllocator.get());
+	mTextureStreamer->SetResidency(mResidency.get());
+
+	UINT64 stamp = mFenceManager.NextValue();
+	for (auto& tex : mTextures)
+		mResidency->Track(tex.second->Resource.Get(), stamp);
+
+	for (auto& geo : mGeometries)
+	{
+		mResidency->Track(geo.second->VertexBufferGPU.Get(), stamp);
+		mResidency->Track(geo.second->IndexBufferGPU.Get(), stamp);
+	}
+}
+
+void PendulumMotion::UpdateTextureStreaming()
+{
+	// screen pixels covered by one world unit at distance 1 (vertical field of view 0.25*pi, see OnResize).
+	float pixelsPerUnit = mClientHeight / (2.0f * tanf(0.125f * MathHelper::Pi));
+	XMVECTOR eye = XMLoadFloat3(&mCameraPos);
+
+	// a texture is wanted at the size its largest object covers on screen.  Tiling is ignored:
+	// a tiled texture asks for more detail than it needs, never for less.
+	for (auto& ri : mAllRitems)
+	{
+		BoundingBox bounds;
+		ri->Bounds.Transform(bounds, XMLoadFloat4x4(&ri->World));
+
+		float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - eye)) - radius;
+		float pixels = 2.0f * radius * pixelsPerUnit / std::max(distance, 1.0f);
+
+		for (auto& tex : mTextures)
+		{
+			if (tex.second->SrvHeapIndex == ri->Mat->DiffuseSrvHeapIndex)
+				mTextureStreamer->RequestScreenSize(tex.second.get(), pixels);
+		}
+	}
+
+	mTextureStreamer->Update(mCommandQueue.Get(), mStreamedTextures);
+	if (mStreamedTextures.empty())
+		return;
+
+	// new mips are published with a new SRV (clamped to them) in a new slot; frames in
+	// flight keep sampling through the old one.
+	UINT64 lastUseFence = mFenceManager.LastSignaledValue();
+	for (Texture* tex : mStreamedTextures)
+		ReplaceTextureSrv(tex, lastUseFence);
+
+	mDescriptorAllocator->CommitStaged();
+}
+
+void PendulumMotion::CullRenderItems()
+{
+	// the view frustum in world space, and one twice as wide around it: what lies between the
+	// two comes into view first when the camera turns.
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+
+	BoundingFrustum frustum(XMLoadFloat4x4(&mProj));
+	BoundingFrustum nearFrustum = frustum;
+	nearFrustum.RightSlope *= 2.0f;
+	nearFrustum.LeftSlope *= 2.0f;
+	nearFrustum.TopSlope *= 2.0f;
+	nearFrustum.BottomSlope *= 2.0f;
+	frustum.Transform(frustum, invView);
+	nearFrustum.Transform(nearFrustum, invView);
+
+	mNearViewRitems.clear();
+	for (int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+	{
+		for (RenderItem* ri : mRitemLayer[layer])
+		{
+			// the shadow matrices are projective, which BoundingBox::Transform does not handle
+			// (no divide by w); the shadows lie on the floor and are always drawn.
+			if (layer == (int)RenderLayer::Shadow)
+			{
+				ri->Visible = true;
+				continue;
+			}
+
+			BoundingBox bounds;
+			ri->Bounds.Transform(bounds, XMLoadFloat4x4(&ri->World));
+			ri->Visible = frustum.Intersects(bounds);
+			if (!ri->Visible && nearFrustum.Intersects(bounds))
+				mNearViewRitems.push_back(ri);
+		}
+	}
+}
+
+void PendulumMotion::UpdateResidency()
+{
+	// stamped with the fence value this frame will signal.
+	UINT64 stamp = mFenceManager.NextValue();
+
+	// the render items drawn this frame use their resources; culled ones do not, so their
+	// resources age out of the budget first.
+	for (auto& ri : mAllRitems)
+	{
+		if (!ri->Visible)
+			continue;
+
+		mResidency->MarkUsed(ri->Geo->VertexBufferGPU.Get(), stamp);
+		mResidency->MarkUsed(ri->Geo->IndexBufferGPU.Get(), stamp);
+
+		for (auto& tex : mTextures)
+		{
+			if (tex.second->SrvHeapIndex == ri->Mat->DiffuseSrvHeapIndex)
+				mResidency->MarkUsed(tex.second->Resource.Get(), stamp);
+		}
+	}
+	mResidency->MarkUsed(mTextures["glyphAtlasTex"]->Resource.Get(), stamp);
+
+	// those about to come into view are brought back ahead of time if the budget allows.
+	for (RenderItem* ri : mNearViewRitems)
+	{
+		mResidency->Prefetch(ri->Geo->VertexBufferGPU.Get());
+		mResidency->Prefetch(ri->Geo->IndexBufferGPU.Get());
+
+		for (auto& tex : mTextures)
+		{
+			if (tex.second->SrvHeapIndex == ri->Mat->DiffuseSrvHeapIndex)
+				mResidency->Prefetch(tex.second->Resource.Get());
+		}
+	}
+
+	// the tracked objects get what is left of the GPU budget after everything else.
+	const MemoryBudget::Report& memory = mMemoryBudget.LastReport();
+	UINT64 gpuBudget = memory.Budget[(int)MemoryBudget::Pool::Gpu];
+	if (memory.OsBudget != 0 && (gpuBudget == 0 || memory.OsBudget < gpuBudget))
+		gpuBudget = memory.OsBudget;
+
+	UINT64 budget = UINT64_MAX;
+	if (gpuBudget != 0)
+	{
+		UINT64 tracked = mResidency->GetStats().TotalBytes;
+		UINT64 untracked = memory.Total[(int)MemoryBudget::Pool::Gpu] - std::min(tracked, memory.Total[(int)MemoryBudget::Pool::Gpu]);
+		budget = (gpuBudget > untracked) ? gpuBudget - untracked : 0;
+	}
+
+	mResidency->Update(mCommandQueue.Get(), budget, mFenceManager.CompletedValue(), mCopyQueue->CompletedValue());
 }
 
 void PendulumMotion::Draw(const GameTimer& gt)
@@ -315,16 +725,13 @@ void PendulumMotion::Draw(const GameTimer& gt)
 	// Specify the buffers we are going to render to.
 	mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mSrvDescriptorHeap.Get() };
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mDescriptorAllocator->Heap() };
 	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 	
 	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
-	UINT commonCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(CommonConstants));
-
 	// draw opaque items, floor, wall, and pendulum
-	auto commonCB = mCurrentFrameBuffer->CommonCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, commonCB->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootConstantBufferView(2, mCommonCBAddress);
 	DrawRenderingItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
 
 	// mark the visible mirror pixels on the stencil buffer with the value 1.
@@ -334,12 +741,12 @@ void PendulumMotion::Draw(const GameTimer& gt)
 
 	// draw reflected image on the mirror (only for pixels where the stencil buffer is 1).
 	// to draw reflected image, light reflected common constant buffer is required.
-	mCommandList->SetGraphicsRootConstantBufferView(2, commonCB->GetGPUVirtualAddress() + commonCBByteSize);
+	mCommandList->SetGraphicsRootConstantBufferView(2, mReflectedCommonCBAddress);
 	mCommandList->SetPipelineState(mPSOs["drawStencilReflections"].Get());
 	DrawRenderingItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Reflected]);
 
 	// restore the original common constants and stencil ref.
-	mCommandList->SetGraphicsRootConstantBufferView(2, commonCB->GetGPUVirtualAddress());
+	mCommandList->SetGraphicsRootConstantBufferView(2, mCommonCBAddress);
 	mCommandList->OMSetStencilRef(0);
 
 	// draw mirror with transparent PSO so that object in the mirror can be seen through.
@@ -350,6 +757,23 @@ void PendulumMotion::Draw(const GameTimer& gt)
 	mCommandList->SetPipelineState(mPSOs["shadow"].Get());
 	DrawRenderingItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Shadow]);
 
+	// draw the text overlay on top of everything.
+	if (mTextVertexCount > 0)
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE glyphAtlas = mDescriptorAllocator->GpuHandle(mGlyphAtlasSrvHeapIndex);
+
+		D3D12_VERTEX_BUFFER_VIEW textVbv;
+		textVbv.BufferLocation = mTextVBAddress;
+		textVbv.StrideInBytes = sizeof(TextVertex);
+		textVbv.SizeInBytes = mTextVertexCount * sizeof(TextVertex);
+
+		mCommandList->SetPipelineState(mPSOs["text"].Get());
+		mCommandList->SetGraphicsRootDescriptorTable(0, glyphAtlas);
+		mCommandList->IASetVertexBuffers(0, 1, &textVbv);
+		mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		mCommandList->DrawInstanced(mTextVertexCount, 1, 0, 0);
+	}
+
 	// indicate a state transition on the resource usage.
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
 		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
@@ -366,9 +790,10 @@ void PendulumMotion::Draw(const GameTimer& gt)
 	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
 	// advance the fence value to mark commands up to this fence point.
-	mCurrentFrameBuffer->Fence = ++mCurrentFence;
+	mCurrentFrameBuffer->Fence = mFenceManager.Signal(mCommandQueue.Get());
 
-	mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+	// everything allocated from the ring this frame is in use until the fence passes.
+	mFrameAllocator->FinishFrame(mCurrentFrameBuffer->Fence);
 }
 
 void PendulumMotion::OnMouseDown(WPARAM btnState, int x, int y)
@@ -376,17 +801,31 @@ void PendulumMotion::OnMouseDown(WPARAM btnState, int x, int y)
 	mLastMousePos.x = x;
 	mLastMousePos.y = y;
 
+	// grab the pendulum if the left button is pressed over a bob. otherwise the drag orbits the camera.
+	if ((btnState & MK_LBUTTON) != 0)
+	{
+		UINT bobIndex = 0;
+		mDraggingBob = PickPendulum(x, y, bobIndex);
+	}
+
 	SetCapture(mhMainWnd);
 }
 
 void PendulumMotion::OnMouseUp(WPARAM btnState, int x, int y)
 {
+	// release the pendulum from rest at the angle it was dragged to.
+	mDraggingBob = false;
+
 	ReleaseCapture();
 }
 
 void PendulumMotion::OnMouseMove(WPARAM btnState, int x, int y)
 {
-	if ((btnState & MK_LBUTTON) != 0)
+	if ((btnState & MK_LBUTTON) != 0 && mDraggingBob)
+	{
+		DragPendulum(x, y);
+	}
+	else if ((btnState & MK_LBUTTON) != 0)
 	{
 		float dx = XMConvertToRadians(0.25f * static_cast<float>(x - mLastMousePos.x));
 		float dy = XMConvertToRadians(0.25f * static_cast<float>(y - mLastMousePos.y));
@@ -415,6 +854,12 @@ void PendulumMotion::OnMouseMove(WPARAM btnState, int x, int y)
 	mLastMousePos.y = y;
 }
 
+void PendulumMotion::OnKeyUp(WPARAM key)
+{
+	if (key == VK_F5)
+		ReloadTextures();
+}
+
 void PendulumMotion::UpdateCamera(const GameTimer& gt)
 {
 	mCameraPos.x = mRadius * sinf(mPhi) * cosf(mTheta);
@@ -437,19 +882,35 @@ void PendulumMotion::UpdateObjectCBs(const GameTimer& gt)
 	UpdateReflectedAndShadowed();				// update the reflected and shadowed objects accordingly.
 	
 	auto currentObjectCB = mCurrentFrameBuffer->ObjectCB.get();
-	for (auto& elem : mAllRitems)
+
+	// write each run of contiguous stale slots of this frame buffer with a single batch.
+	int slotCount = (int)mObjectCBSlots.size();
+	for (int first = 0; first < slotCount; )
 	{
-		if (elem->numFrameBufferFill > 0)
+		if (mObjectCBSlots[first]->numFrameBufferFill <= 0)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&elem->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&elem->TexTransform);
+			++first;
+			continue;
+		}
 
-			ObjectConstants objConstants;
-			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+		int last = first + 1;
+		while (last < slotCount && mObjectCBSlots[last]->numFrameBufferFill > 0)
+			++last;
 
-			currentObjectCB->CopyData(elem->ObjCBIndex, objConstants);
-		}
+		currentObjectCB->WriteBatch(first, last - first, [this](int slot, ObjectConstants& objConstants)
+			{
+				RenderItem* ri = mObjectCBSlots[slot];
+
+				XMMATRIX world = XMLoadFloat4x4(&ri->World);
+				XMMATRIX texTransform = XMLoadFloat4x4(&ri->TexTransform);
+				XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+				XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+
+				// the next frame buffer needs the update as well, once per frame buffer.
+				ri->numFrameBufferFill--;
+			});
+
+		first = last;
 	}
 }
 
@@ -493,6 +954,78 @@ void PendulumMotion::UpdateReflectedAndShadowed()	// update world matrices of a
 		mWireRenderItem[i]->numFrameBufferFill = gNumFrameBuffers;
 		mBallRenderItem[i]->numFrameBufferFill = gNumFrameBuffers;
 	}
+
+	UpdatePickingBvh();
+}
+
+void PendulumMotion::SetPickingBvh()
+{
+	// one bounding sphere per pendulum bob (ball radius : 0.2f)
+	mBobBounds.assign(1, BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.2f));
+	UpdatePickingBvh();
+
+	mBobBvh.Build(mBobBounds);
+}
+
+void PendulumMotion::UpdatePickingBvh()
+{
+	XMFLOAT4X4& ballWorld = mBallRenderItem[0]->World;
+	mBobBounds[0].Center = XMFLOAT3(ballWorld._41, ballWorld._42, ballWorld._43);
+
+	// the bobs move every frame but the set of bobs does not change: refit instead of rebuilding.
+	if (mBobBvh.ObjectCount() == mBobBounds.size())
+	{
+		mBobBvh.Refit(mBobBounds);
+	}
+}
+
+void PendulumMotion::ComputePickRay(int sx, int sy, XMVECTOR& origin, XMVECTOR& dir)
+{
+	// screen point -> view space direction. the projection matrix scales view space x, y by P(0,0), P(1,1).
+	float vx = (2.0f * sx / mClientWidth - 1.0f) / mProj(0, 0);
+	float vy = (-2.0f * sy / mClientHeight + 1.0f) / mProj(1, 1);
+
+	// view space -> world space.
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+
+	origin = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), invView);
+	dir = XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(vx, vy, 1.0f, 0.0f), invView));
+}
+
+bool PendulumMotion::PickPendulum(int sx, int sy, UINT& bobIndex)
+{
+	XMVECTOR origin, dir;
+	ComputePickRay(sx, sy, origin, dir);
+
+	float dist = 0.0f;
+	return mBobBvh.RayCast(origin, dir, bobIndex, dist);
+}
+
+void PendulumMotion::DragPendulum(int sx, int sy)
+{
+	XMVECTOR origin, dir;
+	ComputePickRay(sx, sy, origin, dir);
+
+	// intersect the ray with the plane the pendulum swings in (z = -5, see UpdateReflectedAndShadowed).
+	const XMFLOAT3 pivot(0.0f, 6.0f, -5.0f);
+
+	XMFLOAT3 o, d;
+	XMStoreFloat3(&o, origin);
+	XMStoreFloat3(&d, dir);
+	if (fabsf(d.z) < 1.0e-4f)
+		return;
+
+	float t = (pivot.z - o.z) / d.z;
+	if (t <= 0.0f)
+		return;
+
+	float px = o.x + t * d.x;
+	float py = o.y + t * d.y;
+
+	// angle measured from the downward vertical, as in EulerUpdate.
+	mSimplePend.theta = atan2f(px - pivot.x, pivot.y - py);
+	mSimplePend.omega = 0.0f;
 }
 
 
@@ -551,8 +1084,7 @@ void PendulumMotion::UpdateCommonCB(const GameTimer& gt)
 	mCommonCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
 	mCommonCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
 
-	auto currentCommonCB = mCurrentFrameBuffer->CommonCB.get();
-	currentCommonCB->CopyData(0, mCommonCB);
+	mCommonCBAddress = mFrameAllocator->PushConstants(mCommonCB);
 }
 
 void PendulumMotion::UpdateReflectedCommonCB(const GameTimer& gt)
@@ -571,8 +1103,7 @@ void PendulumMotion::UpdateReflectedCommonCB(const GameTimer& gt)
 	}
 
 	// reflected common const. buffer stored right next to common const.
-	auto currentCommonCB = mCurrentFrameBuffer->CommonCB.get();
-	currentCommonCB->CopyData(1, mReflectedCommonCB);
+	mReflectedCommonCBAddress = mFrameAllocator->PushConstants(mReflectedCommonCB);
 }
 
 
@@ -584,23 +1115,29 @@ void PendulumMotion::DrawRenderingItems(ID3D12GraphicsCommandList* cmdList, cons
 	auto objectCB = mCurrentFrameBuffer->ObjectCB->Resource();
 	auto matCB = mCurrentFrameBuffer->MaterialCB->Resource();
 
+	// materials sharing a texture (an atlas page) share its SRV: the table is only set when it changes.
+	int boundSrvHeapIndex = -1;
+
 	// draw each render items in the container storing pointer type of RenderItem.
 	for (size_t i = 0; i < ritems.size(); ++i)
 	{
 		RenderItem* ri = ritems[i];
+		if (!ri->Visible)
+			continue;
 
 		// feed IA(Input Assembler) with relevant data...
 		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
 		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
 		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
-		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, mCbvSrvDescriptorSize);
-
 		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex * objCBByteSize;
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
+		if (ri->Mat->DiffuseSrvHeapIndex != boundSrvHeapIndex)
+		{
+			cmdList->SetGraphicsRootDescriptorTable(0, mDescriptorAllocator->GpuHandle(ri->Mat->DiffuseSrvHeapIndex));
+			boundSrvHeapIndex = ri->Mat->DiffuseSrvHeapIndex;
+		}
 		cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
 		cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
 
@@ -612,34 +1149,188 @@ void PendulumMotion::DrawRenderingItems(ID3D12GraphicsCommandList* cmdList, cons
 
 void PendulumMotion::PrepareTextures()
 {
-	auto bricksTex = make_unique<Texture>();
-	bricksTex->Name = "bricksTex";
-	bricksTex->Filename = L"Textures/bricks3.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(),
-		bricksTex->Filename.c_str(), bricksTex->Resource, bricksTex->UploadHeap));
-
-	auto floorTex = make_unique<Texture>();
-	floorTex->Name = "floorTex";
-	floorTex->Filename = L"Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(),
-		floorTex->Filename.c_str(), floorTex->Resource, floorTex->UploadHeap));
-
-	auto mirrorTex = make_unique<Texture>();
-	mirrorTex->Name = "mirrorTex";
-	mirrorTex->Filename = L"Textures/ice.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(),
-		mirrorTex->Filename.c_str(), mirrorTex->Resource, mirrorTex->UploadHeap));
-
-	auto white1x1Tex = make_unique<Texture>();
-	white1x1Tex->Name = "white1x1Tex";
-	white1x1Tex->Filename = L"Textures/white1x1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(md3dDevice.Get(), mCommandList.Get(),
-		white1x1Tex->Filename.c_str(), white1x1Tex->Resource, white1x1Tex->UploadHeap));
-
-	mTextures[bricksTex->Name] = move(bricksTex);
-	mTextures[floorTex->Name] = move(floorTex);
-	mTextures[mirrorTex->Name] = move(mirrorTex);
-	mTextures[white1x1Tex->Name] = move(white1x1Tex);
+	LoadTexture("bricksTex", L"Textures/bricks3.dds");
+	LoadTexture("floorTex", L"Textures/grass.dds");
+	LoadTexture("mirrorTex", L"Textures/ice.dds");
+
+	// small textures that are only sampled inside [0, 1] share atlas pages, so their materials
+	// share one SRV.  Those that cannot be packed are streamed like the others.
+	for (auto& file : PackSmallTextures({ { "white1x1Tex", L"Textures/white1x1.dds" } }))
+		LoadTexture(file.first, file.second);
+
+	// glyph atlas for the text overlay, rasterized at startup instead of loaded from a file.
+	auto glyphAtlasTex = make_shared<Texture>();
+	mTextOverlay.BuildGlyphAtlas(md3dDevice.Get(), mCopyQueue->CommandList(), mCopyQueue->Staging(), L"Consolas", 16, *glyphAtlasTex);
+	mTextures[glyphAtlasTex->Name] = glyphAtlasTex;
+}
+
+void PendulumMotion::LoadTexture(const string& name, const wstring& filename)
+{
+	// the file is streamed: the texture gets its resource (and real SRV) as its mips arrive.
+	// A file with the same contents as one already loaded gets that texture instead of a copy.
+	bool created = false;
+	shared_ptr<Texture> tex = mTextureCache->Acquire(name, filename, created);
+	if (created)
+		mTextureStreamer->Load(tex.get());
+	mTextures[name] = tex;
+	mTextureFiles[name] = filename;
+}
+
+vector<pair<string, wstring>> PendulumMotion::PackSmallTextures(const vector<pair<string, wstring>>& files)
+{
+	const UINT MaxPackedSize = 128;		// larger textures are worth their own SRV (and streaming)
+
+	// the files are small: they are read and decoded right here.
+	vector<pair<string, wstring>> unpacked;
+	vector<pair<string, wstring>> packed;
+	vector<RgbaImage> images;
+	for (auto& file : files)
+	{
+		// from the archive if it holds the file (mapped, or unpacked if compressed).
+		MappedFile mapped;
+		vector<uint8_t> unpackedFile;
+		ArchiveSpan contents;
+		UINT32 entry = mArchive != nullptr ? mArchive->Find(file.second.c_str()) : AssetArchive::NotFound;
+		if (entry != AssetArchive::NotFound)
+		{
+			if (!mArchive->Map(entry, contents) && mArchive->Read(entry, unpackedFile))
+				contents = { unpackedFile.data(), unpackedFile.size() };
+		}
+		else if (mapped.Open(file.second.c_str()))
+		{
+			contents = { mapped.Data(), (size_t)mapped.Size() };
+		}
+
+		RgbaImage image;
+		string error;
+		if (contents.Data != nullptr && ReadDdsImage(contents.Data, contents.Size, image, error) &&
+			image.Width <= MaxPackedSize && image.Height <= MaxPackedSize)
+		{
+			packed.push_back(file);
+			images.push_back(move(image));
+		}
+		else
+		{
+			unpacked.push_back(file);
+		}
+	}
+
+	vector<AtlasImage> atlasImages(images.size());
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		atlasImages[i].Width = images[i].Width;
+		atlasImages[i].Height = images[i].Height;
+		atlasImages[i].RowPitch = 4 * (size_t)images[i].Width;
+		atlasImages[i].Data = images[i].Rgba.data();
+	}
+
+	AtlasSettings settings;
+	settings.PageSize = 512;
+	vector<AtlasPage> pages;
+	vector<AtlasPlacement> placements;
+	BuildTextureAtlases(settings, atlasImages.data(), (UINT)atlasImages.size(), pages, placements);
+
+	// one texture per page, uploaded with the other copies of the open batch.
+	ID3D12GraphicsCommandList* cmdList = mCopyQueue->CommandList();
+	vector<shared_ptr<Texture>> pageTextures;
+	for (size_t p = 0; p < pages.size(); ++p)
+	{
+		auto tex = make_shared<Texture>();
+		tex->Name = "atlasPage" + to_string(p) + "Tex";
+
+		UINT16 mipLevels = (UINT16)pages[p].Levels.size();
+		CD3DX12_RESOURCE_DESC texDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, pages[p].Width, pages[p].Height, 1, mipLevels);
+		ThrowIfFailed(mCopyQueue->Staging().CreateTexture(texDesc, D3D12_RESOURCE_STATE_COPY_DEST, tex->Resource));
+
+		vector<D3D12_SUBRESOURCE_DATA> subresources(mipLevels);
+		for (UINT16 level = 0; level < mipLevels; ++level)
+		{
+			subresources[level].pData = pages[p].Levels[level].data();
+			subresources[level].RowPitch = 4 * (LONG_PTR)max(pages[p].Width >> level, 1u);
+			subresources[level].SlicePitch = subresources[level].RowPitch * max(pages[p].Height >> level, 1u);
+		}
+		mCopyQueue->Staging().UploadSubresources(cmdList, tex->Resource.Get(), 0, mipLevels, subresources.data());
+
+		CD3DX12_RESOURCE_BARRIER toShaderResource = CD3DX12_RESOURCE_BARRIER::Transition(tex->Resource.Get(),
+			D3D12_RESOURCE_STATE_COPY_DEST, StagingArena::ReadyState(cmdList, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+		cmdList->ResourceBarrier(1, &toShaderResource);
+
+		mTextures[tex->Name] = tex;
+		pageTextures.push_back(tex);
+	}
+
+	// the packed names share their page; SetDiffuseTexture maps materials to the rectangles.
+	for (size_t i = 0; i < packed.size(); ++i)
+	{
+		if (placements[i].Page == AtlasPlacement::NotPacked)
+		{
+			unpacked.push_back(packed[i]);
+			continue;
+		}
+
+		mTextures[packed[i].first] = pageTextures[placements[i].Page];
+		mAtlasPlacements[packed[i].first] = placements[i];
+		mAtlasSources.push_back(packed[i]);
+	}
+	mAtlasPages.insert(mAtlasPages.end(), pageTextures.begin(), pageTextures.end());
+	return unpacked;
+}
+
+void PendulumMotion::RepackSmallTextures(UINT64 lastUseFence)
+{
+	if (mAtlasSources.empty())
+		return;
+
+	// the old pages, and their slots, go once the frames that may sample them are done.
+	DescriptorAllocator* descriptors = mDescriptorAllocator.get();
+	for (auto& page : mAtlasPages)
+	{
+		int oldSrvHeapIndex = page->SrvHeapIndex;
+		mDeferredRelease->Retire([descriptors, oldSrvHeapIndex]() { descriptors->FreePersistent(oldSrvHeapIndex); }, lastUseFence);
+		mResidency->Untrack(page->Resource.Get());
+		mDeferredRelease->Retire(page->Resource, mFenceManager.NextValue());
+		mTextures.erase(page->Name);
+	}
+	mAtlasPages.clear();
+
+	vector<pair<string, wstring>> sources;
+	sources.swap(mAtlasSources);
+	for (auto& source : sources)
+	{
+		mTextures.erase(source.first);
+		mAtlasPlacements.erase(source.first);
+	}
+
+	// the files are read and packed again (they may have changed size); the next frame waits for the upload.
+	mCopyQueue->Begin();
+	vector<pair<string, wstring>> unpacked = PackSmallTextures(sources);
+	for (auto& page : mAtlasPages)
+	{
+		mResidency->Track(page->Resource.Get(), mFenceManager.NextValue());
+		mResidency->MarkCopied(page->Resource.Get(), mCopyQueue->NextValue());
+		CreateTextureSrv(page.get());
+	}
+	mCopyQueue->GpuWait(mCommandQueue.Get(), mCopyQueue->Submit());
+
+	// files that no longer fit a page are streamed on their own.
+	for (auto& file : unpacked)
+	{
+		LoadTexture(file.first, file.second);
+		Texture* tex = mTextures[file.first].get();
+		if (tex->SrvHeapIndex < 0)
+			CreateTextureSrv(tex);
+	}
+
+	// the materials sample the new pages through their new rectangles.
+	auto bindings = move(mAtlasMaterials);
+	mAtlasMaterials.clear();
+	for (auto& binding : bindings)
+	{
+		Material* mat = binding.first;
+		mat->MatTransform = binding.second.second;
+		SetDiffuseTexture(mat, binding.second.first);
+		mat->NumFramesDirty = gNumFrameBuffers;
+	}
 }
 
 void PendulumMotion::SetRootSignature()
@@ -680,50 +1371,121 @@ void PendulumMotion::SetRootSignature()
 
 void PendulumMotion::SetDescriptorHeaps()
 {
-	// Create the shader resource view.
-	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 4;
-	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&mSrvDescriptorHeap)));
-
-	// fill up the heap with texture resource descriptors.
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(mSrvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto bricksTex = mTextures["bricksTex"]->Resource;
-	auto floorTex = mTextures["floorTex"]->Resource;
-	auto mirrorTex = mTextures["mirrorTex"]->Resource;
-	auto white1x1Tex = mTextures["white1x1Tex"]->Resource;
-
-	// 1st descriptor
+	// slots for the texture SRVs; replaced views take new slots until the old ones are retired.
+	mDescriptorAllocator = make_unique<DescriptorAllocator>(md3dDevice.Get(), 256);
+
+	// one SRV per texture, whatever the number of textures is; materials refer to them by SrvHeapIndex.
+	for (auto& tex : DistinctTextures())
+		CreateTextureSrv(tex.get());
+
+	// copy the staged descriptors to the shader-visible heap in one go.
+	mDescriptorAllocator->CommitStaged();
+
+	mGlyphAtlasSrvHeapIndex = mTextures["glyphAtlasTex"]->SrvHeapIndex;
+}
+
+void PendulumMotion::CreateTextureSrv(Texture* tex)
+{
+	tex->SrvHeapIndex = (int)mDescriptorAllocator->AllocatePersistent();
+
+	// a texture still being streamed in has no resource yet: a null SRV samples as zero.
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = bricksTex->GetDesc().Format;
+	srvDesc.Format = (tex->Resource != nullptr) ? tex->Resource->GetDesc().Format : DXGI_FORMAT_R8G8B8A8_UNORM;
 	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.Texture2D.MipLevels = -1;
-	md3dDevice->CreateShaderResourceView(bricksTex.Get(), &srvDesc, hDescriptor);
-
-	// 2nd descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);			// add offset to the resource view handle
-	srvDesc.Format = floorTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(floorTex.Get(), &srvDesc, hDescriptor);
-
-	// 3rd descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = mirrorTex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(mirrorTex.Get(), &srvDesc, hDescriptor);
-
-	// 4th descriptor
-	hDescriptor.Offset(1, mCbvSrvDescriptorSize);
-	srvDesc.Format = white1x1Tex->GetDesc().Format;
-	md3dDevice->CreateShaderResourceView(white1x1Tex.Get(), &srvDesc, hDescriptor);
+	srvDesc.Texture2D.ResourceMinLODClamp = (float)tex->ResidentMip;		// mips above it are not loaded yet
+
+	md3dDevice->CreateShaderResourceView(tex->Resource.Get(), &srvDesc,
+		mDescriptorAllocator->StagingHandle(tex->SrvHeapIndex));
+}
+
+void PendulumMotion::ReplaceTextureSrv(Texture* tex, UINT64 lastUseFence)
+{
+	// a new slot: the old one may still be read by the frames in flight.
+	int oldSrvHeapIndex = tex->SrvHeapIndex;
+	CreateTextureSrv(tex);
+
+	DescriptorAllocator* descriptors = mDescriptorAllocator.get();
+	mDeferredRelease->Retire([descriptors, oldSrvHeapIndex]() { descriptors->FreePersistent(oldSrvHeapIndex); }, lastUseFence);
+
+	for (auto& mat : mMaterials)
+	{
+		if (mat.second->DiffuseSrvHeapIndex == oldSrvHeapIndex)
+			mat.second->DiffuseSrvHeapIndex = tex->SrvHeapIndex;
+	}
+}
+
+void PendulumMotion::ReloadTextures()
+{
+	// frames already submitted keep using the old textures and descriptor slots; they are
+	// released once the last of those frames has completed.  Nothing waits here.
+	UINT64 lastUseFence = mFenceManager.LastSignaledValue();
+	DescriptorAllocator* descriptors = mDescriptorAllocator.get();
+
+	for (auto& shared : DistinctTextures())
+	{
+		Texture* tex = shared.get();
+		if (tex->Filename.empty())
+			continue;		// generated (glyph atlas), or an atlas page: repacked below
+
+		// the direct queue waits for copies still writing the old resource, so it can go with
+		// the next frame's fence.
+		mTextureStreamer->Unload(tex, mCommandQueue.Get());
+		if (tex->Resource != nullptr)
+		{
+			mResidency->Untrack(tex->Resource.Get());
+			mDeferredRelease->Retire(tex->Resource, mFenceManager.NextValue());
+		}
+
+		int oldSrvHeapIndex = tex->SrvHeapIndex;
+		mDeferredRelease->Retire([descriptors, oldSrvHeapIndex]() { descriptors->FreePersistent(oldSrvHeapIndex); }, lastUseFence);
+		mTextureCache->Forget(shared);
+	}
+
+	// every name is acquired again from its own file: names that shared a texture get
+	// textures of their own if their files differ now, and names whose files became
+	// identical share one.  The files then stream in again from their mip tails.
+	unordered_map<string, wstring> files = mTextureFiles;
+	for (auto& file : files)
+		LoadTexture(file.first, file.second);
+
+	for (auto& file : files)
+	{
+		Texture* tex = mTextures[file.first].get();
+		if (tex->SrvHeapIndex < 0)
+			CreateTextureSrv(tex);
+	}
+
+	for (auto& binding : mMaterialTextures)
+	{
+		if (files.find(binding.second) != files.end())
+			binding.first->DiffuseSrvHeapIndex = mTextures[binding.second]->SrvHeapIndex;
+	}
+
+	RepackSmallTextures(lastUseFence);
+	mDescriptorAllocator->CommitStaged();
+}
+
+vector<shared_ptr<Texture>> PendulumMotion::DistinctTextures()
+{
+	vector<shared_ptr<Texture>> textures;
+	for (auto& elem : mTextures)
+	{
+		if (find(textures.begin(), textures.end(), elem.second) == textures.end())
+			textures.push_back(elem.second);
+	}
+	return textures;
 }
 
 void PendulumMotion::SetShadersAndInputLayout()
 {
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\BasicShader.hlsl", nullptr, "VS", "vs_5_0");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\BasicShader.hlsl", nullptr, "PS", "ps_5_0");
+	// from the archive when it has them, the files otherwise.
+	mShaders["standardVS"] = d3dUtil::CompileShader(mArchive.get(), L"Shaders\\BasicShader.hlsl", nullptr, "VS", "vs_5_0");
+	mShaders["opaquePS"] = d3dUtil::CompileShader(mArchive.get(), L"Shaders\\BasicShader.hlsl", nullptr, "PS", "ps_5_0");
+	mShaders["textVS"] = d3dUtil::CompileShader(mArchive.get(), L"Shaders\\TextOverlay.hlsl", nullptr, "VS", "vs_5_0");
+	mShaders["textPS"] = d3dUtil::CompileShader(mArchive.get(), L"Shaders\\TextOverlay.hlsl", nullptr, "PS", "ps_5_0");
 
 	mInputLayout =				
 	{
@@ -805,23 +1567,20 @@ void PendulumMotion::SetBackgroundGeometry()
 	mirrorSubmesh.StartIndexLocation = 24;
 	mirrorSubmesh.BaseVertexLocation = 0;
 
+	BoundingBox::CreateFromPoints(floorSubmesh.Bounds, 4, &vertices[0].Position, sizeof(Vertex));
+	BoundingBox::CreateFromPoints(wallSubmesh.Bounds, 12, &vertices[4].Position, sizeof(Vertex));
+	BoundingBox::CreateFromPoints(mirrorSubmesh.Bounds, 4, &vertices[16].Position, sizeof(Vertex));
+
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(uint16_t);
 
 	auto geo = make_unique<MeshGeometry>();
 	geo->Name = "backgroundGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
-		vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	// GPU-only geometry: no system memory copies, the staging arena copies the vertices at record time.
+	geo->VertexBufferGPU = mCopyQueue->Staging().CreateDefaultBuffer(mCopyQueue->CommandList(), vertices.data(), vbByteSize);
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(),
-		indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = mCopyQueue->Staging().CreateDefaultBuffer(mCopyQueue->CommandList(), indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -870,6 +1629,10 @@ void PendulumMotion::SetPendulumGeometry()			// opaque pendulum and ceiling
 	sphereSubmesh.StartIndexLocation = sphereIndexStart;
 	sphereSubmesh.BaseVertexLocation = sphereVertexStart;
 
+	BoundingBox::CreateFromPoints(ceilingSubmesh.Bounds, ceiling.Vertices.size(), &ceiling.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+	BoundingBox::CreateFromPoints(cylinderSubmesh.Bounds, cylinder.Vertices.size(), &cylinder.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+	BoundingBox::CreateFromPoints(sphereSubmesh.Bounds, sphere.Vertices.size(), &sphere.Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+
 	auto totalVertexCount = ceiling.Vertices.size() + cylinder.Vertices.size() + sphere.Vertices.size();
 
 	vector<Vertex> vertices(totalVertexCount);
@@ -907,17 +1670,10 @@ void PendulumMotion::SetPendulumGeometry()			// opaque pendulum and ceiling
 	auto geo = make_unique<MeshGeometry>();
 	geo->Name = "pendulumGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	// GPU-only geometry: no system memory copies, the staging arena copies the vertices at record time.
+	geo->VertexBufferGPU = mCopyQueue->Staging().CreateDefaultBuffer(mCopyQueue->CommandList(), vertices.data(), vbByteSize);
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(),
-		vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(),
-		ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = mCopyQueue->Staging().CreateDefaultBuffer(mCopyQueue->CommandList(), indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -1055,15 +1811,50 @@ void PendulumMotion::SetPSOs()
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPsoDesc = transparentPsoDesc;	
 	shadowPsoDesc.DepthStencilState = shadowDSS;
 	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&shadowPsoDesc, IID_PPV_ARGS(&mPSOs["shadow"])));
+
+	// pipeline state object for the text overlay: alpha blended screen-space quads, no depth/stencil test.
+	UINT textInputLayoutCount = 0;
+	const D3D12_INPUT_ELEMENT_DESC* textInputLayout = TextOverlay::InputLayout(textInputLayoutCount);
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC textPsoDesc = transparentPsoDesc;
+	textPsoDesc.InputLayout = { textInputLayout, textInputLayoutCount };
+	textPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["textVS"]->GetBufferPointer()),
+		mShaders["textVS"]->GetBufferSize()
+	};
+	textPsoDesc.PS =
+	{
+		reinterpret_cast<BYTE*>(mShaders["textPS"]->GetBufferPointer()),
+		mShaders["textPS"]->GetBufferSize()
+	};
+	textPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	textPsoDesc.DepthStencilState.DepthEnable = false;
+	textPsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	textPsoDesc.DepthStencilState.StencilEnable = false;
+	ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&textPsoDesc, IID_PPV_ARGS(&mPSOs["text"])));
 }
 
 void PendulumMotion::SetFrameBuffers()
 {
 	for (int i = 0; i < gNumFrameBuffers; ++i)
 	{
-		mFrameBuffers.push_back(make_unique<FrameBuffer>(md3dDevice.Get(),
-			2, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
+		mFrameBuffers.push_back(make_unique<FrameBuffer>(md3dDevice.Get(), mGpuAllocator.get(),
+			(UINT)mAllRitems.size(), (UINT)mMaterials.size()));
 	}
+
+	mObjectCBSlots.assign(mAllRitems.size(), nullptr);
+	for (auto& elem : mAllRitems)
+		mObjectCBSlots[elem->ObjCBIndex] = elem.get();
+
+	// transient data of one frame: common + reflected common constants and the text vertices.
+	UINT64 commonCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(CommonConstants));
+	UINT64 textVBByteSize = d3dUtil::CalcConstantBufferByteSize(TextOverlay::MaxVertices * sizeof(TextVertex));
+	UINT64 frameBytes = 2 * commonCBByteSize + textVBByteSize;
+
+	// one extra frame of slack covers alignment padding and wrap-around at the end of the ring.
+	mFrameAllocator = make_unique<FrameRingAllocator>(md3dDevice.Get(), (gNumFrameBuffers + 1) * frameBytes);
+	mMemoryBudget.Track(MemoryBudget::Pool::Gpu, MemoryBudget::Category::Constants, mFrameAllocator->Capacity());
 }
 
 void PendulumMotion::SetMaterials()
@@ -1071,7 +1862,7 @@ void PendulumMotion::SetMaterials()
 	auto bricks = make_unique<Material>();
 	bricks->Name = "bricks";
 	bricks->MatCBIndex = 0;
-	bricks->DiffuseSrvHeapIndex = 0;
+	SetDiffuseTexture(bricks.get(), "bricksTex");
 	bricks->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	bricks->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	bricks->Roughness = 0.25f;
@@ -1079,7 +1870,7 @@ void PendulumMotion::SetMaterials()
 	auto grassfloor = make_unique<Material>();
 	grassfloor->Name = "grassfloor";
 	grassfloor->MatCBIndex = 1;
-	grassfloor->DiffuseSrvHeapIndex = 1;
+	SetDiffuseTexture(grassfloor.get(), "floorTex");
 	grassfloor->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	grassfloor->FresnelR0 = XMFLOAT3(0.07f, 0.07f, 0.07f);
 	grassfloor->Roughness = 0.3f;
@@ -1087,7 +1878,7 @@ void PendulumMotion::SetMaterials()
 	auto glassmirror = make_unique<Material>();
 	glassmirror->Name = "grassmirror";
 	glassmirror->MatCBIndex = 2;
-	glassmirror->DiffuseSrvHeapIndex = 2;
+	SetDiffuseTexture(glassmirror.get(), "mirrorTex");
 	glassmirror->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.3f);
 	glassmirror->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	glassmirror->Roughness = 0.5f;
@@ -1095,7 +1886,7 @@ void PendulumMotion::SetMaterials()
 	auto whitesurface = make_unique<Material>();
 	whitesurface->Name = "whitesurface";
 	whitesurface->MatCBIndex = 3;
-	whitesurface->DiffuseSrvHeapIndex = 3;
+	SetDiffuseTexture(whitesurface.get(), "white1x1Tex");
 	whitesurface->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	whitesurface->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	whitesurface->Roughness = 0.3f;
@@ -1103,7 +1894,7 @@ void PendulumMotion::SetMaterials()
 	auto shadow = make_unique<Material>();
 	shadow->Name = "shadow";
 	shadow->MatCBIndex = 4;
-	shadow->DiffuseSrvHeapIndex = 3;
+	SetDiffuseTexture(shadow.get(), "white1x1Tex");
 	shadow->DiffuseAlbedo = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.5f);
 	shadow->FresnelR0 = XMFLOAT3(0.001f, 0.001f, 0.001f);
 	shadow->Roughness = 0.0f;
@@ -1115,6 +1906,26 @@ void PendulumMotion::SetMaterials()
 	mMaterials["shadow"] = move(shadow);
 }
 
+void PendulumMotion::SetDiffuseTexture(Material* mat, const string& texName)
+{
+	mat->DiffuseSrvHeapIndex = mTextures[texName]->SrvHeapIndex;
+	mMaterialTextures[mat] = texName;
+
+	// a texture packed into an atlas page is sampled through its rectangle there: the material's
+	// own texture transform (set before this call) comes first, then the page placement.
+	auto packed = mAtlasPlacements.find(texName);
+	if (packed == mAtlasPlacements.end())
+		return;
+
+	// the material's own transform is kept, so a repacked page can place it again.
+	mAtlasMaterials[mat] = make_pair(texName, mat->MatTransform);
+
+	const AtlasPlacement& placement = packed->second;
+	XMMATRIX toPage = XMMatrixScaling(placement.Scale[0], placement.Scale[1], 1.0f) *
+		XMMatrixTranslation(placement.Offset[0], placement.Offset[1], 0.0f);
+	XMStoreFloat4x4(&mat->MatTransform, XMLoadFloat4x4(&mat->MatTransform) * toPage);
+}
+
 void PendulumMotion::SetRenderingItems()
 {
 	auto floorRitem = make_unique<RenderItem>();
@@ -1127,6 +1938,7 @@ void PendulumMotion::SetRenderingItems()
 	floorRitem->IndexCount = floorRitem->Geo->DrawArgs["floor"].IndexCount;
 	floorRitem->StartIndexLocation = floorRitem->Geo->DrawArgs["floor"].StartIndexLocation;
 	floorRitem->BaseVertexLocation = floorRitem->Geo->DrawArgs["floor"].BaseVertexLocation;
+	floorRitem->Bounds = floorRitem->Geo->DrawArgs["floor"].Bounds;
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(floorRitem.get());
 
 	auto wallRitem = make_unique<RenderItem>();
@@ -1139,6 +1951,7 @@ void PendulumMotion::SetRenderingItems()
 	wallRitem->IndexCount = wallRitem->Geo->DrawArgs["wall"].IndexCount;
 	wallRitem->StartIndexLocation = wallRitem->Geo->DrawArgs["wall"].StartIndexLocation;
 	wallRitem->BaseVertexLocation = wallRitem->Geo->DrawArgs["wall"].BaseVertexLocation;
+	wallRitem->Bounds = wallRitem->Geo->DrawArgs["wall"].Bounds;
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(wallRitem.get());
 
 	auto mirrorRitem = make_unique<RenderItem>();
@@ -1151,6 +1964,7 @@ void PendulumMotion::SetRenderingItems()
 	mirrorRitem->IndexCount = mirrorRitem->Geo->DrawArgs["mirror"].IndexCount;
 	mirrorRitem->StartIndexLocation = mirrorRitem->Geo->DrawArgs["mirror"].StartIndexLocation;
 	mirrorRitem->BaseVertexLocation = mirrorRitem->Geo->DrawArgs["mirror"].BaseVertexLocation;
+	mirrorRitem->Bounds = mirrorRitem->Geo->DrawArgs["mirror"].Bounds;
 	mRitemLayer[(int)RenderLayer::Mirrors].push_back(mirrorRitem.get());				// for rendering on the stencil buffer
 	mRitemLayer[(int)RenderLayer::Transparent].push_back(mirrorRitem.get());			// for rendering on the back buffer(real blended object appeared on the scene)
 
@@ -1167,6 +1981,7 @@ void PendulumMotion::SetRenderingItems()
 	ceilingRitem->IndexCount = ceilingRitem->Geo->DrawArgs["ceiling"].IndexCount;
 	ceilingRitem->StartIndexLocation = ceilingRitem->Geo->DrawArgs["ceiling"].StartIndexLocation;
 	ceilingRitem->BaseVertexLocation = ceilingRitem->Geo->DrawArgs["ceiling"].BaseVertexLocation;
+	ceilingRitem->Bounds = ceilingRitem->Geo->DrawArgs["ceiling"].Bounds;
 	mCeilingRenderItem[0] = ceilingRitem.get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(ceilingRitem.get());
 
@@ -1196,6 +2011,7 @@ void PendulumMotion::SetRenderingItems()
 	wireRitem->IndexCount = wireRitem->Geo->DrawArgs["cylinder"].IndexCount;
 	wireRitem->StartIndexLocation = wireRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
 	wireRitem->BaseVertexLocation = wireRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+	wireRitem->Bounds = wireRitem->Geo->DrawArgs["cylinder"].Bounds;
 	mWireRenderItem[0] = wireRitem.get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(wireRitem.get());
 
@@ -1225,6 +2041,7 @@ void PendulumMotion::SetRenderingItems()
 	ballRitem->IndexCount = ballRitem->Geo->DrawArgs["sphere"].IndexCount;
 	ballRitem->StartIndexLocation = ballRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
 	ballRitem->BaseVertexLocation = ballRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+	ballRitem->Bounds = ballRitem->Geo->DrawArgs["sphere"].Bounds;
 	mBallRenderItem[0] = ballRitem.get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(ballRitem.get());
 
@@ -0,0 +1,38 @@
+// Text Overlay Shaders : screen-space glyph quads sampled from the glyph atlas
+
+Texture2D gGlyphAtlas : register(t0);       // single channel glyph coverage
+
+SamplerState gsamPointClamp         :   register(s1);
+
+struct VertexInput
+{
+    float2 PosNDC   :   POSITION;           // position already in normalized device coordinates
+    float2 TexC     :   TEXCOORD;           // glyph atlas coordinates
+    float4 Color    :   COLOR;              // text color
+};
+
+struct VertexOutput
+{
+    float4 PosH     : SV_POSITION;
+    float2 TexC     : TEXCOORD;
+    float4 Color    : COLOR;
+};
+
+VertexOutput VS(VertexInput vin)
+{
+    VertexOutput vout;
+
+    vout.PosH = float4(vin.PosNDC, 0.0f, 1.0f);
+    vout.TexC = vin.TexC;
+    vout.Color = vin.Color;
+
+    return vout;
+}
+
+float4 PS(VertexOutput pin) : SV_Target
+{
+    // glyphs are rasterized 1:1 in pixels, so point sampling keeps them crisp.
+    float coverage = gGlyphAtlas.Sample(gsamPointClamp, pin.TexC).r;
+
+    return float4(pin.Color.rgb, pin.Color.a * coverage);
+}
@@ -0,0 +1,255 @@
+//***************************************************************************************
+// AssetArchiveTest.cpp
+//
+// Checks AssetArchive against archives written by AssetArchiveWriter: lookups and reads
+// of an intact archive, then copies of it damaged one field at a time, which Open() must
+// reject (or Read() report) without reading outside the mapping.
+//
+//	AssetArchiveTest
+//
+// Writes its archives to the current directory and deletes them.  Prints what fails and
+// exits with 1, or exits with 0 when everything holds.
+//***************************************************************************************
+
+#include "../../Helpers/AssetArchiveWriter.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	const char* ArchiveName = "AssetArchiveTest.pak";
+	const char* DamagedName = "AssetArchiveTest.damaged.pak";
+
+	int gFailures = 0;
+
+	void Check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", what);
+			++gFailures;
+		}
+	}
+
+	std::vector<std::uint8_t> Pattern(std::size_t size, std::uint32_t seed, bool compressible)
+	{
+		std::vector<std::uint8_t> data(size);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			data[i] = compressible ? (std::uint8_t)((i / 64) % 7 + (seed >> 31)) : (std::uint8_t)(seed >> 24);
+		}
+		return data;
+	}
+
+	bool ReadFile(const char* name, std::vector<std::uint8_t>& data)
+	{
+		FILE* file = std::fopen(name, "rb");
+		if (file == nullptr)
+			return false;
+		std::fseek(file, 0, SEEK_END);
+		data.resize((std::size_t)std::ftell(file));
+		std::fseek(file, 0, SEEK_SET);
+		bool read = data.empty() || std::fread(data.data(), 1, data.size(), file) == data.size();
+		std::fclose(file);
+		return read;
+	}
+
+	bool WriteFile(const char* name, const std::vector<std::uint8_t>& data)
+	{
+		FILE* file = std::fopen(name, "wb");
+		if (file == nullptr)
+			return false;
+		bool written = data.empty() || std::fwrite(data.data(), 1, data.size(), file) == data.size();
+		return (std::fclose(file) == 0) && written;
+	}
+
+	ArchiveHeader& Header(std::vector<std::uint8_t>& file)
+	{
+		return *reinterpret_cast<ArchiveHeader*>(file.data());
+	}
+
+	ArchiveEntry& Entry(std::vector<std::uint8_t>& file, std::uint32_t index)
+	{
+		return reinterpret_cast<ArchiveEntry*>(file.data() + sizeof(ArchiveHeader))[index];
+	}
+
+	// ---------- intact archive ----------
+
+	struct Source
+	{
+		const char* Name;				// as added
+		const char* Lookup;				// as looked up
+		std::vector<std::uint8_t> Data;
+		bool Compress;
+	};
+
+	void CheckIntact(const std::vector<Source>& sources)
+	{
+		AssetArchive archive;
+		Check(archive.Open(ArchiveName), "an intact archive opens");
+		Check(archive.EntryCount() == sources.size(), "entry count");
+
+		for (auto& source : sources)
+		{
+			std::uint32_t entry = archive.Find(source.Lookup);
+			Check(entry != AssetArchive::NotFound, source.Lookup);
+			if (entry == AssetArchive::NotFound)
+				continue;
+
+			std::vector<std::uint8_t> data;
+			Check(archive.Read(entry, data) && data == source.Data, "read contents");
+
+			ArchiveSpan span;
+			if (archive.Map(entry, span))
+			{
+				Check(!archive.IsCompressed(entry) && span.Size == source.Data.size() &&
+					(span.Size == 0 || std::memcmp(span.Data, source.Data.data(), span.Size) == 0), "mapped contents");
+			}
+			else
+			{
+				Check(source.Compress && archive.IsCompressed(entry), "only compressed entries are not mapped");
+			}
+		}
+
+		Check(archive.Find("textures/missing.dds") == AssetArchive::NotFound, "a missing name is not found");
+		Check(archive.Find("") == AssetArchive::NotFound, "an empty name is not found");
+	}
+
+	// ---------- damaged archives ----------
+
+	// 'damage' edits a copy of the archive, which Open() must then reject.
+	void CheckRejected(const std::vector<std::uint8_t>& intact, const char* what,
+		const std::function<void(std::vector<std::uint8_t>&)>& damage)
+	{
+		std::vector<std::uint8_t> file = intact;
+		damage(file);
+		if (!WriteFile(DamagedName, file))
+		{
+			Check(false, "cannot write the damaged archive");
+			return;
+		}
+
+		AssetArchive archive;
+		bool opened = archive.Open(DamagedName);
+		Check(!opened, what);
+
+		// what a caller would do next: must stay inside the mapping even so.
+		if (opened)
+			archive.Find("shaders/color.hlsl");
+	}
+
+	// 'damage' leaves the table of contents valid, but Read() must report the payload.
+	void CheckUnreadable(const std::vector<std::uint8_t>& intact, const char* lookup, const char* what,
+		const std::function<void(std::vector<std::uint8_t>&, const ArchiveEntry&)>& damage)
+	{
+		std::vector<std::uint8_t> file = intact;
+
+		AssetArchive reference;
+		reference.Open(ArchiveName);
+		std::uint32_t entry = reference.Find(lookup);
+		damage(file, Entry(file, entry));
+		reference.Close();
+
+		if (!WriteFile(DamagedName, file))
+		{
+			Check(false, "cannot write the damaged archive");
+			return;
+		}
+
+		AssetArchive archive;
+		std::vector<std::uint8_t> data;
+		Check(archive.Open(DamagedName), "a damaged payload still opens");
+		Check(!archive.Read(archive.Find(lookup), data), what);
+	}
+
+	void CheckDamaged(std::uint32_t firstCompressed)
+	{
+		std::vector<std::uint8_t> intact;
+		if (!ReadFile(ArchiveName, intact))
+		{
+			Check(false, "cannot read the archive back");
+			return;
+		}
+		const std::uint64_t size = intact.size();
+
+		CheckRejected(intact, "a file shorter than the header", [](std::vector<std::uint8_t>& f) { f.resize(sizeof(ArchiveHeader) - 1); });
+		CheckRejected(intact, "a wrong signature", [](std::vector<std::uint8_t>& f) { Header(f).Magic = 0x12345678; });
+		CheckRejected(intact, "a newer version", [](std::vector<std::uint8_t>& f) { Header(f).Version += 1; });
+		CheckRejected(intact, "a zero block size", [](std::vector<std::uint8_t>& f) { Header(f).BlockSize = 0; });
+		CheckRejected(intact, "more entries than the file holds", [](std::vector<std::uint8_t>& f) { Header(f).EntryCount = 0x7FFFFFFF; });
+		CheckRejected(intact, "names inside the table of contents", [](std::vector<std::uint8_t>& f) { Header(f).NamesOffset -= 1; });
+		CheckRejected(intact, "names starting past the end of the file", [size](std::vector<std::uint8_t>& f) { Header(f).NamesOffset = size + 4096; });
+		CheckRejected(intact, "names starting far past the end of the file", [](std::vector<std::uint8_t>& f) { Header(f).NamesOffset = UINT64_MAX - 8; });
+		CheckRejected(intact, "names running past the end of the file", [size](std::vector<std::uint8_t>& f) { Header(f).NamesSize = size; });
+		CheckRejected(intact, "a name outside the names", [](std::vector<std::uint8_t>& f) { Entry(f, 1).NameOffset = (std::uint32_t)Header(f).NamesSize; });
+		CheckRejected(intact, "a payload starting past the end", [size](std::vector<std::uint8_t>& f) { Entry(f, 0).Offset = size + 1; });
+		CheckRejected(intact, "a payload running past the end", [size](std::vector<std::uint8_t>& f) { Entry(f, 0).StoredSize = size; Entry(f, 0).Size = size; });
+		CheckRejected(intact, "an uncompressed size not matching", [](std::vector<std::uint8_t>& f)
+		{
+			for (std::uint32_t i = 0; i < Header(f).EntryCount; ++i)
+			{
+				if (Entry(f, i).Compression == ArchiveCompression::None)
+				{
+					Entry(f, i).Size += 1;
+					break;
+				}
+			}
+		});
+		CheckRejected(intact, "an unknown compression", [](std::vector<std::uint8_t>& f) { Entry(f, 0).Compression = (ArchiveCompression)7; });
+		CheckRejected(intact, "entries out of hash order", [](std::vector<std::uint8_t>& f) { std::swap(Entry(f, 0), Entry(f, 1)); });
+		CheckRejected(intact, "a file cut inside the table of contents", [](std::vector<std::uint8_t>& f) { f.resize(sizeof(ArchiveHeader) + sizeof(ArchiveEntry) / 2); });
+
+		if (firstCompressed == UINT32_MAX)
+			return;
+
+		CheckUnreadable(intact, "textures/stone.dds", "a block table not adding up",
+			[](std::vector<std::uint8_t>& f, const ArchiveEntry& e) { f[(std::size_t)e.Offset] ^= 0x10; });
+		CheckUnreadable(intact, "textures/stone.dds", "a raw block of the wrong size",
+			[](std::vector<std::uint8_t>& f, const ArchiveEntry& e)
+		{
+			std::uint32_t first;
+			std::memcpy(&first, &f[(std::size_t)e.Offset], sizeof(first));
+			first |= ArchiveEntry::RawBlock;
+			std::memcpy(&f[(std::size_t)e.Offset], &first, sizeof(first));
+		});
+	}
+}
+
+int main()
+{
+	std::vector<Source> sources;
+	sources.push_back({ "Textures/Stone.dds", "textures\\STONE.dds", Pattern(600 * 1024, 1, true), true });
+	sources.push_back({ "Textures/noise.dds", "./Textures/noise.dds", Pattern(200 * 1024, 2, false), true });
+	sources.push_back({ "Shaders/Color.hlsl", "shaders//color.hlsl", Pattern(3000, 3, true), false });
+	sources.push_back({ "empty.txt", "EMPTY.TXT", {}, false });
+
+	AssetArchiveWriter writer(4096, 64 * 1024);
+	for (auto& source : sources)
+		Check(writer.Add(source.Name, source.Data, source.Compress), source.Name);
+	Check(!writer.Add("textures\\stone.dds", {}, false), "a name added twice is refused");
+	Check(writer.Write(ArchiveName), "the archive is written");
+
+	CheckIntact(sources);
+
+	std::uint32_t firstCompressed = UINT32_MAX;
+	{
+		AssetArchive archive;
+		if (archive.Open(ArchiveName))
+		{
+			std::uint32_t stone = archive.Find("textures/stone.dds");
+			Check(stone != AssetArchive::NotFound && archive.IsCompressed(stone), "a compressible entry is compressed");
+			firstCompressed = stone;
+		}
+	}
+	CheckDamaged(firstCompressed);
+
+	std::remove(ArchiveName);
+	std::remove(DamagedName);
+
+	std::printf("%d failures\n", gFailures);
+	return (gFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+//***************************************************************************************
+// AssetPacker.cpp
+//
+// Packs files into an asset archive (.pak, see AssetArchive.h) that the demo reads in
+// place of the loose files it holds.
+//
+//	AssetPacker [options] output.pak inputs...
+//		-c					compress with LZ4 (entries that do not shrink are stored as is)
+//		-align bytes		payload alignment (4096)
+//		-block bytes		compressed block size (262144)
+//
+// A directory input adds every file below it.  Entries are named by their path as given
+// on the command line, so run it from the demo's directory:
+//
+//	AssetPacker -c Assets.pak Textures Shaders
+//***************************************************************************************
+
+#include "../../Helpers/AssetArchiveWriter.h"
+#include "../../Helpers/MappedFile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	struct Options
+	{
+		bool Compress = false;
+		std::uint32_t Alignment = AssetArchiveWriter::DefaultAlignment;
+		std::uint32_t BlockSize = AssetArchiveWriter::DefaultBlockSize;
+		const char* Output = nullptr;
+		std::vector<std::string> Inputs;
+	};
+
+	// ---------- command line ----------
+
+	void PrintUsage()
+	{
+		std::printf(
+			"usage: AssetPacker [options] output.pak inputs...\n"
+			"  -c              compress with LZ4\n"
+			"  -align bytes    payload alignment (4096)\n"
+			"  -block bytes    compressed block size (262144)\n");
+	}
+
+	bool ParseSize(const char* value, std::uint32_t& size)
+	{
+		char* end = nullptr;
+		unsigned long parsed = std::strtoul(value, &end, 10);
+		if (end == value || *end != 0 || parsed == 0 || parsed > 0x7FFFFFFF)
+			return false;
+		size = (std::uint32_t)parsed;
+		return true;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+
+			if (arg == "-c")
+				options.Compress = true;
+			else if (arg == "-align")
+			{
+				if (!ParseSize(value, options.Alignment))
+					return false;
+				++i;
+			}
+			else if (arg == "-block")
+			{
+				if (!ParseSize(value, options.BlockSize))
+					return false;
+				++i;
+			}
+			else if (arg[0] == '-')
+				return false;
+			else if (!options.Output)
+				options.Output = argv[i];
+			else
+				options.Inputs.push_back(arg);
+		}
+		return options.Output && !options.Inputs.empty();
+	}
+
+	// ---------- inputs ----------
+
+	// 'path' itself if it is a file, every file below it if it is a directory.
+	void ListFiles(const std::string& path, std::vector<std::string>& files)
+	{
+#if defined(_WIN32)
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+		{
+			files.push_back(path);
+			return;
+		}
+
+		WIN32_FIND_DATAA found;
+		HANDLE find = FindFirstFileA((path + "/*").c_str(), &found);
+		if (find == INVALID_HANDLE_VALUE)
+			return;
+		do
+		{
+			std::string name = found.cFileName;
+			if (name != "." && name != "..")
+				ListFiles(path + "/" + name, files);
+		} while (FindNextFileA(find, &found));
+		FindClose(find);
+#else
+		struct stat status;
+		if (stat(path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode))
+		{
+			files.push_back(path);
+			return;
+		}
+
+		DIR* dir = opendir(path.c_str());
+		if (dir == nullptr)
+			return;
+		while (dirent* found = readdir(dir))
+		{
+			std::string name = found->d_name;
+			if (name != "." && name != "..")
+				ListFiles(path + "/" + name, files);
+		}
+		closedir(dir);
+#endif
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<std::string> files;
+	for (auto& input : options.Inputs)
+		ListFiles(input, files);
+
+	auto start = std::chrono::steady_clock::now();
+
+	// ---------- read ----------
+	AssetArchiveWriter writer(options.Alignment, options.BlockSize);
+	for (auto& name : files)
+	{
+		MappedFile file;
+		if (!file.Open(name.c_str()))
+		{
+			std::fprintf(stderr, "%s: cannot open (error %lu)\n", name.c_str(), file.LastError());
+			return 1;
+		}
+
+		file.Prefetch(0, file.Size());
+		std::vector<std::uint8_t> data(file.Data(), file.Data() + file.Size());
+		if (!writer.Add(name.c_str(), std::move(data), options.Compress))
+		{
+			std::fprintf(stderr, "%s: not a valid name, or added twice\n", name.c_str());
+			return 1;
+		}
+	}
+
+	// ---------- write ----------
+	if (!writer.Write(options.Output))
+	{
+		std::fprintf(stderr, "%s: cannot write\n", options.Output);
+		return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("%s: %u files, %llu bytes stored as %llu, %.2f s\n", options.Output, writer.EntryCount(),
+		(unsigned long long)writer.Size(), (unsigned long long)writer.StoredSize(), seconds);
+	return 0;
+}
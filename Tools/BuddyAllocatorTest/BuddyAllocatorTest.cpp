@@ -0,0 +1,229 @@
+//***************************************************************************************
+// BuddyAllocatorTest.cpp
+//
+// Checks BuddyAllocator with random allocate/free sequences against a shadow list of the
+// blocks handed out: no two blocks overlap, every block honours its alignment and lies
+// inside the range, the statistics add up, PlanCompaction only moves blocks into free
+// space below them, and freeing everything merges the range back into one block.  Ends
+// with a timing of the allocate/free cycle.
+//
+//	BuddyAllocatorTest
+//
+// Prints what fails and exits with 1, or exits with 0 when everything holds.
+//***************************************************************************************
+
+#include "../../Helpers/BuddyAllocator.h"
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const std::uint64_t Capacity = 64ull * 1024 * 1024;
+	const std::uint64_t MinBlockSize = 64 * 1024;
+
+	int gFailures = 0;
+
+	void Check(bool condition, const char* what, std::uint64_t offset)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s (offset %llu)\n", what, (unsigned long long)offset);
+			++gFailures;
+		}
+	}
+
+	struct Shadow
+	{
+		std::uint64_t BlockSize;
+		std::uint64_t Requested;
+	};
+
+	std::uint64_t BlockSizeFor(std::uint64_t size, std::uint64_t alignment)
+	{
+		std::uint64_t block = MinBlockSize;
+		while (block < size || block < alignment)
+			block <<= 1;
+		return block;
+	}
+
+	// the block at 'it' against its neighbours in offset order.
+	void CheckPlacement(const std::map<std::uint64_t, Shadow>& blocks, std::map<std::uint64_t, Shadow>::const_iterator it)
+	{
+		Check(it->first % it->second.BlockSize == 0, "block aligned to its size", it->first);
+		Check(it->first + it->second.BlockSize <= Capacity, "block inside the range", it->first);
+		if (it != blocks.begin())
+		{
+			auto prev = std::prev(it);
+			Check(prev->first + prev->second.BlockSize <= it->first, "no overlap with the block below", it->first);
+		}
+		auto next = std::next(it);
+		if (next != blocks.end())
+			Check(it->first + it->second.BlockSize <= next->first, "no overlap with the block above", it->first);
+	}
+
+	void CheckStats(const BuddyAllocator& allocator, const std::map<std::uint64_t, Shadow>& blocks)
+	{
+		std::uint64_t used = 0, requested = 0;
+		for (const auto& elem : blocks)
+		{
+			used += elem.second.BlockSize;
+			requested += elem.second.Requested;
+		}
+
+		BuddyAllocator::Stats stats = allocator.GetStats();
+		Check(stats.Capacity == Capacity, "capacity", 0);
+		Check(stats.UsedBytes == used, "used bytes", 0);
+		Check(stats.RequestedBytes == requested, "requested bytes", 0);
+		Check(stats.AllocationCount == blocks.size(), "allocation count", 0);
+		Check(stats.LargestFreeBlock <= Capacity - used, "largest free block within the free bytes", 0);
+		Check(allocator.Empty() == blocks.empty(), "empty", 0);
+	}
+
+	void Allocate(BuddyAllocator& allocator, std::map<std::uint64_t, Shadow>& blocks, std::mt19937& random)
+	{
+		// mostly small resources, some large ones, a few with MSAA alignment.
+		std::uint64_t size = (random() % 8 == 0) ? 1 + random() % (8 * 1024 * 1024) : 1 + random() % (512 * 1024);
+		std::uint64_t alignment = (random() % 16 == 0) ? 4 * 1024 * 1024 : MinBlockSize;
+
+		std::uint64_t largestFree = allocator.GetStats().LargestFreeBlock;
+		std::uint64_t offset = allocator.Allocate(size, alignment);
+		if (offset == BuddyAllocator::InvalidOffset)
+		{
+			Check(largestFree < BlockSizeFor(size, alignment), "refused although a free block is large enough", size);
+			return;
+		}
+
+		Check(offset % alignment == 0, "offset honours the alignment", offset);
+		Check(blocks.find(offset) == blocks.end(), "offset handed out twice", offset);
+		auto it = blocks.insert(std::make_pair(offset, Shadow{ BlockSizeFor(size, alignment), size })).first;
+		CheckPlacement(blocks, it);
+	}
+
+	void Free(BuddyAllocator& allocator, std::map<std::uint64_t, Shadow>& blocks, std::mt19937& random)
+	{
+		auto it = blocks.begin();
+		std::advance(it, random() % blocks.size());
+		allocator.Free(it->first);
+		blocks.erase(it);
+	}
+
+	void CheckCompaction(BuddyAllocator& allocator, std::map<std::uint64_t, Shadow>& blocks, std::size_t maxMoves)
+	{
+		std::vector<BuddyAllocator::Move> moves = allocator.PlanCompaction(maxMoves);
+		Check(moves.size() <= maxMoves, "no more moves than allowed", moves.size());
+
+		for (const auto& move : moves)
+		{
+			auto from = blocks.find(move.From);
+			Check(from != blocks.end(), "moves an allocated block", move.From);
+			if (from == blocks.end())
+				continue;
+
+			Check(move.To < move.From, "moves towards the start", move.From);
+			Check(move.Size == from->second.Requested, "move size", move.From);
+
+			Shadow shadow = from->second;
+			blocks.erase(from);
+			auto to = blocks.insert(std::make_pair(move.To, shadow));
+			Check(to.second, "moves into a free block", move.To);
+			CheckPlacement(blocks, to.first);
+		}
+
+		CheckStats(allocator, blocks);
+	}
+
+	void CheckRandom(std::uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		BuddyAllocator allocator(Capacity, MinBlockSize);
+		std::map<std::uint64_t, Shadow> blocks;
+
+		for (int step = 0; step < 20000; ++step)
+		{
+			// phases that fill the range and phases that drain it.
+			bool filling = (step / 500) % 2 == 0;
+			bool allocate = filling ? (random() % 4 != 0) : (random() % 4 == 0);
+			if (blocks.empty() || allocate)
+				Allocate(allocator, blocks, random);
+			else
+				Free(allocator, blocks, random);
+
+			if (step % 97 == 0)
+				CheckStats(allocator, blocks);
+			if (step % 1009 == 0)
+				CheckCompaction(allocator, blocks, 1 + random() % 16);
+		}
+		CheckCompaction(allocator, blocks, blocks.size());
+
+		while (!blocks.empty())
+			Free(allocator, blocks, random);
+		CheckStats(allocator, blocks);
+
+		// everything freed merges back into the whole range.
+		BuddyAllocator::Stats stats = allocator.GetStats();
+		Check(stats.FreeBlockCount == 1 && stats.LargestFreeBlock == Capacity, "free blocks merged", 0);
+		Check(allocator.Allocate(Capacity) == 0, "the whole range fits again", 0);
+	}
+
+	void CheckEdges()
+	{
+		BuddyAllocator allocator(Capacity, MinBlockSize);
+		Check(allocator.Allocate(0) == BuddyAllocator::InvalidOffset, "zero size refused", 0);
+		Check(allocator.Allocate(Capacity + 1) == BuddyAllocator::InvalidOffset, "oversized refused", 0);
+		Check(allocator.Allocate(1, Capacity * 2) == BuddyAllocator::InvalidOffset, "over-aligned refused", 0);
+
+		// a sparse layout: PlanCompaction packs it to the front.
+		std::vector<std::uint64_t> offsets;
+		for (int i = 0; i < 16; ++i)
+			offsets.push_back(allocator.Allocate(Capacity / 16));
+		for (int i = 0; i < 16; i += 2)
+			allocator.Free(offsets[i]);
+		std::vector<BuddyAllocator::Move> moves = allocator.PlanCompaction(16);
+		Check(moves.size() == 4, "half of the blocks move", moves.size());
+		Check(allocator.GetStats().LargestFreeBlock == Capacity / 2, "compaction frees the upper half", 0);
+	}
+
+	void Benchmark()
+	{
+		std::mt19937 random(7);
+		BuddyAllocator allocator(Capacity, MinBlockSize);
+		std::vector<std::uint64_t> live;
+		const int Cycles = 200000;
+
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < Cycles; ++i)
+		{
+			if (live.size() < 256)
+			{
+				std::uint64_t offset = allocator.Allocate(1 + random() % (512 * 1024), MinBlockSize);
+				if (offset != BuddyAllocator::InvalidOffset)
+					live.push_back(offset);
+			}
+			else
+			{
+				std::size_t index = random() % live.size();
+				allocator.Free(live[index]);
+				live[index] = live.back();
+				live.pop_back();
+			}
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+		std::printf("%d allocate/free calls with about 256 live blocks: %.0f ns per call\n", Cycles, ns / Cycles);
+	}
+}
+
+int main()
+{
+	for (std::uint32_t seed = 1; seed <= 4; ++seed)
+		CheckRandom(seed);
+	CheckEdges();
+	Benchmark();
+
+	std::printf("%d failures\n", gFailures);
+	return (gFailures == 0) ? 0 : 1;
+}
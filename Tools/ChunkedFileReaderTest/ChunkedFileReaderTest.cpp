@@ -0,0 +1,134 @@
+//***************************************************************************************
+// ChunkedFileReaderTest.cpp
+//
+// Checks ChunkedFileReader against the bytes it was given: files around the chunk size
+// (empty, one byte short, exact, one byte over, many chunks) read back through Next() in
+// random piece sizes and through Read(), the end of the file and past it, a missing file,
+// and a reader closed halfway (its thread waiting on a full chunk) then reopened.
+//
+//	ChunkedFileReaderTest
+//
+// Writes its files to the current directory and deletes them.  Prints what fails and
+// exits with 1, or exits with 0 when everything holds.
+//***************************************************************************************
+
+#include "../../Helpers/ChunkedFileReader.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const char* FileName = "ChunkedFileReaderTest.bin";
+
+	int gFailures = 0;
+
+	void Check(bool condition, const char* what, std::size_t size, std::size_t chunkSize)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s (file %zu bytes, chunks of %zu)\n", what, size, chunkSize);
+			++gFailures;
+		}
+	}
+
+	std::vector<std::uint8_t> WriteFile(std::size_t size, std::uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<std::uint8_t> data(size);
+		for (auto& byte : data)
+			byte = (std::uint8_t)random();
+
+		FILE* file = std::fopen(FileName, "wb");
+		if (file != nullptr)
+		{
+			if (size != 0)
+				std::fwrite(data.data(), 1, size, file);
+			std::fclose(file);
+		}
+		return data;
+	}
+
+	void CheckNext(const std::vector<std::uint8_t>& data, std::size_t chunkSize, std::mt19937& random)
+	{
+		ChunkedFileReader reader(chunkSize);
+		Check(reader.Open(FileName), "opens", data.size(), chunkSize);
+		Check(reader.Size() == data.size(), "size", data.size(), chunkSize);
+
+		// pieces end at chunk ends at the latest, so they come out at most chunkSize long.
+		std::vector<std::uint8_t> read;
+		for (;;)
+		{
+			const std::uint8_t* piece;
+			std::size_t size = reader.Next(1 + random() % (2 * chunkSize + 3), piece);
+			if (size == 0)
+				break;
+
+			Check(size <= chunkSize, "a piece within one chunk", data.size(), chunkSize);
+			read.insert(read.end(), piece, piece + size);
+			Check(reader.Position() == read.size(), "position follows the pieces", data.size(), chunkSize);
+		}
+
+		Check(read == data, "Next() hands out the file's bytes in order", data.size(), chunkSize);
+		Check(reader.LastError() == 0, "no read error", data.size(), chunkSize);
+
+		const std::uint8_t* piece;
+		Check(reader.Next(16, piece) == 0, "nothing past the end", data.size(), chunkSize);
+		std::uint8_t byte;
+		Check(!reader.Read(&byte, 1), "Read() past the end fails", data.size(), chunkSize);
+	}
+
+	void CheckRead(const std::vector<std::uint8_t>& data, std::size_t chunkSize)
+	{
+		ChunkedFileReader reader(chunkSize);
+		Check(reader.Open(FileName), "opens", data.size(), chunkSize);
+
+		// a header, then the rest in one call spanning every chunk.
+		std::size_t head = std::min<std::size_t>(data.size(), 7);
+		std::vector<std::uint8_t> read(data.size());
+		Check(reader.Read(read.data(), head), "reads the head", data.size(), chunkSize);
+		Check(reader.Read(read.data() + head, data.size() - head), "reads the rest", data.size(), chunkSize);
+		Check(read == data, "Read() copies the file's bytes", data.size(), chunkSize);
+	}
+
+	void CheckCloseEarly(const std::vector<std::uint8_t>& data, std::size_t chunkSize)
+	{
+		ChunkedFileReader reader(chunkSize);
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			// both chunks filled and the reader thread waiting: Close() has to wake it.
+			Check(reader.Open(FileName), "opens again", data.size(), chunkSize);
+			std::uint8_t byte = 0;
+			Check(reader.Read(&byte, 1) && byte == data[0], "first byte", data.size(), chunkSize);
+			reader.Close();
+			Check(!reader.IsOpen() && reader.Size() == 0, "closed", data.size(), chunkSize);
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 random(5);
+	const std::size_t chunkSizes[] = { 1, 1000, 4096 };
+	for (std::size_t chunkSize : chunkSizes)
+	{
+		const std::size_t sizes[] = { 0, 1, chunkSize - 1, chunkSize, chunkSize + 1, 2 * chunkSize, 5 * chunkSize + 17, 300000 };
+		for (std::size_t size : sizes)
+		{
+			std::vector<std::uint8_t> data = WriteFile(size, (std::uint32_t)(size + chunkSize));
+			CheckNext(data, chunkSize, random);
+			CheckRead(data, chunkSize);
+			if (size > 2 * chunkSize)
+				CheckCloseEarly(data, chunkSize);
+		}
+	}
+
+	ChunkedFileReader missing;
+	std::remove(FileName);
+	Check(!missing.Open(FileName) && missing.LastError() != 0, "a missing file does not open", 0, 0);
+
+	std::printf("%d failures\n", gFailures);
+	return (gFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+//***************************************************************************************
+// ResidencyPolicyTest.cpp
+//
+// Checks the decisions of ResidencyPolicy: least recently used objects go first, objects a
+// frame or a copy in flight may use are never evicted, used objects come back even over
+// budget while prefetch hints only come back when they fit (and only once), and
+// MarkCopied makes an evicted object resident at once.  Ends with random use against a
+// shadow of the resident set.
+//
+//	ResidencyPolicyTest
+//
+// Prints what fails and exits with 1, or exits with 0 when everything holds.
+//***************************************************************************************
+
+#include "../../Helpers/ResidencyPolicy.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	typedef ResidencyPolicy::Handle Handle;
+
+	int gFailures = 0;
+
+	void Check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", what);
+			++gFailures;
+		}
+	}
+
+	bool Contains(const std::vector<Handle>& handles, Handle handle)
+	{
+		return std::find(handles.begin(), handles.end(), handle) != handles.end();
+	}
+
+	void CheckEvictionOrder()
+	{
+		ResidencyPolicy policy;
+		Handle a = policy.Register(100, 1);
+		Handle b = policy.Register(100, 1);
+		Handle c = policy.Register(100, 1);
+		policy.MarkUsed(a, 2);
+
+		// b is now the least recently used, then c.
+		std::vector<Handle> evict, restore;
+		policy.Plan(200, 2, 0, evict, restore);
+		Check(evict.size() == 1 && evict[0] == b, "the least recently used object goes first");
+		Check(restore.empty(), "nothing to restore");
+
+		policy.Plan(100, 2, 0, evict, restore);
+		Check(evict.size() == 1 && evict[0] == c, "then the next least recently used one");
+		Check(policy.IsResident(a) && !policy.IsResident(b) && !policy.IsResident(c), "resident set after evicting");
+
+		policy.Plan(1000, 2, 0, evict, restore);
+		Check(evict.empty() && restore.empty(), "evicted objects stay out until used");
+
+		ResidencyPolicy::Stats stats = policy.GetStats();
+		Check(stats.ObjectCount == 3 && stats.ResidentCount == 1, "object counts");
+		Check(stats.TotalBytes == 300 && stats.ResidentBytes == 100, "byte counts");
+		Check(stats.Evictions == 2 && stats.Restores == 0, "eviction count");
+	}
+
+	void CheckInFlight()
+	{
+		ResidencyPolicy policy;
+		Handle a = policy.Register(100, 1);
+		Handle b = policy.Register(100, 1);
+		policy.MarkUsed(a, 5);
+		policy.MarkUsed(b, 6);
+
+		// a is the least recently used, but frame 5 has not completed.
+		std::vector<Handle> evict, restore;
+		policy.Plan(0, 4, 0, evict, restore);
+		Check(evict.empty(), "nothing in use by a frame in flight is evicted");
+
+		policy.Plan(0, 5, 0, evict, restore);
+		Check(evict.size() == 1 && evict[0] == a, "evicted once its frame completed");
+		Check(policy.IsResident(b), "the object of the frame still in flight stays");
+
+		policy.Plan(0, 6, 0, evict, restore);
+		Check(evict.size() == 1 && evict[0] == b, "all objects go when their frames completed");
+	}
+
+	void CheckCopies()
+	{
+		ResidencyPolicy policy;
+		Handle a = policy.Register(100, 1);
+		Handle b = policy.Register(100, 1);
+
+		// a copy in flight holds an object just like a frame does.
+		Check(!policy.MarkCopied(a, 3), "MarkCopied on a resident object needs nothing");
+		std::vector<Handle> evict, restore;
+		policy.Plan(0, 10, 2, evict, restore);
+		Check(evict.size() == 1 && evict[0] == b, "an object under a copy in flight stays");
+
+		policy.Plan(0, 10, 3, evict, restore);
+		Check(evict.size() == 1 && evict[0] == a, "evicted once the copy completed");
+
+		// an evicted object is resident as soon as MarkCopied returns.
+		Check(policy.MarkCopied(a, 4), "MarkCopied on an evicted object asks to make it resident");
+		Check(policy.IsResident(a) && policy.GetStats().ResidentBytes == 100, "counted resident at once");
+		policy.Plan(1000, 10, 3, evict, restore);
+		Check(evict.empty() && restore.empty(), "no second restore for it");
+		Check(policy.GetStats().Restores == 1, "restore count");
+	}
+
+	void CheckPrefetch()
+	{
+		ResidencyPolicy policy;
+		Handle a = policy.Register(100, 1);
+		Handle b = policy.Register(100, 1);
+		Handle c = policy.Register(100, 1);
+
+		std::vector<Handle> evict, restore;
+		policy.Plan(0, 1, 0, evict, restore);
+		Check(evict.size() == 3, "everything evicted");
+
+		// a hint over budget is dropped; a use is restored regardless.
+		policy.Prefetch(a);
+		policy.MarkUsed(b, 2);
+		policy.Plan(100, 1, 0, evict, restore);
+		Check(restore.size() == 1 && restore[0] == b, "the used object comes back, the hint waits");
+		Check(!policy.IsResident(a), "a hint that does not fit stays evicted");
+
+		// hints are one-shot: room alone does not bring a back.
+		policy.Plan(1000, 1, 0, evict, restore);
+		Check(restore.empty(), "a dropped hint is forgotten");
+
+		policy.Prefetch(a);
+		policy.Prefetch(a);
+		policy.Plan(1000, 1, 0, evict, restore);
+		Check(restore.size() == 1 && restore[0] == a, "a hint that fits is restored once");
+		Check(policy.LastUse(a) == 1, "a prefetch is not a use");
+
+		// a restored hint moves to the most recently used end: c passes b and a.
+		policy.Prefetch(c);
+		policy.Plan(1000, 2, 0, evict, restore);
+		Check(restore.size() == 1 && restore[0] == c, "the second hint is restored");
+		policy.Plan(200, 2, 0, evict, restore);
+		Check(evict.size() == 1 && evict[0] == b, "the least recently used object goes, not the restored hint");
+
+		// an unregistered object with a pending hint is not restored.
+		Handle d = policy.Register(50, 2);
+		policy.Plan(0, 2, 0, evict, restore);
+		policy.Prefetch(d);
+		policy.Unregister(d);
+		policy.Plan(1000, 2, 0, evict, restore);
+		Check(!Contains(restore, d), "an unregistered object is forgotten");
+	}
+
+	void CheckRandom()
+	{
+		std::mt19937 random(11);
+		ResidencyPolicy policy;
+		std::vector<Handle> handles;
+		std::vector<std::uint64_t> lastUse;
+		std::vector<bool> resident;
+		std::uint64_t frame = 1;
+		std::uint64_t budget = 4000;
+
+		for (int i = 0; i < 64; ++i)
+		{
+			handles.push_back(policy.Register(50 + random() % 200, frame));
+			lastUse.push_back(frame);
+			resident.push_back(true);
+		}
+
+		std::vector<Handle> evict, restore;
+		for (int step = 0; step < 2000; ++step)
+		{
+			++frame;
+			std::vector<bool> used(handles.size(), false);
+			for (int n = 0; n < 8; ++n)
+			{
+				std::size_t i = random() % handles.size();
+				policy.MarkUsed(handles[i], frame);
+				lastUse[i] = frame;
+				used[i] = true;
+			}
+			for (int n = 0; n < 4; ++n)
+				policy.Prefetch(handles[random() % handles.size()]);
+
+			// up to 2 frames in flight.
+			std::uint64_t completed = frame - 1 - random() % 3;
+			policy.Plan(budget, completed, 0, evict, restore);
+
+			for (Handle h : evict)
+			{
+				std::size_t i = std::find(handles.begin(), handles.end(), h) - handles.begin();
+				Check(resident[i], "evicts only resident objects");
+				Check(lastUse[i] <= completed, "never evicts what a frame in flight uses");
+				resident[i] = false;
+			}
+			for (Handle h : restore)
+			{
+				std::size_t i = std::find(handles.begin(), handles.end(), h) - handles.begin();
+				Check(!resident[i], "restores only evicted objects");
+				resident[i] = true;
+			}
+
+			std::uint64_t residentBytes = 0;
+			for (std::size_t i = 0; i < handles.size(); ++i)
+			{
+				Check(policy.IsResident(handles[i]) == resident[i], "resident set matches the decisions");
+				Check(!used[i] || resident[i], "what the frame uses is resident");
+				if (resident[i])
+					residentBytes += policy.Size(handles[i]);
+			}
+			Check(policy.GetStats().ResidentBytes == residentBytes, "resident bytes match the decisions");
+		}
+	}
+}
+
+int main()
+{
+	CheckEvictionOrder();
+	CheckInFlight();
+	CheckCopies();
+	CheckPrefetch();
+	CheckRandom();
+
+	std::printf("%d failures\n", gFailures);
+	return (gFailures == 0) ? 0 : 1;
+}
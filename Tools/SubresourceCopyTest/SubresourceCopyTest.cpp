@@ -0,0 +1,218 @@
+//***************************************************************************************
+// SubresourceCopyTest.cpp
+//
+// Checks SubresourceCopy without a device: ComputeFootprints against layouts
+// GetCopyableFootprints returns for the same textures, and CopySubresources (rows spread
+// over threads) against a plain serial copy into the same footprints, padding included.
+//
+//	SubresourceCopyTest
+//
+// Prints what fails and exits with 1, or exits with 0 when everything matches.
+//***************************************************************************************
+
+#include "../../Helpers/ParallelFor.h"
+#include "../../Helpers/SubresourceCopy.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	int gFailures = 0;
+
+	void Check(bool condition, const char* what, std::uint32_t subresource)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s (subresource %u)\n", what, subresource);
+			++gFailures;
+		}
+	}
+
+	struct Texture
+	{
+		const char* Name;
+		std::uint32_t Width, Height, Depth, MipLevels, ArraySize;
+		std::uint32_t BlockSize, BytesPerBlock;
+	};
+
+	// what GetCopyableFootprints returns for the first subresources of a texture.
+	struct ExpectedFootprint
+	{
+		std::uint64_t Offset;
+		std::uint32_t RowPitch;
+		std::uint32_t NumRows;
+		std::uint64_t RowSize;
+	};
+
+	// ---------- ComputeFootprints ----------
+
+	void CheckLayout(const Texture& texture, const ExpectedFootprint* expected, std::uint32_t count)
+	{
+		std::vector<SubresourceFootprint> footprints(count);
+		ComputeFootprints(texture.Width, texture.Height, texture.Depth, texture.MipLevels,
+			texture.BlockSize, texture.BytesPerBlock, 0, count, 0, footprints.data());
+
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			Check(footprints[i].Offset == expected[i].Offset, "offset", i);
+			Check(footprints[i].RowPitch == expected[i].RowPitch, "row pitch", i);
+			Check(footprints[i].NumRows == expected[i].NumRows, "row count", i);
+			Check(footprints[i].RowSize == expected[i].RowSize, "row size", i);
+		}
+	}
+
+	// alignment, and a range starting past the first subresource matches the whole layout.
+	void CheckRanges(const Texture& texture)
+	{
+		std::uint32_t count = texture.MipLevels * texture.ArraySize;
+		std::vector<SubresourceFootprint> all(count);
+		std::uint64_t total = ComputeFootprints(texture.Width, texture.Height, texture.Depth, texture.MipLevels,
+			texture.BlockSize, texture.BytesPerBlock, 0, count, 0, all.data());
+
+		const SubresourceFootprint& last = all[count - 1];
+		Check(total == last.Offset + (std::uint64_t)(last.NumRows * last.Depth - 1) * last.RowPitch + last.RowSize,
+			"total size", count - 1);
+
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			Check(all[i].Offset % SubresourcePlacementAlignment == 0, "placement alignment", i);
+			Check(all[i].RowPitch % SubresourcePitchAlignment == 0, "pitch alignment", i);
+			Check(all[i].RowPitch >= all[i].RowSize, "pitch below row size", i);
+		}
+
+		if (count < 2)
+			return;
+
+		const std::uint64_t baseOffset = 3 * SubresourcePlacementAlignment;
+		std::vector<SubresourceFootprint> tail(count - 1);
+		ComputeFootprints(texture.Width, texture.Height, texture.Depth, texture.MipLevels,
+			texture.BlockSize, texture.BytesPerBlock, 1, count - 1, baseOffset, tail.data());
+
+		for (std::uint32_t i = 1; i < count; ++i)
+		{
+			const SubresourceFootprint& a = all[i];
+			const SubresourceFootprint& b = tail[i - 1];
+			Check(b.Offset - baseOffset == a.Offset - all[1].Offset, "range offset", i);
+			Check(a.Width == b.Width && a.Height == b.Height && a.Depth == b.Depth && a.RowPitch == b.RowPitch
+				&& a.NumRows == b.NumRows && a.RowSize == b.RowSize, "range footprint", i);
+		}
+	}
+
+	// ---------- CopySubresources ----------
+
+	void CopySerial(std::uint8_t* dest, const SubresourceFootprint* footprints,
+		const SubresourceSource* sources, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const SubresourceFootprint& fp = footprints[i];
+			const std::uint8_t* src = static_cast<const std::uint8_t*>(sources[i].Data);
+
+			for (std::uint32_t z = 0; z < fp.Depth; ++z)
+			{
+				for (std::uint32_t y = 0; y < fp.NumRows; ++y)
+				{
+					std::memcpy(dest + fp.Offset + (std::uint64_t)fp.RowPitch * (z * fp.NumRows + y),
+						src + sources[i].SlicePitch * z + sources[i].RowPitch * y, (std::size_t)fp.RowSize);
+				}
+			}
+		}
+	}
+
+	// sources with rows and slices padded apart, as a loaded file or a mapping may have them.
+	void CheckCopy(const Texture& texture)
+	{
+		std::uint32_t count = texture.MipLevels * texture.ArraySize;
+		std::vector<SubresourceFootprint> footprints(count);
+		std::uint64_t total = ComputeFootprints(texture.Width, texture.Height, texture.Depth, texture.MipLevels,
+			texture.BlockSize, texture.BytesPerBlock, 0, count, 0, footprints.data());
+
+		std::uint32_t seed = 12345;
+		std::vector<std::vector<std::uint8_t>> data(count);
+		std::vector<SubresourceSource> sources(count);
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			const SubresourceFootprint& fp = footprints[i];
+			sources[i].RowPitch = (std::int64_t)fp.RowSize + 4 * (i % 3);
+			sources[i].SlicePitch = sources[i].RowPitch * fp.NumRows + 16 * (i % 2);
+
+			data[i].resize((std::size_t)(sources[i].SlicePitch * fp.Depth));
+			for (auto& byte : data[i])
+			{
+				seed = seed * 1664525 + 1013904223;
+				byte = (std::uint8_t)(seed >> 24);
+			}
+			sources[i].Data = data[i].data();
+		}
+
+		// padding between rows and subresources keeps its fill.
+		std::vector<std::uint8_t> parallel((std::size_t)total, 0xCD);
+		std::vector<std::uint8_t> serial((std::size_t)total, 0xCD);
+		CopySubresources(parallel.data(), footprints.data(), sources.data(), count);
+		CopySerial(serial.data(), footprints.data(), sources.data(), count);
+
+		// reports the subresource the first difference falls in.
+		std::size_t at = 0;
+		while (at < parallel.size() && parallel[at] == serial[at])
+			++at;
+		std::uint32_t subresource = 0;
+		while (subresource + 1 < count && footprints[subresource + 1].Offset <= at)
+			++subresource;
+		Check(at == parallel.size(), "copy differs from the serial copy", subresource);
+	}
+
+	void Run(const Texture& texture, const ExpectedFootprint* expected, std::uint32_t expectedCount)
+	{
+		int failures = gFailures;
+		if (expected != nullptr)
+			CheckLayout(texture, expected, expectedCount);
+		CheckRanges(texture);
+		CheckCopy(texture);
+		std::printf("%-32s %s\n", texture.Name, (gFailures == failures) ? "ok" : "FAILED");
+	}
+}
+
+int main()
+{
+	// 512x512 BC1, full chain: rows of blocks, pitch padded to 256 from mip 3 on.
+	const Texture bc1 = { "512x512 BC1, 10 mips, 2 slices", 512, 512, 1, 10, 2, 4, 8 };
+	const ExpectedFootprint bc1Expected[] =
+	{
+		{ 0, 1024, 128, 1024 },
+		{ 131072, 512, 64, 512 },
+		{ 163840, 256, 32, 256 },
+		{ 172032, 256, 16, 128 },
+		{ 176128, 256, 8, 64 },
+	};
+	Run(bc1, bc1Expected, 5);
+
+	// odd sizes: row pitch rounds up to 256, offsets to 512.
+	const Texture rgba = { "300x17 RGBA8, 9 mips", 300, 17, 1, 9, 1, 1, 4 };
+	const ExpectedFootprint rgbaExpected[] =
+	{
+		{ 0, 1280, 17, 1200 },
+		{ 22016, 768, 8, 600 },
+		{ 28160, 512, 4, 300 },
+	};
+	Run(rgba, rgbaExpected, 3);
+
+	// depth slices are packed back to back within a subresource.
+	const Texture volume = { "64x32x8 RGBA8, 7 mips", 64, 32, 8, 7, 1, 1, 4 };
+	const ExpectedFootprint volumeExpected[] =
+	{
+		{ 0, 256, 32, 256 },
+		{ 65536, 256, 16, 128 },
+	};
+	Run(volume, volumeExpected, 2);
+
+	// a partial block at the edge and a texture smaller than one block.
+	Run({ "1000x600 BC7, 10 mips", 1000, 600, 1, 10, 1, 4, 16 }, nullptr, 0);
+	Run({ "2x2 BC4", 2, 2, 1, 1, 1, 4, 8 }, nullptr, 0);
+
+	// large enough to be split into many runs over the threads.
+	Run({ "4096x4096 RGBA8, 2 slices", 4096, 4096, 1, 1, 2, 1, 4 }, nullptr, 0);
+
+	std::printf("%u threads, %d failures\n", ParallelForThreadCount(), gFailures);
+	return (gFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+//***************************************************************************************
+// TextureCooker.cpp
+//
+// Offline texture cooker: reads a TGA or DDS image, builds its mip chain and writes it
+// block-compressed as a .dds file the demo loads like any other (PrepareTextures).
+//
+//	TextureCooker [options] input.tga|input.dds output.dds
+//		-f bc1|bc2|bc3|bc4|bc5|bc7|rgba8	output format (bc7)
+//		-q fast|normal|best					encoder quality (normal)
+//		-srgb								store as an _SRGB format
+//		-linear								filter the mips as plain data (normal maps, masks)
+//		-filter box|kaiser					mip filter (kaiser)
+//		-nomips								write the top level only
+//
+// Color is filtered in linear light unless -linear is given, as the streamer does for
+// textures stored without mips.  Only the top level of a DDS input is used.
+//***************************************************************************************
+
+#include "../../Helpers/BlockEncoder.h"
+#include "../../Helpers/DDSReader.h"
+#include "../../Helpers/DDSWriter.h"
+#include "../../Helpers/MappedFile.h"
+#include "../../Helpers/MipGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		DdsFormat Format = DdsFormat::BC7;
+		EncodeQuality Quality = EncodeQuality::Normal;
+		MipFilter Filter = MipFilter::Kaiser;
+		bool Srgb = false;
+		bool Linear = false;
+		bool Mips = true;
+		const char* Input = nullptr;
+		const char* Output = nullptr;
+	};
+
+	inline std::uint32_t Read16(const std::uint8_t* p) { return p[0] | (p[1] << 8); }
+
+	// ---------- TGA ----------
+
+	// uncompressed or RLE true-color images, 24 or 32 bits per pixel.
+	bool LoadTga(const std::uint8_t* data, std::size_t size, RgbaImage& image, std::string& error)
+	{
+		if (size < 18)
+		{
+			error = "not a TGA file";
+			return false;
+		}
+
+		const std::uint32_t type = data[2];
+		const std::uint32_t bits = data[16];
+		const bool topDown = (data[17] & 0x20) != 0;
+		if ((type != 2 && type != 10) || (bits != 24 && bits != 32) || data[1] != 0)
+		{
+			error = "only 24 or 32 bit true-color TGA files are supported";
+			return false;
+		}
+
+		image.Width = Read16(data + 12);
+		image.Height = Read16(data + 14);
+		image.Rgba.assign(4 * (std::size_t)image.Width * image.Height, 255);
+
+		const std::size_t bytes = bits / 8;
+		const std::size_t count = (std::size_t)image.Width * image.Height;
+		const std::uint8_t* p = data + 18 + data[0];
+		const std::uint8_t* end = data + size;
+
+		// pixels in file order, bottom row first unless the image says otherwise.
+		std::size_t pixel = 0;
+		auto put = [&](const std::uint8_t* bgra)
+		{
+			std::size_t row = pixel / image.Width;
+			std::size_t column = pixel % image.Width;
+			if (!topDown)
+				row = image.Height - 1 - row;
+
+			std::uint8_t* out = &image.Rgba[4 * (row * image.Width + column)];
+			out[0] = bgra[2];
+			out[1] = bgra[1];
+			out[2] = bgra[0];
+			out[3] = (bytes == 4) ? bgra[3] : 255;
+			++pixel;
+		};
+
+		while (pixel < count)
+		{
+			std::size_t run = 1;
+			bool repeat = false;
+			if (type == 10)
+			{
+				if (p >= end)
+					break;
+				run = (*p & 0x7F) + 1;
+				repeat = (*p & 0x80) != 0;
+				++p;
+			}
+
+			run = std::min(run, count - pixel);
+			if (p + (repeat ? 1 : run) * bytes > end)
+				break;
+
+			for (std::size_t i = 0; i < run; ++i)
+			{
+				put(p);
+				if (!repeat)
+					p += bytes;
+			}
+			if (repeat)
+				p += bytes;
+		}
+
+		if (pixel < count)
+		{
+			error = "the TGA file is truncated";
+			return false;
+		}
+		return true;
+	}
+
+	// ---------- command line ----------
+
+	void PrintUsage()
+	{
+		std::printf(
+			"usage: TextureCooker [options] input.tga|input.dds output.dds\n"
+			"  -f bc1|bc2|bc3|bc4|bc5|bc7|rgba8  output format (bc7)\n"
+			"  -q fast|normal|best                encoder quality (normal)\n"
+			"  -srgb                              store as an _SRGB format\n"
+			"  -linear                            filter the mips as plain data\n"
+			"  -filter box|kaiser                 mip filter (kaiser)\n"
+			"  -nomips                            write the top level only\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		static const struct { const char* Name; DdsFormat Format; } Formats[] =
+		{
+			{ "bc1", DdsFormat::BC1 }, { "bc2", DdsFormat::BC2 }, { "bc3", DdsFormat::BC3 }, { "bc4", DdsFormat::BC4 },
+			{ "bc5", DdsFormat::BC5 }, { "bc7", DdsFormat::BC7 }, { "rgba8", DdsFormat::RGBA8 },
+		};
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+			const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+
+			if (arg == "-f")
+			{
+				auto format = std::find_if(std::begin(Formats), std::end(Formats),
+					[&](const decltype(Formats[0])& f) { return std::strcmp(f.Name, value) == 0; });
+				if (format == std::end(Formats))
+					return false;
+				options.Format = format->Format;
+				++i;
+			}
+			else if (arg == "-q")
+			{
+				if (std::strcmp(value, "fast") == 0)
+					options.Quality = EncodeQuality::Fast;
+				else if (std::strcmp(value, "normal") == 0)
+					options.Quality = EncodeQuality::Normal;
+				else if (std::strcmp(value, "best") == 0)
+					options.Quality = EncodeQuality::Best;
+				else
+					return false;
+				++i;
+			}
+			else if (arg == "-filter")
+			{
+				if (std::strcmp(value, "box") == 0)
+					options.Filter = MipFilter::Box;
+				else if (std::strcmp(value, "kaiser") == 0)
+					options.Filter = MipFilter::Kaiser;
+				else
+					return false;
+				++i;
+			}
+			else if (arg == "-srgb")
+				options.Srgb = true;
+			else if (arg == "-linear")
+				options.Linear = true;
+			else if (arg == "-nomips")
+				options.Mips = false;
+			else if (arg[0] == '-')
+				return false;
+			else if (!options.Input)
+				options.Input = argv[i];
+			else if (!options.Output)
+				options.Output = argv[i];
+			else
+				return false;
+		}
+		return options.Input && options.Output;
+	}
+
+	bool EndsWith(const std::string& text, const char* suffix)
+	{
+		std::size_t length = std::strlen(suffix);
+		if (text.size() < length)
+			return false;
+
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			char c = text[text.size() - length + i];
+			if (c >= 'A' && c <= 'Z')
+				c = (char)(c - 'A' + 'a');
+			if (c != suffix[i])
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// ---------- load ----------
+	MappedFile file;
+	if (!file.Open(options.Input))
+	{
+		std::fprintf(stderr, "%s: cannot open (error %lu)\n", options.Input, file.LastError());
+		return 1;
+	}
+
+	RgbaImage image;
+	std::string error;
+	bool loaded = EndsWith(options.Input, ".dds")
+		? ReadDdsImage(file.Data(), (std::size_t)file.Size(), image, error)
+		: LoadTga(file.Data(), (std::size_t)file.Size(), image, error);
+	file.Close();
+	if (!loaded || image.Width == 0 || image.Height == 0)
+	{
+		std::fprintf(stderr, "%s: %s\n", options.Input, error.empty() ? "empty image" : error.c_str());
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// ---------- mips ----------
+	const std::uint32_t mipCount = options.Mips ? FullMipCount(image.Width, image.Height) : 1;
+	std::vector<std::vector<std::uint8_t>> texels(mipCount);
+	std::vector<MipImage> mips(mipCount);
+	texels[0] = std::move(image.Rgba);
+	for (std::uint32_t level = 0; level < mipCount; ++level)
+	{
+		mips[level].Width = std::max(image.Width >> level, 1u);
+		mips[level].Height = std::max(image.Height >> level, 1u);
+		mips[level].RowPitch = 4 * (std::size_t)mips[level].Width;
+		if (level > 0)
+			texels[level].resize(mips[level].RowPitch * mips[level].Height);
+		mips[level].Data = texels[level].data();
+	}
+	GenerateMips(MipFormat::RGBA8, options.Filter, !options.Linear, mips.data(), mipCount);
+
+	// ---------- encode ----------
+	std::vector<std::vector<std::uint8_t>> blocks(mipCount);
+	std::vector<DdsLevel> levels(mipCount);
+	BlockFormat blockFormat;
+	const bool compressed = DdsBlockFormat(options.Format, blockFormat);
+	for (std::uint32_t level = 0; level < mipCount; ++level)
+	{
+		if (!compressed)
+		{
+			levels[level].Data = mips[level].Data;
+			levels[level].RowPitch = mips[level].RowPitch;
+			continue;
+		}
+
+		const std::size_t rowBytes = DdsRowBytes(options.Format, mips[level].Width);
+		blocks[level].resize(rowBytes * DdsRowCount(options.Format, mips[level].Height));
+		EncodeBlocks(blockFormat, options.Quality, mips[level].Data, mips[level].RowPitch,
+			mips[level].Width, mips[level].Height, blocks[level].data(), rowBytes);
+
+		levels[level].Data = blocks[level].data();
+		levels[level].RowPitch = rowBytes;
+	}
+
+	// ---------- write ----------
+	if (!WriteDds(options.Output, options.Format, options.Srgb, image.Width, image.Height, levels.data(), mipCount))
+	{
+		std::fprintf(stderr, "%s: cannot write\n", options.Output);
+		return 1;
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::printf("%s: %ux%u, %u mips, %.2f s\n", options.Output, image.Width, image.Height, mipCount, seconds);
+	return 0;
+}